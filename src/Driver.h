@@ -29,6 +29,7 @@
 
 #include "Debug.h"
 #include "Configuration.h"
+#include "mavlink_arena.h"
 
 
 /**
@@ -144,16 +145,26 @@ public:
      * Override this method to send out your own MavLink messages from
      * your driver.
      *
-     * @param msgs - append your message to this vector to send it
+     * @param msgs - pack your messages in to msgs.next() to send them
      * @param uasId - the identifier of this system
      * @param sendRateHz - the number of messages sent/sec.
      * @param msgNumber - the number of messages sent thus far
      *
      **/
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
     {
     };
 
+    /**
+     * Override this method along with sendMavlinkMsg to give the most
+     * messages one call of it writes, the sender's arena is sized from the
+     * sum over all drivers.
+     **/
+    virtual size_t mavlinkMsgCapacity()
+    {
+        return 0;
+    };
+
     /**
      * Utility function for checking if a message should be sent.
      *
@@ -36,6 +36,19 @@ boost::numeric::ublas::matrix<double> EulerAngles::toRotation() const
 }
 
 
+void EulerAngles::toQuaternion(double& w, double& x, double& y, double& z) const
+{
+    const double cr = cos(_rollRad / 2), sr = sin(_rollRad / 2);
+    const double cp = cos(_pitchRad / 2), sp = sin(_pitchRad / 2);
+    const double cy = cos(_yawRad / 2), sy = sin(_yawRad / 2);
+
+    w = cr * cp * cy + sr * sp * sy;
+    x = sr * cp * cy - cr * sp * sy;
+    y = cr * sp * cy + sr * cp * sy;
+    z = cr * cp * sy - sr * sp * cy;
+}
+
+
 /// Adapted from http://ai.stanford.edu/~acoates/quaternion.h
 EulerAngles EulerAngles::fromQuaternion(double w, double x, double y, double z)
 {
@@ -37,6 +37,9 @@ class EulerAngles
 
         static EulerAngles fromQuaternion(double w, double x, double y, double z);
 
+        /// The unit quaternion of these angles, the inverse of fromQuaternion
+        void toQuaternion(double& w, double& x, double& y, double& z) const;
+
         double getRollRad()
         {
             return _rollRad;
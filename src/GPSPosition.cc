@@ -119,6 +119,18 @@ ublas::vector<double> GPSPosition::ned(GPSPosition &origin) const
     return ned;
 }
 
+void GPSPosition::ned(const GPSPosition &origin, double ned[3]) const
+{
+    GeographicLib::LocalCartesian originCoords(origin._latitudeDD, origin._longitudeDD, origin._heightM);
+
+    double x=0, y=0, z=0;
+    originCoords.Forward(_latitudeDD, _longitudeDD, _heightM, x, y, z);
+
+    ned[0] = x;
+    ned[1] = y;
+    ned[2] = -z;
+}
+
 
 std::string GPSPosition::toString() const
 {
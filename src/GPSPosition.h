@@ -66,6 +66,8 @@ class GPSPosition
          * @return a vector of n,e,d
          **/
         ublas::vector<double> ned(GPSPosition &origin) const;
+        /// ned() written in to ned[3], for callers that must not allocate
+        void ned(const GPSPosition &origin, double ned[3]) const;
 
         /// Returns the latitude in decimal degrees
         const double getLatitudeDD(){return _latitudeDD;};
@@ -40,6 +40,7 @@ const std::string XML_TAIL_HUB_OFFSET_Z = XML_ROOT + "tail_hub_offset.z";
 const std::string XML_INERTIA_X = XML_ROOT + "inertia.x";
 const std::string XML_INERTIA_Y = XML_ROOT + "inertia.y";
 const std::string XML_INERTIA_Z = XML_ROOT + "inertia.z";
+const std::string XML_SWASHPLATE = XML_ROOT + "swashplate";
 
 
 
@@ -48,6 +49,10 @@ Helicopter::Helicopter()
     :Logger("Helicopter"),
      radio_cal_data(RadioCalibration::getInstance()),
      out(servo_switch::getInstance()),
+     mixer_generation(0),
+     mixer_dirty(true),
+     swashplate(actuator_mixer::MECHANICAL),
+     cyclic_scale(1),
      mass(13.65),
      gravity(9.8),
      main_hub_offset(3),
@@ -80,6 +85,8 @@ Helicopter::Helicopter()
     set_inertia_y(config->getd(XML_INERTIA_Y, 1.48));
     set_inertia_z(config->getd(XML_INERTIA_Z, 1.21));
 
+    set_swashplate(config->geti(XML_SWASHPLATE, actuator_mixer::MECHANICAL));
+
     writeToSystemState();
 }
 
@@ -97,6 +104,8 @@ const std::string Helicopter::PARAM_INERTIA_X = "J_X";
 const std::string Helicopter::PARAM_INERTIA_Y = "J_Y";
 const std::string Helicopter::PARAM_INERTIA_Z = "J_Z";
 
+const std::string Helicopter::PARAM_SWASHPLATE = "Swashplate";
+
 std::vector<Parameter> Helicopter::getParameters()
 {
     std::vector<Parameter> plist;
@@ -115,10 +124,12 @@ std::vector<Parameter> Helicopter::getParameters()
     plist.push_back(Parameter(PARAM_INERTIA_Y, get_inertia()(1,1), heli::HELICOPTER_ID));
     plist.push_back(Parameter(PARAM_INERTIA_Z, get_inertia()(2,2), heli::HELICOPTER_ID));
 
+    plist.push_back(Parameter(PARAM_SWASHPLATE, swashplate.load(), heli::HELICOPTER_ID));
+
     return plist;
 }
 
-void Helicopter::setParameter(Parameter p)
+bool Helicopter::setParameter(Parameter p)
 {
     std::string param_id(p.getParamID());
     boost::trim(param_id);
@@ -146,11 +157,26 @@ void Helicopter::setParameter(Parameter p)
         set_inertia_y(p.getValue());
     else if (param_id == PARAM_INERTIA_Z)
         set_inertia_z(p.getValue());
+
+    else if (param_id == PARAM_SWASHPLATE)
+    {
+        // a fractional type is rejected rather than truncated to one that was not asked for
+        const int type = static_cast<int>(p.getValue());
+        if (type != p.getValue())
+        {
+            warning() << "Swashplate type must be a whole number, not " << p.getValue();
+            return false;
+        }
+        if (!set_swashplate(type))
+            return false;
+    }
     else
+    {
         debug() << "Helicopter: Received unknown parameter.";
+        return false;
+    }
 
-    saveFile();
-    writeToSystemState();
+    return true;
 }
 
 void Helicopter::saveFile()
@@ -173,6 +199,8 @@ void Helicopter::saveFile()
     config->set(XML_INERTIA_X, std::to_string(inertia(0,0)));
     config->set(XML_INERTIA_Y, std::to_string(inertia(1,1)));
     config->set(XML_INERTIA_Z, std::to_string(inertia(2,2)));
+
+    config->seti(XML_SWASHPLATE, swashplate);
 }
 
 void Helicopter::writeToSystemState()
@@ -186,122 +214,40 @@ void Helicopter::writeToSystemState()
     **/
 }
 
-uint16_t Helicopter::norm2pulse(double norm, std::array<uint16_t, 3> setpoint)
+void Helicopter::configure_mixer()
 {
-    uint16_t pulse = 0;
-    if(setpoint[2] > setpoint[0])
-    {
-        if(norm >= 0)
-            pulse = setpoint[1] + (norm * (setpoint[2] - setpoint[1]));
-        else
-            pulse = setpoint[1] - (norm * (setpoint[0] - setpoint[1]));
-    }
-    else if(setpoint[2] < setpoint[0])
-    {
-        if(norm >= 0)
-            pulse = setpoint[1] - (norm * (setpoint[1] - setpoint[2]));
-        else
-            pulse = setpoint[1] + (norm * (setpoint[1] - setpoint[0]));
-    }
-    return pulse;
+    actuator_mixer::calibration cal;
+    cal.aileron = radio_cal_data->getAileron();
+    cal.elevator = radio_cal_data->getElevator();
+    cal.throttle = radio_cal_data->getThrottle();
+    cal.rudder = radio_cal_data->getRudder();
+    cal.gyro = radio_cal_data->getGyro();
+    cal.pitch = radio_cal_data->getPitch();
+
+    mixer_generation = radio_cal_data->generation();
+    mixer.configure(static_cast<actuator_mixer::swashplate_type>(swashplate.load()), cal);
 }
 
-uint16_t Helicopter::norm2pulse(double norm, std::array<uint16_t, 2> setpoint)
+void Helicopter::setScaled(const actuator_mixer::input& norm, actuator_mixer::output& pulse)
 {
-    uint16_t pulse = 0;
-    {
-        if(norm == 0)
-            pulse = setpoint[0];
-        else
-            pulse = setpoint[1];
-    }
-    return pulse;
+    if (mixer_dirty.exchange(false) || mixer_generation != radio_cal_data->generation())
+        configure_mixer();
+
+    cyclic_scale = mixer(norm, pulse);
+    out->setRaw(pulse);
 }
 
-// FIXME - the complexity of this is huge, the magic numbers  don't help. - Joseph
-uint16_t Helicopter::norm2pulse(double norm, std::array<uint16_t, 5> setpoint)
+bool Helicopter::set_swashplate(int type)
 {
-    uint16_t pulse = 1;
-    if(setpoint[4] > setpoint[0])
-    {
-        if(norm <= 0.25 && norm >= 0)
-            pulse = (norm/0.25) * (setpoint[1] - setpoint[0]) + setpoint[0];
-        else if(norm <= 0.50 && norm > 0.25)
-            pulse = ((norm - 0.25)/0.25) * (setpoint[2] - setpoint[1]) + setpoint[1];
-        else if(norm <= 0.75 && norm > 0.50)
-            pulse = ((norm - 0.50)/0.25) * (setpoint[3] - setpoint[2]) + setpoint[2];
-        else if(norm <= 1.0 && norm > 0.75)
-            pulse = ((norm - 0.75)/0.25) * (setpoint[4] - setpoint[3]) + setpoint[3];
-    }
-    else if(setpoint[4] < setpoint[0])
+    if (type < actuator_mixer::MECHANICAL || type >= actuator_mixer::SWASHPLATE_TYPES)
     {
-        if(norm <= 0.25 && norm >= 0)
-            pulse = setpoint[0] - (norm/0.25) * (setpoint[0] - setpoint[1]);
-        else if(norm <= 0.50 && norm > 0.25)
-            pulse = setpoint[1] - ((norm - 0.25)/0.25) * (setpoint[1] - setpoint[2]);
-        else if(norm <= 0.75 && norm > 0.50)
-            pulse = setpoint[2] - ((norm - 0.50)/0.25) * (setpoint[2] - setpoint[3]);
-        else if(norm <= 1.0 && norm > 0.75)
-            pulse = setpoint[3] - ((norm - 0.75)/0.25) * (setpoint[3] - setpoint[4]);
+        warning() << "Unknown swashplate type " << type;
+        return false;
     }
-    return pulse;
-}
-
-std::vector<uint16_t> Helicopter::setScaled(std::vector<double> norm)
-{
-    std::vector<uint16_t> pulse(6);
-
-    pulse[AILERON] = setAileron(norm[0]);
-    pulse[ELEVATOR] = setElevator(norm[1]);
-    pulse[THROTTLE] = setThrottle(norm[2]);
-    pulse[RUDDER] = setRudder(norm[3]);
-    pulse[GYRO] = setGyro(norm[4]);
-    pulse[PITCH] = setPitch(norm[5]);
-
-    return pulse;
-}
-
-// FIXME these look like they might be able to be made in to templates - Joseph
-uint16_t Helicopter::setAileron(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getAileron());
-    out->setRaw(heli::CH1, pulse);
-    return pulse;
-}
-
-uint16_t Helicopter::setElevator(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getElevator());
-    out->setRaw(heli::CH2, pulse);
-    return pulse;
-}
-
-uint16_t Helicopter::setThrottle(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getThrottle());
-    out->setRaw(heli::CH3, pulse);
-    return pulse;
-}
-
-uint16_t Helicopter::setRudder(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getRudder());
-    out->setRaw(heli::CH4, pulse);
-    return pulse;
-}
-
-uint16_t Helicopter::setGyro(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getGyro());
-    out->setRaw(heli::CH5, pulse);
-    return pulse;
-}
-
-uint16_t Helicopter::setPitch(double norm)
-{
-    uint16_t pulse = norm2pulse(norm, radio_cal_data->getPitch());
-    out->setRaw(heli::CH6, pulse);
-    return pulse;
+    swashplate = type;
+    mixer_dirty = true;
+    message() << "Swashplate set to " << type;
+    return true;
 }
 
 double Helicopter::get_main_collective() const
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <atomic>
 //#include <thread>
 
 /* Boost Headers */
@@ -34,6 +35,7 @@ namespace blas = boost::numeric::ublas;
 /* Project Headers */
 #include <servo_switch.h>
 #include "RadioCalibration.h"
+#include "actuator_mixer.h"
 #include "RCTrans.h"
 #include "heli.h"
 #include "Parameter.h"
@@ -61,46 +63,28 @@ public:
      */
     void writeToSystemState();
 
-    /** Returns Aileron channel pulse value derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setAileron(double norm);
-    /** Returns Elevator channel pulse value derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setElevator(double norm);
-    /** Returns "Throttle" channel pulse value derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setThrottle(double norm);
-    /** Returns pulse value on channel controlling Rudder, which is derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setRudder(double norm);
-    /** Returns Gyro channel's pulse value on channel controlling Rudder, which is derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setGyro(double norm);
-    /** Returns Collective Pitch pulse value derived from scaled pulse
-    	@param norm scaled value of pulse
-    	@return pulse pulse value from value scaled with respect to Radio calibration end-points.
-    	*/
-    uint16_t setPitch(double norm);
+    /**
+     * Mix and scale normalized commands to pulse widths and send them to the servo board.
+     * The mixer is rebuilt here (in the calling thread) if the calibration or swashplate changed.
+     * @param norm scaled values for all 6 channels
+     * @param pulse filled in place with the pulse widths for all 6 channels
+     */
+    void setScaled(const actuator_mixer::input& norm, actuator_mixer::output& pulse);
+    /// same as above for any container of (at least) 6 scaled values
+    template <typename ContainerType>
+    void setScaled(const ContainerType& norm, actuator_mixer::output& pulse)
+    {
+        actuator_mixer::input in;
+        for (int i = 0; i < actuator_mixer::CHANNELS; ++i)
+            in[i] = norm[i];
+        setScaled(in, pulse);
+    }
 
-    /** @param norm vector of scaled pulse values for all 6 channels
-     	   @return pulse vector of de-normalized pulse values for all 6 channels */
-    std::vector<uint16_t> setScaled(blas::vector<double> norm)
+    /// @returns the factor applied to the cyclic on the last call to setScaled (1 when not saturated)
+    double get_cyclic_scale() const
     {
-        return setScaled(std::vector<double>(norm.begin(), norm.end()));
+        return cyclic_scale;
     }
-    /** @param norm vector of scaled pulse values for all 6 channels
-     	   @return pulse vector of de-normalized pulse values for all 6 channels */
-    std::vector<uint16_t> setScaled(std::vector<double> norm);
 
     /// get the helicopter's mass
     double get_mass() const
@@ -134,8 +118,10 @@ public:
 
     /// get a list of helicopter parameters
     std::vector<Parameter> getParameters();
-    /// set a parameter value
-    void setParameter(Parameter p);
+    /// set a parameter value without saving it, @returns false if it is unknown or out of range
+    bool setParameter(Parameter p);
+    /// Save the configuration to the file heli::physical_param_filename
+    void saveFile();
 
     static const std::string PARAM_MASS;
 
@@ -151,6 +137,8 @@ public:
     static const std::string PARAM_INERTIA_Y;
     static const std::string PARAM_INERTIA_Z;
 
+    static const std::string PARAM_SWASHPLATE;
+
     double get_main_collective() const;
 
 private:
@@ -163,32 +151,19 @@ private:
     /// Pointer to an instance of servo_switch to output the channel values.
     servo_switch *out;
 
-    /** Returns a pulse value from a scaled value, with respect to 2 Radio calibration end-points.
-        @param norm the scaled pulse value
-        @param setpoint an array that stores the calibrated end point pulse values of the Radio
-        @return pulse pulse value derived from the scaled value with respect to end points */
-    uint16_t norm2pulse(double norm, std::array<uint16_t, 2> setpoint);
-    /** Returns a pulse value from a scaled value, with respect to 3 Radio calibration end-points.
-        @param norm the scaled pulse value
-        @param setpoint an array that stores the calibrated end point pulse values of the Radio
-        @return pulse pulse value derived from the scaled value with respect to end points */
-    uint16_t norm2pulse(double norm, std::array<uint16_t, 3> setpoint);
-    /** Returns a pulse value from a scaled value, with respect to 5 Radio calibration end-points.
-        @param norm the scaled pulse value
-        @param setpoint an array that stores the calibrated end point pulse values of the Radio
-        @return pulse pulse value derived from the scaled value with respect to end points */
-    uint16_t norm2pulse(double norm, std::array<uint16_t, 5> setpoint);
-
-    /// List provides index to channel mapping for the Helicopter::getScaledPulses function.
-    enum RadioElement
-    {
-        AILERON = 0,
-        ELEVATOR,
-        THROTTLE,
-        RUDDER,
-        GYRO,
-        PITCH
-    };
+    /// maps normalized commands to pulses, only used from the thread calling setScaled
+    actuator_mixer mixer;
+    /// calibration generation the mixer was built from
+    uint32_t mixer_generation;
+    /// set when the swashplate type changes
+    std::atomic_bool mixer_dirty;
+    /// swashplate type (see actuator_mixer::swashplate_type)
+    std::atomic<int> swashplate;
+    /// rebuild the mixer from the current calibration
+    void configure_mixer();
+    std::atomic<double> cyclic_scale;
+    /// set the swashplate type, @returns false if it is not a known type
+    bool set_swashplate(int type);
 
     /// helicopter mass (kg)
     double mass;
@@ -320,9 +295,6 @@ private:
         }
         message() << "Inertia z set to " << jz;
     }
-
-    /// Save the configuration to the file heli::physical_param_filename
-    void saveFile();
 };
 
 #endif // HELICOPTER_H
@@ -22,6 +22,13 @@
 #include "LogFile.h"
 #include "Debug.h"
 #include "LogFileWriter.h"
+#include "Configuration.h"
+#include "ParameterTable.h"
+#include "heli.h"
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 // System Headers
 #include <iostream>
@@ -48,6 +55,11 @@ void LogFile::newLogPoint()
     setupLogFolder();
 }
 
+void LogFile::sync()
+{
+    LogfileWriter::syncAll();
+}
+
 
 void LogFile::setupLogFolder()
 {
@@ -76,6 +88,113 @@ void LogFile::logHeader(const std::string& name, const std::string& header)
     LogfileWriter::getLogger(name)->setHeader(header);
 }
 
+LogfileWriter* LogFile::getWriter(const std::string& name)
+{
+    return LogfileWriter::getLogger(name);
+}
+
+log_decimator& LogFile::getDecimator(LogfileWriter* writer)
+{
+    return writer->getDecimator();
+}
+
+void LogFile::writeRow(LogfileWriter* writer, const std::string& row)
+{
+    writer->logPolicyHeader();
+
+    std::stringstream dataStr;
+
+    dataStr << getMicrosSinceInit() << '\t';
+    dataStr << row;
+    dataStr << std::endl;
+
+    writer->log(dataStr.str());
+}
+
+std::vector<Parameter> LogFile::getParameters()
+{
+    std::vector<Parameter> plist;
+
+    const std::vector<std::string> channels = LogfileWriter::policyChannels();
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        const log_decimator& decimator = LogfileWriter::getLogger(channels[i])->getDecimator();
+        const std::string prefix = "LOG" + std::to_string(i) + "_";
+        plist.push_back(Parameter(prefix + "MODE", decimator.get_mode(), heli::LOGGER_ID));
+        plist.push_back(Parameter(prefix + "N", decimator.get_n(), heli::LOGGER_ID));
+        plist.push_back(Parameter(prefix + "PERIOD", decimator.get_period(), heli::LOGGER_ID));
+    }
+
+    return plist;
+}
+
+bool LogFile::setParameter(const Parameter& p)
+{
+    std::string param_id(p.getParamID());
+    boost::trim(param_id);
+
+    const size_t underscore = param_id.find('_');
+    if (param_id.compare(0, 3, "LOG") != 0 || underscore == std::string::npos)
+        return false;
+
+    size_t index = 0;
+    try
+    {
+        index = boost::lexical_cast<size_t>(param_id.substr(3, underscore - 3));
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        return false;
+    }
+    const std::string field = param_id.substr(underscore + 1);
+
+    const std::vector<std::string> channels = LogfileWriter::policyChannels();
+    if (index >= channels.size())
+        return false;
+
+    log_decimator& decimator = LogfileWriter::getLogger(channels[index])->getDecimator();
+
+    // the decimator rounds and clamps, so the table gets what it kept
+    float kept = 0;
+    if (field == "MODE")
+    {
+        const log_decimator::mode m = static_cast<log_decimator::mode>(static_cast<int>(p.getValue()));
+        decimator.set_mode(m);
+        kept = decimator.get_mode();
+    }
+    else if (field == "N")
+    {
+        decimator.set_n(static_cast<uint32_t>(p.getValue()));
+        kept = decimator.get_n();
+    }
+    else if (field == "PERIOD")
+    {
+        decimator.set_period(p.getValue());
+        kept = decimator.get_period();
+    }
+    else
+    {
+        return false;
+    }
+
+    ParameterTable::getInstance()->changed(heli::LOGGER_ID, p.getParamID().c_str(), kept);
+    return true;
+}
+
+void LogFile::saveFile()
+{
+    Configuration* config = Configuration::getInstance();
+
+    for (const std::string& channel : LogfileWriter::policyChannels())
+    {
+        const log_decimator& decimator = LogfileWriter::getLogger(channel)->getDecimator();
+        const std::string key = LogfileWriter::policyKey(channel);
+        config->set(key + ".mode", log_decimator::mode_name(decimator.get_mode()));
+        config->seti(key + ".n", decimator.get_n());
+        config->setd(key + ".period_seconds", decimator.get_period());
+    }
+}
+
 void LogFile::logMessage(const std::string& name, const std::string& msg)
 {
     std::stringstream dataStr;
@@ -28,6 +28,7 @@
 #include <chrono>
 #include <mutex>
 #include <atomic>
+#include <vector>
 
 /* c headers */
 #include <stdint.h>
@@ -37,6 +38,10 @@
 #include "ThreadSafeVariable.h"
 #include "Singleton.h"
 #include "Path.h"
+#include "Parameter.h"
+#include "log_decimator.h"
+
+class LogfileWriter;
 
 /**
    \brief This class implements the logging facility for the avionics.
@@ -99,6 +104,12 @@
 	}
    \endcode
 
+   Logs named in log.policies are thinned before they are formatted by the
+   log_decimator set up from log.policy.<name>: every row, every nth row or
+   a min/max/mean/last summary per period.  Those policies are the LOG<i>_MODE,
+   LOG<i>_N and LOG<i>_PERIOD parameters so they can be changed from the
+   ground station.
+
    \todo Add the ability to set a base directory
  */
 
@@ -134,14 +145,46 @@ public:
      */
     void newLogPoint();
 
+    /**
+     * Ask every log file to make what it has written durable, used on mode
+     * changes so the lead up to them survives a power cut.
+     */
+    void sync();
+
     Path getLogFolder()
     {
         std::lock_guard<std::mutex> lg(_logFolderLock);
         return log_folder;
     }
 
+    /// the policy of each log in log.policies
+    std::vector<Parameter> getParameters();
+    /// change a policy, @returns false if p is not one of getParameters()
+    bool setParameter(const Parameter& p);
+    /// save every policy to the configuration
+    void saveFile();
+
 private:
 
+    static LogfileWriter* getWriter(const std::string& name);
+    static log_decimator& getDecimator(LogfileWriter* writer);
+    /// timestamp row and hand it to writer, after the policy's header if it changed
+    void writeRow(LogfileWriter* writer, const std::string& row);
+
+    template<typename InputIterator>
+    static std::string formatRow(InputIterator first, InputIterator last)
+    {
+        std::stringstream output;
+
+        for (InputIterator it = first; it != last; ++it)
+        {
+            output << std::to_string(*it);
+            output << '\t';
+        }
+
+        return output.str();
+    }
+
     long getMicrosSinceInit()
     {
         return std::chrono::duration_cast<std::chrono::microseconds>(
@@ -172,15 +215,28 @@ private:
 template<typename DataContainer>
 void LogFile::logData(const std::string& name, const DataContainer& data)
 {
-    std::stringstream output;
+    LogfileWriter* writer = getWriter(name);
+    log_decimator& decimator = getDecimator(writer);
+
+    // the cost of logging is measured on a sample of the calls
+    const bool timed = decimator.sample_producer();
+    const log_decimator::clock::time_point start = timed ? log_decimator::clock::now() : log_decimator::clock::time_point();
 
-    for (typename DataContainer::const_iterator it = data.begin(); it != data.end(); ++it)
+    static thread_local std::vector<double> summary;
+    switch (decimator.admit(data.begin(), data.end(), summary))
     {
-        output << std::to_string(*it);
-        output << '\t';
+    case log_decimator::RAW:
+        writeRow(writer, formatRow(data.begin(), data.end()));
+        break;
+    case log_decimator::SUMMARY:
+        writeRow(writer, formatRow(summary.begin(), summary.end()));
+        break;
+    case log_decimator::SKIP:
+        break;
     }
 
-    logMessage(name, output.str()); // adds timestamp, endline
+    if (timed)
+        decimator.add_producer_time(log_decimator::clock::now() - start);
 };
 
 
@@ -19,16 +19,24 @@
 
 #include "LogFileWriter.h"
 #include "RateLimiter.h"
+#include "Configuration.h"
+#include "deadline_watchdog.h"
 
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <chrono>
 #include <exception>
 #include <iostream>
-#include <fstream>
 #include <thread>
 
 
 // static members
 std::map<std::string, LogfileWriter*> LogfileWriter::_ALL_LOGGERS;
 std::recursive_mutex LogfileWriter::_ALL_LOGGERS_MUTEX;
+std::atomic<uint32_t> LogfileWriter::_syncRequests(0);
+
+const std::string LogfileWriter::LOG_WRITE_LATENCY = "Log Write Latency";
 
 
 LogfileWriter* LogfileWriter::getLogger(const std::string& path)
@@ -54,11 +62,15 @@ LogfileWriter* LogfileWriter::getLogger(const std::string& path)
 
 
 LogfileWriter::LogfileWriter(std::string path)
-    :Driver("LogFile", "log")
+    :Driver("LogFile", "log"),
+     _headerGeneration(0)
 {
     _logName = path;
     _currentBuffer = &_firstBuffer;
 
+    configurePolicy();
+    _headerGeneration = _decimator.generation();
+
     //debug() << "Created for " << path;
 
     // all logging write threads will die when the software shuts down.
@@ -112,35 +124,185 @@ void LogfileWriter::log(const std::string& message)
     *_currentBuffer << message;
 }
 
+std::vector<std::string> LogfileWriter::policyChannels()
+{
+    Configuration* config = Configuration::getInstance();
+    config->describe("log.policies",
+                     "comma separated list of log names",
+                     "Logs that are not written at full rate, each is set up under log.policy.");
+
+    std::vector<std::string> channels;
+    boost::split(channels, config->gets("log.policies", ""), boost::is_any_of(","));
+    for (std::string& channel : channels)
+        boost::algorithm::trim(channel);
+    channels.erase(std::remove(channels.begin(), channels.end(), std::string()), channels.end());
+    return channels;
+}
+
+std::string LogfileWriter::policyKey(const std::string& channel)
+{
+    // log names have spaces and punctuation, configuration keys do not
+    std::string key = channel;
+    for (char& c : key)
+    {
+        if (! isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+    }
+    if (key.empty() || isdigit(static_cast<unsigned char>(key[0])))
+        key = "_" + key;
+    return "log.policy." + key;
+}
+
+void LogfileWriter::configurePolicy()
+{
+    const std::vector<std::string> channels = policyChannels();
+    if (std::find(channels.begin(), channels.end(), _logName) == channels.end())
+        return;
+
+    Configuration* config = Configuration::getInstance();
+    const std::string key = policyKey(_logName);
+
+    config->describe(key + ".mode",
+                     "full/nth/aggregate",
+                     "Write every row, every nth row or a summary of each period.");
+    config->describe(key + ".n",
+                     ">= 1",
+                     "Rows kept in nth mode are one in n.");
+    config->describe(key + ".period_seconds",
+                     "> 0",
+                     "Time each summary row covers in aggregate mode.",
+                     "seconds");
+    config->describe(key + ".aggregates",
+                     "comma separated list of min, max, mean, last",
+                     "What a summary row has for each column in aggregate mode.");
+
+    _decimator.set_n(config->geti(key + ".n", 1));
+    _decimator.set_period(config->getd(key + ".period_seconds", 1));
+    _decimator.set_aggregates(log_decimator::parse_aggregates(config->gets(key + ".aggregates", "min,max,mean,last")));
+    _decimator.set_mode(log_decimator::parse_mode(config->gets(key + ".mode", "full")));
+
+    info() << _logName << " is logged at " << _decimator.describe();
+}
+
+void LogfileWriter::logPolicyHeader()
+{
+    const uint32_t generation = _decimator.generation();
+    if (_headerGeneration.exchange(generation) != generation)
+    {
+        log("Time(micros)\t" + _decimator.header(_header) + "\n");
+    }
+}
+
+log_segment_writer::options LogfileWriter::segmentOptions()
+{
+    log_segment_writer::options opts;
+
+    configDescribe("segment_megabytes",
+                   "0 - 2047",
+                   "Size log files are split at, 0 for one file per channel.",
+                   "MiB");
+    opts.segment_bytes = static_cast<size_t>(std::max(0, configGeti("segment_megabytes", 64))) * 1024 * 1024;
+
+    configDescribe("preallocate",
+                   "true/false",
+                   "Allocate each segment up front so writes do not wait on the filesystem.");
+    opts.preallocate = configGetb("preallocate", true);
+
+    configDescribe("direct_io",
+                   "true/false",
+                   "Write around the page cache with O_DIRECT.");
+    opts.direct = configGetb("direct_io", false);
+
+    configDescribe("sync",
+                   "comma separated list of segment, periodic, requested",
+                   "When logs are flushed to disk: as each segment is finished, every sync_seconds and/or on mode changes.");
+    opts.sync = log_segment_writer::parse_sync_policy(configGets("sync", "segment,periodic,requested"));
+
+    configDescribe("sync_seconds",
+                   "> 0",
+                   "Time between periodic syncs, the most a power cut should lose.",
+                   "seconds");
+    opts.sync_seconds = configGetd("sync_seconds", 5);
+
+    return opts;
+}
+
 void LogfileWriter::writeThread()
 {
     RateLimiter rl(2);
 
+    const log_segment_writer::options opts = segmentOptions();
+    configDescribe("latency_report_seconds",
+                   "> 0",
+                   "Time between reports of each log's write latency.",
+                   "seconds");
+    const std::chrono::steady_clock::duration report_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(configGetd("latency_report_seconds", 10)));
+
+    const std::string watchdog_name = "Log " + _logName;
+
+    if (_logName == LOG_WRITE_LATENCY)
+        setHeader("Channel P50_us P99_us Max_us At_Risk_Bytes Segments Bytes_Per_Hour Producer_us_Per_s Policy");
+
     while(! terminateRequested())
     {
         Path filename = getLogPath();
-        bool existed = filename.exists();
 
-        std::fstream output(filename.c_str(), std::fstream::out | std::fstream::ate | std::fstream::app);
-
-        if(! existed)
+        if(! filename.exists())
         {
             info() << "Creating log file " << filename.c_str();
-            std::string header = _header;
-            output << "Time(micros)\t" << header << std::endl;
         }
 
-        while(! terminateRequested() && filename.exists())
+        std::string header = _header;
+        log_segment_writer output(filename.toString(), opts, "Time(micros)\t" + _decimator.header(header) + "\n");
+        uint32_t syncs = _syncRequests;
+        std::chrono::steady_clock::time_point next_report = std::chrono::steady_clock::now() + report_period;
+        uint64_t reported_bytes = output.accepted();
+        uint64_t reported_producer_ns = _decimator.producer_ns();
+
+        // start over when a new log point moves the folder or the file is removed
+        while(! terminateRequested() && filename.toString() == getLogPath().toString()
+                && Path(output.segment_path()).exists())
         {
             rl.wait();
+            deadline_watchdog::check_in(watchdog_name.c_str(), std::chrono::milliseconds(500));
 
             std::stringstream* writeBuffer = swapBuffers();
-            output << writeBuffer->str();
+            header = _header;
+            output.set_header("Time(micros)\t" + _decimator.header(header) + "\n");
+            if (! output.write(writeBuffer->str()))
+            {
+                warning() << "Could not write to " << output.segment_path();
+            }
             writeBuffer->str("");
 
-            rl.finishedCriticalSection();
+            if (syncs != _syncRequests)
+            {
+                syncs = _syncRequests;
+                output.sync_requested();
+            }
+
+            if (std::chrono::steady_clock::now() >= next_report && _logName != LOG_WRITE_LATENCY)
+            {
+                next_report += report_period;
+
+                const double period_s = std::chrono::duration<double>(report_period).count();
+                const uint64_t producer_ns = _decimator.producer_ns();
 
-            filename = getLogPath();
+                std::stringstream report;
+                report << _logName << '\t' << output.latency_percentile(0.5) << '\t' << output.latency_percentile(0.99)
+                       << '\t' << output.latency_max() << '\t' << (output.accepted() - output.durable())
+                       << '\t' << output.segments()
+                       << '\t' << static_cast<uint64_t>((output.accepted() - reported_bytes) * 3600 / period_s)
+                       << '\t' << (producer_ns - reported_producer_ns) / 1e3 / period_s
+                       << '\t' << _decimator.describe();
+                output.clear_latency();
+                reported_bytes = output.accepted();
+                reported_producer_ns = producer_ns;
+                LogFile::getInstance()->logMessage(LOG_WRITE_LATENCY, report.str());
+            }
+
+            rl.finishedCriticalSection();
         }
 
         output.close();
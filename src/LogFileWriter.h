@@ -24,16 +24,27 @@
 #include "LogFile.h"
 #include "ThreadSafeVariable.h"
 #include "Path.h"
+#include "log_segment_writer.h"
+#include "log_decimator.h"
 
+#include <atomic>
 #include <sstream>
 #include <map>
 #include <string>
 #include <mutex>
+#include <vector>
 
 
 /**
  * A basic file writer that accepts strings and writes them
  * to a file periodically.
+ *
+ * The file is written through a log_segment_writer configured by the log
+ * section: it is split in to log.segment_megabytes segments, preallocated
+ * and synced according to log.sync.  Each writer reports its write latency
+ * percentiles and the bytes a power cut would lose to LOG_WRITE_LATENCY,
+ * along with the bytes it writes per hour and the time the threads logging
+ * to it spend on its policy and formatting.
  */
 class LogfileWriter : public Driver
 {
@@ -56,13 +67,47 @@ private:
     /// a function that writes the buffers out.
     void writeThread();
 
+    /// read the segment options from the configuration
+    log_segment_writer::options segmentOptions();
+
+    /// incremented by syncAll()
+    static std::atomic<uint32_t> _syncRequests;
+
+    log_decimator _decimator;
+    /// the decimator generation whose header was last written
+    std::atomic<uint32_t> _headerGeneration;
+
+    /// set up the decimator from log.policy.<name> if this log is in log.policies
+    void configurePolicy();
+
 
     LogfileWriter(std::string path);
     ~LogfileWriter();
 public:
+    static const std::string LOG_WRITE_LATENCY;
+
     static LogfileWriter* getLogger(const std::string& path);
 
+    /// ask every writer to make its data durable, if log.sync includes "requested"
+    static void syncAll()
+    {
+        ++_syncRequests;
+    }
+
+    /// the logs listed in log.policies
+    static std::vector<std::string> policyChannels();
+    /// the configuration key of a log's policy
+    static std::string policyKey(const std::string& channel);
+
     void log(const std::string& message);
+
+    /// write the column names of the current policy if it changed since the last call
+    void logPolicyHeader();
+
+    log_decimator& getDecimator()
+    {
+        return _decimator;
+    }
     void setHeader(const std::string& header)
     {
         _header = header;
@@ -39,17 +39,40 @@
 #include "Linux.h"
 #include "SystemState.h"
 #include "CommonMessages.h"
+#include "ParameterTable.h"
 #include "WaypointManager.h"
 #include "ExternalMavlink.h"
 #include "FakeRc.h"
+#include "Watchdog.h"
+#include "SensorStream.h"
+#include "deadline_watchdog.h"
+#include "host_self_test.h"
+#include "Configuration.h"
+#include "frame_trigger.h"
+
+/* STL Headers */
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+
+/* System Headers */
+#include <unistd.h>
 
 const std::string MainApp::LOG_SCALED_INPUTS = "Scaled Inputs";
+const std::string MainApp::LOG_MAIN_LOOP_PHASES = "Main Loop Phases";
+const std::string MainApp::LOG_MODES = "Autopilot Modes";
+const int MainApp::MAIN_LOOP_HZ;
 
 MainApp::MainApp()
     :Logger("MainApp"),
      autopilot_mode(heli::MODE_AUTOMATIC_CONTROL)
 {
     this->_terminate = false;
+    this->_selfTestBlocksAutomatic = false;
 }
 
 void MainApp::run()
@@ -65,12 +88,36 @@ void MainApp::run()
     });
 
     /* Construct components of the autopilot */
+    message() << "Setting up watchdog";
+    Watchdog::getInstance()->failsafe.connect([](const std::string& thread)
+    {
+        MainApp::getInstance()->warning() << thread << " stalled, switching to direct manual";
+        MainApp::request_mode(heli::MODE_DIRECT_MANUAL);
+    });
+
+    // before the drivers so the serial ports are free and the host is quiet
+    Configuration* config = Configuration::getInstance();
+    config->describe("self_test.enable", "true/false", "Measure the host against the self_test limits at startup.");
+    config->describe("self_test.block_automatic", "true/false", "Stay out of automatic control if the self test fails.");
+    if (config->getb("self_test.enable", false) && ! selfTest())
+    {
+        critical() << "Self test failed, see self_test.txt in the log folder";
+        _selfTestBlocksAutomatic = config->getb("self_test.block_automatic", false);
+    }
+
+    config->describe("main_loop.rc_trigger", "true/false",
+                     "In manual and mixed modes start a tick as each frame of pilot inputs arrives, the timer fills in between frames.");
+    const bool rcTrigger = config->getb("main_loop.rc_trigger", false);
+
     message() << "Setting up waypoint manager";
     WaypointManager::getInstance();
 
     message() << "Setting up system state object";
     SystemState* systemState = SystemState::getInstance();
 
+    message() << "Setting up sensor stream";
+    SensorStream::getInstance();
+
     message() << "Setting up common messages";
     CommonMessages::getInstance();
 
@@ -100,6 +147,22 @@ void MainApp::run()
     message() << "Setting up control";
     Control* control = Control::getInstance();
 
+    message() << "Indexing parameters";
+    ParameterTable* parameters = ParameterTable::getInstance();
+    parameters->add_component(heli::CONTROLLER_ID,
+                              [control](){ return control->getParameters(); },
+                              [control](const Parameter& p){ return control->setParameter(p); },
+                              [control](){ control->saveFile(); });
+    parameters->add_component(heli::HELICOPTER_ID,
+                              [bergen](){ return bergen->getParameters(); },
+                              [bergen](const Parameter& p){ return bergen->setParameter(p); },
+                              [bergen](){ bergen->saveFile(); });
+    parameters->add_component(heli::LOGGER_ID,
+                              [log](){ return log->getParameters(); },
+                              [log](const Parameter& p){ return log->setParameter(p); },
+                              [log](){ log->saveFile(); });
+    parameters->build();
+
     message() << "Setting up Linux CPU Reader";
     Linux::getInstance();
 
@@ -113,12 +176,10 @@ void MainApp::run()
     control->mode_changed(control->get_controller_mode());
     GPS::getInstance();
 
-    using std::vector;
-    vector<uint16_t> inputMicros(6);
-    vector<double> inputScaled(6);
+    actuator_mixer::output outputMicros;
 
     // Set default autopilot mode
-    autopilot_mode = heli::MODE_AUTOMATIC_CONTROL;
+    autopilot_mode = _selfTestBlocksAutomatic ? heli::MODE_DIRECT_MANUAL : heli::MODE_AUTOMATIC_CONTROL;
     mode_changed(autopilot_mode);
 
     uint16_t ch7PulseWidthLast = 1000;
@@ -127,20 +188,55 @@ void MainApp::run()
     boost::signals2::scoped_connection pilot_connection(servo_board->pilot_mode_changed.connect(
                 boost::bind(&MainApp::change_pilot_mode, this, _1)));
 
+    log->logHeader(LOG_SCALED_INPUTS, "CH1 CH2 CH3 CH4 CH5 CH6");
+    log->logHeader(LOG_MODES, "Autopilot_Mode Pilot_Mode");
+    logModes();
+
+    std::string phasesHeader("Ticks");
+    for (int p = 0; p < tick_profiler::PHASES; p++)
+    {
+        const std::string name(tick_profiler::name(static_cast<tick_profiler::phase>(p)));
+        phasesHeader += " " + name + "_p50_us " + name + "_p99_us " + name + "_max_us";
+    }
+    log->logHeader(LOG_MAIN_LOOP_PHASES, phasesHeader);
+
     message() << "Started main loop";
-    RateLimiter rl(100, true); // 100 times a second and report percent of time used.
+    RateLimiter rl(MAIN_LOOP_HZ, true); // report percent of time used.
+    frame_trigger trigger(std::chrono::milliseconds(1000 / MAIN_LOOP_HZ));
+    // frame triggered ticks may be up to a period and a half apart
+    const std::chrono::milliseconds tickBudget((rcTrigger ? 1500 : 1000) / MAIN_LOOP_HZ);
+    tick_profiler profile;
+    int profiledTicks = 0;
+    RCTrans::pilot_inputs pilot = RCTrans::getInputs();
 
     while(! _terminate.load())
     {
-
-        /* Dequeue messages & pulses on a channel with MsgReceivev(). Threads Receive-block & queue on channel for a msg/pulse to arrive.  */
-        float amt = rl.wait();
-        info() << "used " << amt << "time";
+        float amt = 0;
+        if (rcTrigger && pilotInLoop())
+        {
+            // a frame of pilot inputs starts the tick, the timer fills in between
+            // frames; the load is taken before waiting so it is the busy fraction
+            amt = rl.busy();
+            std::this_thread::sleep_until(trigger.earliest());
+            RCTrans::waitForFrame(pilot.frame, trigger.deadline());
+            rl.restart();
+        }
+        else
+        {
+            amt = rl.wait();
+        }
+        profile.begin_tick();
+        deadline_watchdog::check_in("Main loop", tickBudget);
         systemState->main_loop_load.set(amt, 0);
+        systemState->select_sources();
+        profile.lap(tick_profiler::SELECT);
 
+        // every use of the pilot inputs this tick sees the same frame
+        pilot = RCTrans::getInputs();
+        trigger.started(std::chrono::steady_clock::now(), pilot.received);
 
         // Pilot Flight log marker.
-        ch7PulseWidth = servo_board->getRaw(heli::CH7);
+        ch7PulseWidth = pilot.pulse[heli::CH7];
         if(ch7PulseWidth - ch7PulseWidthLast > 500)
         {
             log->logData("Flight log marker", std::vector<uint16_t>());
@@ -150,21 +246,23 @@ void MainApp::run()
         {
             ch7PulseWidthLast = ch7PulseWidth;
         }
+        profile.lap(tick_profiler::RC);
 
-
-        inputScaled = RCTrans::getScaledVector();
-        log->logHeader(LOG_SCALED_INPUTS, "CH1 CH2 CH3 CH4 CH5 CH6");
-        log->logData(LOG_SCALED_INPUTS, inputScaled);
+        log->logData(LOG_SCALED_INPUTS, pilot.scaled);
+        profile.lap(tick_profiler::LOG);
 
         switch(autopilot_mode.load())
         {
         case heli::MODE_DIRECT_MANUAL:
-            inputMicros = servo_board->getRaw();
-            servo_board->setRaw(inputMicros);
+            servo_board->setOutputSource(pilot.received);
+            servo_board->setRaw(pilot.pulse);
+            profile.lap(tick_profiler::MIX);
             break;
 
         case heli::MODE_SCALED_MANUAL:
-            bergen->setScaled(inputScaled);
+            servo_board->setOutputSource(pilot.received);
+            bergen->setScaled(pilot.scaled, outputMicros);
+            profile.lap(tick_profiler::MIX);
             break;
 
         case heli::MODE_AUTOMATIC_CONTROL:
@@ -174,7 +272,11 @@ void MainApp::run()
                 try
                 {
                     (*control)();
-                    bergen->setScaled(control->get_control_effort());
+                    profile.lap(tick_profiler::CONTROL);
+                    if (control->mixes_pilot())
+                        servo_board->setOutputSource(pilot.received);
+                    bergen->setScaled(control->get_control_effort(pilot), outputMicros);
+                    profile.lap(tick_profiler::MIX);
                 }
                 catch (bad_control& b)
                 {
@@ -199,9 +301,45 @@ void MainApp::run()
             request_mode(heli::MODE_DIRECT_MANUAL);
             break;
         }
+
+        profile.end_tick();
+        if (++profiledTicks == MAIN_LOOP_HZ)
+        {
+            publishTickProfile(profile.summarize());
+            profiledTicks = 0;
+        }
     }
 
     Driver::terminateAll();
+    // save what the ground station changed in the last moments
+    ParameterTable::getInstance()->stop();
+}
+
+void MainApp::publishTickProfile(const tick_profiler::summary& summary)
+{
+    std::vector<double> phases(1, summary.ticks);
+    for (const tick_profiler::percentiles& p : summary.phases)
+    {
+        phases.push_back(p.p50_us);
+        phases.push_back(p.p99_us);
+        phases.push_back(p.max_us);
+    }
+    LogFile::getInstance()->logData(LOG_MAIN_LOOP_PHASES, phases);
+    SystemState::getInstance()->main_loop_phases.set(summary, 0);
+}
+
+bool MainApp::pilotInLoop()
+{
+    switch (autopilot_mode.load())
+    {
+    case heli::MODE_DIRECT_MANUAL:
+    case heli::MODE_SCALED_MANUAL:
+        return true;
+    case heli::MODE_AUTOMATIC_CONTROL:
+        return Control::getInstance()->mixes_pilot();
+    default:
+        return false;
+    }
 }
 
 boost::signals2::signal<void (heli::AUTOPILOT_MODE)> MainApp::mode_changed;
@@ -209,9 +347,16 @@ boost::signals2::signal<void (heli::AUTOPILOT_MODE)> MainApp::request_mode;
 
 void MainApp::change_mode(heli::AUTOPILOT_MODE mode)
 {
+    if (mode == heli::MODE_AUTOMATIC_CONTROL && _selfTestBlocksAutomatic)
+    {
+        warning() << "Automatic control refused, the host failed its self test";
+        return;
+    }
+
     debug() << "Switching autopilot mode out of " << MainApp::getModeString();
     autopilot_mode = mode;
     message() << "Switched autopilot mode into " << MainApp::getModeString();
+    logModes();
     MainApp::mode_changed(mode);
 }
 
@@ -222,6 +367,7 @@ std::string MainApp::getModeString()
 
 void MainApp::change_pilot_mode(heli::PILOT_MODE mode)
 {
+    logModes();
     if (mode == heli::PILOT_AUTO)
     {
         warning() << "Pilot engaged autopilot. Recording position setpoint";
@@ -230,3 +376,106 @@ void MainApp::change_pilot_mode(heli::PILOT_MODE mode)
     }
 }
 
+
+void MainApp::logModes()
+{
+    const std::array<int, 2> modes = {{autopilot_mode.load(), servo_switch::getInstance()->get_pilot_mode()}};
+    LogFile::getInstance()->logData(LOG_MODES, modes);
+}
+
+bool MainApp::selfTest()
+{
+    Configuration* config = Configuration::getInstance();
+    config->describe("self_test.duration_s", "> 0", "Time spent measuring wakeup jitter and CPU headroom.", "seconds");
+    config->describe("self_test.cpu", "-1 or a CPU number", "CPU the control loop runs on, -1 for any.");
+    config->describe("self_test.max_jitter_us", "> 0", "Limit on the 99th percentile lateness of main loop wakeups.", "us");
+    config->describe("self_test.min_cpu_headroom", "0 - 1", "Least idle fraction of the control CPU.");
+    config->describe("self_test.ports", "comma separated list of names", "Serial ports to time, each set up under self_test.port.");
+    config->describe("self_test.serial_probes", ">= 1", "Exchanges timed on each port.");
+    config->describe("self_test.serial_timeout_ms", "> 0", "Time after which an exchange counts as lost.", "ms");
+    config->describe("self_test.max_serial_rtt_ms", "> 0", "Limit on the 99th percentile serial round trip.", "ms");
+    config->describe("self_test.log_volume", "directory", "Where to time log writes, the log folder if empty.");
+    config->describe("self_test.log_block_bytes", "> 0", "Size of each timed log write.", "bytes");
+    config->describe("self_test.log_writes", ">= 1", "Number of timed log writes.");
+    config->describe("self_test.max_write_ms", "> 0", "Limit on the 99th percentile write().", "ms");
+    config->describe("self_test.max_sync_ms", "> 0", "Limit on the 99th percentile fdatasync().", "ms");
+
+    const host_self_test::clock::duration length = std::chrono::milliseconds(
+                static_cast<int>(1000 * config->getd("self_test.duration_s", 2)));
+    const int cpu = config->geti("self_test.cpu", -1);
+    host_self_test test;
+
+    message() << "Self test: measuring wakeup jitter at " << MAIN_LOOP_HZ << " Hz";
+    const host_self_test::percentiles jitter = host_self_test::wakeup_jitter(MAIN_LOOP_HZ, length, cpu);
+    test.expect_at_most("wakeup_jitter_p99", jitter.p99, config->getd("self_test.max_jitter_us", 2000), "us");
+    test.expect_at_most("wakeup_jitter_max", jitter.max, 1e6 / MAIN_LOOP_HZ, "us");
+
+    test.expect_at_least("cpu_headroom", host_self_test::cpu_headroom(length, cpu),
+                         config->getd("self_test.min_cpu_headroom", 0.3), "");
+
+    std::vector<std::string> ports;
+    boost::split(ports, config->gets("self_test.ports", ""), boost::is_any_of(","));
+    for (std::string& port : ports)
+    {
+        boost::algorithm::trim(port);
+        if (port.empty())
+            continue;
+
+        const std::string key = "self_test.port." + port;
+        config->describe(key + ".device", "path", "Serial device to time.");
+        config->describe(key + ".baudrate", "9600 - 115200", "Baud rate of the device.");
+        config->describe(key + ".probe", "hex bytes", "Bytes written to the port.");
+        config->describe(key + ".reply", "hex bytes", "Bytes the device answers the probe with, the probe itself for a loopback if empty.");
+
+        const std::string name = "serial_" + port;
+        std::string probe, reply;
+        if (! host_self_test::parse_hex(config->gets(key + ".probe", "55"), probe) || probe.empty()
+                || ! host_self_test::parse_hex(config->gets(key + ".reply", ""), reply))
+        {
+            test.fail(name, "probe and reply must be hex bytes");
+            continue;
+        }
+
+        const std::string device = config->gets(key + ".device", "");
+        const int fd = host_self_test::open_port(device, config->geti(key + ".baudrate", 115200));
+        if (fd < 0)
+        {
+            test.fail(name, "could not open " + device);
+            continue;
+        }
+
+        message() << "Self test: timing " << device;
+        size_t lost = 0;
+        const size_t probes = std::max(1, config->geti("self_test.serial_probes", 20));
+        const host_self_test::percentiles rtt = host_self_test::serial_round_trip(
+                fd, probe, reply, probes,
+                std::chrono::milliseconds(config->geti("self_test.serial_timeout_ms", 100)), &lost);
+        close(fd);
+
+        test.expect_at_most(name + "_rtt_p99", rtt.p99 / 1000, config->getd("self_test.max_serial_rtt_ms", 20), "ms");
+        test.expect_at_most(name + "_lost", lost, 0, "exchanges");
+    }
+
+    const Path log_folder = LogFile::getInstance()->getLogFolder();
+    const std::string volume = config->gets("self_test.log_volume", "");
+    message() << "Self test: timing log writes";
+    const host_self_test::write_latency writes = host_self_test::log_volume(
+                volume.empty() ? log_folder.toString() : volume,
+                std::max(1, config->geti("self_test.log_block_bytes", 4096)),
+                std::max(1, config->geti("self_test.log_writes", 50)));
+    if (writes.sync.count == 0)
+        test.fail("log_volume", "could not write to " + (volume.empty() ? log_folder.toString() : volume));
+    test.expect_at_most("log_write_p99", writes.write.p99 / 1000, config->getd("self_test.max_write_ms", 10), "ms");
+    test.expect_at_most("log_sync_p99", writes.sync.p99 / 1000, config->getd("self_test.max_sync_ms", 50), "ms");
+
+    const std::string report = test.report();
+    std::ofstream((log_folder / "self_test.txt").toString().c_str()) << report;
+    for (const host_self_test::check& c : test.checks())
+    {
+        if (! c.passed())
+            warning() << "Self test: " << c.name << " is " << c.value << " " << c.units << ", limit " << c.limit;
+    }
+    message() << "Self test " << (test.passed() ? "passed" : "failed");
+
+    return test.passed();
+}
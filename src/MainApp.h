@@ -30,6 +30,7 @@
 #include "heli.h"
 #include "Debug.h"
 #include "Singleton.h"
+#include "tick_profiler.h"
 
 /* Boost Headers */
 #include <boost/signals2.hpp>
@@ -67,6 +68,9 @@ public:
 
 private:
     static const std::string LOG_SCALED_INPUTS ;
+    static const std::string LOG_MAIN_LOOP_PHASES;
+    /// written at start up and whenever either mode changes
+    static const std::string LOG_MODES;
 
 
     /// default constructor (initializes terminate to false)
@@ -81,6 +85,28 @@ private:
     /// controls whether the main loop continues to execute
     std::atomic_bool _terminate;
 
+    /// rate of the main control loop
+    static const int MAIN_LOOP_HZ = 100;
+
+    /// set when a failed self test keeps the autopilot out of automatic control
+    std::atomic_bool _selfTestBlocksAutomatic;
+
+    /**
+     * Measure the host against the self_test.* limits before the drivers
+     * start and write the report to the log folder.
+     * @returns false if a limit was not met
+     */
+    bool selfTest();
+
+    /// log the last second of main loop phases and publish them for telemetry
+    void publishTickProfile(const tick_profiler::summary& summary);
+
+    /// log the autopilot and pilot modes, which decide what drives the servos
+    void logModes();
+
+    /// @returns true if the pilot inputs reach the servos in the current mode, in part or whole
+    bool pilotInLoop();
+
     /// stores the current operating mode of the autopilot
     std::atomic<heli::AUTOPILOT_MODE> autopilot_mode;
 
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "ParameterTable.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cstring>
+
+const size_t ParameterTable::ID_LENGTH;
+const std::chrono::milliseconds ParameterTable::SAVE_DELAY(200);
+
+ParameterTable::ParameterTable()
+    : Logger("Parameter Table"),
+      _size(0),
+      slot_mask(0),
+      _built(false),
+      stopping(false)
+{
+    component_lookup.fill(-1);
+}
+
+ParameterTable::~ParameterTable()
+{
+    stop();
+}
+
+void ParameterTable::add_component(uint8_t component, source get, setter set, saver save)
+{
+    std::lock_guard<std::mutex> lock(update_lock);
+    if (_built)
+    {
+        warning() << "Component " << static_cast<int>(component) << " registered after the table was built, ignoring";
+        return;
+    }
+    if (component_lookup[component] >= 0)
+    {
+        warning() << "Component " << static_cast<int>(component) << " registered twice, ignoring";
+        return;
+    }
+
+    registration r;
+    r.component = component;
+    r.get = get;
+    r.set = set;
+    r.save = save;
+    r.first = 0;
+    r.count = 0;
+    component_lookup[component] = components.size();
+    components.push_back(r);
+}
+
+size_t ParameterTable::trimmed_length(const char* id)
+{
+    size_t length = 0;
+    while (length < ID_LENGTH && id[length] != '\0')
+        ++length;
+    while (length > 0 && id[length - 1] == ' ')
+        --length;
+    return length;
+}
+
+uint32_t ParameterTable::hash(uint8_t component, const char* id, size_t length)
+{
+    uint32_t h = 2166136261u;
+    h = (h ^ component) * 16777619u;
+    for (size_t i = 0; i < length; ++i)
+        h = (h ^ static_cast<uint8_t>(id[i])) * 16777619u;
+    return h;
+}
+
+void ParameterTable::build()
+{
+    std::lock_guard<std::mutex> lock(update_lock);
+    if (_built)
+        return;
+
+    std::vector<std::vector<Parameter> > snapshot;
+    size_t total = 0;
+    for (registration& r : components)
+    {
+        snapshot.push_back(r.get());
+        r.first = total;
+        r.count = snapshot.back().size();
+        total += r.count;
+    }
+
+    entries.reset(new entry[total]);
+    _size = total;
+
+    // at most half full so probes stay short
+    size_t slot_count = 1;
+    while (slot_count < 2*total)
+        slot_count <<= 1;
+    slots.assign(slot_count, -1);
+    slot_mask = slot_count - 1;
+
+    for (size_t c = 0; c < components.size(); ++c)
+    {
+        const registration& r = components[c];
+        for (int i = 0; i < r.count; ++i)
+        {
+            const Parameter& p = snapshot[c][i];
+            const int position = r.first + i;
+            entry& e = entries[position];
+            e.component = r.component;
+            e.id.fill('\0');
+            const std::string id(p.getParamID());
+            std::copy(id.begin(), id.begin() + std::min(id.size(), ID_LENGTH), e.id.begin());
+            e.index = i;
+            e.count = r.count;
+            e.value = p.getValue();
+
+            const size_t length = trimmed_length(e.id.data());
+            uint32_t slot = hash(e.component, e.id.data(), length) & slot_mask;
+            bool duplicate = false;
+            while (slots[slot] >= 0)
+            {
+                const entry& other = entries[slots[slot]];
+                if (other.component == e.component && trimmed_length(other.id.data()) == length &&
+                        std::memcmp(other.id.data(), e.id.data(), length) == 0)
+                {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & slot_mask;
+            }
+            if (duplicate)
+                warning() << "Duplicate parameter " << id << " in component " << static_cast<int>(e.component);
+            else
+                slots[slot] = position;
+        }
+    }
+
+    message() << "Indexed " << total << " parameters from " << components.size() << " components";
+    unsaved.assign(components.size(), false);
+    save_thread = std::thread(&ParameterTable::save_loop, this);
+    _built = true;
+}
+
+void ParameterTable::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(save_lock);
+        stopping = true;
+    }
+    save_wake.notify_one();
+    if (save_thread.joinable())
+        save_thread.join();
+}
+
+void ParameterTable::save_loop()
+{
+    std::unique_lock<std::mutex> lock(save_lock);
+    while (true)
+    {
+        save_wake.wait(lock, [this]() { return stopping || std::find(unsaved.begin(), unsaved.end(), true) != unsaved.end(); });
+        // let the rest of a burst of sets arrive so it is saved once
+        if (!stopping)
+            save_wake.wait_for(lock, SAVE_DELAY, [this]() { return stopping; });
+
+        std::vector<bool> pending(unsaved.size(), false);
+        pending.swap(unsaved);
+        const bool last = stopping;
+        lock.unlock();
+
+        for (size_t c = 0; c < pending.size(); ++c)
+            if (pending[c])
+                components[c].save();
+
+        lock.lock();
+        if (last)
+            return;
+    }
+}
+
+int ParameterTable::find(uint8_t component, const char* id) const
+{
+    if (!_built)
+        return -1;
+
+    const size_t length = trimmed_length(id);
+    uint32_t slot = hash(component, id, length) & slot_mask;
+    while (slots[slot] >= 0)
+    {
+        const entry& e = entries[slots[slot]];
+        if (e.component == component && trimmed_length(e.id.data()) == length &&
+                std::memcmp(e.id.data(), id, length) == 0)
+            return slots[slot];
+        slot = (slot + 1) & slot_mask;
+    }
+    return -1;
+}
+
+int ParameterTable::find(uint8_t component, int index) const
+{
+    if (!_built || component_lookup[component] < 0)
+        return -1;
+
+    const registration& r = components[component_lookup[component]];
+    if (index < 0 || index >= r.count)
+        return -1;
+    return r.first + index;
+}
+
+bool ParameterTable::set(int position, float value)
+{
+    if (!_built || position < 0 || static_cast<size_t>(position) >= _size)
+        return false;
+
+    entry& e = entries[position];
+    std::lock_guard<std::mutex> lock(update_lock);
+    const registration& r = components[component_lookup[e.component]];
+
+    // the setter may correct the slot with changed(), so it is written first
+    const float previous = e.value;
+    e.value = value;
+    const bool accepted = r.set(Parameter(std::string(e.id.data(), trimmed_length(e.id.data())), value, e.component));
+    if (!accepted)
+    {
+        e.value = previous;
+        return false;
+    }
+
+    if (r.save)
+    {
+        {
+            std::lock_guard<std::mutex> save_guard(save_lock);
+            unsaved[component_lookup[e.component]] = true;
+        }
+        save_wake.notify_one();
+    }
+    return true;
+}
+
+void ParameterTable::changed(uint8_t component, const char* id, float value)
+{
+    const int position = find(component, id);
+    if (position >= 0)
+        entries[position].value = value;
+}
+
+void ParameterTable::refresh(uint8_t component)
+{
+    if (!_built)
+        return;
+
+    std::lock_guard<std::mutex> lock(update_lock);
+    for (const registration& r : components)
+    {
+        if (component != 0 && r.component != component)
+            continue;
+
+        const std::vector<Parameter> plist(r.get());
+        for (const Parameter& p : plist)
+        {
+            const int position = find(r.component, p.getParamID().c_str());
+            if (position >= 0)
+                entries[position].value = p.getValue();
+        }
+    }
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef PARAMETERTABLE_H_
+#define PARAMETERTABLE_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Project Headers */
+#include "Parameter.h"
+#include "Debug.h"
+#include "Singleton.h"
+
+/**
+ * @brief Index of every parameter exposed to the ground station
+ *
+ * Components register a source (their getParameters()) and a setter (their
+ * setParameter()) with add_component().  build() then takes one snapshot of
+ * all the parameters and lays them out in a flat array, numbered per
+ * component in the order the component lists them, with an open addressing
+ * hash over (component id, param id).
+ *
+ * After build() finding a parameter by id or by index is a hash probe or an
+ * array lookup, reading its value is an atomic load and nothing is allocated,
+ * so PARAM_REQUEST_READ and the PARAM_VALUE echo of a PARAM_SET never have
+ * to rebuild the parameter list.  set() calls back in to the component
+ * (which validates and applies the value) and writes only that parameter's
+ * slot: the sent value if the component accepted it, the old one if not.  A
+ * component that keeps something other than what it was sent (a rounded or
+ * clamped value) reports it for that one parameter with changed().  Only
+ * refresh() re-reads whole components.
+ *
+ * Components do not save their configuration from the setter, which runs on
+ * the MAVLink receive thread with the table locked.  A component that keeps
+ * its parameters in config.xml registers a saver instead; set() marks the
+ * component unsaved and a thread started by build() calls the saver once
+ * the burst of PARAM_SETs has settled for SAVE_DELAY.
+ *
+ * Parameter ids are compared without trailing spaces or nulls so both the
+ * space padded ids from Parameter and null padded ids from the ground station
+ * match.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class ParameterTable : public Singleton<ParameterTable>, public Logger
+{
+public:
+    /// size of the mavlink param_id field
+    static const size_t ID_LENGTH = 16;
+
+    typedef std::function<std::vector<Parameter> ()> source;
+    typedef std::function<bool (const Parameter&)> setter;
+    typedef std::function<void ()> saver;
+
+    /// time a component's saver waits for further PARAM_SETs
+    static const std::chrono::milliseconds SAVE_DELAY;
+
+    /// one parameter, in the form sent in PARAM_VALUE
+    struct entry
+    {
+        uint8_t component;
+        /// param id as listed by the component, null padded
+        std::array<char, ID_LENGTH> id;
+        /// index within the component
+        uint16_t index;
+        /// number of parameters of the component
+        uint16_t count;
+        std::atomic<float> value;
+    };
+
+    ParameterTable();
+    ~ParameterTable();
+
+    /**
+     * Register a component, must be called before build().
+     * @param save writes the component's configuration after set() changed it, may be empty
+     */
+    void add_component(uint8_t component, source get, setter set, saver save = saver());
+
+    /// snapshot every registered component, build the index and start saving, later calls are ignored
+    void build();
+
+    /// run the savers of the components still unsaved and stop the save thread
+    void stop();
+
+    /// @returns true once build() has completed
+    bool built() const
+    {
+        return _built;
+    }
+
+    /**
+     * @param id param id, at most ID_LENGTH characters and not necessarily null terminated
+     * @returns the position of the parameter in the table or -1 if it does not exist
+     */
+    int find(uint8_t component, const char* id) const;
+    /// @returns the position of the index-th parameter of component or -1 if it does not exist
+    int find(uint8_t component, int index) const;
+
+    /// @returns the number of parameters of every component
+    size_t size() const
+    {
+        return _built ? _size : 0;
+    }
+
+    const entry& operator[](int position) const
+    {
+        return entries[position];
+    }
+
+    /**
+     * Set a parameter through its component and store the value it accepted.
+     * @returns false if the parameter does not exist or the component rejected it
+     */
+    bool set(int position, float value);
+
+    /**
+     * Store the value a component holds for one of its parameters, for a
+     * component that changes it itself or keeps other than what set() sent.
+     * Takes no lock, so it may be called from within the component's setter.
+     * @param id param id as in find()
+     */
+    void changed(uint8_t component, const char* id, float value);
+
+    /// re-read the values of a component (or every component when component is 0)
+    void refresh(uint8_t component = 0);
+
+private:
+    struct registration
+    {
+        uint8_t component;
+        source get;
+        setter set;
+        saver save;
+        /// position of the component's first entry and number of entries
+        int first;
+        int count;
+    };
+
+    /// FNV-1a over the component and the trimmed id
+    static uint32_t hash(uint8_t component, const char* id, size_t length);
+    /// length of id ignoring trailing spaces and nulls
+    static size_t trimmed_length(const char* id);
+    /// body of save_thread
+    void save_loop();
+
+    std::vector<registration> components;
+    /// position in components by component id, -1 if not registered
+    std::array<int, 256> component_lookup;
+    std::unique_ptr<entry[]> entries;
+    size_t _size;
+    /// open addressing hash table of positions in entries, -1 marks an empty slot
+    std::vector<int> slots;
+    uint32_t slot_mask;
+
+    std::atomic_bool _built;
+    /// serializes build, set and refresh
+    std::mutex update_lock;
+
+    /// set for each component in components whose saver has not run since set()
+    std::vector<bool> unsaved;
+    bool stopping;
+    /// serializes unsaved and stopping
+    std::mutex save_lock;
+    std::condition_variable save_wake;
+    std::thread save_thread;
+};
+
+#endif
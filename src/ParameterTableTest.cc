@@ -0,0 +1,176 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "ParameterTable.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+
+namespace
+{
+
+/// a component keeping its parameters in a map by padded id, rejecting negative values
+struct fake_component
+{
+    fake_component(int id, int count)
+        : id(id), gets(0)
+    {
+        for (int i = 0; i < count; ++i)
+            values[Parameter("P" + std::to_string(id) + "_" + std::to_string(i), 0, id).getParamID()] = i;
+    }
+
+    std::vector<Parameter> get()
+    {
+        ++gets;
+        std::vector<Parameter> plist;
+        for (const auto& v : values)
+            plist.push_back(Parameter(v.first, v.second, id));
+        return plist;
+    }
+
+    bool set(const Parameter& p)
+    {
+        auto it = values.find(p.getParamID());
+        if (it == values.end() || p.getValue() < 0)
+            return false;
+        it->second = p.getValue();
+        return true;
+    }
+
+    int id;
+    std::map<std::string, float> values;
+    int gets;
+};
+
+void add(ParameterTable& table, fake_component& c)
+{
+    table.add_component(c.id, [&c](){ return c.get(); }, [&c](const Parameter& p){ return c.set(p); });
+}
+
+}
+
+// TESTS
+TEST(ParameterTable, FIND_BY_ID_AND_INDEX)
+{
+    fake_component a(20, 30), b(70, 5);
+    ParameterTable table;
+    add(table, a);
+    add(table, b);
+    table.build();
+
+    ASSERT_EQ(35u, table.size());
+
+    // space padded, null padded and unterminated ids all match
+    const char padded[16] = {'P', '7', '0', '_', '3', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', '\0', '\0'};
+    int position = table.find(70, padded);
+    ASSERT_GE(position, 0);
+    EXPECT_EQ(70, table[position].component);
+    EXPECT_EQ(5, table[position].count);
+    EXPECT_FLOAT_EQ(3, table[position].value);
+    EXPECT_EQ(position, table.find(70, table[position].index));
+
+    const char full[16] = {'P', '2', '0', '_', '1', '7', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+    position = table.find(20, full);
+    ASSERT_GE(position, 0);
+    EXPECT_FLOAT_EQ(17, table[position].value);
+    EXPECT_EQ(30, table[position].count);
+
+    EXPECT_EQ(-1, table.find(70, "P20_1"));
+    EXPECT_EQ(-1, table.find(20, "P20_99"));
+    EXPECT_EQ(-1, table.find(20, 30));
+    EXPECT_EQ(-1, table.find(10, 0));
+}
+
+TEST(ParameterTable, SET_ECHOES_ACCEPTED_VALUE)
+{
+    fake_component a(20, 4);
+    ParameterTable table;
+    add(table, a);
+    table.build();
+
+    const int position = table.find(20, "P20_2");
+    ASSERT_GE(position, 0);
+
+    EXPECT_TRUE(table.set(position, 9));
+    EXPECT_FLOAT_EQ(9, table[position].value);
+
+    // rejected, the slot keeps the component's value
+    EXPECT_FALSE(table.set(position, -1));
+    EXPECT_FLOAT_EQ(9, table[position].value);
+
+    EXPECT_FALSE(table.set(100, 1));
+}
+
+TEST(ParameterTable, SET_WRITES_ONE_SLOT)
+{
+    fake_component a(20, 4);
+    ParameterTable table;
+    add(table, a);
+    table.build();
+    const int gets = a.gets;
+
+    const int position = table.find(20, "P20_1");
+    ASSERT_TRUE(table.set(position, 5));
+    EXPECT_FLOAT_EQ(5, table[position].value);
+    EXPECT_EQ(gets, a.gets);
+}
+
+TEST(ParameterTable, CHANGED_STORES_WHAT_THE_COMPONENT_KEPT)
+{
+    fake_component a(20, 4);
+    ParameterTable table;
+    // rounds to whole numbers and reports what it kept
+    table.add_component(a.id, [&a](){ return a.get(); }, [&a, &table](const Parameter& p)
+    {
+        const Parameter rounded(p.getParamID(), std::round(p.getValue()), a.id);
+        if (!a.set(rounded))
+            return false;
+        table.changed(a.id, p.getParamID().c_str(), rounded.getValue());
+        return true;
+    });
+    table.build();
+
+    const int position = table.find(20, "P20_3");
+    ASSERT_TRUE(table.set(position, 6.4));
+    EXPECT_FLOAT_EQ(6, table[position].value);
+
+    EXPECT_FALSE(table.set(position, -2));
+    EXPECT_FLOAT_EQ(6, table[position].value);
+
+    // a parameter the component changes itself
+    table.changed(20, "P20_0", 12);
+    EXPECT_FLOAT_EQ(12, table[table.find(20, "P20_0")].value);
+}
+
+TEST(ParameterTable, SAVES_A_BURST_ONCE_OFF_THE_SETTING_THREAD)
+{
+    fake_component a(20, 4);
+    std::atomic<int> saves(0);
+    std::thread::id saved_on;
+    ParameterTable table;
+    table.add_component(a.id, [&a](){ return a.get(); }, [&a](const Parameter& p){ return a.set(p); },
+                        [&saves, &saved_on](){ saved_on = std::this_thread::get_id(); ++saves; });
+    table.build();
+
+    for (int i = 0; i < 5; ++i)
+        ASSERT_TRUE(table.set(table.find(20, i % 4), i));
+    // a rejected value is not saved
+    EXPECT_FALSE(table.set(table.find(20, 0), -1));
+    EXPECT_EQ(0, saves);
+
+    for (int i = 0; i < 100 && saves == 0; ++i)
+        std::this_thread::sleep_for(ParameterTable::SAVE_DELAY / 10);
+    std::this_thread::sleep_for(ParameterTable::SAVE_DELAY);
+    EXPECT_EQ(1, saves);
+    EXPECT_NE(std::this_thread::get_id(), saved_on);
+
+    // stopping saves what is left without waiting
+    ASSERT_TRUE(table.set(table.find(20, 1), 7));
+    table.stop();
+    EXPECT_EQ(2, saves);
+}
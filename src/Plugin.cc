@@ -7,6 +7,7 @@
 
 #include "Plugin.h"
 #include "RateLimiter.h"
+#include "deadline_watchdog.h"
 
 Plugin::Plugin(std::string humanReadableName,
                std::string machineReadableName,
@@ -61,9 +62,11 @@ void Plugin::internalLoop(Plugin* inst)
     if(inst->loopRateHz > 0)
     {
         RateLimiter rl(inst->loopRateHz);
+        const std::string name = inst->getName();
         while(! inst->terminateRequested())
         {
             rl.wait();
+            deadline_watchdog::check_in(name.c_str(), std::chrono::milliseconds(1000 / inst->loopRateHz));
             inst->loop();
             rl.finishedCriticalSection();
         }
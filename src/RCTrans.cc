@@ -20,6 +20,24 @@
 
 #include "RCTrans.h"
 
+/* STL Headers */
+#include <condition_variable>
+#include <mutex>
+
+/* Project Headers */
+#include "seqlock.h"
+
+const size_t RCTrans::SCALED_CHANNELS;
+
+namespace
+{
+/// the last frame published, readers copy it out without blocking the receive thread
+seqlock<RCTrans::pilot_inputs> published;
+/// only held to notify and wait, never while scaling
+std::mutex frame_lock;
+std::condition_variable frame_arrived;
+}
+
 double RCTrans::pulse2norm(uint16_t pulse, std::array<uint16_t, 2> setpoint)
 {
     double pulseMicros = pulse;
@@ -132,19 +150,55 @@ double RCTrans::pulse2norm(uint16_t pulse, std::array<uint16_t, 5> setpoint)
 }
 
 
+RCTrans::pilot_inputs RCTrans::scale(const servo_switch::input_record& record)
+{
+    auto rc = RadioCalibration::getInstance();
+
+    pilot_inputs inputs;
+    inputs.pulse = record.pulse;
+    inputs.received = record.received;
+    inputs.frame = record.frame;
+
+    inputs.scaled[AILERON] =    pulse2norm(record.pulse[heli::CH1], rc->getAileron());
+    inputs.scaled[ELEVATOR] =   pulse2norm(record.pulse[heli::CH2], rc->getElevator());
+    inputs.scaled[THROTTLE] =   pulse2norm(record.pulse[heli::CH3], rc->getThrottle());
+    inputs.scaled[RUDDER] =     pulse2norm(record.pulse[heli::CH4], rc->getRudder());
+    inputs.scaled[GYRO] =       pulse2norm(record.pulse[heli::CH5], rc->getGyro());
+    inputs.scaled[PITCH] =      pulse2norm(record.pulse[heli::CH6], rc->getPitch());
+
+    return inputs;
+}
+
 std::vector<double> RCTrans::getScaledVector()
 {
-    std::vector<double> norms(6);
+    const pilot_inputs inputs = getInputs();
+    return std::vector<double>(inputs.scaled.begin(), inputs.scaled.end());
+}
 
-    auto ss = servo_switch::getInstance();
-    auto rc = RadioCalibration::getInstance();
+void RCTrans::publish(const servo_switch::input_record& record)
+{
+    published.store(scale(record));
+
+    // a waiter between its check and its wait can not miss the notify
+    {
+        std::lock_guard<std::mutex> lock(frame_lock);
+    }
+    frame_arrived.notify_all();
+}
 
-    norms[AILERON] =    pulse2norm(ss->getRaw(heli::CH1), rc->getAileron());
-    norms[ELEVATOR] =   pulse2norm(ss->getRaw(heli::CH2), rc->getElevator());
-    norms[THROTTLE] =   pulse2norm(ss->getRaw(heli::CH3), rc->getThrottle());
-    norms[RUDDER] =     pulse2norm(ss->getRaw(heli::CH4), rc->getRudder());
-    norms[GYRO] =       pulse2norm(ss->getRaw(heli::CH5), rc->getGyro());
-    norms[PITCH] =      pulse2norm(ss->getRaw(heli::CH6), rc->getPitch());
+RCTrans::pilot_inputs RCTrans::getInputs()
+{
+    const pilot_inputs inputs = published.load();
+    if (inputs.frame == 0)
+        return scale(servo_switch::getInstance()->getInputs());
+    return inputs;
+}
 
-    return norms;
+bool RCTrans::waitForFrame(uint32_t frame, std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(frame_lock);
+    return frame_arrived.wait_until(lock, deadline, [frame]()
+    {
+        return published.load().frame != frame;
+    });
 }
@@ -21,6 +21,10 @@
 #ifndef RCTRANS_H
 #define RCTRANS_H
 
+/* STL Headers */
+#include <array>
+#include <chrono>
+
 /* Project Headers */
 #include "servo_switch.h"
 #include "RadioCalibration.h"
@@ -37,8 +41,34 @@
 class RCTrans
 {
 public:
+    static const size_t SCALED_CHANNELS = 6;
+
+    /// one servo switch frame of pilot inputs, scaled once when it arrived
+    struct pilot_inputs
+    {
+        std::array<double, SCALED_CHANNELS> scaled;
+        std::array<uint16_t, servo_switch::NUM_CHANNELS> pulse;
+        /// when the read holding the end of the frame returned
+        std::chrono::steady_clock::time_point received;
+        /// number of pulse input frames before this one
+        uint32_t frame;
+    };
+
     /** returns a vector of scaled valued for all channels */
     static std::vector<double> getScaledVector();
+
+    /**
+     * Scale a frame and make it the latest pilot inputs, waking waitForFrame().
+     * Called by the servo switch receive thread as each frame arrives.
+     */
+    static void publish(const servo_switch::input_record& record);
+    /// the latest frame of pilot inputs, scaled now if none was published yet
+    static pilot_inputs getInputs();
+    /**
+     * Wait for a frame after frame to be published.
+     * @returns true if there is one, false if deadline passed first
+     */
+    static bool waitForFrame(uint32_t frame, std::chrono::steady_clock::time_point deadline);
     /// List provides index to channel mapping for the RCTrans::getScaled function.
     enum RadioElement
     {
@@ -51,6 +81,9 @@ public:
     };
 
 private:
+    /// scale the pulses of record with the current calibration
+    static pilot_inputs scale(const servo_switch::input_record& record);
+
     /** Scales a pulse value to a normalized value 0 or 1
         @param pulse the received pulse to be scaled
         @param setpoint an array that stores the calibrated end point pulse values of the Radio
@@ -30,6 +30,7 @@
 #include "SystemState.h"
 
 RadioCalibration::RadioCalibration()
+    : _generation(0)
 {
     gyro[0] = 1050;
     gyro[1] = 1800;
@@ -74,6 +75,7 @@ void RadioCalibration::setCalibration(const std::vector<std::vector<uint16_t> >&
     populateVector(calibration_data[3], rudder);
     populateVector(calibration_data[4], gyro);
     populateVector(calibration_data[5], pitch);
+    ++_generation;
 
     saveFile();
     writeToSystemState();
@@ -23,6 +23,7 @@
 /* STL Headers */
 #include <string>
 #include <mutex>
+#include <atomic>
 
 /* Project Headers */
 #include "heli.h"
@@ -70,6 +71,12 @@ public:
      */
     void setCalibration(const std::vector<std::vector<uint16_t> >& calibration_data);
 
+    /// incremented every time the calibration changes so cached tables can be rebuilt
+    uint32_t generation() const
+    {
+        return _generation;
+    }
+
 private:
     RadioCalibration();
 
@@ -92,6 +99,7 @@ private:
     };
 
     std::recursive_mutex calibration_lock;
+    std::atomic<uint32_t> _generation;
     std::mutex calibration_file_lock;
     std::array<uint16_t, 2> gyro;
 
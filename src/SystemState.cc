@@ -18,16 +18,111 @@
 
 #include "SystemState.h"
 
+/* Project Headers */
+#include "Configuration.h"
+#include "LogFile.h"
+
+namespace
+{
+const std::string LOG_SOURCE_SELECTION = "State Source Selection";
+
+/// read the selector's tuning from prefix, the defaults are the selector's own
+void configure(state_selector& selector, const std::string& prefix, const std::string& units)
+{
+    Configuration* cfg = Configuration::getInstance();
+    cfg->describe(prefix + ".innovation_scale", "> 0", "Disagreement with the other sources at which a source's score halves.", units);
+    cfg->describe(prefix + ".accuracy_scale", "> 0", "Reported accuracy at which a source's score halves.", units);
+    cfg->describe(prefix + ".latency_scale_s", "> 0", "Measurement latency at which a source's score halves.", "seconds");
+    cfg->describe(prefix + ".timeout_periods", "> 0", "Periods without a measurement before a source is stale.");
+    cfg->describe(prefix + ".min_score", "0 - 1", "Least score of a source that may be selected.");
+    cfg->describe(prefix + ".switch_margin", ">= 0", "Fraction a source must beat the selected source's score by to replace it.");
+    cfg->describe(prefix + ".hold_s", ">= 0", "Time a better source must stay better before it is selected.", "seconds");
+
+    state_selector::tuning t(selector.get_tuning());
+    t.innovation_scale = cfg->getd(prefix + ".innovation_scale", t.innovation_scale);
+    t.accuracy_scale = cfg->getd(prefix + ".accuracy_scale", t.accuracy_scale);
+    t.latency_scale = cfg->getd(prefix + ".latency_scale_s", t.latency_scale);
+    t.timeout_periods = cfg->getd(prefix + ".timeout_periods", t.timeout_periods);
+    t.min_score = cfg->getd(prefix + ".min_score", t.min_score);
+    t.switch_margin = cfg->getd(prefix + ".switch_margin", t.switch_margin);
+    t.hold = std::chrono::duration_cast<state_selector::clock::duration>(
+                 std::chrono::duration<double>(cfg->getd(prefix + ".hold_s", std::chrono::duration<double>(t.hold).count())));
+    selector.set_tuning(t);
+}
+}
+
 SystemState::SystemState()
-:batteryVoltage_mV(500),
+:Logger("System State"),
+ batteryVoltage_mV(500),
  position(1000 , GPSPosition(0,0,0,500)),
  nedOrigin(2000, GPSPosition(0,0,0,500)),
  cpu_load(0),
  main_loop_load(500),
+ main_loop_phases(2000, tick_profiler::summary()),
  rollSpeed_radPerS(500),
  pitchSpeed_radPerS(500),
  yawSpeed_radPerS(500),
  rotation(500, EulerAngles(0,0,0)),
- servoRawInputs(3000, std::array<uint16_t, 8>()) // wait 3 seconds before defaulting.
+ headSpeed_hz(500),
+ servoRawInputs(3000, std::array<uint16_t, 8>()), // wait 3 seconds before defaulting.
+ attitude_sources(&state_selector::angle_distance),
+ position_sources(&state_selector::llh_distance)
+{
+    Configuration* cfg = Configuration::getInstance();
+    cfg->describe("state_selection.enforce", "true/false",
+                  "Switch the GX3 attitude source with the selection and stop the controllers when the GX3 is not selected.");
+    const bool enforce = cfg->getb("state_selection.enforce", false);
+
+    // attitudes are compared in radians, positions in metres; the yaw of the
+    // gx3 nav filter and ahrs normally differ by several degrees
+    state_selector::tuning attitude(attitude_sources.get_tuning());
+    attitude.innovation_scale = 0.2;
+    attitude.accuracy_scale = 0.05;
+    attitude_sources.set_tuning(attitude);
+    configure(attitude_sources, "state_selection.attitude", "radians");
+    attitude_sources.set_enforced(enforce);
+
+    state_selector::tuning position(position_sources.get_tuning());
+    position.innovation_scale = 5;
+    position.accuracy_scale = 50;
+    position_sources.set_tuning(position);
+    configure(position_sources, "state_selection.position", "m");
+    position_sources.set_enforced(enforce);
+
+    LogFile::getInstance()->logHeader(LOG_SOURCE_SELECTION, "Attitude(0)/Position(1) From To Score");
+}
+
+void SystemState::select_sources()
+{
+    const state_selector::clock::time_point now = state_selector::clock::now();
+    state_selector::value_type value;
+    double accuracy;
+
+    const int attitude_from = attitude_sources.selected();
+    const int attitude_to = attitude_sources.select(now);
+    if (attitude_to != attitude_from)
+        log_selection(attitude_sources, 0, "attitude", attitude_from, attitude_to);
+    if (attitude_sources.latest(attitude_to, value, accuracy))
+        rotation.set(EulerAngles(value[0], value[1], value[2]), 0);
+
+    const int position_from = position_sources.selected();
+    const int position_to = position_sources.select(now);
+    if (position_to != position_from)
+        log_selection(position_sources, 1, "position", position_from, position_to);
+    if (position_sources.latest(position_to, value, accuracy))
+        position.set(GPSPosition(value[0], value[1], value[2], accuracy), 0);
+}
+
+void SystemState::log_selection(const state_selector& selector, int kind, const char* what, int from, int to)
 {
+    const std::vector<state_selector::health> healths(selector.report());
+    const double score = to >= 0 && static_cast<size_t>(to) < healths.size() ? healths[to].score : 0;
+    LogFile::getInstance()->logData(LOG_SOURCE_SELECTION, std::vector<double> {static_cast<double>(kind),
+                                    static_cast<double>(from), static_cast<double>(to), score});
+
+    if (to < 0)
+        critical() << "no usable " << what << " source, " << selector.name(from) << " was lost";
+    else
+        warning() << what << " source " << (from < 0 ? std::string("none") : selector.name(from))
+                  << " -> " << selector.name(to) << " score " << score;
 }
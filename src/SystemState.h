@@ -34,6 +34,9 @@
 #include "gps_time.h"
 #include "Singleton.h"
 #include "EulerAngles.h"
+#include "state_selector.h"
+#include "tick_profiler.h"
+#include "Debug.h"
 
 /**
  * The SystemState keeps track of variables that multiple drivers wish to manipulate
@@ -72,7 +75,7 @@
  * - NED origin (used in some autopilot calculations)
  *
  **/
-class SystemState : public Singleton<SystemState>
+class SystemState : public Singleton<SystemState>, public Logger
 {
 friend class Singleton<SystemState>;
 
@@ -115,6 +118,9 @@ public:
     /// The mainloop load as a proportion
     SystemStateParam<float> main_loop_load;
 
+    /// Where the main loop's time went over the last second
+    SystemStateObjParam<tick_profiler::summary> main_loop_phases;
+
     /// The rate of change in roll
     SystemStateParam<float> rollSpeed_radPerS;
     /// The rate of change in pitch
@@ -124,12 +130,30 @@ public:
     /// The rotation of the system
     SystemStateObjParam<EulerAngles> rotation;
 
+    /// The main rotor speed in revolutions per second, 0 when stopped or unknown
+    SystemStateParam<float> headSpeed_hz;
+
     /// The raw values for the servo.
     SystemStateObjParam<std::array<uint16_t, 8> > servoRawInputs;
 
+    /// The drivers measuring the attitude (roll, pitch, yaw in radians), the selected one feeds rotation.
+    state_selector attitude_sources;
+    /// The drivers measuring the position (lat, lon in degrees, height in m), the selected one feeds position.
+    state_selector position_sources;
+
+    /**
+     * Score the attitude and position sources, log any change of selection and
+     * copy the selected measurements in to rotation and position.  Called from
+     * the main loop.
+     */
+    void select_sources();
+
 
 private:
     SystemState();
+
+    /// log and report a change of selection
+    void log_selection(const state_selector& selector, int kind, const char* what, int from, int to);
 };
 
 #endif //SYSTEMSTATE_H_
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "actuator_mixer.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+
+/* Project Headers */
+#include "AutopilotMath.hpp"
+
+namespace
+{
+
+/// angle of the swashplate servos clockwise from the nose looking down in degrees (CH1, CH2, CH6)
+const double SERVO_ANGLES[actuator_mixer::SWASHPLATE_TYPES][3] = {
+    {0, 0, 0},        // MECHANICAL (unused)
+    {-60, 180, 60},   // H120
+    {-40, 180, 40}    // H140
+};
+
+inline double clamp(double x, double lower, double upper)
+{
+    return std::max(lower, std::min(upper, x));
+}
+
+}
+
+actuator_mixer::lut::lut()
+    : lower(0),
+      inv_step(0),
+      segments(1)
+{
+    y.fill(0);
+    slope.fill(0);
+}
+
+template <size_t N>
+void actuator_mixer::lut::set(const std::array<uint16_t, N>& set_points, double lower, double upper)
+{
+    static_assert(N >= 2 && N <= MAX_KNOTS, "lookup table size out of range");
+
+    this->lower = lower;
+    segments = N - 1;
+    inv_step = segments / (upper - lower);
+
+    // keep the table monotone in the direction of the end points so a bad
+    // calibration can never reverse the servo part way through its travel
+    const bool increasing = set_points[N - 1] >= set_points[0];
+    y[0] = set_points[0];
+    for (size_t i = 1; i < N; ++i)
+        y[i] = increasing ? std::max<double>(set_points[i], y[i - 1]) : std::min<double>(set_points[i], y[i - 1]);
+
+    for (int i = 0; i < segments; ++i)
+        slope[i] = y[i + 1] - y[i];
+}
+
+actuator_mixer::actuator_mixer()
+    : _type(MECHANICAL)
+{
+    gyro.fill(0);
+    for (auto& row : swash_mix)
+        row.fill(0);
+}
+
+void actuator_mixer::configure(swashplate_type type, const calibration& cal)
+{
+    _type = (type >= MECHANICAL && type < SWASHPLATE_TYPES) ? type : MECHANICAL;
+
+    for (auto& row : swash_mix)
+        row.fill(0);
+
+    if (_type == MECHANICAL)
+    {
+        swash_mix[SERVO_CH1][ROLL_CYCLIC] = 1;
+        swash_mix[SERVO_CH2][PITCH_CYCLIC] = 1;
+        swash_mix[SERVO_CH6][COLLECTIVE] = 1;
+    }
+    else
+    {
+        // positive roll lowers the right side, positive pitch lowers the front,
+        // the direction of each servo is set by its calibration end points
+        for (int servo = 0; servo < SWASH_SERVOS; ++servo)
+        {
+            const double angle = AutopilotMath::degreesToRadians(SERVO_ANGLES[_type][servo]);
+            swash_mix[servo][COLLECTIVE] = 1;
+            swash_mix[servo][ROLL_CYCLIC] = -std::sin(angle);
+            swash_mix[servo][PITCH_CYCLIC] = -std::cos(angle);
+        }
+    }
+
+    aileron.set(cal.aileron, -1, 1);
+    elevator.set(cal.elevator, -1, 1);
+    rudder.set(cal.rudder, -1, 1);
+    throttle.set(cal.throttle, 0, 1);
+    // the pitch table is indexed by the centered collective used in the swashplate mix
+    pitch.set(cal.pitch, -1, 1);
+    gyro = cal.gyro;
+}
+
+double actuator_mixer::operator()(const input& norm, output& pulse) const
+{
+    const double swash_input[SWASH_INPUTS] = {
+        clamp(2*norm[PITCH] - 1, -1, 1),
+        clamp(norm[AILERON], -1, 1),
+        clamp(norm[ELEVATOR], -1, 1)
+    };
+
+    // collective first, then the largest share of cyclic every servo can still follow
+    double base[SWASH_SERVOS];
+    double cyclic[SWASH_SERVOS];
+    double scale = 1;
+    for (int servo = 0; servo < SWASH_SERVOS; ++servo)
+    {
+        const std::array<double, SWASH_INPUTS>& row = swash_mix[servo];
+        base[servo] = clamp(row[COLLECTIVE]*swash_input[COLLECTIVE], -1, 1);
+        cyclic[servo] = row[ROLL_CYCLIC]*swash_input[ROLL_CYCLIC] + row[PITCH_CYCLIC]*swash_input[PITCH_CYCLIC];
+
+        const double total = base[servo] + cyclic[servo];
+        if (total > 1)
+            scale = std::min(scale, (1 - base[servo]) / cyclic[servo]);
+        else if (total < -1)
+            scale = std::min(scale, (-1 - base[servo]) / cyclic[servo]);
+    }
+
+    pulse[AILERON] = aileron(base[SERVO_CH1] + scale*cyclic[SERVO_CH1]);
+    pulse[ELEVATOR] = elevator(base[SERVO_CH2] + scale*cyclic[SERVO_CH2]);
+    pulse[PITCH] = pitch(base[SERVO_CH6] + scale*cyclic[SERVO_CH6]);
+    pulse[THROTTLE] = throttle(norm[THROTTLE]);
+    pulse[RUDDER] = rudder(norm[RUDDER]);
+    pulse[GYRO] = (norm[GYRO] == 0) ? gyro[0] : gyro[1];
+
+    return scale;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef ACTUATOR_MIXER_H_
+#define ACTUATOR_MIXER_H_
+
+/* STL Headers */
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Maps normalized channel commands to servo pulse widths
+ *
+ * The inputs are in the order used throughout the autopilot: aileron, elevator,
+ * throttle, rudder, gyro and collective pitch.  Aileron, elevator and rudder are
+ * in [-1, 1], throttle and pitch in [0, 1] and the gyro is off when 0.
+ *
+ * The three swashplate servos (CH1, CH2 and CH6) are driven through a
+ * precomputed 3x3 matrix from collective, roll cyclic and pitch cyclic.  For a
+ * mechanically mixed head this is the identity so the channels pass straight
+ * through.  For electronic CCPM heads (H-120, H-140) each servo gets a blend of
+ * all three.
+ *
+ * When the mix would drive a swashplate servo past its travel, collective is
+ * kept and the cyclic contribution is scaled down uniformly until every servo is
+ * within range, so the collective and yaw (tail and throttle are not mixed)
+ * authority is never traded for cyclic.
+ *
+ * Every channel ends in a monotone piecewise linear lookup table built from the
+ * RadioCalibration set points with uniformly spaced knots, so a lookup is a
+ * multiply, a truncation and one interpolation.  Nothing is allocated after
+ * configure().
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class actuator_mixer
+{
+public:
+    static const int CHANNELS = 6;
+    typedef std::array<double, CHANNELS> input;
+    typedef std::array<uint16_t, CHANNELS> output;
+
+    enum swashplate_type
+    {
+        MECHANICAL = 0,
+        H120,
+        H140,
+        SWASHPLATE_TYPES
+    };
+
+    /// radio calibration set points, see RadioCalibration
+    struct calibration
+    {
+        std::array<uint16_t, 3> aileron;
+        std::array<uint16_t, 3> elevator;
+        std::array<uint16_t, 5> throttle;
+        std::array<uint16_t, 3> rudder;
+        std::array<uint16_t, 2> gyro;
+        std::array<uint16_t, 5> pitch;
+    };
+
+    actuator_mixer();
+
+    /// precompute the mixing matrix and lookup tables
+    void configure(swashplate_type type, const calibration& cal);
+
+    /**
+     * Mix and scale a set of normalized commands.
+     * @param norm normalized channel commands, out of range values are clamped
+     * @param pulse filled with the pulse width for each channel in microseconds
+     * @returns the factor applied to the cyclic commands, 1 when nothing saturated
+     */
+    double operator()(const input& norm, output& pulse) const;
+
+    swashplate_type type() const
+    {
+        return _type;
+    }
+
+private:
+    /// monotone piecewise linear map over uniformly spaced knots
+    class lut
+    {
+    public:
+        lut();
+
+        /// build the table from N set points spread over [lower, upper]
+        template <size_t N>
+        void set(const std::array<uint16_t, N>& set_points, double lower, double upper);
+
+        uint16_t operator()(double x) const
+        {
+            double s = (x - lower) * inv_step;
+            s = (s < 0) ? 0 : ((s > segments) ? segments : s);
+            int i = static_cast<int>(s);
+            if (i == segments)
+                --i;
+            return static_cast<uint16_t>(y[i] + (s - i) * slope[i] + 0.5);
+        }
+
+    private:
+        static const int MAX_KNOTS = 5;
+        double lower;
+        double inv_step;
+        int segments;
+        std::array<double, MAX_KNOTS> y;
+        std::array<double, MAX_KNOTS - 1> slope;
+    };
+
+    enum radio_element
+    {
+        AILERON = 0,
+        ELEVATOR,
+        THROTTLE,
+        RUDDER,
+        GYRO,
+        PITCH
+    };
+
+    /// swashplate servos in the rows of swash_mix, inputs in the columns
+    enum swash_servo
+    {
+        SERVO_CH1 = 0,
+        SERVO_CH2,
+        SERVO_CH6,
+        SWASH_SERVOS
+    };
+    enum swash_input
+    {
+        COLLECTIVE = 0,
+        ROLL_CYCLIC,
+        PITCH_CYCLIC,
+        SWASH_INPUTS
+    };
+
+    swashplate_type _type;
+    std::array<std::array<double, SWASH_INPUTS>, SWASH_SERVOS> swash_mix;
+
+    lut aileron;
+    lut elevator;
+    lut throttle;
+    lut rudder;
+    lut pitch;
+    std::array<uint16_t, 2> gyro;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "actuator_mixer.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+actuator_mixer::calibration default_calibration()
+{
+    actuator_mixer::calibration cal;
+    cal.aileron = {{1000, 1500, 2000}};
+    cal.elevator = {{2000, 1500, 1000}};
+    cal.throttle = {{1000, 1250, 1500, 1750, 2000}};
+    cal.rudder = {{1000, 1500, 2000}};
+    cal.gyro = {{1050, 1800}};
+    cal.pitch = {{1000, 1300, 1500, 1700, 2000}};
+    return cal;
+}
+
+actuator_mixer::input command(double aileron, double elevator, double throttle, double rudder, double gyro, double pitch)
+{
+    actuator_mixer::input in {{aileron, elevator, throttle, rudder, gyro, pitch}};
+    return in;
+}
+
+}
+
+// TESTS
+TEST(ActuatorMixer, MECHANICAL_PASS_THROUGH)
+{
+    actuator_mixer mixer;
+    mixer.configure(actuator_mixer::MECHANICAL, default_calibration());
+
+    actuator_mixer::output pulse;
+    EXPECT_DOUBLE_EQ(1, mixer(command(0.5, 0.5, 0.125, -1, 0, 0.125), pulse));
+    EXPECT_EQ(1750, pulse[0]);
+    // reversed channel
+    EXPECT_EQ(1250, pulse[1]);
+    EXPECT_EQ(1125, pulse[2]);
+    EXPECT_EQ(1000, pulse[3]);
+    EXPECT_EQ(1050, pulse[4]);
+    EXPECT_EQ(1150, pulse[5]);
+
+    // out of range commands are clamped to the end points
+    mixer(command(3, -3, 2, 2, 1, -1), pulse);
+    EXPECT_EQ(2000, pulse[0]);
+    EXPECT_EQ(2000, pulse[1]);
+    EXPECT_EQ(2000, pulse[2]);
+    EXPECT_EQ(2000, pulse[3]);
+    EXPECT_EQ(1800, pulse[4]);
+    EXPECT_EQ(1000, pulse[5]);
+}
+
+TEST(ActuatorMixer, MONOTONE_TABLE)
+{
+    actuator_mixer::calibration cal(default_calibration());
+    cal.throttle = {{1000, 1400, 1300, 1750, 2000}};
+
+    actuator_mixer mixer;
+    mixer.configure(actuator_mixer::MECHANICAL, cal);
+
+    actuator_mixer::output pulse;
+    uint16_t last = 0;
+    for (int i = 0; i <= 100; ++i)
+    {
+        mixer(command(0, 0, i / 100.0, 0, 0, 0.5), pulse);
+        EXPECT_GE(pulse[2], last);
+        last = pulse[2];
+    }
+}
+
+TEST(ActuatorMixer, H120_COLLECTIVE)
+{
+    actuator_mixer mixer;
+    mixer.configure(actuator_mixer::H120, default_calibration());
+
+    // pure collective moves all three servos by the same fraction of their travel
+    actuator_mixer::output pulse;
+    EXPECT_DOUBLE_EQ(1, mixer(command(0, 0, 0, 0, 0, 0.75), pulse));
+    EXPECT_EQ(1750, pulse[0]);
+    EXPECT_EQ(1250, pulse[1]);
+    EXPECT_EQ(1700, pulse[5]);
+}
+
+TEST(ActuatorMixer, SATURATION_PRESERVES_COLLECTIVE)
+{
+    actuator_mixer::calibration cal(default_calibration());
+    cal.pitch = {{1000, 1250, 1500, 1750, 2000}};
+
+    actuator_mixer mixer;
+    mixer.configure(actuator_mixer::H120, cal);
+
+    // high collective with full forward cyclic cannot be reached, the cyclic gives way
+    actuator_mixer::output pulse;
+    EXPECT_NEAR(0.3, mixer(command(0, 1, 0.5, 0.8, 1, 0.85), pulse), 1e-9);
+
+    // the cyclic terms cancel across the three servos so their mean is the collective
+    const double ch1 = (pulse[0] - 1500) / 500.0;
+    const double ch2 = (1500 - pulse[1]) / 500.0;
+    const double ch6 = (pulse[5] - 1500) / 500.0;
+    EXPECT_NEAR(0.7, (ch1 + ch2 + ch6) / 3, 0.005);
+    EXPECT_DOUBLE_EQ(1, ch2);
+
+    // yaw and throttle are untouched
+    EXPECT_EQ(1900, pulse[3]);
+    EXPECT_EQ(1500, pulse[2]);
+
+    // at full collective no cyclic is left
+    EXPECT_DOUBLE_EQ(0, mixer(command(0, 1, 0.5, 0.8, 1, 1), pulse));
+}
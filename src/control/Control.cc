@@ -35,6 +35,7 @@
 #include "Configuration.h"
 #include "LogFile.h"
 
+#include <algorithm>
 #include <functional>
 
 // constants
@@ -61,37 +62,47 @@ Control::Control()
 
 
     // Set the huge map for lookups
-    parameterSetMap[attitude_pid::PARAM_ROLL_KP] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_proportional(val);};
-    parameterSetMap[attitude_pid::PARAM_ROLL_KD] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_derivative(val);};
-    parameterSetMap[attitude_pid::PARAM_ROLL_KI] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_integral(val);};
-    parameterSetMap[attitude_pid::PARAM_PITCH_KP] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_proportional(val);};
-    parameterSetMap[attitude_pid::PARAM_PITCH_KD] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_derivative(val);};
-    parameterSetMap[attitude_pid::PARAM_PITCH_KI] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_integral(val);};
-    parameterSetMap[PARAM_MIX_ROLL] = [](double val){Control::getInstance()->set_roll_mix(val);};
-    parameterSetMap[PARAM_MIX_PITCH] = [](double val){Control::getInstance()->set_pitch_mix(val);};
-    parameterSetMap[attitude_pid::PARAM_ROLL_TRIM] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_trim_degrees(val);};
-    parameterSetMap[attitude_pid::PARAM_PITCH_TRIM] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_trim_degrees(val);};
-    parameterSetMap[translation_outer_pid::PARAM_X_KP] = [](double val){Control::getInstance()->translation_pid_controller().set_x_proportional(val);};
-    parameterSetMap[translation_outer_pid::PARAM_X_KD] = [](double val){Control::getInstance()->translation_pid_controller().set_x_derivative(val);};
-    parameterSetMap[translation_outer_pid::PARAM_X_KI] = [](double val){Control::getInstance()->translation_pid_controller().set_x_integral(val);};
-    parameterSetMap[translation_outer_pid::PARAM_Y_KP] = [](double val){Control::getInstance()->translation_pid_controller().set_y_proportional(val);};
-    parameterSetMap[translation_outer_pid::PARAM_Y_KD] = [](double val){Control::getInstance()->translation_pid_controller().set_y_derivative(val);};
-    parameterSetMap[translation_outer_pid::PARAM_Y_KI] = [](double val){Control::getInstance()->translation_pid_controller().set_y_integral(val);};
-    parameterSetMap[translation_outer_pid::PARAM_TRAVEL] = [](double val){Control::getInstance()->translation_pid_controller().set_scaled_travel_degrees(val);};
-    parameterSetMap[tail_sbf::PARAM_TRAVEL] = [](double val){Control::getInstance()->x_y_sbf_controller.set_scaled_travel_degrees(val);};
-    parameterSetMap[tail_sbf::PARAM_X_KP] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_proportional(val);};
-    parameterSetMap[tail_sbf::PARAM_X_KD] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_derivative(val);};
-    parameterSetMap[tail_sbf::PARAM_X_KI] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_integral(val);};
-    parameterSetMap[tail_sbf::PARAM_Y_KP] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_proportional(val);};
-    parameterSetMap[tail_sbf::PARAM_Y_KD] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_derivative(val);};
-    parameterSetMap[tail_sbf::PARAM_Y_KI] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_integral(val);};
-    parameterSetMap[circle::PARAM_HOVER_TIME] = [](double val){Control::getInstance()->circle_trajectory.set_hover_time(val);};
-    parameterSetMap[circle::PARAM_RADIUS] = [](double val){Control::getInstance()->circle_trajectory.set_radius(val);};
-    parameterSetMap[circle::PARAM_SPEED] = [](double val){Control::getInstance()->circle_trajectory.set_speed(val);};
-    parameterSetMap[line::PARAM_HOVER_TIME] = [](double val){Control::getInstance()->line_trajectory.set_hover_time(val);};
-    parameterSetMap[line::PARAM_SPEED] = [](double val){Control::getInstance()->line_trajectory.set_speed(val);};
-    parameterSetMap[line::PARAM_X_TRAVEL] = [](double val){Control::getInstance()->line_trajectory.set_x_travel(val);};
-    parameterSetMap[line::PARAM_Y_TRAVEL] = [](double val){Control::getInstance()->line_trajectory.set_y_travel(val);};
+    parameterSetMap[attitude_pid::PARAM_ROLL_KP] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_proportional(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_ROLL_KD] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_derivative(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_ROLL_KI] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_integral(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_PITCH_KP] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_proportional(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_PITCH_KD] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_derivative(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_PITCH_KI] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_integral(val); return true;};
+    parameterSetMap[PARAM_MIX_ROLL] = [](double val){return Control::getInstance()->set_roll_mix(val);};
+    parameterSetMap[PARAM_MIX_PITCH] = [](double val){return Control::getInstance()->set_pitch_mix(val);};
+    parameterSetMap[attitude_pid::PARAM_ROLL_TRIM] = [](double val){Control::getInstance()->attitude_pid_controller().set_roll_trim_degrees(val); return true;};
+    parameterSetMap[attitude_pid::PARAM_PITCH_TRIM] = [](double val){Control::getInstance()->attitude_pid_controller().set_pitch_trim_degrees(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_X_KP] = [](double val){Control::getInstance()->translation_pid_controller().set_x_proportional(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_X_KD] = [](double val){Control::getInstance()->translation_pid_controller().set_x_derivative(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_X_KI] = [](double val){Control::getInstance()->translation_pid_controller().set_x_integral(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_Y_KP] = [](double val){Control::getInstance()->translation_pid_controller().set_y_proportional(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_Y_KD] = [](double val){Control::getInstance()->translation_pid_controller().set_y_derivative(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_Y_KI] = [](double val){Control::getInstance()->translation_pid_controller().set_y_integral(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_TRAVEL] = [](double val){Control::getInstance()->translation_pid_controller().set_scaled_travel_degrees(val); return true;};
+    parameterSetMap[translation_outer_pid::PARAM_FEED_FORWARD] = [](double val){Control::getInstance()->translation_pid_controller().set_feed_forward_gain(val); return true;};
+    parameterSetMap[translation_outer_mpc::PARAM_ENABLE] = [](double val){Control::getInstance()->x_y_mpc_controller.set_enabled(val != 0); return true;};
+    parameterSetMap[translation_outer_mpc::PARAM_Q_POSITION] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_position_weight(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_Q_VELOCITY] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_velocity_weight(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_R_ACCELERATION] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_acceleration_weight(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_STEP] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_step(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_RHO] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_rho(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_MAX_ITERATIONS] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_max_iterations(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_BUDGET] = [](double val){return Control::getInstance()->x_y_mpc_controller.set_budget(val);};
+    parameterSetMap[translation_outer_mpc::PARAM_TRAVEL] = [](double val){Control::getInstance()->x_y_mpc_controller.set_scaled_travel_degrees(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_TRAVEL] = [](double val){Control::getInstance()->x_y_sbf_controller.set_scaled_travel_degrees(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_X_KP] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_proportional(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_X_KD] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_derivative(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_X_KI] = [](double val){Control::getInstance()->x_y_sbf_controller.set_x_integral(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_Y_KP] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_proportional(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_Y_KD] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_derivative(val); return true;};
+    parameterSetMap[tail_sbf::PARAM_Y_KI] = [](double val){Control::getInstance()->x_y_sbf_controller.set_y_integral(val); return true;};
+    parameterSetMap[circle::PARAM_HOVER_TIME] = [](double val){Control::getInstance()->circle_trajectory.set_hover_time(val); return true;};
+    parameterSetMap[circle::PARAM_RADIUS] = [](double val){Control::getInstance()->circle_trajectory.set_radius(val); return true;};
+    parameterSetMap[circle::PARAM_SPEED] = [](double val){Control::getInstance()->circle_trajectory.set_speed(val); return true;};
+    parameterSetMap[line::PARAM_HOVER_TIME] = [](double val){Control::getInstance()->line_trajectory.set_hover_time(val); return true;};
+    parameterSetMap[line::PARAM_SPEED] = [](double val){Control::getInstance()->line_trajectory.set_speed(val); return true;};
+    parameterSetMap[line::PARAM_X_TRAVEL] = [](double val){Control::getInstance()->line_trajectory.set_x_travel(val); return true;};
+    parameterSetMap[line::PARAM_Y_TRAVEL] = [](double val){Control::getInstance()->line_trajectory.set_y_travel(val); return true;};
 }
 
 
@@ -121,6 +132,9 @@ std::vector<Parameter> Control::getParameters()
     std::vector<Parameter> translation_controller_params(translation_pid_controller().getParameters());
     plist.insert(plist.end(), translation_controller_params.begin(), translation_controller_params.end());
 
+    std::vector<Parameter> mpc_controller_params(x_y_mpc_controller.getParameters());
+    plist.insert(plist.end(), mpc_controller_params.begin(), mpc_controller_params.end());
+
     std::vector<Parameter> sbf_controller_params(x_y_sbf_controller.getParameters());
     plist.insert(plist.end(), sbf_controller_params.begin(), sbf_controller_params.end());
 
@@ -141,22 +155,34 @@ bool Control::setParameter(Parameter p)
     std::string param_id(p.getParamID());
     boost::trim(param_id);
 
-    // Make sure the param id is in the map.
-    if(parameterSetMap.find(param_id) == parameterSetMap.end())
+    // Make sure the param id is in the map, otherwise it may be a gain schedule entry.
+    if(parameterSetMap.find(param_id) != parameterSetMap.end())
+    {
+        if (!parameterSetMap[param_id](p.getValue()))
+        {
+            warning() << "Control::setParameter - rejected value: " << p;
+            return false;
+        }
+    }
+    else if(!(attitude_pid_controller().set_schedule_parameter(param_id, p.getValue()) ||
+              translation_pid_controller().set_schedule_parameter(param_id, p.getValue()) ||
+              x_y_sbf_controller.set_schedule_parameter(param_id, p.getValue())))
     {
         warning() << "Control::setParameter - unknown parameter: " << p;
         return false;
     }
 
-    parameterSetMap[param_id](p.getValue());
-    saveFile();
-    writeToSystemState();
     return true;
 }
 
 blas::vector<double> Control::get_control_effort() const
 {
-    std::vector<double> pilot_inputs(RCTrans::getScaledVector());
+    return get_control_effort(RCTrans::getInputs());
+}
+
+blas::vector<double> Control::get_control_effort(const RCTrans::pilot_inputs& pilot) const
+{
+    const std::array<double, RCTrans::SCALED_CHANNELS>& pilot_inputs = pilot.scaled;
 
     // compute control effort
     blas::vector<double> control_effort(attitude_pid_controller().get_control_effort());
@@ -188,7 +214,7 @@ blas::vector<double> Control::get_control_effort() const
     return control_output;
 }
 
-void Control::set_roll_mix(double roll_mix)
+bool Control::set_roll_mix(double roll_mix)
 {
     if (roll_mix <= 1 && roll_mix >= 0)
     {
@@ -197,12 +223,14 @@ void Control::set_roll_mix(double roll_mix)
             pilot_mix[ROLL] = roll_mix;
         }
         message() << "Changed roll pilot mix to: " << roll_mix;
+        return true;
     }
     else
         message() << "Invalid roll mix argument: " << roll_mix;
+    return false;
 }
 
-void Control::set_pitch_mix(double pitch_mix)
+bool Control::set_pitch_mix(double pitch_mix)
 {
 
     if (pitch_mix <= 1 && pitch_mix >= 0)
@@ -212,10 +240,12 @@ void Control::set_pitch_mix(double pitch_mix)
             pilot_mix[PITCH] = pitch_mix;
         }
         message() << "Changed pitch pilot mix to: " << pitch_mix;
+        return true;
     }
 
     else
         message() << "Invalid pitch mix argument: " << pitch_mix;
+    return false;
 }
 
 double Control::get_roll_mix() const
@@ -230,6 +260,12 @@ double Control::get_pitch_mix() const
     return pilot_mix[PITCH];
 }
 
+bool Control::mixes_pilot() const
+{
+    std::lock_guard<std::mutex> lock(pilot_mix_lock);
+    return std::any_of(pilot_mix.begin(), pilot_mix.end(), [](double mix) { return mix > 0; });
+}
+
 
 
 void Control::loadFile()
@@ -246,6 +282,7 @@ void Control::loadFile()
 
     attitude_pid_controller().parse_pid();
     translation_pid_controller().parse_xml_node();
+    x_y_mpc_controller.parse_xml_node();
     x_y_sbf_controller.parse_xml_node();
 
     line_trajectory.parse_xml_node();
@@ -263,8 +300,19 @@ void Control::operator()()
         {
             try
             {
-                translation_pid_controller()(reference_position);
-                blas::vector<double> roll_pitch_reference(translation_pid_controller().get_control_effort());
+                bool use_mpc = false;
+                if (x_y_mpc_controller.enabled())
+                {
+                    x_y_mpc_controller(reference_position, get_reference_velocity());
+                    use_mpc = x_y_mpc_controller.within_budget();
+                }
+
+                // the pid runs every tick, whichever output is used, so its timer and
+                // integrators are current when the mpc misses its budget
+                translation_pid_controller()(reference_position, get_reference_velocity(), get_reference_acceleration());
+
+                blas::vector<double> roll_pitch_reference(use_mpc ? x_y_mpc_controller.get_control_effort()
+                                                                  : translation_pid_controller().get_control_effort());
                 set_reference_attitude(roll_pitch_reference);
                 LogFile::getInstance()->logData(LOG_PID_TRANS_ATTITUDE_REF, roll_pitch_reference);
                 attitude_pid_controller()(roll_pitch_reference);
@@ -332,6 +380,9 @@ void Control::saveFile()
     /* get trans pid params */
     translation_pid_controller().get_xml_node();
 
+    /* get mpc params */
+    x_y_mpc_controller.get_xml_node();
+
     /* get sbf params */
     x_y_sbf_controller.get_xml_node();
 
@@ -398,6 +449,7 @@ void Control::set_controller_mode(heli::Controller_Mode mode)
     {
         this->mode_changed(mode);
         warning() << "Controller mode changed to: " << getModeString(mode);
+        LogFile::getInstance()->sync();
         saveFile();
         writeToSystemState();
     }
@@ -406,6 +458,7 @@ void Control::set_controller_mode(heli::Controller_Mode mode)
 void Control::reset()
 {
     x_y_pid_controller.reset();
+    x_y_mpc_controller.reset();
     roll_pitch_pid_controller.reset();
     x_y_sbf_controller.reset();
     line_trajectory.reset();
@@ -430,11 +483,58 @@ blas::vector<double> Control::get_reference_position() const
     }
     else //(get_trajectory_type() == heli::Point_Trajectory)
     {
-        std::lock_guard<std::mutex> lock(reference_position_lock);
+        tick_profiler::lock_guard<std::mutex> lock(reference_position_lock);
         return reference_position;
     }
 }
 
+blas::vector<double> Control::get_reference_velocity() const
+{
+    if (get_trajectory_type() == heli::Line_Trajectory)
+        return line_trajectory.get_reference_velocity();
+    else if (get_trajectory_type() == heli::Circle_Trajectory)
+        return circle_trajectory.get_reference_velocity();
+    else
+        return blas::zero_vector<double>(3);
+}
+
+blas::vector<double> Control::get_reference_acceleration() const
+{
+    if (get_trajectory_type() == heli::Line_Trajectory)
+        return line_trajectory.get_reference_acceleration();
+    else if (get_trajectory_type() == heli::Circle_Trajectory)
+        return circle_trajectory.get_reference_acceleration();
+    else
+        return blas::zero_vector<double>(3);
+}
+
+void Control::capture_telemetry(telemetry::snapshot& s) const
+{
+    if (get_trajectory_type() == heli::Point_Trajectory)
+    {
+        std::lock_guard<std::mutex> lock(reference_position_lock);
+        for (size_t i = 0; i < 3; ++i)
+            s.ref_pos[i] = reference_position[i];
+    }
+    else
+    {
+        const blas::vector<double> reference(get_reference_position());
+        for (size_t i = 0; i < 3; ++i)
+            s.ref_pos[i] = reference[i];
+    }
+
+    {
+        // only roll and pitch are set, and nothing before the first control tick
+        std::lock_guard<std::mutex> lock(reference_attitude_lock);
+        for (size_t i = 0; i < 3; ++i)
+            s.attitude_reference[i] = i < reference_attitude.size() ? reference_attitude[i] : 0;
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+        s.ned_error[i] = s.ned_pos[i] - s.ref_pos[i];
+    telemetry::ned_to_body(s.euler(), s.ned_error, s.body_error);
+}
+
 void Control::set_trajectory_type(const heli::Trajectory_Type trajectory_type)
 {
     bool type_changed = false;
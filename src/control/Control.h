@@ -29,14 +29,18 @@
 #include "Parameter.h"
 #include "attitude_pid.h"
 #include "translation_outer_pid.h"
+#include "translation_outer_mpc.h"
 #include "ControllerInterface.h"
 #include "tail_sbf.h"
 #include "IMU.h"
+#include "telemetry_encoders.h"
 #include "line.h"
 #include "circle.h"
 #include "heli.h"
 #include "Singleton.h"
 #include "Debug.h"
+#include "tick_profiler.h"
+#include "RCTrans.h"
 
 /* Boost Headers */
 #include <boost/numeric/ublas/vector.hpp>
@@ -83,9 +87,15 @@ public:
      * @param p parameter to change
      * @note make sure that the param_id field has been trimmed to remove white space inserted by QGC
      * @return true if the param was set, false if it was not found
+     * @note does not save the configuration, see saveFile()
      */
     bool setParameter(Parameter p);
 
+    /**
+     * save the state of the controller in an xml file
+     */
+    void saveFile();
+
     /**
      *
      * @returns the (normalized) values to be sent to the helicopter.  These values
@@ -93,6 +103,8 @@ public:
      * Control::pilot_mix.
      */
     blas::vector<double> get_control_effort() const;
+    /// as above, mixed with the given frame of pilot inputs instead of the latest
+    blas::vector<double> get_control_effort(const RCTrans::pilot_inputs& pilot) const;
 
     /**
      * This function computes the control effort for the autopilot.  How the control is computed
@@ -163,12 +175,16 @@ public:
     /// threadsafe get controller mode
     inline heli::Controller_Mode get_controller_mode() const
     {
-        std::lock_guard<std::mutex> lock(controller_mode_lock);
+        tick_profiler::lock_guard<std::mutex> lock(controller_mode_lock);
         return controller_mode;
     }
 
     /// threadsafe access reference_position depending on trajectory type
     blas::vector<double> get_reference_position() const;
+    /// reference velocity in the NED frame depending on trajectory type, zero for a point
+    blas::vector<double> get_reference_velocity() const;
+    /// reference acceleration in the NED frame depending on trajectory type, zero for a point
+    blas::vector<double> get_reference_acceleration() const;
 
     /// return the difference between the current position and the reference position in the body frame
     blas::vector<double> get_body_postion_error() const
@@ -189,12 +205,19 @@ public:
         return reference_attitude;
     }
 
+    /**
+     * Add the reference position and attitude to a snapshot taken by
+     * IMU::capture_telemetry(), and the position errors computed from the
+     * position and attitude already in it.
+     */
+    void capture_telemetry(telemetry::snapshot& s) const;
+
     /// set trajectory type
     void set_trajectory_type(const heli::Trajectory_Type trajectory_type);
     /// get the trajectory type
     heli::Trajectory_Type get_trajectory_type() const
     {
-        std::lock_guard<std::mutex> lock(trajectory_type_lock);
+        tick_profiler::lock_guard<std::mutex> lock(trajectory_type_lock);
         return trajectory_type;
     }
 
@@ -204,6 +227,9 @@ public:
     /// Get the pitch mix
     double get_pitch_mix() const;
 
+    /// @returns true if any pilot input is mixed in to the control effort
+    bool mixes_pilot() const;
+
     /// line trajectory generator
     line line_trajectory;
 
@@ -217,6 +243,12 @@ public:
      */
     translation_outer_pid x_y_pid_controller;
 
+    /** Model predictive position controller, used in place of x_y_pid_controller
+     * in heli::Mode_Position_Hold_PID when enabled.  x_y_pid_controller is used for
+     * any iteration where the mpc does not finish within its time budget.
+     */
+    translation_outer_mpc x_y_mpc_controller;
+
     /// PID control with tail rotor sbf compensation
     tail_sbf x_y_sbf_controller;
 
@@ -251,14 +283,16 @@ private:
     /**
      * Set the weight of the pilot input on the roll channel.
      * This function is threadsafe.
+     * @returns false if the mix is not within [0, 1]
      */
-    void set_roll_mix(double roll_mix);
+    bool set_roll_mix(double roll_mix);
 
     /**
      * Set the weight of the pilot input on the pitch channel.
      * This function is threadsafe.
+     * @returns false if the mix is not within [0, 1]
      */
-    void set_pitch_mix(double pitch_mix);
+    bool set_pitch_mix(double pitch_mix);
 
     /**
      * Reads the configuration file stored in heli::controller_param_filename and
@@ -275,11 +309,6 @@ private:
     /// parse the trajectory type xml node
     void parse_trajectory();
 
-    /**
-     * save the state of the controller in an xml file
-     */
-    void saveFile();
-
     /// store the current controller mode
     heli::Controller_Mode controller_mode;
     /// serialize access to controller_mode
@@ -300,7 +329,7 @@ private:
     /// set the reference attitude
     void set_reference_attitude(const blas::vector<double>& reference_attitude)
     {
-        std::lock_guard<std::mutex> lock(reference_attitude_lock);
+        tick_profiler::lock_guard<std::mutex> lock(reference_attitude_lock);
         this->reference_attitude = reference_attitude;
     }
 
@@ -322,7 +351,7 @@ private:
     static std::string getTrajectoryString(heli::Trajectory_Type trajectory_type);
 
     /// Holds a map between Parameter names and the functions that set them.
-    std::unordered_map<std::string, std::function<void(double)>> parameterSetMap;
+    std::unordered_map<std::string, std::function<bool(double)>> parameterSetMap;
 
 };
 
@@ -56,6 +56,16 @@ class Timer
         _timerInit = now;
         return ms;
     }
+
+    /// Like click() but in seconds at the full resolution of the clock, for control timesteps
+    double lap()
+    {
+        std::lock_guard<std::mutex> lock(start_time_lock);
+        auto now = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(now - _timerInit).count();
+        _timerInit = now;
+        return seconds;
+    }
 };
 
 #endif //TIMER_HPP
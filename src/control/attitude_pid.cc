@@ -27,6 +27,7 @@
 #include "Configuration.h"
 #include "LogFile.h"
 #include "util/AutopilotMath.hpp"
+#include "tick_profiler.h"
 
 
 const std::string XML_ROLL_PROPORTIONAL = "controller_params.attitude_pid.roll.gain.proportional";
@@ -37,6 +38,10 @@ const std::string XML_PITCH_PROPORTIONAL = "controller_params.attitude_pid.pitch
 const std::string XML_PITCH_DERIVATIVE = "controller_params.attitude_pid.pitch.gain.derivative";
 const std::string XML_PITCH_INTEGRAL = "controller_params.attitude_pid.pitch.gain.integral";
 const std::string XML_PITCH_TRIM = "controller_params.attitude_pid.pitch.trim";
+const std::string XML_ROLL_SCHEDULE = "controller_params.attitude_pid.roll.schedule";
+const std::string XML_PITCH_SCHEDULE = "controller_params.attitude_pid.pitch.schedule";
+const std::string XML_ROLL = "controller_params.attitude_pid.roll";
+const std::string XML_PITCH = "controller_params.attitude_pid.pitch";
 
 const std::string attitude_pid::PARAM_ROLL_KP = "PID_ROLL_KP";
 const std::string attitude_pid::PARAM_ROLL_KD = "PID_ROLL_KD";
@@ -63,6 +68,8 @@ attitude_pid::attitude_pid()
 {
     roll.name() = "Roll";
     pitch.name() = "Pitch";
+    roll.schedule().param_prefix() = "GS_ROLL";
+    pitch.schedule().param_prefix() = "GS_PITCH";
 
     LogFile *log = LogFile::getInstance();
     log->logHeader(LOG_ATTITUDE_ERROR, "Roll_Proportional Roll_Derivative Roll_Integral Pitch_Proportional Pitch_Derivative Pitch_Integral");
@@ -95,10 +102,16 @@ attitude_pid::attitude_pid(const attitude_pid& other)
 
 }
 
+bool attitude_pid::runnable() const
+{
+    return _runnable && IMU::getInstance()->attitude_source_selected();
+}
+
 void attitude_pid::reset()
 {
     roll.reset();
     pitch.reset();
+    tick.set_start_time();
 }
 
 void attitude_pid::operator()(const blas::vector<double>& reference) throw(bad_control)
@@ -109,44 +122,45 @@ void attitude_pid::operator()(const blas::vector<double>& reference) throw(bad_c
     if (reference.size() < 2)
         throw bad_control("Attitude control received less than two references (roll pitch)");
 
-    blas::vector<double> roll_pitch_reference(reference);
-    roll_pitch_reference.resize(2);
-
     IMU* imu = IMU::getInstance();
-    blas::vector<double> euler(imu->get_euler());
-    blas::vector<double> euler_rate(imu->get_euler_rate());
-    // resize to perform vector subtraction
-    euler.resize(2);
-
+    const std::array<attitude_scalar, 2> euler(controller_math::to_array<attitude_scalar, 2>(imu->get_euler()));
+    const std::array<attitude_scalar, 2> euler_rate(controller_math::to_array<attitude_scalar, 2>(imu->get_euler_rate()));
+    const std::array<attitude_scalar, 2> roll_pitch_reference(controller_math::to_array<attitude_scalar, 2>(reference));
 
-    blas::vector<double> euler_error(euler - roll_pitch_reference);
+    std::array<attitude_scalar, 2> euler_error;
+    for (size_t i = 0; i < euler_error.size(); ++i)
+        euler_error[i] = euler[i] - roll_pitch_reference[i];
 
     std::vector<double> log(euler_error.begin(), euler_error.end());
-    log.insert(log.end(), euler_rate.begin(), euler_rate.end()-1);
+    log.insert(log.end(), euler_rate.begin(), euler_rate.end());
     LogFile::getInstance()->logData("Attitude PID error", log);
-    blas::vector<double> control_effort(2);
-    control_effort.clear();
+    std::array<attitude_scalar, 2> control_effort;
+
+    const gain_schedule::point schedule_point(gain_schedule::point::sample());
+    const attitude_scalar dt = tick.lap();
 
+    // the channels saturate the controls to [-1, 1] and hold their integrals back there
     std::vector<double> error_states;
-    roll_lock.lock();
-    error_states.push_back(roll.error().setProportional(euler_error[0]));
-    error_states.push_back(roll.error().setDerivative(euler_rate[0]));
-    error_states.push_back(++roll.error());
-    control_effort[0] = roll.compute_pid();
-    roll_lock.unlock();
+    {
+        tick_profiler::lock_guard<std::mutex> lock(roll_lock);
+        error_states.push_back(roll.error().setProportional(euler_error[0]));
+        roll.error().setDerivative(euler_rate[0]);
+        control_effort[0] = roll.compute_pid(dt, 1, schedule_point);
+        error_states.push_back(roll.error().getDerivative());
+        error_states.push_back(roll.error().getIntegral());
+    }
 
-    pitch_lock.lock();
-    error_states.push_back(pitch.error().setProportional(euler_error[1]));
-    error_states.push_back(pitch.error().setDerivative(euler_rate[1]));
-    error_states.push_back(++pitch.error());
+    {
+        tick_profiler::lock_guard<std::mutex> lock(pitch_lock);
+        error_states.push_back(pitch.error().setProportional(euler_error[1]));
+        pitch.error().setDerivative(euler_rate[1]);
+        control_effort[1] = pitch.compute_pid(dt, 1, schedule_point);
+        error_states.push_back(pitch.error().getDerivative());
+        error_states.push_back(pitch.error().getIntegral());
+    }
 
     LogFile::getInstance()->logData(LOG_ATTITUDE_ERROR, error_states);
-    control_effort[1] = pitch.compute_pid();
-    pitch_lock.unlock();
-
-    // saturate the controls to [-1, 1]
-    Control::saturate(control_effort);
-    set_control_effort(control_effort);
+    set_control_effort(controller_math::to_vector(control_effort));
 
     LogFile::getInstance()->logData(LOG_ATTITUDE_CONTROL_EFFORT, control_effort);
 //	debug() << "Attitude PID control effort: " << control_effort;
@@ -161,12 +175,14 @@ std::vector<Parameter> attitude_pid::getParameters()
     plist.push_back(Parameter(PARAM_ROLL_KP, roll.gains().getProportional(), heli::CONTROLLER_ID));
     plist.push_back(Parameter(PARAM_ROLL_KD, roll.gains().getDerivative(), heli::CONTROLLER_ID));
     plist.push_back(Parameter(PARAM_ROLL_KI, roll.gains().getIntegral(), heli::CONTROLLER_ID));
+    roll.schedule().getParameters(plist);
     roll_lock.unlock();
 
     pitch_lock.lock();
     plist.push_back(Parameter(PARAM_PITCH_KP, pitch.gains().getProportional(), heli::CONTROLLER_ID));
     plist.push_back(Parameter(PARAM_PITCH_KD, pitch.gains().getDerivative(), heli::CONTROLLER_ID));
     plist.push_back(Parameter(PARAM_PITCH_KI, pitch.gains().getIntegral(), heli::CONTROLLER_ID));
+    pitch.schedule().getParameters(plist);
     pitch_lock.unlock();
 
     plist.push_back(Parameter(PARAM_ROLL_TRIM, get_roll_trim_degrees(), heli::CONTROLLER_ID));
@@ -265,6 +281,16 @@ void attitude_pid::set_pitch_integral(double ki)
     }
     message() << "Set pitch integral gain to: " << ki;
 }
+bool attitude_pid::set_schedule_parameter(const std::string& param_id, double value)
+{
+    if (roll.schedule().setParameter(param_id, value) || pitch.schedule().setParameter(param_id, value))
+    {
+        message() << "Set gain schedule entry " << param_id << " to: " << value;
+        return true;
+    }
+    return false;
+}
+
 void attitude_pid::set_roll_trim_degrees(double trim_degrees)
 {
     roll_trim = AutopilotMath::degreesToRadians(trim_degrees);
@@ -292,6 +318,11 @@ void attitude_pid::get_xml_node()
     cfg->setd(XML_PITCH_DERIVATIVE, get_pitch_derivative());
     cfg->setd(XML_PITCH_INTEGRAL, get_pitch_integral());
     cfg->setd(XML_PITCH_TRIM, get_pitch_trim_degrees());
+
+    roll.schedule().get_xml_node(XML_ROLL_SCHEDULE);
+    pitch.schedule().get_xml_node(XML_PITCH_SCHEDULE);
+    roll.get_xml_node(XML_ROLL);
+    pitch.get_xml_node(XML_PITCH);
 }
 
 
@@ -308,4 +339,9 @@ void attitude_pid::parse_pid()
     set_pitch_derivative(cfg->getd(XML_PITCH_DERIVATIVE, get_pitch_derivative()));
     set_pitch_integral(cfg->getd(XML_PITCH_INTEGRAL, get_pitch_integral()));
     set_pitch_trim_degrees(cfg->getd(XML_PITCH_TRIM, get_pitch_trim_degrees()));
+
+    roll.schedule().parse_xml_node(XML_ROLL_SCHEDULE);
+    pitch.schedule().parse_xml_node(XML_PITCH_SCHEDULE);
+    roll.parse_xml_node(XML_ROLL);
+    pitch.parse_xml_node(XML_PITCH);
 }
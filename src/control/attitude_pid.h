@@ -34,6 +34,9 @@ namespace blas = boost::numeric::ublas;
 /* Project Headers */
 #include "Parameter.h"
 #include "pid_channel.h"
+#include "controller_math.h"
+#include "scalar_types.h"
+#include "Timer.hpp"
 #include "ControllerInterface.h"
 #include "util/AutopilotMath.hpp"
 #include "Debug.h"
@@ -176,11 +179,8 @@ public:
     {
         return AutopilotMath::radiansToDegrees(pitch_trim);
     }
-    /// threadsafe get runnable
-    inline bool runnable() const
-    {
-        return _runnable;
-    }
+    /// threadsafe get runnable, false while the state selection has not selected the GX3 attitude
+    bool runnable() const;
 
 
     double get_roll_proportional();
@@ -190,17 +190,26 @@ public:
     double get_pitch_derivative();
     double get_pitch_integral();
 
+    /**
+     * Set an entry of the roll or pitch gain schedule.  threadsafe
+     * @returns false if param_id is not a schedule entry of this controller
+     */
+    bool set_schedule_parameter(const std::string& param_id, double value);
+
 private:
     static const std::string LOG_ATTITUDE_ERROR;
     static const std::string LOG_ATTITUDE_REFERENCE;
     static const std::string LOG_ATTITUDE_CONTROL_EFFORT;
 
 
-    pid_channel roll;
+    basic_pid_channel<attitude_scalar> roll;
     mutable std::mutex roll_lock;
-    pid_channel pitch;
+    basic_pid_channel<attitude_scalar> pitch;
     mutable std::mutex pitch_lock;
 
+    /// measures the timestep between ticks
+    Timer tick;
+
     /// store the current normalized servo commands
     blas::vector<double> control_effort;
     /// serialize access to control_effort
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef BOX_QP_HPP
+#define BOX_QP_HPP
+
+/* STL Headers */
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Fixed size box constrained quadratic program solver
+ *
+ * Solves
+ * \code
+ *   minimize    0.5 u' H u + f' u
+ *   subject to  lower <= u <= upper
+ * \endcode
+ * using ADMM with the splitting u = z, z in the box.  The matrix H + rho*I is
+ * factored once in set_hessian() so each iteration is two triangular solves,
+ * a clip and a dual update.  All storage is fixed size so solve() never
+ * allocates.
+ *
+ * Successive calls to solve() are warm started from the previous primal and
+ * dual iterates, which for a receding horizon problem are usually within a
+ * few iterations of the new optimum.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+template <int N>
+class box_qp
+{
+public:
+    typedef std::array<double, N> vector;
+    typedef std::array<double, N*N> matrix;
+
+    /// outcome of a call to solve()
+    struct result
+    {
+        int iterations;
+        bool converged;
+    };
+
+    box_qp()
+        : _rho(1)
+    {
+        _factor.fill(0);
+        reset();
+    }
+
+    /**
+     * Set the (row major) Hessian and penalty parameter and factor H + rho*I.
+     * @returns false if H + rho*I is not positive definite, the previous factor is kept
+     */
+    bool set_hessian(const matrix& H, double rho)
+    {
+        matrix L;
+        L.fill(0);
+        for (int i = 0; i < N; ++i)
+        {
+            for (int j = 0; j <= i; ++j)
+            {
+                double sum = H[i*N + j] + (i == j ? rho : 0);
+                for (int k = 0; k < j; ++k)
+                    sum -= L[i*N + k] * L[j*N + k];
+                if (i == j)
+                {
+                    if (sum <= 0)
+                        return false;
+                    L[i*N + i] = std::sqrt(sum);
+                }
+                else
+                    L[i*N + j] = sum / L[j*N + j];
+            }
+        }
+        _factor = L;
+        _rho = rho;
+        return true;
+    }
+
+    /// discard the warm start
+    void reset()
+    {
+        _z.fill(0);
+        _w.fill(0);
+    }
+
+    /**
+     * Solve the QP for a new linear term and bounds.
+     * @param max_iterations hard cap on the number of ADMM iterations
+     * @param tolerance convergence threshold on the primal and dual residuals (infinity norm)
+     * @param expired callable returning true once the time budget is used up, checked every iteration
+     */
+    template <typename Deadline>
+    result solve(const vector& f, const vector& lower, const vector& upper,
+                 int max_iterations, double tolerance, Deadline expired)
+    {
+        result r;
+        r.iterations = 0;
+        r.converged = false;
+
+        // the warm start may lie outside new bounds
+        clip(_z, lower, upper);
+
+        vector u, rhs;
+        while (r.iterations < max_iterations && !expired())
+        {
+            ++r.iterations;
+
+            for (int i = 0; i < N; ++i)
+                rhs[i] = _rho * (_z[i] - _w[i]) - f[i];
+            cholesky_solve(rhs, u);
+
+            double primal = 0;
+            double dual = 0;
+            for (int i = 0; i < N; ++i)
+            {
+                const double z_next = std::max(lower[i], std::min(upper[i], u[i] + _w[i]));
+                dual = std::max(dual, std::fabs(z_next - _z[i]));
+                primal = std::max(primal, std::fabs(u[i] - z_next));
+                _w[i] += u[i] - z_next;
+                _z[i] = z_next;
+            }
+
+            if (primal < tolerance && _rho * dual < tolerance)
+            {
+                r.converged = true;
+                break;
+            }
+        }
+        return r;
+    }
+
+    /// @returns the last solution, always within the bounds
+    const vector& solution() const
+    {
+        return _z;
+    }
+
+private:
+    static void clip(vector& v, const vector& lower, const vector& upper)
+    {
+        for (int i = 0; i < N; ++i)
+            v[i] = std::max(lower[i], std::min(upper[i], v[i]));
+    }
+
+    /// solve L L' x = b
+    void cholesky_solve(const vector& b, vector& x) const
+    {
+        vector y;
+        for (int i = 0; i < N; ++i)
+        {
+            double sum = b[i];
+            for (int k = 0; k < i; ++k)
+                sum -= _factor[i*N + k] * y[k];
+            y[i] = sum / _factor[i*N + i];
+        }
+        for (int i = N - 1; i >= 0; --i)
+        {
+            double sum = y[i];
+            for (int k = i + 1; k < N; ++k)
+                sum -= _factor[k*N + i] * x[k];
+            x[i] = sum / _factor[i*N + i];
+        }
+    }
+
+    /// lower triangular Cholesky factor of H + rho*I
+    matrix _factor;
+    double _rho;
+    /// primal iterate, always feasible
+    vector _z;
+    /// scaled dual iterate
+    vector _w;
+};
+
+#endif // BOX_QP_HPP
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "box_qp.hpp"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+typedef box_qp<2> qp2;
+
+bool never()
+{
+    return false;
+}
+
+qp2::matrix hessian()
+{
+    // [4 1; 1 3]
+    qp2::matrix H {{4, 1, 1, 3}};
+    return H;
+}
+
+qp2::vector vec(double a, double b)
+{
+    qp2::vector v {{a, b}};
+    return v;
+}
+
+}
+
+// TESTS
+TEST(BoxQP, UNCONSTRAINED)
+{
+    qp2 qp;
+    ASSERT_TRUE(qp.set_hessian(hessian(), 1));
+
+    // H u = -f with f = [-1 -2] gives u = [1/11 7/11]
+    qp2::result r = qp.solve(vec(-1, -2), vec(-10, -10), vec(10, 10), 500, 1e-9, never);
+    EXPECT_TRUE(r.converged);
+    EXPECT_NEAR(1.0/11, qp.solution()[0], 1e-6);
+    EXPECT_NEAR(7.0/11, qp.solution()[1], 1e-6);
+}
+
+TEST(BoxQP, ACTIVE_BOUND)
+{
+    qp2 qp;
+    ASSERT_TRUE(qp.set_hessian(hessian(), 1));
+
+    // u[1] is clipped at 0.5, then 4 u[0] + 0.5 = 1 gives u[0] = 1/8
+    qp2::result r = qp.solve(vec(-1, -2), vec(-10, -10), vec(10, 0.5), 500, 1e-9, never);
+    EXPECT_TRUE(r.converged);
+    EXPECT_NEAR(0.125, qp.solution()[0], 1e-6);
+    EXPECT_DOUBLE_EQ(0.5, qp.solution()[1]);
+}
+
+TEST(BoxQP, REJECT_INDEFINITE)
+{
+    qp2 qp;
+    qp2::matrix H {{1, 3, 3, 1}};
+    EXPECT_FALSE(qp.set_hessian(H, 0.1));
+}
+
+TEST(BoxQP, WARM_START)
+{
+    qp2 qp;
+    ASSERT_TRUE(qp.set_hessian(hessian(), 1));
+
+    qp2::result cold = qp.solve(vec(-1, -2), vec(-1, -1), vec(1, 1), 500, 1e-8, never);
+    ASSERT_TRUE(cold.converged);
+
+    // a slightly perturbed problem starting from the previous solution
+    qp2::result warm = qp.solve(vec(-1.01, -2), vec(-1, -1), vec(1, 1), 500, 1e-8, never);
+    ASSERT_TRUE(warm.converged);
+    EXPECT_LT(warm.iterations, cold.iterations);
+}
+
+TEST(BoxQP, DEADLINE)
+{
+    qp2 qp;
+    ASSERT_TRUE(qp.set_hessian(hessian(), 1));
+
+    int calls = 0;
+    qp2::result r = qp.solve(vec(-100, 50), vec(-1, -1), vec(1, 1), 500, 1e-12,
+                             [&calls](){ return ++calls > 3; });
+    EXPECT_EQ(3, r.iterations);
+    EXPECT_FALSE(r.converged);
+
+    // unfinished solutions are still feasible
+    EXPECT_LE(qp.solution()[0], 1);
+    EXPECT_GE(qp.solution()[1], -1);
+}
@@ -22,6 +22,7 @@
 
 /* STL Headers */
 #include <math.h>
+#include <algorithm>
 
 /* Project Headers */
 #include "IMU.h"
@@ -83,14 +84,75 @@ blas::vector<double> circle::get_reference_position() const
     }
     else
     {
-        elapsed_time -= hover_time;
+        const std::array<trajectory_scalar, 2> offset(controller_math::circle_offset<trajectory_scalar>(
+                get_radius(), angle_at(elapsed_time - hover_time, period)));
         blas::vector<double> reference_position(get_center_location());
-        reference_position(0) += get_radius()*cos(2*AutopilotMath::PI*elapsed_time/period + get_initial_angle());
-        reference_position(1) += get_radius()*sin(2*AutopilotMath::PI*elapsed_time/period + get_initial_angle());
+        reference_position(0) += offset[0];
+        reference_position(1) += offset[1];
         return reference_position;
     }
 }
 
+blas::vector<double> circle::get_reference_velocity() const
+{
+    double elapsed_time = getMsSinceInit() / 1000.0;
+    double period = (get_speed() > 0 ? get_circumference()/get_speed() : 0);
+    double hover_time = get_hover_time();
+    if (period == 0 || elapsed_time <= hover_time)
+    {
+        return blas::zero_vector<double>(3);
+    }
+    else
+    {
+        blas::vector<double> velocity(blas::zero_vector<double>(3));
+        const std::array<trajectory_scalar, 2> ned(controller_math::circle_velocity<trajectory_scalar>(
+                get_radius(), period, angle_at(elapsed_time - hover_time, period)));
+        std::copy(ned.begin(), ned.end(), velocity.begin());
+        return velocity;
+    }
+}
+
+blas::vector<double> circle::get_reference_acceleration() const
+{
+    double elapsed_time = getMsSinceInit() / 1000.0;
+    double period = (get_speed() > 0 ? get_circumference()/get_speed() : 0);
+    double hover_time = get_hover_time();
+    if (period == 0 || elapsed_time <= hover_time)
+    {
+        return blas::zero_vector<double>(3);
+    }
+    else
+    {
+        blas::vector<double> acceleration(blas::zero_vector<double>(3));
+        const std::array<trajectory_scalar, 2> ned(controller_math::circle_acceleration<trajectory_scalar>(
+                get_radius(), period, angle_at(elapsed_time - hover_time, period)));
+        std::copy(ned.begin(), ned.end(), acceleration.begin());
+        return acceleration;
+    }
+}
+
+blas::vector<double> circle::velocity_at(double radius, double period, double angle)
+{
+    blas::vector<double> velocity(blas::zero_vector<double>(3));
+    const std::array<double, 2> ned(controller_math::circle_velocity(radius, period, angle));
+    std::copy(ned.begin(), ned.end(), velocity.begin());
+    return velocity;
+}
+
+blas::vector<double> circle::acceleration_at(double radius, double period, double angle)
+{
+    blas::vector<double> acceleration(blas::zero_vector<double>(3));
+    const std::array<double, 2> ned(controller_math::circle_acceleration(radius, period, angle));
+    std::copy(ned.begin(), ned.end(), acceleration.begin());
+    return acceleration;
+}
+
+trajectory_scalar circle::angle_at(double elapsed_time, double period) const
+{
+    // whole laps are dropped in double so the angle keeps its precision on a long flight
+    return controller_math::circle_angle<trajectory_scalar>(fmod(elapsed_time, period), period, get_initial_angle());
+}
+
 double circle::get_circumference() const
 {
     return 2*AutopilotMath::PI*get_radius();
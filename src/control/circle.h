@@ -38,6 +38,8 @@ namespace blas = boost::numeric::ublas;
 #include "Parameter.h"
 #include "heli.h"
 #include "Timer.hpp"
+#include "controller_math.h"
+#include "scalar_types.h"
 
 /**
  * This class defines a circular reference trajectory.  The helicopter
@@ -51,6 +53,18 @@ public:
     circle();
     /// return the reference position for the current time
     blas::vector<double> get_reference_position() const;
+    /// return the reference velocity in the NED frame for the current time
+    blas::vector<double> get_reference_velocity() const;
+    /// return the reference acceleration in the NED frame for the current time
+    blas::vector<double> get_reference_acceleration() const;
+    /**
+     * The velocity along a circle flown clockwise seen from above, in the NED frame.
+     * @param period time to fly around the circle once in seconds
+     * @param angle position on the circle, radians from north
+     */
+    static blas::vector<double> velocity_at(double radius, double period, double angle);
+    /// The acceleration towards the center of a circle, in the NED frame.
+    static blas::vector<double> acceleration_at(double radius, double period, double angle);
     /// reset the trajectory to begin from the current location
     void reset();
 
@@ -133,6 +147,12 @@ protected:
 
     /// return circumference of the circular trajectory
     double get_circumference() const;
+
+    /**
+     * The angle on the circle after elapsed_time seconds of the manoeuvre.
+     * @param period time to fly around the circle once in seconds
+     */
+    trajectory_scalar angle_at(double elapsed_time, double period) const;
 };
 
 #endif /* CIRCLE_H_ */
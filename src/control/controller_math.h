@@ -0,0 +1,190 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef CONTROLLER_MATH_H_
+#define CONTROLLER_MATH_H_
+
+/* STL Headers */
+#include <array>
+#include <cmath>
+
+/* Boost Headers */
+#include <boost/numeric/ublas/vector.hpp>
+namespace blas = boost::numeric::ublas;
+
+/**
+ * The per tick arithmetic of the outer loop controllers and trajectories,
+ * templated on the scalar type chosen in scalar_types.h.
+ *
+ * The controllers read double ublas vectors from the IMU and hand double
+ * ublas vectors to Control.  Anything that can be large, a NED position or
+ * the time since the trajectory started, is reduced to a small difference or
+ * phase in double before it is converted, so the kernels only ever see
+ * errors, angles and offsets that single precision holds to well under a
+ * millimetre or a microradian.
+ */
+namespace controller_math
+{
+/// the first N elements of v as Scalar
+template <typename Scalar, size_t N = 3>
+std::array<Scalar, N> to_array(const blas::vector<double>& v)
+{
+    std::array<Scalar, N> a;
+    for (size_t i = 0; i < N; ++i)
+        a[i] = static_cast<Scalar>(v[i]);
+    return a;
+}
+
+template <typename Scalar, size_t N>
+blas::vector<double> to_vector(const std::array<Scalar, N>& a)
+{
+    blas::vector<double> v(N);
+    for (size_t i = 0; i < N; ++i)
+        v[i] = a[i];
+    return v;
+}
+
+/**
+ * Rotate a NED vector in to the body frame, the first two rows of the
+ * transpose of IMU::euler_to_rotation.
+ * @param euler roll, pitch and yaw in radians
+ * @returns the body x and y components
+ */
+template <typename Scalar>
+std::array<Scalar, 2> body_xy(const std::array<Scalar, 3>& euler, const std::array<Scalar, 3>& ned)
+{
+    using std::cos;
+    using std::sin;
+    const Scalar sr = sin(euler[0]), cr = cos(euler[0]);
+    const Scalar sp = sin(euler[1]), cp = cos(euler[1]);
+    const Scalar sy = sin(euler[2]), cy = cos(euler[2]);
+
+    std::array<Scalar, 2> body;
+    body[0] = cy*cp*ned[0] + sy*cp*ned[1] - sp*ned[2];
+    body[1] = (-sy*cr + cy*sp*sr)*ned[0] + (cy*cr + sy*sp*sr)*ned[1] + cp*sr*ned[2];
+    return body;
+}
+
+/**
+ * The roll and pitch that tilt the thrust to give a body acceleration: pitch
+ * forward (negative) to accelerate along x, then roll about the pitched x
+ * axis for y.
+ */
+template <typename Scalar>
+std::array<Scalar, 2> feed_forward_attitude(Scalar x_acceleration, Scalar y_acceleration, Scalar gravity)
+{
+    using std::atan2;
+    using std::hypot;
+    std::array<Scalar, 2> attitude;
+    attitude[1] = -atan2(x_acceleration, gravity);
+    attitude[0] = atan2(y_acceleration, hypot(x_acceleration, gravity));
+    return attitude;
+}
+
+/**
+ * The roll and pitch of tail_sbf which give the NED horizontal forces while
+ * balancing the tail rotor's thrust against the main rotor's countertorque.
+ * @param tail_offset distance from the main to the tail hub along x in m
+ */
+template <typename Scalar>
+std::array<Scalar, 2> sbf_attitude(Scalar heading, Scalar north_force, Scalar east_force,
+                                   Scalar mass, Scalar gravity, Scalar tail_offset)
+{
+    using std::atan;
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+    // countertorque approximate slope
+    const Scalar alpham = 0.04;
+
+    const Scalar ch = cos(heading), sh = sin(heading);
+    const Scalar body_x = mass*(ch*north_force + sh*east_force);
+    const Scalar body_y = mass*(ch*east_force - sh*north_force);
+    const Scalar body_z = -mass*gravity;
+    const Scalar xz = sqrt(body_x*body_x + body_z*body_z);
+
+    std::array<Scalar, 2> attitude;
+    attitude[1] = atan(body_x/body_z);
+    attitude[0] = -atan((alpham*xz + tail_offset*body_y)/(alpham*body_y - tail_offset*xz));
+    return attitude;
+}
+
+/**
+ * Where a circle is after some time, as an angle.
+ * @param phase time in to the current lap in seconds, reduced in double so a
+ * long flight keeps its precision
+ */
+template <typename Scalar>
+Scalar circle_angle(Scalar phase, Scalar period, Scalar initial_angle)
+{
+    return 2*static_cast<Scalar>(M_PI)*phase/period + initial_angle;
+}
+
+/// north and east offset from the centre of a circle
+template <typename Scalar>
+std::array<Scalar, 2> circle_offset(Scalar radius, Scalar angle)
+{
+    using std::cos;
+    using std::sin;
+    std::array<Scalar, 2> offset;
+    offset[0] = radius*cos(angle);
+    offset[1] = radius*sin(angle);
+    return offset;
+}
+
+/// north and east velocity along a circle
+template <typename Scalar>
+std::array<Scalar, 2> circle_velocity(Scalar radius, Scalar period, Scalar angle)
+{
+    using std::cos;
+    using std::sin;
+    const Scalar omega = 2*static_cast<Scalar>(M_PI)/period;
+    std::array<Scalar, 2> velocity;
+    velocity[0] = -omega*radius*sin(angle);
+    velocity[1] = omega*radius*cos(angle);
+    return velocity;
+}
+
+/// north and east acceleration along a circle
+template <typename Scalar>
+std::array<Scalar, 2> circle_acceleration(Scalar radius, Scalar period, Scalar angle)
+{
+    using std::cos;
+    using std::sin;
+    const Scalar omega = 2*static_cast<Scalar>(M_PI)/period;
+    std::array<Scalar, 2> acceleration;
+    acceleration[0] = -omega*omega*radius*cos(angle);
+    acceleration[1] = -omega*omega*radius*sin(angle);
+    return acceleration;
+}
+
+/**
+ * Velocity along a line flown at constant speed.
+ * @param travel end minus start of the line in m
+ */
+template <typename Scalar>
+std::array<Scalar, 3> line_velocity(const std::array<Scalar, 3>& travel, Scalar flight_time)
+{
+    std::array<Scalar, 3> velocity;
+    for (size_t i = 0; i < 3; ++i)
+        velocity[i] = travel[i]/flight_time;
+    return velocity;
+}
+
+/// Offset from the start of a line after elapsed of flight_time seconds.
+template <typename Scalar>
+std::array<Scalar, 3> line_offset(const std::array<Scalar, 3>& travel, Scalar elapsed, Scalar flight_time)
+{
+    const Scalar fraction = elapsed/flight_time;
+    std::array<Scalar, 3> offset;
+    for (size_t i = 0; i < 3; ++i)
+        offset[i] = travel[i]*fraction;
+    return offset;
+}
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "controller_math.h"
+#include <gtest/gtest.h>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <cmath>
+
+namespace
+{
+const double GRAVITY = 9.81;
+
+/// NED to body rotation built the long way, Rx(roll)^T Ry(pitch)^T Rz(yaw)^T
+blas::matrix<double> ned_to_body(double roll, double pitch, double yaw)
+{
+    blas::matrix<double> rx(blas::identity_matrix<double>(3)), ry(rx), rz(rx);
+    rx(1,1) = cos(roll);  rx(1,2) = -sin(roll);  rx(2,1) = sin(roll);   rx(2,2) = cos(roll);
+    ry(0,0) = cos(pitch); ry(0,2) = sin(pitch);  ry(2,0) = -sin(pitch); ry(2,2) = cos(pitch);
+    rz(0,0) = cos(yaw);   rz(0,1) = -sin(yaw);   rz(1,0) = sin(yaw);    rz(1,1) = cos(yaw);
+    blas::matrix<double> yaw_pitch(prod(rz, ry));
+    blas::matrix<double> body_to_ned(prod(yaw_pitch, rx));
+    return trans(body_to_ned);
+}
+
+template <typename Scalar>
+std::array<Scalar, 3> triple(double a, double b, double c)
+{
+    std::array<Scalar, 3> t = {{static_cast<Scalar>(a), static_cast<Scalar>(b), static_cast<Scalar>(c)}};
+    return t;
+}
+}
+
+TEST(controller_math, BODY_XY_MATCHES_THE_ROTATION_MATRIX)
+{
+    const double roll = 0.2, pitch = -0.15, yaw = 2.5;
+    blas::vector<double> ned(3);
+    ned[0] = 1.5; ned[1] = -0.7; ned[2] = 0.3;
+
+    const blas::vector<double> expected(prod(ned_to_body(roll, pitch, yaw), ned));
+    const std::array<double, 2> body(controller_math::body_xy(triple<double>(roll, pitch, yaw), controller_math::to_array<double>(ned)));
+
+    EXPECT_NEAR(expected[0], body[0], 1e-12);
+    EXPECT_NEAR(expected[1], body[1], 1e-12);
+}
+
+TEST(controller_math, SBF_ATTITUDE_MATCHES_THE_BODY_FORCE)
+{
+    const double heading = 0.8, north = 0.6, east = -0.4, mass = 8.0, xt = 1.1;
+    const std::array<double, 2> attitude(controller_math::sbf_attitude(heading, north, east, mass, GRAVITY, xt));
+
+    // body force m*Rz^T*(north, east, -g)
+    const double bx = mass*(cos(heading)*north + sin(heading)*east);
+    const double by = mass*(-sin(heading)*north + cos(heading)*east);
+    const double bz = -mass*GRAVITY;
+    const double xz = sqrt(bx*bx + bz*bz);
+    EXPECT_NEAR(atan(bx/bz), attitude[1], 1e-12);
+    EXPECT_NEAR(-atan((0.04*xz + xt*by)/(0.04*by - xt*xz)), attitude[0], 1e-12);
+}
+
+/// single precision agrees with double to well below what the servos resolve
+TEST(controller_math, FLOAT_MATCHES_DOUBLE)
+{
+    const double radians = 1e-5, metres = 1e-4;
+    for (int i = 0; i < 200; ++i)
+    {
+        const double roll = 0.3*sin(0.37*i), pitch = 0.3*cos(0.51*i), yaw = M_PI*sin(0.13*i);
+        const double e0 = 5*sin(0.29*i), e1 = 5*cos(0.43*i), e2 = sin(0.7*i);
+
+        const std::array<double, 2> body_d(controller_math::body_xy(triple<double>(roll, pitch, yaw), triple<double>(e0, e1, e2)));
+        const std::array<float, 2> body_f(controller_math::body_xy(triple<float>(roll, pitch, yaw), triple<float>(e0, e1, e2)));
+        EXPECT_NEAR(body_d[0], body_f[0], metres);
+        EXPECT_NEAR(body_d[1], body_f[1], metres);
+
+        const std::array<double, 2> ff_d(controller_math::feed_forward_attitude<double>(e0, e1, GRAVITY));
+        const std::array<float, 2> ff_f(controller_math::feed_forward_attitude<float>(e0, e1, GRAVITY));
+        EXPECT_NEAR(ff_d[0], ff_f[0], radians);
+        EXPECT_NEAR(ff_d[1], ff_f[1], radians);
+
+        const std::array<double, 2> sbf_d(controller_math::sbf_attitude<double>(yaw, e0, e1, 8, GRAVITY, 1.1));
+        const std::array<float, 2> sbf_f(controller_math::sbf_attitude<float>(yaw, e0, e1, 8, GRAVITY, 1.1));
+        EXPECT_NEAR(sbf_d[0], sbf_f[0], radians);
+        EXPECT_NEAR(sbf_d[1], sbf_f[1], radians);
+
+        const double radius = 10, period = 200, phase = period*(0.5 + 0.5*sin(0.11*i));
+        const double angle_d = controller_math::circle_angle<double>(phase, period, yaw);
+        const float angle_f = controller_math::circle_angle<float>(phase, period, yaw);
+        EXPECT_NEAR(angle_d, angle_f, radians);
+
+        const std::array<double, 2> offset_d(controller_math::circle_offset<double>(radius, angle_d));
+        const std::array<float, 2> offset_f(controller_math::circle_offset<float>(radius, angle_f));
+        EXPECT_NEAR(offset_d[0], offset_f[0], metres);
+        EXPECT_NEAR(offset_d[1], offset_f[1], metres);
+    }
+}
+
+TEST(controller_math, LINE_OFFSET_FOLLOWS_THE_VELOCITY)
+{
+    const std::array<float, 3> travel(triple<float>(30, -40, 0));
+    const std::array<float, 3> velocity(controller_math::line_velocity(travel, 10.0f));
+    const std::array<float, 3> offset(controller_math::line_offset(travel, 2.5f, 10.0f));
+    for (size_t i = 0; i < 3; ++i)
+        EXPECT_FLOAT_EQ(velocity[i]*2.5f, offset[i]);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "gain_schedule.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <sstream>
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/numeric/ublas/vector.hpp>
+namespace blas = boost::numeric::ublas;
+
+/* Project Headers */
+#include "Configuration.h"
+#include "Debug.h"
+#include "Helicopter.h"
+#include "IMU.h"
+#include "heli.h"
+
+class gain_schedule::table
+{
+public:
+    table(const axis& x, const axis& y, const std::vector<gain_set>& cells)
+        : x(x), y(y)
+    {
+        x_inv_step = (x.points > 1) ? (x.points - 1) / (x.max - x.min) : 0;
+        y_inv_step = (y.points > 1) ? (y.points - 1) / (y.max - y.min) : 0;
+        std::copy(cells.begin(), cells.end(), this->cells.begin());
+    }
+
+    static bool valid(const axis& a)
+    {
+        return a.points >= 1 && a.points <= MAX_POINTS && (a.points == 1 || a.max > a.min);
+    }
+
+    /// find the cell containing v and the fractional position within it
+    static void bracket(const axis& a, double inv_step, double v, int& index, double& frac)
+    {
+        if (a.points < 2)
+        {
+            index = 0;
+            frac = 0;
+            return;
+        }
+        double s = (v - a.min) * inv_step;
+        s = std::max(0.0, std::min(s, static_cast<double>(a.points - 1)));
+        index = std::min(static_cast<int>(s), a.points - 2);
+        frac = s - index;
+    }
+
+    gain_set operator()(const point& at) const
+    {
+        int ix, iy;
+        double fx, fy;
+        bracket(x, x_inv_step, x.variable == NONE ? 0 : at.value[x.variable], ix, fx);
+        bracket(y, y_inv_step, y.variable == NONE ? 0 : at.value[y.variable], iy, fy);
+
+        const int x1 = std::min(ix + 1, x.points - 1);
+        const int y1 = std::min(iy + 1, y.points - 1);
+        const gain_set& g00 = cells[iy*x.points + ix];
+        const gain_set& g10 = cells[iy*x.points + x1];
+        const gain_set& g01 = cells[y1*x.points + ix];
+        const gain_set& g11 = cells[y1*x.points + x1];
+
+        const double w00 = (1 - fx)*(1 - fy);
+        const double w10 = fx*(1 - fy);
+        const double w01 = (1 - fx)*fy;
+        const double w11 = fx*fy;
+
+        gain_set g;
+        g.proportional = w00*g00.proportional + w10*g10.proportional + w01*g01.proportional + w11*g11.proportional;
+        g.derivative = w00*g00.derivative + w10*g10.derivative + w01*g01.derivative + w11*g11.derivative;
+        g.integral = w00*g00.integral + w10*g10.integral + w01*g01.integral + w11*g11.integral;
+        return g;
+    }
+
+    int size() const
+    {
+        return x.points * y.points;
+    }
+
+    axis x;
+    axis y;
+    double x_inv_step;
+    double y_inv_step;
+    std::array<gain_set, MAX_POINTS*MAX_POINTS> cells;
+};
+
+gain_schedule::point gain_schedule::point::sample()
+{
+    point p;
+    p.value.fill(0);
+
+    IMU* imu = IMU::getInstance();
+    blas::vector<double> velocity(imu->get_ned_velocity());
+    p.value[AIRSPEED] = std::sqrt(velocity(0)*velocity(0) + velocity(1)*velocity(1));
+    p.value[ALTITUDE] = -imu->get_ned_position()(2);
+    p.value[COLLECTIVE] = Helicopter::getInstance()->get_main_collective();
+
+    return p;
+}
+
+gain_schedule::gain_schedule()
+{
+}
+
+gain_schedule::gain_schedule(const gain_schedule& other)
+    : _table(other.load()),
+      _param_prefix(other._param_prefix)
+{
+}
+
+gain_schedule& gain_schedule::operator=(const gain_schedule& other)
+{
+    std::atomic_store(&_table, other.load());
+    _param_prefix = other._param_prefix;
+    return *this;
+}
+
+std::shared_ptr<const gain_schedule::table> gain_schedule::load() const
+{
+    return std::atomic_load(&_table);
+}
+
+bool gain_schedule::enabled() const
+{
+    return load() != nullptr;
+}
+
+bool gain_schedule::lookup(const point& at, gain_set& gains) const
+{
+    std::shared_ptr<const table> current(load());
+    if (!current)
+        return false;
+
+    gains = (*current)(at);
+    return true;
+}
+
+bool gain_schedule::set_table(const axis& x, const axis& y, const std::vector<gain_set>& cells)
+{
+    if (x.variable == NONE || !table::valid(x) || !table::valid(y))
+        return false;
+    if (cells.size() != static_cast<size_t>(x.points * y.points))
+        return false;
+
+    std::atomic_store(&_table, std::shared_ptr<const table>(new table(x, y, cells)));
+    return true;
+}
+
+void gain_schedule::clear()
+{
+    std::atomic_store(&_table, std::shared_ptr<const table>());
+}
+
+namespace
+{
+
+gain_schedule::axis parse_axis(Configuration* cfg, const std::string& prefix)
+{
+    gain_schedule::axis a;
+    int variable = cfg->geti(prefix + ".variable", gain_schedule::NONE);
+    if (variable <= gain_schedule::NONE || variable >= gain_schedule::SCHEDULING_VARIABLES)
+        return a;
+
+    a.variable = static_cast<gain_schedule::scheduling_variable>(variable);
+    a.min = cfg->getd(prefix + ".min", 0);
+    a.max = cfg->getd(prefix + ".max", 0);
+    a.points = cfg->geti(prefix + ".points", 1);
+    return a;
+}
+
+void save_axis(Configuration* cfg, const std::string& prefix, const gain_schedule::axis& a)
+{
+    cfg->seti(prefix + ".variable", a.variable);
+    cfg->setd(prefix + ".min", a.min);
+    cfg->setd(prefix + ".max", a.max);
+    cfg->seti(prefix + ".points", a.points);
+}
+
+/// parses a string delimited by commas in to doubles
+std::vector<double> parse_list(const std::string& input)
+{
+    std::vector<double> output;
+    std::vector<std::string> strs;
+    boost::split(strs, input, boost::is_any_of(","));
+    for (std::string& s : strs)
+    {
+        boost::algorithm::trim(s);
+        if (s.empty())
+            continue;
+        try
+        {
+            output.push_back(boost::lexical_cast<double>(s));
+        }
+        catch (const boost::bad_lexical_cast&)
+        {
+            return std::vector<double>();
+        }
+    }
+    return output;
+}
+
+const char* const GAIN_SUFFIX[3] = {"_KP_", "_KD_", "_KI_"};
+
+}
+
+void gain_schedule::parse_xml_node(const std::string& xml_prefix)
+{
+    Configuration* cfg = Configuration::getInstance();
+
+    axis x(parse_axis(cfg, xml_prefix + ".x"));
+    axis y(parse_axis(cfg, xml_prefix + ".y"));
+    if (x.variable == NONE)
+    {
+        clear();
+        return;
+    }
+
+    if (!table::valid(x) || !table::valid(y))
+    {
+        Logger("Gain Schedule").warning() << xml_prefix << ": invalid breakpoints, schedule disabled";
+        clear();
+        return;
+    }
+
+    std::vector<double> kp(parse_list(cfg->gets(xml_prefix + ".proportional")));
+    std::vector<double> kd(parse_list(cfg->gets(xml_prefix + ".derivative")));
+    std::vector<double> ki(parse_list(cfg->gets(xml_prefix + ".integral")));
+
+    const size_t size = x.points * y.points;
+    std::vector<gain_set> cells(size);
+    if (kp.size() != size || kd.size() != size || ki.size() != size)
+    {
+        Logger("Gain Schedule").warning() << xml_prefix << ": expected " << size << " gains per table, schedule disabled";
+        clear();
+        return;
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        cells[i].proportional = kp[i];
+        cells[i].derivative = kd[i];
+        cells[i].integral = ki[i];
+    }
+
+    set_table(x, y, cells);
+}
+
+void gain_schedule::get_xml_node(const std::string& xml_prefix) const
+{
+    std::shared_ptr<const table> current(load());
+    if (!current)
+        return;
+
+    Configuration* cfg = Configuration::getInstance();
+    save_axis(cfg, xml_prefix + ".x", current->x);
+    save_axis(cfg, xml_prefix + ".y", current->y);
+
+    std::stringstream kp, kd, ki;
+    for (int i = 0; i < current->size(); ++i)
+    {
+        const char* sep = (i == 0) ? "" : ", ";
+        kp << sep << current->cells[i].proportional;
+        kd << sep << current->cells[i].derivative;
+        ki << sep << current->cells[i].integral;
+    }
+    cfg->set(xml_prefix + ".proportional", kp.str());
+    cfg->set(xml_prefix + ".derivative", kd.str());
+    cfg->set(xml_prefix + ".integral", ki.str());
+}
+
+void gain_schedule::getParameters(std::vector<Parameter>& plist) const
+{
+    std::shared_ptr<const table> current(load());
+    if (!current)
+        return;
+
+    for (int i = 0; i < current->size(); ++i)
+    {
+        const std::string index(std::to_string(i));
+        plist.push_back(Parameter(_param_prefix + GAIN_SUFFIX[0] + index, current->cells[i].proportional, heli::CONTROLLER_ID));
+        plist.push_back(Parameter(_param_prefix + GAIN_SUFFIX[1] + index, current->cells[i].derivative, heli::CONTROLLER_ID));
+        plist.push_back(Parameter(_param_prefix + GAIN_SUFFIX[2] + index, current->cells[i].integral, heli::CONTROLLER_ID));
+    }
+}
+
+bool gain_schedule::setParameter(const std::string& param_id, double value)
+{
+    if (_param_prefix.empty() || param_id.compare(0, _param_prefix.size(), _param_prefix) != 0)
+        return false;
+
+    const std::string rest(param_id.substr(_param_prefix.size()));
+    for (int gain = 0; gain < 3; ++gain)
+    {
+        const std::string suffix(GAIN_SUFFIX[gain]);
+        if (rest.compare(0, suffix.size(), suffix) != 0)
+            continue;
+
+        int index = -1;
+        try
+        {
+            index = boost::lexical_cast<int>(rest.substr(suffix.size()));
+        }
+        catch (const boost::bad_lexical_cast&)
+        {
+            return false;
+        }
+
+        // copy on write so the control thread keeps using a consistent table
+        std::shared_ptr<const table> current(load());
+        while (current && index >= 0 && index < current->size())
+        {
+            std::shared_ptr<table> next(new table(*current));
+            gain_set& cell = next->cells[index];
+            if (gain == 0)
+                cell.proportional = value;
+            else if (gain == 1)
+                cell.derivative = value;
+            else
+                cell.integral = value;
+
+            std::shared_ptr<const table> published(next);
+            if (std::atomic_compare_exchange_strong(&_table, &current, published))
+                return true;
+        }
+        return false;
+    }
+    return false;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef GAIN_SCHEDULE_H_
+#define GAIN_SCHEDULE_H_
+
+/* STL Headers */
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Project Headers */
+#include "Parameter.h"
+
+/**
+ * @brief Gain schedule for a single pid_channel
+ *
+ * The gains are stored in a precomputed table over one or two scheduling
+ * variables (airspeed, altitude or collective) with evenly spaced breakpoints,
+ * so finding the bracketing cell is a single multiply and the gains are
+ * bilinearly interpolated between the four surrounding entries.
+ *
+ * Tables are immutable once published.  A change from the GCS or the
+ * configuration builds a new table and swaps it in atomically so the control
+ * thread never observes a partially updated table.
+ *
+ * Configuration (under the prefix given to parse_xml_node):
+ * - x.variable, y.variable: scheduling_variable, y is optional
+ * - x.min, x.max, x.points (and y.*): breakpoint range and count
+ * - proportional, derivative, integral: comma separated tables, x varies fastest
+ *
+ * Each table entry is exposed to QGC as <prefix>_KP_<n>, <prefix>_KD_<n> and <prefix>_KI_<n>.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class gain_schedule
+{
+public:
+    enum scheduling_variable
+    {
+        NONE = 0,
+        /// horizontal speed in m/s, from the nav filter since there is no air data
+        AIRSPEED,
+        /// height above the ned origin in m
+        ALTITUDE,
+        /// main rotor collective in degrees
+        COLLECTIVE,
+        SCHEDULING_VARIABLES
+    };
+
+    /// largest number of breakpoints on one axis
+    static const int MAX_POINTS = 8;
+
+    /// one set of scheduled gains
+    struct gain_set
+    {
+        double proportional;
+        double derivative;
+        double integral;
+    };
+
+    /// breakpoints along one scheduling variable
+    struct axis
+    {
+        axis() : variable(NONE), min(0), max(0), points(1) {}
+
+        scheduling_variable variable;
+        double min;
+        double max;
+        int points;
+    };
+
+    /**
+     * The value of every scheduling variable at one instant.  Sample it once
+     * per control iteration and share it between all the channels.
+     */
+    struct point
+    {
+        std::array<double, SCHEDULING_VARIABLES> value;
+
+        /// read the current scheduling variables from the IMU and Helicopter
+        static point sample();
+    };
+
+    gain_schedule();
+    gain_schedule(const gain_schedule& other);
+    gain_schedule& operator=(const gain_schedule& other);
+
+    /// @returns the parameter id prefix as lvalue
+    std::string& param_prefix()
+    {
+        return _param_prefix;
+    }
+
+    /// @returns true if a table is loaded
+    bool enabled() const;
+
+    /**
+     * Interpolate the gains at the given point.
+     * @returns false if the schedule is disabled, gains is unchanged in that case
+     */
+    bool lookup(const point& at, gain_set& gains) const;
+
+    /**
+     * Build and publish a new table.
+     * @param cells x.points * y.points gains, x varies fastest
+     * @returns false if the table is malformed, the current table is kept
+     */
+    bool set_table(const axis& x, const axis& y, const std::vector<gain_set>& cells);
+
+    /// remove the table so the channel falls back to its fixed gains
+    void clear();
+
+    /// load the table from the configuration
+    void parse_xml_node(const std::string& xml_prefix);
+    /// save the table to the configuration
+    void get_xml_node(const std::string& xml_prefix) const;
+
+    /// append the table entries to plist
+    void getParameters(std::vector<Parameter>& plist) const;
+    /**
+     * Set one table entry from QGC
+     * @returns false if param_id does not belong to this schedule
+     */
+    bool setParameter(const std::string& param_id, double value);
+
+private:
+    class table;
+
+    std::shared_ptr<const table> load() const;
+
+    /// current table, only accessed with std::atomic_load / std::atomic_store
+    std::shared_ptr<const table> _table;
+    std::string _param_prefix;
+};
+
+#endif
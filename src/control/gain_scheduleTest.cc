@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "gain_schedule.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+gain_schedule::gain_set gains(double kp, double kd, double ki)
+{
+    gain_schedule::gain_set g;
+    g.proportional = kp;
+    g.derivative = kd;
+    g.integral = ki;
+    return g;
+}
+
+gain_schedule::point at(double airspeed, double collective)
+{
+    gain_schedule::point p;
+    p.value.fill(0);
+    p.value[gain_schedule::AIRSPEED] = airspeed;
+    p.value[gain_schedule::COLLECTIVE] = collective;
+    return p;
+}
+
+}
+
+// TESTS
+TEST(GainSchedule, NO_TABLE)
+{
+    gain_schedule schedule;
+    gain_schedule::gain_set g(gains(7, 7, 7));
+
+    EXPECT_FALSE(schedule.enabled());
+    EXPECT_FALSE(schedule.lookup(at(0, 0), g));
+    EXPECT_EQ(7, g.proportional);
+}
+
+TEST(GainSchedule, INTERPOLATE_1D)
+{
+    gain_schedule schedule;
+    gain_schedule::axis x;
+    x.variable = gain_schedule::AIRSPEED;
+    x.min = 0;
+    x.max = 10;
+    x.points = 3;
+
+    std::vector<gain_schedule::gain_set> cells {gains(1, 0, 0), gains(2, 1, 0), gains(4, 1, 1)};
+    ASSERT_TRUE(schedule.set_table(x, gain_schedule::axis(), cells));
+
+    gain_schedule::gain_set g;
+    ASSERT_TRUE(schedule.lookup(at(2.5, 0), g));
+    EXPECT_DOUBLE_EQ(1.5, g.proportional);
+    EXPECT_DOUBLE_EQ(0.5, g.derivative);
+
+    ASSERT_TRUE(schedule.lookup(at(7.5, 0), g));
+    EXPECT_DOUBLE_EQ(3, g.proportional);
+    EXPECT_DOUBLE_EQ(0.5, g.integral);
+
+    // clamped outside the table
+    ASSERT_TRUE(schedule.lookup(at(-5, 0), g));
+    EXPECT_DOUBLE_EQ(1, g.proportional);
+    ASSERT_TRUE(schedule.lookup(at(50, 0), g));
+    EXPECT_DOUBLE_EQ(4, g.proportional);
+}
+
+TEST(GainSchedule, INTERPOLATE_2D)
+{
+    gain_schedule schedule;
+    gain_schedule::axis x, y;
+    x.variable = gain_schedule::AIRSPEED;
+    x.min = 0;
+    x.max = 10;
+    x.points = 2;
+    y.variable = gain_schedule::COLLECTIVE;
+    y.min = 0;
+    y.max = 4;
+    y.points = 2;
+
+    std::vector<gain_schedule::gain_set> cells {gains(0, 0, 0), gains(1, 0, 0), gains(2, 0, 0), gains(3, 0, 0)};
+    ASSERT_TRUE(schedule.set_table(x, y, cells));
+
+    gain_schedule::gain_set g;
+    ASSERT_TRUE(schedule.lookup(at(5, 2), g));
+    EXPECT_DOUBLE_EQ(1.5, g.proportional);
+    ASSERT_TRUE(schedule.lookup(at(10, 0), g));
+    EXPECT_DOUBLE_EQ(1, g.proportional);
+    ASSERT_TRUE(schedule.lookup(at(0, 4), g));
+    EXPECT_DOUBLE_EQ(2, g.proportional);
+}
+
+TEST(GainSchedule, REJECT_MALFORMED_TABLE)
+{
+    gain_schedule schedule;
+    gain_schedule::axis x;
+    x.variable = gain_schedule::AIRSPEED;
+    x.min = 0;
+    x.max = 10;
+    x.points = 3;
+
+    std::vector<gain_schedule::gain_set> cells {gains(1, 0, 0), gains(2, 0, 0)};
+    EXPECT_FALSE(schedule.set_table(x, gain_schedule::axis(), cells));
+
+    x.points = gain_schedule::MAX_POINTS + 1;
+    cells.resize(x.points);
+    EXPECT_FALSE(schedule.set_table(x, gain_schedule::axis(), cells));
+    EXPECT_FALSE(schedule.enabled());
+}
+
+TEST(GainSchedule, SET_PARAMETER)
+{
+    gain_schedule schedule;
+    schedule.param_prefix() = "GS_TEST";
+    gain_schedule::axis x;
+    x.variable = gain_schedule::AIRSPEED;
+    x.min = 0;
+    x.max = 10;
+    x.points = 2;
+
+    std::vector<gain_schedule::gain_set> cells {gains(1, 1, 1), gains(1, 1, 1)};
+    ASSERT_TRUE(schedule.set_table(x, gain_schedule::axis(), cells));
+
+    std::vector<Parameter> plist;
+    schedule.getParameters(plist);
+    EXPECT_EQ(6u, plist.size());
+
+    EXPECT_TRUE(schedule.setParameter("GS_TEST_KD_1", 5));
+    EXPECT_FALSE(schedule.setParameter("GS_TEST_KD_2", 5));
+    EXPECT_FALSE(schedule.setParameter("GS_OTHER_KD_1", 5));
+
+    gain_schedule::gain_set g;
+    ASSERT_TRUE(schedule.lookup(at(10, 0), g));
+    EXPECT_DOUBLE_EQ(5, g.derivative);
+    EXPECT_DOUBLE_EQ(1, g.proportional);
+}
@@ -83,9 +83,9 @@ blas::vector<double> line::get_reference_position() const
     }
     else if ((elapsed_time - hover_time) <= flight_time)
     {
-        elapsed_time -= hover_time;
-        blas::vector<double> ned_velocity((get_end_location() - get_start_location())/flight_time);
-        return get_start_location() + ned_velocity*elapsed_time;
+        const std::array<trajectory_scalar, 3> travel(controller_math::to_array<trajectory_scalar>(get_end_location() - get_start_location()));
+        return get_start_location() + controller_math::to_vector(controller_math::line_offset<trajectory_scalar>(
+                travel, elapsed_time - hover_time, flight_time));
     }
     else
     {
@@ -93,6 +93,22 @@ blas::vector<double> line::get_reference_position() const
     }
 }
 
+blas::vector<double> line::get_reference_velocity() const
+{
+    double elapsed_time = getMsSinceInit() / 1000.0;
+    double flight_time = (get_speed() > 0 ? get_distance()/get_speed() : 0);
+    double hover_time = get_hover_time();
+    if (flight_time == 0 || elapsed_time <= hover_time || (elapsed_time - hover_time) > flight_time)
+    {
+        return blas::zero_vector<double>(3);
+    }
+    else
+    {
+        const std::array<trajectory_scalar, 3> travel(controller_math::to_array<trajectory_scalar>(get_end_location() - get_start_location()));
+        return controller_math::to_vector(controller_math::line_velocity<trajectory_scalar>(travel, flight_time));
+    }
+}
+
 double line::get_distance() const
 {
     return norm_2(get_end_location() - get_start_location());
@@ -36,6 +36,8 @@ namespace blas = boost::numeric::ublas;
 #include "Debug.h"
 #include "Parameter.h"
 #include "Timer.hpp"
+#include "controller_math.h"
+#include "scalar_types.h"
 
 /**
  * Reference line trajectory generator
@@ -48,6 +50,16 @@ public:
     line();
     /// return the reference position for the current time
     blas::vector<double> get_reference_position() const;
+    /// return the reference velocity in the NED frame for the current time
+    blas::vector<double> get_reference_velocity() const;
+    /**
+     * return the reference acceleration for the current time, always zero
+     * since the line is flown at constant speed
+     */
+    blas::vector<double> get_reference_acceleration() const
+    {
+        return blas::zero_vector<double>(3);
+    }
 
     /// reset the trajectory to begin from the current location
     void reset();
@@ -20,22 +20,152 @@
 
 #include "pid_channel.h"
 
-pid_channel::pid_channel(double integrator_limit)
-    :_error(integrator_limit)
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+
+/* Project Headers */
+#include "Configuration.h"
+
+template <typename Scalar>
+const Scalar basic_pid_channel<Scalar>::MAX_DT = 0.1;
+
+template <typename Scalar>
+basic_pid_channel<Scalar>::basic_pid_channel(Scalar integrator_limit)
+    :_error(integrator_limit),
+     _anti_windup(WINDUP_CONDITIONAL),
+     _tracking_time(0.5),
+     _derivative_tau(0)
 {
 
 }
 
-double pid_channel::compute_pid()
+template <typename Scalar>
+Scalar basic_pid_channel<Scalar>::compute_pid()
 {
     return - gains().getProportional() * error().getProportional() -
            gains().getDerivative() * error().getDerivative() -
            gains().getIntegral() * error().getIntegral();
 }
 
+template <typename Scalar>
+Scalar basic_pid_channel<Scalar>::compute_pid(const gain_schedule::point& at)
+{
+    const gain_schedule::gain_set k(gains_at(at));
+    return - k.proportional * error().getProportional() -
+           k.derivative * error().getDerivative() -
+           k.integral * error().getIntegral();
+}
+
+template <typename Scalar>
+Scalar basic_pid_channel<Scalar>::compute_pid(Scalar dt, Scalar bound, const gain_schedule::point& at)
+{
+    dt = std::min(std::max(dt, Scalar(0)), MAX_DT);
+    const gain_schedule::gain_set k(gains_at(at));
+    const Scalar kp = k.proportional, kd = k.derivative, ki = k.integral;
+
+    const Scalar derivative = error().filterDerivative(dt, _derivative_tau);
+    const Scalar proportional = error().getProportional();
+    const Scalar increment = error().integralIncrement(dt);
+    const Scalar limit = error().getIntegralLimit();
+    auto effort = [&](Scalar integral)
+    {
+        return - kp * proportional - kd * derivative - ki * integral;
+    };
+
+    Scalar integral = error().getIntegral() + increment;
+    const Scalar unsaturated = effort(integral);
+    const Scalar excess = unsaturated - std::min(std::max(unsaturated, -bound), bound);
+
+    if (excess != 0 && ki != 0)
+    {
+        if (_anti_windup == WINDUP_CONDITIONAL && (- ki * increment) * excess > 0)
+            integral -= increment;
+        else if (_anti_windup == WINDUP_BACK_CALCULATION && _tracking_time > 0)
+            integral += excess / (ki * _tracking_time) * dt;
+    }
+
+    integral = std::min(std::max(integral, -limit), limit);
+    error().setIntegral(integral);
+
+    return std::min(std::max(effort(integral), -bound), bound);
+}
+
+template <typename Scalar>
+gain_schedule::gain_set basic_pid_channel<Scalar>::gains_at(const gain_schedule::point& at) const
+{
+    gain_schedule::gain_set k;
+    if (schedule().lookup(at, k))
+        return k;
+
+    k.proportional = gains().getProportional();
+    k.derivative = gains().getDerivative();
+    k.integral = gains().getIntegral();
+    return k;
+}
+
+template <typename Scalar>
+typename basic_pid_channel<Scalar>::anti_windup basic_pid_channel<Scalar>::parse_anti_windup(const std::string& name)
+{
+    if (name == "none")
+        return WINDUP_NONE;
+    if (name == "back_calculation")
+        return WINDUP_BACK_CALCULATION;
+    return WINDUP_CONDITIONAL;
+}
+
+template <typename Scalar>
+std::string basic_pid_channel<Scalar>::anti_windup_name(anti_windup method)
+{
+    switch (method)
+    {
+    case WINDUP_NONE:
+        return "none";
+    case WINDUP_BACK_CALCULATION:
+        return "back_calculation";
+    default:
+        return "conditional";
+    }
+}
+
+template <typename Scalar>
+void basic_pid_channel<Scalar>::parse_xml_node(const std::string& xml_prefix)
+{
+    Configuration* cfg = Configuration::getInstance();
+
+    cfg->describe(xml_prefix + ".anti_windup", "none/conditional/back_calculation",
+                  "How the integral is held back while the output is saturated.");
+    set_anti_windup(parse_anti_windup(cfg->gets(xml_prefix + ".anti_windup", anti_windup_name(_anti_windup))));
+
+    cfg->describe(xml_prefix + ".tracking_time", "> 0",
+                  "Time back calculation removes the saturation excess from the integral over.", "s");
+    set_tracking_time(cfg->getd(xml_prefix + ".tracking_time", _tracking_time));
+
+    cfg->describe(xml_prefix + ".derivative_filter_hz", ">= 0",
+                  "Cutoff of the low pass on the derivative error, 0 to leave it unfiltered.", "hz");
+    const double cutoff = cfg->getd(xml_prefix + ".derivative_filter_hz", _derivative_tau > 0 ? 1 / (2 * M_PI * _derivative_tau) : 0);
+    set_derivative_time_constant(cutoff > 0 ? 1 / (2 * M_PI * cutoff) : 0);
+}
+
+template <typename Scalar>
+void basic_pid_channel<Scalar>::get_xml_node(const std::string& xml_prefix) const
+{
+    Configuration* cfg = Configuration::getInstance();
+
+    cfg->set(xml_prefix + ".anti_windup", anti_windup_name(_anti_windup));
+    cfg->setd(xml_prefix + ".tracking_time", _tracking_time);
+    cfg->setd(xml_prefix + ".derivative_filter_hz", _derivative_tau > 0 ? 1 / (2 * M_PI * _derivative_tau) : 0);
+}
+
 /* global functions */
 
-Debug& operator<<(Debug& dbg, const pid_channel& ch)
+template <typename Scalar>
+Debug& operator<<(Debug& dbg, const basic_pid_channel<Scalar>& ch)
 {
     return dbg << "Channel " << ch.name() << ", error values: " << ch.error() << ", gain values: " << ch.gains();
 }
+
+template class basic_pid_channel<float>;
+template class basic_pid_channel<double>;
+template Debug& operator<<(Debug& dbg, const basic_pid_channel<float>& ch);
+template Debug& operator<<(Debug& dbg, const basic_pid_channel<double>& ch);
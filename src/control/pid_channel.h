@@ -21,22 +21,51 @@
 #ifndef PID_CHANNEL_H_
 #define PID_CHANNEL_H_
 
+/* STL Headers */
+#include <string>
+
 /* Project Headers */
 #include "pid_gains.h"
 #include "pid_error.h"
+#include "gain_schedule.h"
 #include "Debug.h"
 
+template <typename Scalar>
+class basic_pid_channel;
+
+template <typename Scalar>
+Debug& operator<<(Debug& dbg, const basic_pid_channel<Scalar>& ch);
+
 /**
  * @brief this class contains all the relevant information for a channel
+ *
+ * The errors and the effort are computed in Scalar, the gains are kept as
+ * double parameters and converted each tick.  Instantiated for float and
+ * double, see scalar_types.h.
  * @author Bryan Godbolt <godbolt@ece.ualberta.ca>
  * @date October 27, 2011: Class creation
  * @date February 10, 2012: Refactor out of Control
  * @date October 15, 2012: Added constructor to allow setting integrator reset limit
  */
-class pid_channel
+template <typename Scalar>
+class basic_pid_channel
 {
 public:
-    pid_channel(double integrator_limit = 1);
+    /// how the integral is kept from winding up while the output is saturated
+    enum anti_windup
+    {
+        /// only the integral error limit
+        WINDUP_NONE,
+        /// skip integrating when it would drive the output further in to saturation
+        WINDUP_CONDITIONAL,
+        /// bleed the integral by the saturation excess over the tracking time
+        WINDUP_BACK_CALCULATION
+    };
+
+    /// a longer timestep, e.g. the first after a stall, is integrated as this long
+    static const Scalar MAX_DT;
+
+    basic_pid_channel(Scalar integrator_limit = 1);
 
     /**
      * @returns gains as lvalue
@@ -55,17 +84,31 @@ public:
     /**
      * @returns error object as lvalue
      */
-    pid_error& error()
+    basic_pid_error<Scalar>& error()
     {
         return _error;
     }
     /**
      * @returns error object as rvalue
      */
-    const pid_error& error() const
+    const basic_pid_error<Scalar>& error() const
     {
         return _error;
     }
+    /**
+     * @returns gain schedule as lvalue
+     */
+    gain_schedule& schedule()
+    {
+        return _schedule;
+    }
+    /**
+     * @returns gain schedule as rvalue
+     */
+    const gain_schedule& schedule() const
+    {
+        return _schedule;
+    }
     /**
      * @returns name of channel as lvalue
      */
@@ -80,14 +123,10 @@ public:
     {
         return _name;
     }
-    /**
-     * stream insertion operator for outputing the state of the object
-     */
-    friend std::ostream& operator<<(std::ostream& os, const pid_channel& ch);
     /**
      * stream insertion for debugging object
      */
-    friend Debug& operator<<(Debug& dbg, const pid_channel& ch);
+    friend Debug& operator<< <>(Debug& dbg, const basic_pid_channel& ch);
 
     void reset()
     {
@@ -98,16 +137,76 @@ public:
      * Perform actual PID computation
      * @returns computed control effort for this channel
      */
-    double compute_pid();
+    Scalar compute_pid();
+
+    /**
+     * Perform the PID computation using the scheduled gains at the given point.
+     * Falls back to the fixed gains if no schedule is loaded.
+     * @returns computed control effort for this channel
+     */
+    Scalar compute_pid(const gain_schedule::point& at);
+
+    /**
+     * Advance the channel by one tick and compute its control effort.
+     *
+     * Set the proportional and derivative errors first.  The derivative is
+     * filtered, the proportional error integrated by the trapezoid rule over
+     * the measured timestep dt and the integral held back by the anti-windup
+     * against the effort saturated to +/- bound, as Control::saturate does.
+     *
+     * @returns the saturated control effort for this channel
+     */
+    Scalar compute_pid(Scalar dt, Scalar bound, const gain_schedule::point& at);
+
+    void set_anti_windup(anti_windup method)
+    {
+        _anti_windup = method;
+    }
+    anti_windup get_anti_windup() const
+    {
+        return _anti_windup;
+    }
+    /// time constant back calculation removes the saturation excess over, seconds
+    void set_tracking_time(Scalar seconds)
+    {
+        _tracking_time = seconds;
+    }
+    /// time constant of the derivative filter in seconds, 0 to turn it off
+    void set_derivative_time_constant(Scalar seconds)
+    {
+        _derivative_tau = seconds;
+    }
+
+    /// parse none, conditional or back_calculation, conditional if unknown
+    static anti_windup parse_anti_windup(const std::string& name);
+    static std::string anti_windup_name(anti_windup method);
+
+    /**
+     * Load the anti-windup and derivative filter from the configuration:
+     * xml_prefix.anti_windup, xml_prefix.tracking_time and
+     * xml_prefix.derivative_filter_hz (0 leaves the derivative unfiltered).
+     */
+    void parse_xml_node(const std::string& xml_prefix);
+    /// Save the settings parse_xml_node() loads
+    void get_xml_node(const std::string& xml_prefix) const;
 private:
+    /// the scheduled gains at the point, or the fixed gains without a schedule
+    gain_schedule::gain_set gains_at(const gain_schedule::point& at) const;
+
     /// Store the gains for the channels being controlled
     pid_gains _gains;
     /// Store the errors for the channels being controlled
-    pid_error _error;
+    basic_pid_error<Scalar> _error;
+    /// Store the gain schedule, overrides _gains when enabled
+    gain_schedule _schedule;
     /// Store the name of the channel
     std::string _name;
+
+    anti_windup _anti_windup;
+    Scalar _tracking_time;
+    Scalar _derivative_tau;
 };
 
-Debug& operator<<(Debug& dbg, const pid_channel& ch);
+typedef basic_pid_channel<double> pid_channel;
 
 #endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "pid_channel.h"
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+gain_schedule::point nowhere()
+{
+    gain_schedule::point p;
+    p.value.fill(0);
+    return p;
+}
+
+pid_channel integrator(double limit = 100)
+{
+    pid_channel ch(limit);
+    ch.gains().setIntegral(1);
+    return ch;
+}
+
+/// integrate sin(t) for one second at rate_hz, with up to jitter of the period added at random
+double integrate_sine(double rate_hz, double jitter)
+{
+    pid_channel ch(integrator());
+    srand(1);
+    double t = 0;
+    ch.error().setProportional(sin(t));
+    ch.compute_pid(0, 100, nowhere());
+    while (t < 1)
+    {
+        const double dt = std::min(1 - t, (1 + jitter * (rand() / double(RAND_MAX) - 0.5)) / rate_hz);
+        t += dt;
+        ch.error().setProportional(sin(t));
+        ch.compute_pid(dt, 100, nowhere());
+    }
+    return ch.error().getIntegral();
+}
+
+}
+
+// TESTS
+TEST(pid_channel, INTEGRAL_INDEPENDENT_OF_RATE)
+{
+    const double exact = 1 - cos(1.0);
+    for (double rate : {50.0, 100.0, 200.0, 400.0})
+    {
+        EXPECT_NEAR(exact, integrate_sine(rate, 0), 1e-4) << rate << " Hz";
+        EXPECT_NEAR(exact, integrate_sine(rate, 0.8), 1e-4) << rate << " Hz with jitter";
+    }
+}
+
+TEST(pid_channel, LIMIT_HOLDS_INSTEAD_OF_RESETTING)
+{
+    pid_channel ch(integrator(0.5));
+    ch.set_anti_windup(pid_channel::WINDUP_NONE);
+    ch.error().setProportional(1);
+    for (int i = 0; i < 100; ++i)
+        ch.compute_pid(0.01, 100, nowhere());
+    EXPECT_DOUBLE_EQ(0.5, ch.error().getIntegral());
+}
+
+TEST(pid_channel, CONDITIONAL_INTEGRATION)
+{
+    pid_channel ch(integrator());
+    ch.gains().setProportional(0.5);
+
+    // effort -0.5 - I saturates at -1 once the integral reaches 0.5
+    ch.error().setProportional(1);
+    for (int i = 0; i < 200; ++i)
+        EXPECT_GE(ch.compute_pid(0.01, 1, nowhere()), -1);
+    EXPECT_NEAR(0.5, ch.error().getIntegral(), 0.011);
+
+    // integrating back out of saturation is allowed straight away
+    ch.error().setProportional(-1);
+    ch.compute_pid(0.01, 1, nowhere());
+    ch.compute_pid(0.01, 1, nowhere());
+    EXPECT_LT(ch.error().getIntegral(), 0.5);
+}
+
+TEST(pid_channel, BACK_CALCULATION)
+{
+    pid_channel ch(integrator());
+    ch.gains().setProportional(0.5);
+    ch.set_anti_windup(pid_channel::WINDUP_BACK_CALCULATION);
+    ch.set_tracking_time(0.05);
+
+    ch.error().setProportional(1);
+    for (int i = 0; i < 500; ++i)
+        ch.compute_pid(0.01, 1, nowhere());
+
+    // the integral settles where the excess bleeds off as fast as the error adds
+    EXPECT_GT(ch.error().getIntegral(), 0.5);
+    EXPECT_LT(ch.error().getIntegral(), 0.6);
+
+    pid_channel unprotected(integrator());
+    unprotected.gains().setProportional(0.5);
+    unprotected.set_anti_windup(pid_channel::WINDUP_NONE);
+    unprotected.error().setProportional(1);
+    for (int i = 0; i < 500; ++i)
+        unprotected.compute_pid(0.01, 1, nowhere());
+    EXPECT_NEAR(5, unprotected.error().getIntegral(), 0.02);
+}
+
+TEST(pid_channel, DERIVATIVE_FILTER)
+{
+    pid_channel ch;
+    ch.gains().setDerivative(1);
+    ch.set_derivative_time_constant(0.1);
+
+    ch.error().setDerivative(0);
+    ch.compute_pid(0.01, 100, nowhere());
+
+    // a step reaches 1 - 1/e after one time constant at any rate
+    for (double rate : {50.0, 400.0})
+    {
+        ch.reset();
+        ch.error().setDerivative(0);
+        ch.compute_pid(0, 100, nowhere());
+        double effort = 0;
+        for (int i = 0; i < rate * 0.1; ++i)
+        {
+            ch.error().setDerivative(1);
+            effort = ch.compute_pid(1 / rate, 100, nowhere());
+        }
+        EXPECT_NEAR(-(1 - exp(-1.0)), effort, 1e-9);
+    }
+}
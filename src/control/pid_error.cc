@@ -20,44 +20,73 @@
 
 #include "pid_error.h"
 
-/* c headers */
-#include <math.h>
+/* STL Headers */
+#include <cmath>
 
 
-pid_error::pid_error(double integral_error_limit)
+template <typename Scalar>
+basic_pid_error<Scalar>::basic_pid_error(Scalar integral_error_limit)
     :_integral_error_limit(integral_error_limit)
 {
     reset();
 }
 
-double pid_error::operator++()
+template <typename Scalar>
+Scalar basic_pid_error<Scalar>::integralIncrement(Scalar dt)
 {
-    _integral = _integral + _proportional * 0.01; // multiply by the timestep
+    const Scalar proportional = getProportional();
+    const Scalar previous = _proportional_primed ? _previous_proportional : proportional;
+    _previous_proportional = proportional;
+    _proportional_primed = true;
+    return Scalar(0.5) * (previous + proportional) * dt;
+}
+
+template <typename Scalar>
+Scalar basic_pid_error<Scalar>::filterDerivative(Scalar dt, Scalar tau)
+{
+    if (tau <= 0)
+        return getDerivative();
 
-    if(fabs(getIntegral()) > _integral_error_limit)
-    {
-        _integral = 0;
-    }
+    // first order low pass, exact for any dt
+    if (_derivative_primed)
+        _filtered_derivative += (1 - std::exp(-dt / tau)) * (getDerivative() - _filtered_derivative);
+    else
+        _filtered_derivative = getDerivative();
+    _derivative_primed = true;
 
-    return _integral;
+    return setDerivative(_filtered_derivative);
 }
 
 /// zero all the errors
-void pid_error::reset()
+template <typename Scalar>
+void basic_pid_error<Scalar>::reset()
 {
     _integral = 0;
     _derivative = 0;
     _proportional = 0;
+    _previous_proportional = 0;
+    _filtered_derivative = 0;
+    _proportional_primed = false;
+    _derivative_primed = false;
 }
 
 
 /* Global functions */
-std::ostream& operator<<(std::ostream& os, const pid_error& error)
+template <typename Scalar>
+std::ostream& operator<<(std::ostream& os, const basic_pid_error<Scalar>& error)
 {
     return os << error._integral << ", " << error._derivative << ", " << error._proportional;
 }
 
-Debug& operator<<(Debug& dbg, const pid_error& error)
+template <typename Scalar>
+Debug& operator<<(Debug& dbg, const basic_pid_error<Scalar>& error)
 {
     return dbg << error._integral << ", " << error._derivative << ", " << error._proportional;
 }
+
+template class basic_pid_error<float>;
+template class basic_pid_error<double>;
+template std::ostream& operator<<(std::ostream& os, const basic_pid_error<float>& error);
+template std::ostream& operator<<(std::ostream& os, const basic_pid_error<double>& error);
+template Debug& operator<<(Debug& dbg, const basic_pid_error<float>& error);
+template Debug& operator<<(Debug& dbg, const basic_pid_error<double>& error);
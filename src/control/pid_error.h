@@ -28,35 +28,59 @@
 /* Project Headers */
 #include "Debug.h"
 
+template <typename Scalar>
+class basic_pid_error;
+
+template <typename Scalar>
+std::ostream& operator<<(std::ostream& os, const basic_pid_error<Scalar>& error);
+template <typename Scalar>
+Debug& operator<<(Debug& dbg, const basic_pid_error<Scalar>& error);
+
 /**
- * @brief Store the error for PID control. (Integral error reset for all two channels if its magnitude exceeds a limit)
+ * @brief Store the error for PID control.
+ *
+ * The integral is advanced by the channel each tick with the measured
+ * timestep (see basic_pid_channel::compute_pid) and held within +/- the
+ * integral error limit.
+ *
+ * Instantiated for float and double, see scalar_types.h.
+ *
  * @author Bryan Godbolt <godbolt@ece.ualberta.ca>
  * @date October 27, 2011: Class creation
  * @date February 10, 2012: Refactored out of class Control
  */
-class pid_error
+template <typename Scalar>
+class basic_pid_error
 {
 public:
     /**
      * Initializes error to all zeros
      */
-    pid_error(double integral_error_limit = 1);
+    basic_pid_error(Scalar integral_error_limit = 1);
 
     /** copy constructor */
-    pid_error(const pid_error& other)
+    basic_pid_error(const basic_pid_error& other)
     {
         _integral_error_limit = other._integral_error_limit;
         _proportional = other.getProportional();
         _derivative = other.getDerivative();
         _integral = other.getIntegral();
+        _previous_proportional = other._previous_proportional;
+        _filtered_derivative = other._filtered_derivative;
+        _proportional_primed = other._proportional_primed;
+        _derivative_primed = other._derivative_primed;
     };
 
-    pid_error& operator=(const pid_error& other)
+    basic_pid_error& operator=(const basic_pid_error& other)
     {
         _integral_error_limit = other._integral_error_limit;
         setProportional(other.getProportional());
         setDerivative(other.getDerivative());
         setIntegral(other.getIntegral());
+        _previous_proportional = other._previous_proportional;
+        _filtered_derivative = other._filtered_derivative;
+        _proportional_primed = other._proportional_primed;
+        _derivative_primed = other._derivative_primed;
 
         return *this;
     }
@@ -65,62 +89,82 @@ public:
     /**
      * @returns proportional error as lvalue
      */
-    double getProportional() const
+    Scalar getProportional() const
     {
         return _proportional;
     }
-    double getDerivative() const
+    Scalar getDerivative() const
     {
         return _derivative;
     }
-    double getIntegral() const
+    Scalar getIntegral() const
     {
         return _integral;
     }
-    double setProportional(double np)
+    Scalar setProportional(Scalar np)
     {
         _proportional = np;
         return np;
     };
-    double setDerivative(double nd)
+    Scalar setDerivative(Scalar nd)
     {
         _derivative = nd;
         return nd;
     }
-    double setIntegral(double ni)
+    Scalar setIntegral(Scalar ni)
     {
         _integral = ni;
         return ni;
     }
 
+    Scalar getIntegralLimit() const
+    {
+        return _integral_error_limit;
+    }
+
+    /**
+     * The trapezoidal integral of the proportional error over the last dt
+     * seconds, from the proportional error of the previous call to the
+     * current one.  It is not added to the integral error.
+     */
+    Scalar integralIncrement(Scalar dt);
+
     /**
-     * Easy way to increment integral error
-     * When the integral is computed, if it's absolute value is greater than GPS::Error::_integral_error_limit
-     * the integral state is reset.
-     * @returns result integral error state state
+     * Low pass the derivative error with time constant tau, a tau <= 0
+     * leaves it unfiltered.
+     * @returns the derivative error, which is now the filtered value
      */
-    double operator++();
+    Scalar filterDerivative(Scalar dt, Scalar tau);
 
     /**
      * Stream insertion for std::ostream (cerr, cout)
      */
-    friend std::ostream& operator<<(std::ostream& os, const pid_error& error);
+    friend std::ostream& operator<< <>(std::ostream& os, const basic_pid_error& error);
 
     /**
      * Stream insertion operator for Debug object
      */
-    friend Debug& operator<<(Debug& dbg, const pid_error& error);
+    friend Debug& operator<< <>(Debug& dbg, const basic_pid_error& error);
 
     /// zero all the errors
     void reset();
 
 private:
-    double _integral_error_limit;
-
-    std::atomic<double> _proportional;
-    std::atomic<double> _derivative;
-    std::atomic<double> _integral;
+    Scalar _integral_error_limit;
+
+    std::atomic<Scalar> _proportional;
+    std::atomic<Scalar> _derivative;
+    std::atomic<Scalar> _integral;
+
+    /// proportional error at the last integralIncrement
+    Scalar _previous_proportional;
+    /// state of the derivative filter
+    Scalar _filtered_derivative;
+    /// false until the first tick after a reset, which has no previous values
+    bool _proportional_primed;
+    bool _derivative_primed;
 };
 
-Debug& operator<<(Debug& dbg, const pid_error& error);
+typedef basic_pid_error<double> pid_error;
+
 #endif
@@ -29,6 +29,7 @@
 
 /* STL Headers */
 #include <math.h>
+#include <limits>
 
 
 // constants
@@ -39,6 +40,10 @@ std::string tail_sbf::XML_TRANSLATION_Y_DERIVATIVE = "controller_params.translat
 std::string tail_sbf::XML_TRANSLATION_X_INTEGRAL = "controller_params.translation_outer_sbf.ned_x.integral";
 std::string tail_sbf::XML_TRANSLATION_Y_INTEGRAL = "controller_params.translation_outer_sbf.ned_y.integral";
 std::string tail_sbf::XML_TRAVEL = "controller_params.translation_outer_sbf.travel";
+std::string tail_sbf::XML_TRANSLATION_X_SCHEDULE = "controller_params.translation_outer_sbf.ned_x.schedule";
+std::string tail_sbf::XML_TRANSLATION_Y_SCHEDULE = "controller_params.translation_outer_sbf.ned_y.schedule";
+std::string tail_sbf::XML_TRANSLATION_X = "controller_params.translation_outer_sbf.ned_x";
+std::string tail_sbf::XML_TRANSLATION_Y = "controller_params.translation_outer_sbf.ned_y";
 
 const std::string LOG_TRANS_SBF_ERROR_STATES = "Translation SBF Error States";
 
@@ -50,73 +55,64 @@ tail_sbf::tail_sbf()
       ned_y(10)
 {
     scaled_travel = 0;
+    ned_x.schedule().param_prefix() = "GS_SBFX";
+    ned_y.schedule().param_prefix() = "GS_SBFY";
 }
 
 void tail_sbf::reset()
 {
     ned_x.reset();
     ned_y.reset();
+    tick.set_start_time();
 }
 
 bool tail_sbf::runnable() const
 {
-    return true;
+    // the position comes from the GX3, which may not be the selected source
+    return IMU::getInstance()->position_source_selected();
 }
 
 void tail_sbf::operator()(const blas::vector<double>& reference) throw(bad_control)
 {
 
     IMU* imu = IMU::getInstance();
-    blas::vector<double> ned_position_error(imu->get_ned_position() - reference);
-    blas::vector<double> ned_velocity_error(imu->get_ned_velocity());
-
-    blas::vector<double> ned_control(3);
-    ned_control.clear();
+    // the positions are differenced in double, only the error is small enough for translation_scalar
+    const std::array<translation_scalar, 2> ned_position_error(controller_math::to_array<translation_scalar, 2>(imu->get_ned_position() - reference));
+    const std::array<translation_scalar, 2> ned_velocity_error(controller_math::to_array<translation_scalar, 2>(imu->get_ned_velocity()));
+
+    std::array<translation_scalar, 2> ned_control;
+    const gain_schedule::point schedule_point(gain_schedule::point::sample());
+    const translation_scalar dt = tick.lap();
+    // the forces are not saturated themselves, only the attitude they map to
+    const translation_scalar unbounded = std::numeric_limits<translation_scalar>::infinity();
     std::vector<double> error_states;
     {
         std::lock_guard<std::mutex> lock(ned_x_lock);
-        error_states.push_back(ned_x.error().setProportional(ned_position_error(0)));
-        error_states.push_back(ned_x.error().setDerivative(ned_velocity_error(0)));
-        error_states.push_back(++(ned_x.error()));
-        ned_control(0) = ned_x.compute_pid();
+        error_states.push_back(ned_x.error().setProportional(ned_position_error[0]));
+        ned_x.error().setDerivative(ned_velocity_error[0]);
+        ned_control[0] = ned_x.compute_pid(dt, unbounded, schedule_point);
+        error_states.push_back(ned_x.error().getDerivative());
+        error_states.push_back(ned_x.error().getIntegral());
     }
     {
         std::lock_guard<std::mutex> lock(ned_y_lock);
-        error_states.push_back(ned_y.error().setProportional(ned_position_error(1)));
-        error_states.push_back(ned_y.error().setDerivative(ned_velocity_error(1)));
-        error_states.push_back(++(ned_y.error()));
-        ned_control(1) = ned_y.compute_pid();
+        error_states.push_back(ned_y.error().setProportional(ned_position_error[1]));
+        ned_y.error().setDerivative(ned_velocity_error[1]);
+        ned_control[1] = ned_y.compute_pid(dt, unbounded, schedule_point);
+        error_states.push_back(ned_y.error().getDerivative());
+        error_states.push_back(ned_y.error().getIntegral());
     }
 
     LogFile::getInstance()->logData(LOG_TRANS_SBF_ERROR_STATES, error_states);
 
-    double heading = imu->get_euler()(2);
-    blas::matrix<double> Rz(3,3);
-    Rz.clear();
-    Rz(0,0) = cos(heading);
-    Rz(0,1) = -sin(heading);
-    Rz(1,0) = sin(heading);
-    Rz(1,1) = cos(heading);
-    Rz(2,2) = 1;
-
     Helicopter* bergen = Helicopter::getInstance();
-    double m = bergen->get_mass();
-    double g = bergen->get_gravity();
-    ned_control(2) = -g;
-    blas::vector<double> body_control(m*prod(trans(Rz),ned_control));
-    double alpham = 0.04; // countertorque approximate slope
-    double xt = abs(bergen->get_tail_hub_offset()(0));
-
-    double theta_ref = atan(body_control(0)/body_control(2));
-    double phi_ref = -atan((alpham*sqrt(pow(body_control(0),2)+pow(body_control(2),2))+xt*body_control(1))/(alpham*body_control(1) - xt*sqrt(pow(body_control(0),2)+pow(body_control(2),2))));
-
-    blas::vector<double> attitude_reference(2);
-    attitude_reference(0) = phi_ref;
-    attitude_reference(1) = theta_ref;
+    std::array<translation_scalar, 2> attitude_reference(controller_math::sbf_attitude<translation_scalar>(
+            imu->get_euler()(2), ned_control[0], ned_control[1],
+            bergen->get_mass(), bergen->get_gravity(), std::abs(bergen->get_tail_hub_offset()(0))));
 
     Control::saturate(attitude_reference, scaled_travel_radians());
 
-    set_control_effort(attitude_reference);
+    set_control_effort(controller_math::to_vector(attitude_reference));
 }
 
 const std::string tail_sbf::PARAM_X_KP = "SBF_X_KP";
@@ -138,6 +134,7 @@ std::vector<Parameter> tail_sbf::getParameters() const
         plist.push_back(Parameter(PARAM_X_KP, ned_x.gains().getProportional(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_X_KD, ned_x.gains().getDerivative(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_X_KI, ned_x.gains().getIntegral(), heli::CONTROLLER_ID));
+        ned_x.schedule().getParameters(plist);
     }
 
     {
@@ -145,6 +142,7 @@ std::vector<Parameter> tail_sbf::getParameters() const
         plist.push_back(Parameter(PARAM_Y_KP, ned_y.gains().getProportional(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_Y_KD, ned_y.gains().getDerivative(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_Y_KI, ned_y.gains().getIntegral(), heli::CONTROLLER_ID));
+        ned_y.schedule().getParameters(plist);
     }
 
     plist.push_back(Parameter(PARAM_TRAVEL, scaled_travel_degrees(), heli::CONTROLLER_ID));
@@ -206,6 +204,16 @@ void tail_sbf::set_y_integral(double ki)
     message() << "Set SBF y integral gain to: " << ki;
 }
 
+bool tail_sbf::set_schedule_parameter(const std::string& param_id, double value)
+{
+    if (ned_x.schedule().setParameter(param_id, value) || ned_y.schedule().setParameter(param_id, value))
+    {
+        message() << "Set SBF gain schedule entry " << param_id << " to: " << value;
+        return true;
+    }
+    return false;
+}
+
 void tail_sbf::set_scaled_travel(double travel)
 {
     scaled_travel = travel;
@@ -261,6 +269,10 @@ void tail_sbf::get_xml_node()
     cfg->setd(XML_TRANSLATION_X_INTEGRAL, get_x_integral());
     cfg->setd(XML_TRANSLATION_Y_INTEGRAL, get_y_integral());
     cfg->setd(XML_TRAVEL, scaled_travel_degrees());
+    ned_x.schedule().get_xml_node(XML_TRANSLATION_X_SCHEDULE);
+    ned_y.schedule().get_xml_node(XML_TRANSLATION_Y_SCHEDULE);
+    ned_x.get_xml_node(XML_TRANSLATION_X);
+    ned_y.get_xml_node(XML_TRANSLATION_Y);
 }
 
 
@@ -275,4 +287,8 @@ void tail_sbf::parse_xml_node()
     set_x_integral(cfg->getd(XML_TRANSLATION_X_INTEGRAL, get_x_integral()));
     set_y_integral(cfg->getd(XML_TRANSLATION_Y_INTEGRAL, get_y_integral()));
     set_scaled_travel_degrees(cfg->getd(XML_TRAVEL, scaled_travel_degrees()));
+    ned_x.schedule().parse_xml_node(XML_TRANSLATION_X_SCHEDULE);
+    ned_y.schedule().parse_xml_node(XML_TRANSLATION_Y_SCHEDULE);
+    ned_x.parse_xml_node(XML_TRANSLATION_X);
+    ned_y.parse_xml_node(XML_TRANSLATION_Y);
 }
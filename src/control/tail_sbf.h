@@ -34,6 +34,9 @@ namespace blas = boost::numeric::ublas;
 
 /* Project Headers */
 #include "pid_channel.h"
+#include "controller_math.h"
+#include "scalar_types.h"
+#include "Timer.hpp"
 #include "ControllerInterface.h"
 #include "Parameter.h"
 #include "Debug.h"
@@ -144,6 +147,12 @@ public:
     double get_x_integral() const;
     double get_y_integral() const;
 
+    /**
+     * Set an entry of the ned x or ned y gain schedule.  threadsafe
+     * @returns false if param_id is not a schedule entry of this controller
+     */
+    bool set_schedule_parameter(const std::string& param_id, double value);
+
 private:
 
     // constants for accessing the XML config
@@ -154,13 +163,19 @@ private:
     static std::string XML_TRANSLATION_X_INTEGRAL;
     static std::string XML_TRANSLATION_Y_INTEGRAL;
     static std::string XML_TRAVEL;
-
+    static std::string XML_TRANSLATION_X_SCHEDULE;
+    static std::string XML_TRANSLATION_Y_SCHEDULE;
+    static std::string XML_TRANSLATION_X;
+    static std::string XML_TRANSLATION_Y;
 
     /// error states in ned x,y directions
-    pid_channel ned_x, ned_y;
+    basic_pid_channel<translation_scalar> ned_x, ned_y;
     /// serialize access to error states
     mutable std::mutex ned_x_lock, ned_y_lock;
 
+    /// measures the timestep between ticks
+    Timer tick;
+
     /// store the current control effort
     blas::vector<double> control_effort;
     /// serialize access to control_effort
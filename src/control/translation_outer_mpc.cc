@@ -0,0 +1,364 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "translation_outer_mpc.h"
+
+/* STL Headers */
+#include <cmath>
+
+/* Project Headers */
+#include "IMU.h"
+#include "Helicopter.h"
+#include "Control.h"
+#include "Configuration.h"
+#include "LogFile.h"
+#include "heli.h"
+
+const std::string translation_outer_mpc::PARAM_ENABLE = "MPC_ENABLE";
+const std::string translation_outer_mpc::PARAM_Q_POSITION = "MPC_Q_POS";
+const std::string translation_outer_mpc::PARAM_Q_VELOCITY = "MPC_Q_VEL";
+const std::string translation_outer_mpc::PARAM_R_ACCELERATION = "MPC_R_ACC";
+const std::string translation_outer_mpc::PARAM_STEP = "MPC_STEP";
+const std::string translation_outer_mpc::PARAM_RHO = "MPC_RHO";
+const std::string translation_outer_mpc::PARAM_MAX_ITERATIONS = "MPC_MAX_ITER";
+const std::string translation_outer_mpc::PARAM_BUDGET = "MPC_BUDGET_US";
+const std::string translation_outer_mpc::PARAM_TRAVEL = "MPC_TRAVEL";
+
+const std::string translation_outer_mpc::XML_ENABLE = "controller_params.translation_outer_mpc.enabled";
+const std::string translation_outer_mpc::XML_Q_POSITION = "controller_params.translation_outer_mpc.weight.position";
+const std::string translation_outer_mpc::XML_Q_VELOCITY = "controller_params.translation_outer_mpc.weight.velocity";
+const std::string translation_outer_mpc::XML_R_ACCELERATION = "controller_params.translation_outer_mpc.weight.acceleration";
+const std::string translation_outer_mpc::XML_STEP = "controller_params.translation_outer_mpc.step";
+const std::string translation_outer_mpc::XML_RHO = "controller_params.translation_outer_mpc.rho";
+const std::string translation_outer_mpc::XML_MAX_ITERATIONS = "controller_params.translation_outer_mpc.max_iterations";
+const std::string translation_outer_mpc::XML_BUDGET = "controller_params.translation_outer_mpc.budget_us";
+const std::string translation_outer_mpc::XML_TRAVEL = "controller_params.translation_outer_mpc.travel";
+
+const std::string translation_outer_mpc::LOG_MPC_STATES = "Translation MPC States";
+const std::string translation_outer_mpc::LOG_MPC_SOLVE_TIME_HISTOGRAM = "Translation MPC Solve Time Histogram";
+const std::string translation_outer_mpc::LOG_MPC_ITERATION_HISTOGRAM = "Translation MPC Iteration Histogram";
+
+const std::array<double, 8> translation_outer_mpc::SOLVE_TIME_EDGES_US = {{50, 100, 200, 500, 1000, 2000, 5000, 10000}};
+const std::array<double, 8> translation_outer_mpc::ITERATION_EDGES = {{1, 2, 5, 10, 20, 50, 100, 200}};
+
+/// convergence threshold on the ADMM residuals in m/s^2
+const double MPC_TOLERANCE = 1e-3;
+
+translation_outer_mpc::translation_outer_mpc()
+    : Logger("Translation Outer MPC"),
+      _enabled(false),
+      q_position(1),
+      q_velocity(0.5),
+      r_acceleration(0.05),
+      step(0.1),
+      rho(0.1),
+      max_iterations(50),
+      budget_us(1000),
+      scaled_travel(15),
+      _dirty(true),
+      _reset_requested(false),
+      _within_budget(false),
+      fallbacks(0),
+      last_histogram_time(std::chrono::steady_clock::now()),
+      control_effort(blas::zero_vector<double>(2))
+{
+    linear_term.fill(0);
+    solve_time_histogram.fill(0);
+    iteration_histogram.fill(0);
+
+    LogFile *log = LogFile::getInstance();
+    log->logHeader(LOG_MPC_STATES, "X_Error X_Rate_Error Y_Error Y_Rate_Error X_Accel Y_Accel X_Iterations Y_Iterations Converged Solve_Time_us Within_Budget");
+    log->logHeader(LOG_MPC_SOLVE_TIME_HISTOGRAM, "<50us <100us <200us <500us <1ms <2ms <5ms <10ms >=10ms Fallbacks");
+    log->logHeader(LOG_MPC_ITERATION_HISTOGRAM, "1 2 <=5 <=10 <=20 <=50 <=100 <=200 >200");
+}
+
+void translation_outer_mpc::rebuild()
+{
+    const double T = step;
+    const double qp = q_position;
+    const double qv = q_velocity;
+
+    // prediction of step k (1..HORIZON) from input j (j < k) for the double integrator
+    // position: T^2 (k - j - 1/2), velocity: T.  The free response is [1 kT; 0 1] x0.
+    solver::matrix H;
+    H.fill(0);
+    linear_term.fill(0);
+    for (int k = 1; k <= HORIZON; ++k)
+    {
+        for (int i = 0; i < k; ++i)
+        {
+            const double gp_i = T*T*(k - i - 0.5);
+            for (int j = 0; j < k; ++j)
+            {
+                const double gp_j = T*T*(k - j - 0.5);
+                H[i*HORIZON + j] += qp*gp_i*gp_j + qv*T*T;
+            }
+            linear_term[i*2 + 0] += qp*gp_i;
+            linear_term[i*2 + 1] += qp*gp_i*k*T + qv*T;
+        }
+    }
+    for (int i = 0; i < HORIZON; ++i)
+        H[i*HORIZON + i] += r_acceleration;
+
+    if (!(x_solver.set_hessian(H, rho) && y_solver.set_hessian(H, rho)))
+        warning() << "Could not factor the MPC Hessian, keeping the previous problem";
+
+    _dirty = false;
+}
+
+template <size_t BINS>
+void translation_outer_mpc::count(std::array<uint32_t, BINS>& histogram, const std::array<double, BINS - 1>& edges, double value)
+{
+    size_t bin = 0;
+    while (bin < edges.size() && value > edges[bin])
+        ++bin;
+    ++histogram[bin];
+}
+
+void translation_outer_mpc::apply_reset()
+{
+    if (_reset_requested.exchange(false))
+    {
+        x_solver.reset();
+        y_solver.reset();
+    }
+}
+
+void translation_outer_mpc::operator()(const blas::vector<double>& reference) throw(bad_control)
+{
+    (*this)(reference, blas::zero_vector<double>(3));
+}
+
+void translation_outer_mpc::operator()(const blas::vector<double>& reference, const blas::vector<double>& reference_velocity) throw(bad_control)
+{
+    if (reference.size() < 3 || reference_velocity.size() < 3)
+        throw bad_control("Translation MPC received less than three references (north east down)");
+
+    apply_reset();
+
+    IMU* imu = IMU::getInstance();
+    blas::vector<double> euler(imu->get_euler());
+    blas::matrix<double> body_rotation(trans(IMU::euler_to_rotation(euler)));
+    blas::vector<double> body_position_error(blas::prod(body_rotation, imu->get_ned_position() - reference));
+    blas::vector<double> body_velocity_error(blas::prod(body_rotation, imu->get_ned_velocity() - reference_velocity));
+
+    const std::array<double, 2> position_error = {{body_position_error[0], body_position_error[1]}};
+    const std::array<double, 2> velocity_error = {{body_velocity_error[0], body_velocity_error[1]}};
+    const solution result = solve(position_error, velocity_error, Helicopter::getInstance()->get_gravity());
+
+    std::vector<double> states {position_error[0], velocity_error[0],
+                                position_error[1], velocity_error[1],
+                                result.x_acceleration, result.y_acceleration,
+                                static_cast<double>(result.x_iterations), static_cast<double>(result.y_iterations),
+                                static_cast<double>(result.converged),
+                                result.solve_time_us, static_cast<double>(result.within_budget)};
+    LogFile::getInstance()->logData(LOG_MPC_STATES, states);
+}
+
+translation_outer_mpc::solution translation_outer_mpc::solve(const std::array<double, 2>& position_error,
+        const std::array<double, 2>& velocity_error, double g)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point deadline = start + std::chrono::microseconds(budget_us.load());
+
+    if (_dirty)
+        rebuild();
+
+    const double max_acceleration = g * std::tan(scaled_travel_radians());
+
+    solver::vector lower, upper, fx, fy;
+    lower.fill(-max_acceleration);
+    upper.fill(max_acceleration);
+    for (int i = 0; i < HORIZON; ++i)
+    {
+        fx[i] = linear_term[i*2]*position_error[0] + linear_term[i*2 + 1]*velocity_error[0];
+        fy[i] = linear_term[i*2]*position_error[1] + linear_term[i*2 + 1]*velocity_error[1];
+    }
+
+    bool expired = false;
+    auto budget_expired = [&deadline, &expired]()
+    {
+        expired = expired || std::chrono::steady_clock::now() > deadline;
+        return expired;
+    };
+
+    const solver::result x_result = x_solver.solve(fx, lower, upper, max_iterations, MPC_TOLERANCE, budget_expired);
+    const solver::result y_result = y_solver.solve(fy, lower, upper, max_iterations, MPC_TOLERANCE, budget_expired);
+
+    solution result;
+    result.solve_time_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    result.within_budget = !expired;
+    result.x_acceleration = x_solver.solution()[0];
+    result.y_acceleration = y_solver.solution()[0];
+    result.x_iterations = x_result.iterations;
+    result.y_iterations = y_result.iterations;
+    result.converged = x_result.converged && y_result.converged;
+    _within_budget = result.within_budget;
+
+    // a_x = -g tan(theta), a_y = g tan(phi)
+    blas::vector<double> attitude_reference(2);
+    attitude_reference[0] = std::atan(result.y_acceleration / g);
+    attitude_reference[1] = std::atan(-result.x_acceleration / g);
+    Control::saturate(attitude_reference, scaled_travel_radians());
+
+    if (!expired)
+        set_control_effort(attitude_reference);
+    else
+        ++fallbacks;
+
+    count(solve_time_histogram, SOLVE_TIME_EDGES_US, result.solve_time_us);
+    count(iteration_histogram, ITERATION_EDGES, x_result.iterations);
+    count(iteration_histogram, ITERATION_EDGES, y_result.iterations);
+
+    if (start - last_histogram_time >= std::chrono::seconds(1))
+    {
+        last_histogram_time = start;
+        std::vector<double> times(solve_time_histogram.begin(), solve_time_histogram.end());
+        times.push_back(fallbacks);
+        LogFile::getInstance()->logData(LOG_MPC_SOLVE_TIME_HISTOGRAM, times);
+        LogFile::getInstance()->logData(LOG_MPC_ITERATION_HISTOGRAM, iteration_histogram);
+    }
+
+    return result;
+}
+
+void translation_outer_mpc::reset()
+{
+    _reset_requested = true;
+}
+
+bool translation_outer_mpc::runnable() const
+{
+    return true;
+}
+
+std::vector<Parameter> translation_outer_mpc::getParameters() const
+{
+    std::vector<Parameter> plist;
+    plist.push_back(Parameter(PARAM_ENABLE, _enabled.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_Q_POSITION, q_position.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_Q_VELOCITY, q_velocity.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_R_ACCELERATION, r_acceleration.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_STEP, step.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_RHO, rho.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_MAX_ITERATIONS, max_iterations.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_BUDGET, budget_us.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_TRAVEL, scaled_travel.load(), heli::CONTROLLER_ID));
+    return plist;
+}
+
+void translation_outer_mpc::set_enabled(bool enabled)
+{
+    if (enabled != _enabled)
+        reset();
+    _enabled = enabled;
+    message() << "Set MPC enabled to: " << enabled;
+}
+
+bool translation_outer_mpc::set_position_weight(double q)
+{
+    if (q < 0)
+        return false;
+    q_position = q;
+    _dirty = true;
+    message() << "Set MPC position weight to: " << q;
+    return true;
+}
+
+bool translation_outer_mpc::set_velocity_weight(double q)
+{
+    if (q < 0)
+        return false;
+    q_velocity = q;
+    _dirty = true;
+    message() << "Set MPC velocity weight to: " << q;
+    return true;
+}
+
+bool translation_outer_mpc::set_acceleration_weight(double r)
+{
+    if (r <= 0)
+        return false;
+    r_acceleration = r;
+    _dirty = true;
+    message() << "Set MPC acceleration weight to: " << r;
+    return true;
+}
+
+bool translation_outer_mpc::set_step(double step)
+{
+    if (step <= 0)
+        return false;
+    this->step = step;
+    _dirty = true;
+    message() << "Set MPC prediction step to: " << step;
+    return true;
+}
+
+bool translation_outer_mpc::set_rho(double rho)
+{
+    if (rho <= 0)
+        return false;
+    this->rho = rho;
+    _dirty = true;
+    message() << "Set MPC rho to: " << rho;
+    return true;
+}
+
+bool translation_outer_mpc::set_max_iterations(int iterations)
+{
+    if (iterations < 1)
+        return false;
+    max_iterations = iterations;
+    message() << "Set MPC max iterations to: " << iterations;
+    return true;
+}
+
+bool translation_outer_mpc::set_budget(int budget)
+{
+    if (budget < 1)
+        return false;
+    budget_us = budget;
+    message() << "Set MPC time budget to: " << budget << " us";
+    return true;
+}
+
+void translation_outer_mpc::set_scaled_travel_degrees(double travel)
+{
+    scaled_travel = travel;
+    message() << "Set MPC travel to: " << travel;
+}
+
+void translation_outer_mpc::get_xml_node()
+{
+    Configuration* cfg = Configuration::getInstance();
+
+    cfg->seti(XML_ENABLE, enabled());
+    cfg->setd(XML_Q_POSITION, q_position);
+    cfg->setd(XML_Q_VELOCITY, q_velocity);
+    cfg->setd(XML_R_ACCELERATION, r_acceleration);
+    cfg->setd(XML_STEP, step);
+    cfg->setd(XML_RHO, rho);
+    cfg->seti(XML_MAX_ITERATIONS, max_iterations);
+    cfg->seti(XML_BUDGET, budget_us);
+    cfg->setd(XML_TRAVEL, scaled_travel);
+}
+
+void translation_outer_mpc::parse_xml_node()
+{
+    Configuration* cfg = Configuration::getInstance();
+
+    set_enabled(cfg->geti(XML_ENABLE, enabled()));
+    set_position_weight(cfg->getd(XML_Q_POSITION, q_position));
+    set_velocity_weight(cfg->getd(XML_Q_VELOCITY, q_velocity));
+    set_acceleration_weight(cfg->getd(XML_R_ACCELERATION, r_acceleration));
+    set_step(cfg->getd(XML_STEP, step));
+    set_rho(cfg->getd(XML_RHO, rho));
+    set_max_iterations(cfg->geti(XML_MAX_ITERATIONS, max_iterations));
+    set_budget(cfg->geti(XML_BUDGET, budget_us));
+    set_scaled_travel_degrees(cfg->getd(XML_TRAVEL, scaled_travel));
+}
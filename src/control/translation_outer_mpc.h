@@ -0,0 +1,223 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef TRANSLATION_OUTER_MPC_H_
+#define TRANSLATION_OUTER_MPC_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Boost Headers */
+#include <boost/numeric/ublas/vector.hpp>
+namespace blas = boost::numeric::ublas;
+
+/* Project Headers */
+#include "Parameter.h"
+#include "ControllerInterface.h"
+#include "AutopilotMath.hpp"
+#include "box_qp.hpp"
+#include "Debug.h"
+
+/**
+ * @brief Model predictive outer loop position controller
+ *
+ * Each body axis is modelled as a double integrator driven by the horizontal
+ * acceleration a = -g tan(theta) (x) or a = g tan(phi) (y).  Every iteration a
+ * HORIZON step box constrained QP over the future accelerations is solved for
+ * each axis, penalizing position and velocity error relative to the reference
+ * and the acceleration used.  The acceleration bound follows from the travel
+ * limit so the attitude reference handed to attitude_pid is never saturated
+ * after the fact.
+ *
+ * The QP has a fixed size, the Hessian is only refactored when a parameter
+ * changes and the solver is warm started from the previous iteration.  The
+ * number of iterations is capped and the solve is abandoned once the time
+ * budget is used up, in which case within_budget() returns false and Control
+ * falls back to translation_outer_pid for that iteration.
+ *
+ * Solve time and iteration histograms are logged once a second.
+ *
+ * Parameters and reset() may be called from any thread, they only flag the
+ * change and the control thread applies it at the top of its next iteration,
+ * so the solver state is only ever touched by the control thread.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class translation_outer_mpc : public ControllerInterface, public Logger
+{
+public:
+    /// number of prediction steps
+    static const int HORIZON = 10;
+
+    translation_outer_mpc();
+
+    /// track a stationary reference position
+    void operator()(const blas::vector<double>& reference) throw(bad_control);
+
+    /**
+     * Solve for the roll pitch reference which tracks the reference trajectory.
+     * @param reference ned position reference in m
+     * @param reference_velocity ned velocity of the reference in m/s
+     */
+    void operator()(const blas::vector<double>& reference, const blas::vector<double>& reference_velocity) throw(bad_control);
+
+    /// outcome of one solve
+    struct solution
+    {
+        /// first accelerations of the plan in m/s^2
+        double x_acceleration;
+        double y_acceleration;
+        int x_iterations;
+        int y_iterations;
+        bool converged;
+        bool within_budget;
+        double solve_time_us;
+    };
+
+    /**
+     * Plan from the body frame errors relative to the reference and, if the
+     * solve finished inside the budget, set the roll pitch reference.  Called
+     * by operator() once the errors are known, after apply_reset().
+     * @param position_error body x and y position error in m
+     * @param velocity_error body x and y velocity error in m/s
+     * @param gravity in m/s^2
+     */
+    solution solve(const std::array<double, 2>& position_error, const std::array<double, 2>& velocity_error, double gravity);
+
+    /// clear the solver state if reset() was called, only called from the control thread
+    void apply_reset();
+
+    /// @returns the roll pitch reference in radians (threadsafe)
+    inline blas::vector<double> get_control_effort() const
+    {
+        std::lock_guard<std::mutex> lock(control_effort_lock);
+        return control_effort;
+    }
+
+    /// @returns true if the last solve finished inside the time budget
+    bool within_budget() const
+    {
+        return _within_budget;
+    }
+
+    /// @returns true if the mpc should be used in place of the translational pid
+    bool enabled() const
+    {
+        return _enabled;
+    }
+
+    /// clears the warm start and reference history at the next iteration (threadsafe)
+    void reset();
+    /// test if controller is runnable
+    bool runnable() const;
+
+    /// @returns the list of parameters for the mpc outer loop
+    std::vector<Parameter> getParameters() const;
+
+    static const std::string PARAM_ENABLE;
+    static const std::string PARAM_Q_POSITION;
+    static const std::string PARAM_Q_VELOCITY;
+    static const std::string PARAM_R_ACCELERATION;
+    static const std::string PARAM_STEP;
+    static const std::string PARAM_RHO;
+    static const std::string PARAM_MAX_ITERATIONS;
+    static const std::string PARAM_BUDGET;
+    static const std::string PARAM_TRAVEL;
+
+    void set_enabled(bool enabled);
+    /// the weight setters return false and keep the old value when it is out of range
+    bool set_position_weight(double q);
+    bool set_velocity_weight(double q);
+    bool set_acceleration_weight(double r);
+    /// @param step prediction step in seconds
+    bool set_step(double step);
+    /// @param rho ADMM penalty parameter
+    bool set_rho(double rho);
+    bool set_max_iterations(int iterations);
+    /// @param budget_us time allowed for both axes to be solved in microseconds
+    bool set_budget(int budget_us);
+    void set_scaled_travel_degrees(double travel);
+
+    inline double scaled_travel_radians() const
+    {
+        return AutopilotMath::degreesToRadians(scaled_travel);
+    }
+
+    /// save the controller parameters
+    void get_xml_node();
+    /// load parameters from the configuration
+    void parse_xml_node();
+
+private:
+    typedef box_qp<HORIZON> solver;
+
+    static const std::string XML_ENABLE;
+    static const std::string XML_Q_POSITION;
+    static const std::string XML_Q_VELOCITY;
+    static const std::string XML_R_ACCELERATION;
+    static const std::string XML_STEP;
+    static const std::string XML_RHO;
+    static const std::string XML_MAX_ITERATIONS;
+    static const std::string XML_BUDGET;
+    static const std::string XML_TRAVEL;
+
+    static const std::string LOG_MPC_STATES;
+    static const std::string LOG_MPC_SOLVE_TIME_HISTOGRAM;
+    static const std::string LOG_MPC_ITERATION_HISTOGRAM;
+
+    /// rebuild the condensed problem from the current weights, only called from the control thread
+    void rebuild();
+    /// bin edges are upper bounds, the last bin counts everything above
+    template <size_t BINS>
+    static void count(std::array<uint32_t, BINS>& histogram, const std::array<double, BINS - 1>& edges, double value);
+
+    std::atomic_bool _enabled;
+    std::atomic<double> q_position;
+    std::atomic<double> q_velocity;
+    std::atomic<double> r_acceleration;
+    std::atomic<double> step;
+    std::atomic<double> rho;
+    std::atomic<int> max_iterations;
+    std::atomic<int> budget_us;
+    std::atomic<double> scaled_travel;
+    /// set when a parameter changes so the control thread rebuilds the problem
+    std::atomic_bool _dirty;
+    /// set by reset() so the control thread clears the solver state
+    std::atomic_bool _reset_requested;
+    std::atomic_bool _within_budget;
+
+    /// the x and y axes share the Hessian but keep separate warm starts
+    solver x_solver;
+    solver y_solver;
+    /// maps the initial [error, error rate] to the QP linear term, row major HORIZON x 2
+    std::array<double, HORIZON*2> linear_term;
+
+    static const std::array<double, 8> SOLVE_TIME_EDGES_US;
+    static const std::array<double, 8> ITERATION_EDGES;
+    std::array<uint32_t, 9> solve_time_histogram;
+    std::array<uint32_t, 9> iteration_histogram;
+    uint32_t fallbacks;
+    std::chrono::steady_clock::time_point last_histogram_time;
+
+    /// store the current control effort
+    blas::vector<double> control_effort;
+    /// serialize access to control_effort
+    mutable std::mutex control_effort_lock;
+    /// threadsafe set control_effort
+    inline void set_control_effort(const blas::vector<double>& control_effort)
+    {
+        std::lock_guard<std::mutex> lock(control_effort_lock);
+        this->control_effort = control_effort;
+    }
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "translation_outer_mpc.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+const double GRAVITY = 9.81;
+const std::array<double, 2> ERROR = {{1, -0.5}};
+const std::array<double, 2> STILL = {{0, 0}};
+
+/// an mpc with a budget no test machine misses
+void unhurried(translation_outer_mpc& mpc)
+{
+    mpc.set_budget(1000000);
+    mpc.set_max_iterations(500);
+}
+}
+
+TEST(translation_outer_mpc, TILTS_TOWARD_THE_REFERENCE)
+{
+    translation_outer_mpc mpc;
+    unhurried(mpc);
+    const translation_outer_mpc::solution s = mpc.solve(ERROR, STILL, GRAVITY);
+
+    ASSERT_TRUE(s.within_budget);
+    EXPECT_TRUE(s.converged);
+    // ahead of the reference in x accelerates back, a_x = -g tan(pitch) so pitch up
+    EXPECT_LT(s.x_acceleration, 0);
+    EXPECT_GT(s.y_acceleration, 0);
+
+    const blas::vector<double> attitude(mpc.get_control_effort());
+    EXPECT_GT(attitude[1], 0);
+    EXPECT_GT(attitude[0], 0);
+    EXPECT_LE(std::abs(attitude[0]), mpc.scaled_travel_radians() + 1e-9);
+    EXPECT_LE(std::abs(attitude[1]), mpc.scaled_travel_radians() + 1e-9);
+}
+
+TEST(translation_outer_mpc, RESET_IS_APPLIED_BY_THE_NEXT_TICK)
+{
+    translation_outer_mpc fresh;
+    unhurried(fresh);
+    const translation_outer_mpc::solution cold = fresh.solve(ERROR, STILL, GRAVITY);
+
+    translation_outer_mpc mpc;
+    unhurried(mpc);
+    mpc.solve(ERROR, STILL, GRAVITY);
+    const translation_outer_mpc::solution warm = mpc.solve(ERROR, STILL, GRAVITY);
+    EXPECT_LT(warm.x_iterations, cold.x_iterations);
+
+    // as the ground station would, from another thread
+    std::thread([&mpc]() { mpc.reset(); }).join();
+    // as operator() does at the top of the next tick
+    mpc.apply_reset();
+    const translation_outer_mpc::solution after = mpc.solve(ERROR, STILL, GRAVITY);
+    EXPECT_EQ(cold.x_iterations, after.x_iterations);
+    EXPECT_EQ(cold.y_iterations, after.y_iterations);
+    EXPECT_EQ(cold.x_acceleration, after.x_acceleration);
+}
+
+TEST(translation_outer_mpc, PARAMETERS_FROM_ANOTHER_THREAD_DURING_SOLVES)
+{
+    translation_outer_mpc mpc;
+    unhurried(mpc);
+    mpc.set_enabled(true);
+
+    std::atomic_bool done(false);
+    std::thread ground_station([&]()
+    {
+        for (int i = 0; !done; ++i)
+        {
+            mpc.set_enabled(i % 2);
+            mpc.set_position_weight(1 + (i % 3));
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+
+    for (int i = 0; i < 200; ++i)
+    {
+        const translation_outer_mpc::solution s = mpc.solve(ERROR, STILL, GRAVITY);
+        ASSERT_TRUE(std::isfinite(s.x_acceleration));
+        ASSERT_TRUE(std::isfinite(s.y_acceleration));
+        ASSERT_LT(s.x_acceleration, 0);
+    }
+    done = true;
+    ground_station.join();
+}
@@ -24,6 +24,8 @@
 #include "Control.h"
 #include "Configuration.h"
 #include "LogFile.h"
+#include "Helicopter.h"
+#include "tick_profiler.h"
 
 
 // constants
@@ -34,6 +36,11 @@ std::string translation_outer_pid::XML_TRANSLATION_Y_DERIVATIVE = "controller_pa
 std::string translation_outer_pid::XML_TRANSLATION_X_INTEGRAL = "controller_params.translation_outer_pid.x.integral";
 std::string translation_outer_pid::XML_TRANSLATION_Y_INTEGRAL = "controller_params.translation_outer_pid.y.integral";
 std::string translation_outer_pid::XML_TRAVEL = "controller_params.translation_outer_pid.travel";
+std::string translation_outer_pid::XML_FEED_FORWARD = "controller_params.translation_outer_pid.feed_forward_gain";
+std::string translation_outer_pid::XML_TRANSLATION_X_SCHEDULE = "controller_params.translation_outer_pid.x.schedule";
+std::string translation_outer_pid::XML_TRANSLATION_Y_SCHEDULE = "controller_params.translation_outer_pid.y.schedule";
+std::string translation_outer_pid::XML_TRANSLATION_X = "controller_params.translation_outer_pid.x";
+std::string translation_outer_pid::XML_TRANSLATION_Y = "controller_params.translation_outer_pid.y";
 
 const std::string LOG_TRANS_PID_ERROR_STATES = "Translation PID Error States";
 
@@ -43,10 +50,13 @@ translation_outer_pid::translation_outer_pid()
     : Logger("Translation Outer PID"),
       x(10),
       y(10),
-      scaled_travel(15)
+      scaled_travel(15),
+      feed_forward_gain(0)
 {
     x.name() = "X";
     y.name() = "Y";
+    x.schedule().param_prefix() = "GS_X";
+    y.schedule().param_prefix() = "GS_Y";
 }
 
 translation_outer_pid::translation_outer_pid(const translation_outer_pid& other)
@@ -62,6 +72,7 @@ translation_outer_pid::translation_outer_pid(const translation_outer_pid& other)
     }
     {
         scaled_travel = other.scaled_travel.load();
+        feed_forward_gain = other.feed_forward_gain.load();
     }
 }
 
@@ -69,52 +80,79 @@ translation_outer_pid::translation_outer_pid(const translation_outer_pid& other)
 
 void translation_outer_pid::operator()(const blas::vector<double>& reference) throw(bad_control)
 {
+    (*this)(reference, blas::zero_vector<double>(3), blas::zero_vector<double>(3));
+}
+
+void translation_outer_pid::operator()(const blas::vector<double>& reference, const blas::vector<double>& reference_velocity,
+                                       const blas::vector<double>& reference_acceleration) throw(bad_control)
+{
+    const double gain = feed_forward_gain;
     // get attitude measurement
     IMU* imu = IMU::getInstance();
-    blas::vector<double> euler(imu->get_euler());
+    const std::array<translation_scalar, 3> euler(controller_math::to_array<translation_scalar>(imu->get_euler()));
 
-    // get ned position/velocity
-    blas::vector<double> position(imu->get_ned_position());
-    blas::matrix<double> body_rotation(trans(IMU::euler_to_rotation(euler)));
-    blas::vector<double> body_position_error(blas::prod(body_rotation, position - reference));
-    blas::vector<double> body_velocity_error(blas::prod(body_rotation, imu->get_ned_velocity()));
+    // the positions are differenced in double, only the error is small enough for translation_scalar
+    const std::array<translation_scalar, 3> ned_position_error(controller_math::to_array<translation_scalar>(imu->get_ned_position() - reference));
+    const std::array<translation_scalar, 3> ned_velocity_error(controller_math::to_array<translation_scalar>(imu->get_ned_velocity() - gain*reference_velocity));
+    const std::array<translation_scalar, 2> body_position_error(controller_math::body_xy(euler, ned_position_error));
+    const std::array<translation_scalar, 2> body_velocity_error(controller_math::body_xy(euler, ned_velocity_error));
 
     // roll pitch reference
-    blas::vector<double> attitude_reference(2);
-    attitude_reference.clear();
+    std::array<translation_scalar, 2> attitude_reference;
+    const gain_schedule::point schedule_point(gain_schedule::point::sample());
+    const translation_scalar dt = tick.lap();
+    const translation_scalar travel = scaled_travel_radians();
     std::vector<double> error_states;
     {
-        std::lock_guard<std::mutex> lock(x_lock);
+        tick_profiler::lock_guard<std::mutex> lock(x_lock);
         error_states.push_back(x.error().setProportional(body_position_error[0]));
-        error_states.push_back(x.error().setDerivative(body_velocity_error[0]));
-        error_states.push_back(++(x.error()));
-        attitude_reference[1] = -x.compute_pid();
+        x.error().setDerivative(body_velocity_error[0]);
+        attitude_reference[1] = -x.compute_pid(dt, travel, schedule_point);
+        error_states.push_back(x.error().getDerivative());
+        error_states.push_back(x.error().getIntegral());
     }
     {
-        std::lock_guard<std::mutex> lock(y_lock);
+        tick_profiler::lock_guard<std::mutex> lock(y_lock);
         error_states.push_back(y.error().setProportional(body_position_error[1]));
-        error_states.push_back(y.error().setDerivative(body_velocity_error[1]));
-        error_states.push_back(++(y.error()));
-        attitude_reference[0] = y.compute_pid();
+        y.error().setDerivative(body_velocity_error[1]);
+        attitude_reference[0] = y.compute_pid(dt, travel, schedule_point);
+        error_states.push_back(y.error().getDerivative());
+        error_states.push_back(y.error().getIntegral());
     }
 
     LogFile::getInstance()->logData(LOG_TRANS_PID_ERROR_STATES, error_states);
 
-    Control::saturate(attitude_reference, scaled_travel_radians());
+    if (gain != 0)
+    {
+        const std::array<translation_scalar, 2> body_acceleration(controller_math::body_xy(euler, controller_math::to_array<translation_scalar>(reference_acceleration)));
+        const std::array<translation_scalar, 2> feed_forward(controller_math::feed_forward_attitude<translation_scalar>(
+                body_acceleration[0], body_acceleration[1], Helicopter::getInstance()->get_gravity()));
+        for (size_t i = 0; i < attitude_reference.size(); ++i)
+            attitude_reference[i] += gain*feed_forward[i];
+    }
+
+    Control::saturate(attitude_reference, travel);
 
     // set the reference to a roll pitch orientation in radians
-    set_control_effort(attitude_reference);
+    set_control_effort(controller_math::to_vector(attitude_reference));
+}
+
+blas::vector<double> translation_outer_pid::feed_forward_attitude(const blas::vector<double>& body_acceleration, double gravity)
+{
+    return controller_math::to_vector(controller_math::feed_forward_attitude(body_acceleration[0], body_acceleration[1], gravity));
 }
 
 void translation_outer_pid::reset()
 {
     x.reset();
     y.reset();
+    tick.set_start_time();
 }
 
 bool translation_outer_pid::runnable() const
 {
-    return true;
+    // the position comes from the GX3, which may not be the selected source
+    return IMU::getInstance()->position_source_selected();
 }
 
 const std::string translation_outer_pid::PARAM_X_KP = "PID_X_KP";
@@ -126,6 +164,7 @@ const std::string translation_outer_pid::PARAM_Y_KD = "PID_Y_KD";
 const std::string translation_outer_pid::PARAM_Y_KI = "PID_Y_KI";
 
 const std::string translation_outer_pid::PARAM_TRAVEL = "PID_TRAVEL";
+const std::string translation_outer_pid::PARAM_FEED_FORWARD = "PID_FF_GAIN";
 
 std::vector<Parameter> translation_outer_pid::getParameters()
 {
@@ -136,6 +175,7 @@ std::vector<Parameter> translation_outer_pid::getParameters()
         plist.push_back(Parameter(PARAM_X_KP, x.gains().getProportional(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_X_KD, x.gains().getDerivative(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_X_KI, x.gains().getIntegral(), heli::CONTROLLER_ID));
+        x.schedule().getParameters(plist);
     }
 
     {
@@ -143,8 +183,10 @@ std::vector<Parameter> translation_outer_pid::getParameters()
         plist.push_back(Parameter(PARAM_Y_KP, y.gains().getProportional(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_Y_KD, y.gains().getDerivative(), heli::CONTROLLER_ID));
         plist.push_back(Parameter(PARAM_Y_KI, y.gains().getIntegral(), heli::CONTROLLER_ID));
+        y.schedule().getParameters(plist);
     }
     plist.push_back(Parameter(PARAM_TRAVEL, scaled_travel.load(), heli::CONTROLLER_ID));
+    plist.push_back(Parameter(PARAM_FEED_FORWARD, feed_forward_gain.load(), heli::CONTROLLER_ID));
     return plist;
 }
 
@@ -202,12 +244,28 @@ void translation_outer_pid::set_y_integral(double ki)
     message() << "Set PID y integral gain to: " << ki;
 }
 
+bool translation_outer_pid::set_schedule_parameter(const std::string& param_id, double value)
+{
+    if (x.schedule().setParameter(param_id, value) || y.schedule().setParameter(param_id, value))
+    {
+        message() << "Set PID gain schedule entry " << param_id << " to: " << value;
+        return true;
+    }
+    return false;
+}
+
 void translation_outer_pid::set_scaled_travel(double travel)
 {
     scaled_travel = travel;
     message() << "Set travel to: " << travel;
 }
 
+void translation_outer_pid::set_feed_forward_gain(double gain)
+{
+    feed_forward_gain = gain;
+    message() << "Set feed forward gain to: " << gain;
+}
+
 double translation_outer_pid::get_x_proportional() const
 {
     std::lock_guard<std::mutex> lock(x_lock);
@@ -256,6 +314,11 @@ void translation_outer_pid::get_xml_node()
     cfg->setd(XML_TRANSLATION_X_INTEGRAL, get_x_integral());
     cfg->setd(XML_TRANSLATION_Y_INTEGRAL, get_y_integral());
     cfg->setd(XML_TRAVEL, scaled_travel_degrees());
+    cfg->setd(XML_FEED_FORWARD, get_feed_forward_gain());
+    x.schedule().get_xml_node(XML_TRANSLATION_X_SCHEDULE);
+    y.schedule().get_xml_node(XML_TRANSLATION_Y_SCHEDULE);
+    x.get_xml_node(XML_TRANSLATION_X);
+    y.get_xml_node(XML_TRANSLATION_Y);
 }
 
 void translation_outer_pid::parse_xml_node()
@@ -269,6 +332,11 @@ void translation_outer_pid::parse_xml_node()
     set_x_integral(cfg->getd(XML_TRANSLATION_X_INTEGRAL, get_x_integral()));
     set_y_integral(cfg->getd(XML_TRANSLATION_Y_INTEGRAL, get_y_integral()));
     set_scaled_travel_degrees(cfg->getd(XML_TRAVEL, scaled_travel_degrees()));
+    set_feed_forward_gain(cfg->getd(XML_FEED_FORWARD, get_feed_forward_gain()));
+    x.schedule().parse_xml_node(XML_TRANSLATION_X_SCHEDULE);
+    y.schedule().parse_xml_node(XML_TRANSLATION_Y_SCHEDULE);
+    x.parse_xml_node(XML_TRANSLATION_X);
+    y.parse_xml_node(XML_TRANSLATION_Y);
 }
 
 
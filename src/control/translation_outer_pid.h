@@ -30,6 +30,9 @@
 /* Project Headers */
 #include "Parameter.h"
 #include "pid_channel.h"
+#include "controller_math.h"
+#include "scalar_types.h"
+#include "Timer.hpp"
 #include "ControllerInterface.h"
 #include "AutopilotMath.hpp"
 #include "Debug.h"
@@ -88,6 +91,16 @@ public:
      * the roll pitch reference
      */
     void operator()(const blas::vector<double>& reference) throw(bad_control);
+    /**
+     * Same as above while tracking a trajectory.  feed_forward_gain times the
+     * reference velocity is taken from the velocity the derivative term damps,
+     * and the same fraction of the tilt that produces the reference
+     * acceleration is added to the roll pitch reference.
+     * @param reference_velocity NED velocity of the reference in m/s
+     * @param reference_acceleration NED acceleration of the reference in m/s^2
+     */
+    void operator()(const blas::vector<double>& reference, const blas::vector<double>& reference_velocity,
+                    const blas::vector<double>& reference_acceleration) throw(bad_control);
     /// @returns the roll pitch reference in radians (threadsafe)
     inline blas::vector<double> get_control_effort() const
     {
@@ -111,13 +124,15 @@ public:
     /// y ki parameter string representation
     static const std::string PARAM_Y_KI;
     static const std::string PARAM_TRAVEL;
+    /// feed forward gain parameter string representation
+    static const std::string PARAM_FEED_FORWARD;
     /// save the controller parameters
     void get_xml_node();
     /// load parameters for the function and populate the values
     void parse_xml_node();
     /// resets the controller
     void reset();
-    /// test is controller is runnable
+    /// test is controller is runnable, false while the state selection has not selected the GX3 position
     bool runnable() const;
 
     inline double scaled_travel_degrees()
@@ -137,6 +152,25 @@ public:
         set_scaled_travel(AutopilotMath::radiansToDegrees(travel));
     }
 
+    inline double get_feed_forward_gain() const
+    {
+        return feed_forward_gain;
+    }
+    /**
+     * Set the fraction of the trajectory's velocity and acceleration that is
+     * fed forward, 0 disables it.  This function is threadsafe.
+     */
+    void set_feed_forward_gain(double gain);
+
+    /**
+     * The roll and pitch that tilt the rotor thrust to give a body frame
+     * acceleration in the horizontal plane while holding altitude.
+     * @param body_acceleration body frame acceleration in m/s^2 (x and y are used)
+     * @param gravity in m/s^2
+     * @returns roll, pitch in radians
+     */
+    static blas::vector<double> feed_forward_attitude(const blas::vector<double>& body_acceleration, double gravity);
+
     // various getters to go with the setters
     double get_x_proportional() const;
     double get_x_derivative() const;
@@ -145,6 +179,12 @@ public:
     double get_y_derivative() const;
     double get_y_integral() const;
 
+    /**
+     * Set an entry of the x or y gain schedule.  threadsafe
+     * @returns false if param_id is not a schedule entry of this controller
+     */
+    bool set_schedule_parameter(const std::string& param_id, double value);
+
 private:
 
     // XML config references.
@@ -155,12 +195,20 @@ private:
     static std::string XML_TRANSLATION_X_INTEGRAL;
     static std::string XML_TRANSLATION_Y_INTEGRAL;
     static std::string XML_TRAVEL;
+    static std::string XML_FEED_FORWARD;
+    static std::string XML_TRANSLATION_X_SCHEDULE;
+    static std::string XML_TRANSLATION_Y_SCHEDULE;
+    static std::string XML_TRANSLATION_X;
+    static std::string XML_TRANSLATION_Y;
 
-    pid_channel x;
+    basic_pid_channel<translation_scalar> x;
     mutable std::mutex x_lock;
-    pid_channel y;
+    basic_pid_channel<translation_scalar> y;
     mutable std::mutex y_lock;
 
+    /// measures the timestep between ticks
+    Timer tick;
+
     /// store the current control effort
     blas::vector<double> control_effort;
     /// serialize access to control_effort
@@ -186,5 +234,7 @@ private:
      */
     void set_scaled_travel(double travel);
 
+    /// fraction of the trajectory velocity and acceleration fed forward
+    std::atomic<double> feed_forward_gain;
 };
 #endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "translation_outer_pid.h"
+#include "circle.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const double GRAVITY = 9.81;
+
+gain_schedule::point nowhere()
+{
+    gain_schedule::point p;
+    p.value.fill(0);
+    return p;
+}
+
+pid_channel position_channel()
+{
+    pid_channel ch(10);
+    ch.gains().setProportional(0.15);
+    ch.gains().setDerivative(0.25);
+    ch.gains().setIntegral(0.02);
+    ch.set_anti_windup(pid_channel::WINDUP_CONDITIONAL);
+    return ch;
+}
+
+/**
+ * Fly a point mass helicopter around a circle with the outer loop's pid
+ * channels, the attitude follows its reference with a first order lag and
+ * there is no wind.  The heading is held north so the body and NED frames
+ * share x and y.
+ * @returns the RMS distance from the circle over the second lap
+ */
+double circle_cross_track_rms(double radius, double speed, double feed_forward_gain)
+{
+    const double dt = 0.01, attitude_lag = 0.2, travel = 15*M_PI/180;
+    const double period = 2*M_PI*radius/speed;
+
+    pid_channel x(position_channel()), y(position_channel());
+    const gain_schedule::point at(nowhere());
+
+    // start on the circle at the reference speed
+    double position[2] = {radius, 0}, velocity[2] = {0, speed};
+    double roll = 0, pitch = 0;
+    double sum_squares = 0;
+    size_t samples = 0;
+
+    for (double t = 0; t < 2*period; t += dt)
+    {
+        const double angle = 2*M_PI*t/period;
+        const double reference[2] = {radius*cos(angle), radius*sin(angle)};
+
+        const blas::vector<double> reference_velocity(circle::velocity_at(radius, period, angle));
+        x.error().setProportional(position[0] - reference[0]);
+        x.error().setDerivative(velocity[0] - feed_forward_gain*reference_velocity[0]);
+        y.error().setProportional(position[1] - reference[1]);
+        y.error().setDerivative(velocity[1] - feed_forward_gain*reference_velocity[1]);
+
+        blas::vector<double> attitude_reference(2);
+        attitude_reference[1] = -x.compute_pid(dt, travel, at);
+        attitude_reference[0] = y.compute_pid(dt, travel, at);
+        attitude_reference += feed_forward_gain*translation_outer_pid::feed_forward_attitude(
+                                  circle::acceleration_at(radius, period, angle), GRAVITY);
+        for (size_t i = 0; i < 2; ++i)
+            attitude_reference[i] = std::min(std::max(attitude_reference[i], -travel), travel);
+
+        roll += (attitude_reference[0] - roll)*dt/attitude_lag;
+        pitch += (attitude_reference[1] - pitch)*dt/attitude_lag;
+
+        // thrust holds altitude, so its horizontal part is g times the tilt
+        const double acceleration[2] = {-GRAVITY*tan(pitch), GRAVITY*tan(roll)/cos(pitch)};
+        for (size_t i = 0; i < 2; ++i)
+        {
+            velocity[i] += acceleration[i]*dt;
+            position[i] += velocity[i]*dt;
+        }
+
+        if (t >= period)
+        {
+            const double cross_track = hypot(position[0], position[1]) - radius;
+            sum_squares += cross_track*cross_track;
+            ++samples;
+        }
+    }
+    return sqrt(sum_squares/samples);
+}
+}
+
+TEST(translation_outer_pid, FEED_FORWARD_ATTITUDE)
+{
+    blas::vector<double> forward(blas::zero_vector<double>(3));
+    forward[0] = GRAVITY;
+    blas::vector<double> attitude(translation_outer_pid::feed_forward_attitude(forward, GRAVITY));
+    EXPECT_NEAR(0, attitude[0], 1e-12);
+    EXPECT_NEAR(-M_PI/4, attitude[1], 1e-12);
+
+    blas::vector<double> right(blas::zero_vector<double>(3));
+    right[1] = GRAVITY;
+    attitude = translation_outer_pid::feed_forward_attitude(right, GRAVITY);
+    EXPECT_NEAR(M_PI/4, attitude[0], 1e-12);
+    EXPECT_NEAR(0, attitude[1], 1e-12);
+}
+
+TEST(translation_outer_pid, CIRCLE_VELOCITY_AND_ACCELERATION)
+{
+    const double radius = 10, period = 20, omega = 2*M_PI/period;
+    blas::vector<double> v(circle::velocity_at(radius, period, M_PI/2));
+    EXPECT_NEAR(-omega*radius, v[0], 1e-6);
+    EXPECT_NEAR(0, v[1], 1e-6);
+    EXPECT_EQ(0, v[2]);
+
+    blas::vector<double> a(circle::acceleration_at(radius, period, M_PI/2));
+    EXPECT_NEAR(0, a[0], 1e-6);
+    EXPECT_NEAR(-omega*omega*radius, a[1], 1e-6);
+    EXPECT_EQ(0, a[2]);
+}
+
+TEST(translation_outer_pid, FEED_FORWARD_REDUCES_CIRCLE_CROSS_TRACK)
+{
+    // 5 m/s needs more tilt than the travel allows
+    const double radius = 10;
+    for (double speed : {1.0, 2.0, 3.0, 4.0})
+    {
+        const double without = circle_cross_track_rms(radius, speed, 0);
+        const double with = circle_cross_track_rms(radius, speed, 1);
+        std::cout << "circle r " << radius << " m at " << speed << " m/s: cross track rms "
+                  << without << " m without feed forward, " << with << " m with" << std::endl;
+        EXPECT_LT(with, without/10);
+    }
+}
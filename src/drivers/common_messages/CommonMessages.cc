@@ -22,8 +22,13 @@
 #include "Control.h"
 #include "Helicopter.h"
 #include "RCTrans.h"
+#include "ParameterTable.h"
+#include "telemetry_encoders.h"
+#include "tick_profiler.h"
 #include <sys/sysinfo.h>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
 
 
 CommonMessages* CommonMessages::_instance = NULL;
@@ -40,7 +45,9 @@ CommonMessages* CommonMessages::getInstance()
 }
 
 CommonMessages::CommonMessages()
-    :Driver("Mavlink Common Messages","common_messages")
+    :Driver("Mavlink Common Messages","common_messages"),
+    requested_params_head(0),
+    requested_params_tail(0)
 {
     configDescribe("send_system_status_message",
                    "true/false",
@@ -52,6 +59,11 @@ CommonMessages::CommonMessages()
                    "Enables/disables sending the time message which includes the system time.");
     _sendSysTime = configGetb("send_system_time_message", true);
 
+    configDescribe("send_main_loop_phases",
+                   "true/false",
+                   "Enables/disables sending the p50, p99 and max time of each main loop phase once a second as named values.");
+    _sendLoopPhases = configGetb("send_main_loop_phases", true);
+
     configDescribe("message_send_rate_hz",
                    "0 - 200",
                    "The rate at which the set of common messages are sent.",
@@ -70,6 +82,12 @@ CommonMessages::CommonMessages()
                     "hz");
     controlEffortRate = configGeti("control_effort_send_rate_hz", 10);
 
+    configDescribe("telemetry_profile",
+                    "0:full, 1:compact",
+                    "The compact profile sends the attitude as a quaternion, drops the scaled radio channels "
+                    "and sends the system status and time once a second.");
+    _compact = configGeti("telemetry_profile", 0) == 1;
+
     debug() << "Sending messages at: " << _frequencyHz.load();
 
     _sendParams = false; // don't send params until requested
@@ -86,7 +104,27 @@ CommonMessages::~CommonMessages()
 
 }
 
-void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void CommonMessages::request_param(int position)
+{
+    std::lock_guard<std::mutex> lock(requested_params_lock);
+    const size_t next = (requested_params_head + 1) % requested_params.size();
+    if (next == requested_params_tail)
+    {
+        warning() << "Too many parameters requested at once, dropping request";
+        return;
+    }
+    requested_params[requested_params_head] = position;
+    requested_params_head = next;
+}
+
+size_t CommonMessages::mavlinkMsgCapacity()
+{
+    // attitude, two rc channels, control effort, sys status, system time,
+    // global position and radio calibration, the main loop phases, then the parameters
+    return 8 + 3*tick_profiler::PHASES + requested_params.size() + ParameterTable::getInstance()->size();
+}
+
+void CommonMessages::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
@@ -96,20 +134,30 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
     // Send attitude
     if(shouldSendMavlinkMessage(msgNumber, sendRateHz, 5))
     {
-        mavlink_message_t msg;
-
         auto angles = state->rotation.get();
 
-        mavlink_msg_attitude_pack(uasId, MAV_COMP_ID_IMU, &msg,
-                                 getMsSinceInit(),
-                                 angles.getRollRad(),
-                                 angles.getPitchRad(),
-                                 angles.getYawRad(),
-                                 state->rollSpeed_radPerS.get(),
-                                 state->pitchSpeed_radPerS.get(),
-                                 state->yawSpeed_radPerS.get());
-
-        msgs.push_back(msg);
+        if(_compact.load())
+        {
+            double w, x, y, z;
+            angles.toQuaternion(w, x, y, z);
+            mavlink_msg_attitude_quaternion_pack(uasId, MAV_COMP_ID_IMU, msgs.next(),
+                                                 getMsSinceInit(),
+                                                 w, x, y, z,
+                                                 state->rollSpeed_radPerS.get(),
+                                                 state->pitchSpeed_radPerS.get(),
+                                                 state->yawSpeed_radPerS.get());
+        }
+        else
+        {
+            mavlink_msg_attitude_pack(uasId, MAV_COMP_ID_IMU, msgs.next(),
+                                     getMsSinceInit(),
+                                     angles.getRollRad(),
+                                     angles.getPitchRad(),
+                                     angles.getYawRad(),
+                                     state->rollSpeed_radPerS.get(),
+                                     state->pitchSpeed_radPerS.get(),
+                                     state->yawSpeed_radPerS.get());
+        }
     }
 
 
@@ -117,17 +165,16 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
     {
         {
             auto raw = state->servoRawInputs.get();
-            mavlink_message_t msg;
-            mavlink_msg_rc_channels_raw_pack(100, 200, &msg,
+            mavlink_msg_rc_channels_raw_pack(100, 200, msgs.next(),
                                              0, 0,
                                              raw[0], raw[1], raw[2], raw[3],
                                              raw[4], raw[5], raw[6], raw[7], 0);
-            msgs.push_back(msg);
         }
+        // the scaled channels follow from the raw ones and the radio calibration
+        if(!_compact.load())
         {
             std::vector<double> scaled(RCTrans::getScaledVector());
-            mavlink_message_t msg;
-            mavlink_msg_rc_channels_scaled_pack(100, 200, &msg,
+            mavlink_msg_rc_channels_scaled_pack(100, 200, msgs.next(),
                                                 0,0,
                                                 static_cast<int16_t>(scaled[RCTrans::AILERON]*1e4),
                                                 static_cast<int16_t>(scaled[RCTrans::ELEVATOR]*1e4),
@@ -136,41 +183,55 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
                                                 static_cast<int16_t>(scaled[RCTrans::GYRO]*1e4),
                                                 static_cast<int16_t>(scaled[RCTrans::PITCH]*1e4),
                                                 0,0,0);
-            msgs.push_back(msg);
         }
     }
 
     if(msgNumber % (sendRateHz / controlEffortRate.load()) == 0)
     {
-        mavlink_message_t msg;
-        blas::vector<double> effort(Control::getInstance()->get_control_effort());
-        std::vector<float> control(effort.begin(), effort.end());
-        mavlink_msg_ualberta_control_effort_pack(uasId, heli::CONTROLLER_ID, &msg, &control[0]);
-
-        msgs.push_back(msg);
+        const blas::vector<double> effort(Control::getInstance()->get_control_effort());
+        float control[6] = {0};
+        std::copy_n(effort.begin(), std::min<size_t>(effort.size(), 6), control);
+        telemetry::encode_control_effort(control, uasId, heli::CONTROLLER_ID, msgs.next());
     }
 
-    if(!requested_params.empty())
     {
+        ParameterTable* parameters = ParameterTable::getInstance();
         std::lock_guard<std::mutex> lock(requested_params_lock);
-        mavlink_message_t msg;
-        while(!requested_params.empty())
+        // requests that do not fit are answered next time
+        while(requested_params_tail != requested_params_head && msgs.remaining() > 0)
         {
+            const ParameterTable::entry& p = (*parameters)[requested_params[requested_params_tail]];
             mavlink_msg_param_value_pack(uasId,
-                                         requested_params.front().getCompID(),
-                                         &msg, (const char*)(requested_params.front().getParamID().c_str()),
-                                         requested_params.front().getValue(),
+                                         p.component,
+                                         msgs.next(), p.id.data(),
+                                         p.value.load(),
                                          MAV_PARAM_TYPE_REAL32,
-                                         1,   // num of params
-                                         -1); // index
+                                         p.count,
+                                         p.index);
 
-            msgs.push_back(msg);
-            requested_params.pop();
+            requested_params_tail = (requested_params_tail + 1) % requested_params.size();
         }
     }
 
 
 
+    if(_sendLoopPhases.load() && shouldSendMavlinkMessage(msgNumber, sendRateHz, 1))
+    {
+        const tick_profiler::summary summary = state->main_loop_phases.get();
+        const uint32_t now = getMsSinceInit();
+        char name[11];
+        for (size_t p = 0; summary.ticks > 0 && p < tick_profiler::PHASES; p++)
+        {
+            const char* phase = tick_profiler::name(static_cast<tick_profiler::phase>(p));
+            snprintf(name, sizeof(name), "t_%s_p50", phase);
+            mavlink_msg_named_value_float_pack(uasId, MAV_COMP_ID_ALL, msgs.next(), now, name, summary.phases[p].p50_us);
+            snprintf(name, sizeof(name), "t_%s_p99", phase);
+            mavlink_msg_named_value_float_pack(uasId, MAV_COMP_ID_ALL, msgs.next(), now, name, summary.phases[p].p99_us);
+            snprintf(name, sizeof(name), "t_%s_max", phase);
+            mavlink_msg_named_value_float_pack(uasId, MAV_COMP_ID_ALL, msgs.next(), now, name, summary.phases[p].max_us);
+        }
+    }
+
     // the rest of the messages use a common frequency.
     if(_frequencyHz.load() <= 0 || msgNumber % (sendRateHz / _frequencyHz.load()) != 0)
     {
@@ -183,20 +244,20 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
 
     trace() << "Sending Mavlink Messages";
     /**
-    mavlink_message_t msg;
-    mavlink_msg_udenver_cpu_usage_pack(uasId, 40, &msg, getCpuUtilization(), totalram.load(), freeram.load());
-    msgs.push_back(msg);
+    mavlink_msg_udenver_cpu_usage_pack(uasId, 40, msgs.next(), getCpuUtilization(), totalram.load(), freeram.load());
     **/
+    // status and time change slowly, the compact profile sends them once a second
+    const bool sendStatus = !_compact.load() || shouldSendMavlinkMessage(msgNumber, sendRateHz, 1);
+
     // sys_status
-    if(_sendSysStatus.load())
+    if(_sendSysStatus.load() && sendStatus)
     {
         uint16_t load = state->main_loop_load.get() * 100;
 
         if(load > 1000)
             warning() << "main loop is using too much time";
 
-        mavlink_message_t msg;
-        mavlink_msg_sys_status_pack(uasId, MAV_COMP_ID_ALL, &msg,
+        mavlink_msg_sys_status_pack(uasId, MAV_COMP_ID_ALL, msgs.next(),
                                     0, // uint32_t onboard_control_sensors_present,
                                     0, // uint32_t onboard_control_sensors_enabled,
                                     0, // uint32_t onboard_control_sensors_health,
@@ -208,34 +269,30 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
                                     0, // uint16_t errors_comm,
                                     0, 0, 0, 0 //uint16_t errors_count1-4
                                     );
-        msgs.push_back(msg);
     }
 
 
-    if(_sendSysTime.load())
+    if(_sendSysTime.load() && sendStatus)
     {
         struct sysinfo sysinf;
         sysinfo(&sysinf);
-        mavlink_message_t msg;
         uint64_t time_unix_usec = std::chrono::duration_cast<std::chrono::microseconds>(
                                     std::chrono::system_clock::now().time_since_epoch()).count();
 
-        mavlink_msg_system_time_pack(uasId, MAV_COMP_ID_ALL, &msg,
+        mavlink_msg_system_time_pack(uasId, MAV_COMP_ID_ALL, msgs.next(),
                                     time_unix_usec,
                                     sysinf.uptime * 1000
                                     );
-        msgs.push_back(msg);
     }
 
     // Global position (mavlink common message)
     {
 
         // send the default mavlink message
-        mavlink_message_t msg;
         auto position = state->position.get();
         mavlink_msg_global_position_int_pack(uasId,
                                              MAV_COMP_ID_ALL,
-                                             &msg,
+                                             msgs.next(),
                                              getMsSinceInit(),
                                              position.getLatitudeDD() * 1E7,
                                              position.getLongitudeDD() * 1E7,
@@ -245,41 +302,26 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
                                              0,
                                              0,
                                              0);
-        msgs.push_back(msg);
     }
 
 
 
     if(_sendParams.load())
     {
-        mavlink_message_t msg;
-
-        std::vector<std::vector<Parameter> > plist;
+        ParameterTable* parameters = ParameterTable::getInstance();
+        parameters->refresh();
 
-        plist.push_back(Control::getInstance()->getParameters());
-        plist.push_back(Helicopter::getInstance()->getParameters());
-
-        int num_params = 0;
-        for (unsigned int i=0; i<plist.size(); i++)
-        {
-            num_params += plist[i].size();
-        }
-        int index = 0;
-        for (unsigned int i=0; i<plist.size(); i++)
+        for (size_t i = 0; i < parameters->size(); i++)
         {
-            for (unsigned int j=0; j<plist.at(i).size(); j++)
-            {
-                mavlink_msg_param_value_pack(   uasId,
-                                                (uint8_t)plist.at(i).at(j).getCompID(),
-                                                &msg,
-                                                (const char*)(plist.at(i).at(j).getParamID().c_str()),
-                                                plist.at(i).at(j).getValue(),
-                                                MAV_PARAM_TYPE_REAL32,
-                                                num_params,
-                                                index);
-                msgs.push_back(msg);
-                index++;
-            }
+            const ParameterTable::entry& p = (*parameters)[i];
+            mavlink_msg_param_value_pack(   uasId,
+                                            p.component,
+                                            msgs.next(),
+                                            p.id.data(),
+                                            p.value.load(),
+                                            MAV_PARAM_TYPE_REAL32,
+                                            p.count,
+                                            p.index);
         }
 
         _sendParams = false;
@@ -289,10 +331,9 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
 
     if(_sendRCCalibration.load())
     {
-        mavlink_message_t msg;
         RadioCalibration *radio = RadioCalibration::getInstance();
 
-        mavlink_msg_radio_calibration_pack(uasId, heli::RADIO_CAL_ID, &msg,
+        mavlink_msg_radio_calibration_pack(uasId, heli::RADIO_CAL_ID, msgs.next(),
                                            radio->getAileron().data(),
                                            radio->getElevator().data(),
                                            radio->getRudder().data(),
@@ -301,7 +342,6 @@ void CommonMessages::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int ua
                                            radio->getThrottle().data()
                                           );
 
-        msgs.push_back(msg);
         _sendRCCalibration = false;
     }
 };
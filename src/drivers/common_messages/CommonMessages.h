@@ -22,7 +22,7 @@
 
 #include <atomic>  // Used for atomic types
 #include <mutex>   // Used for singleton design.
-#include <queue>   // User for requested param list
+#include <array>   // Used for requested param list
 #include "Driver.h" // All drivers implement this.
 #include "Parameter.h"
 
@@ -36,13 +36,13 @@ public:
     Returns the one allowed instance of this Driver
     **/
     static CommonMessages* getInstance();
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual size_t mavlinkMsgCapacity() override;
     std::atomic_bool _sendParams;
     std::atomic_bool _sendRCCalibration;
 
-    // List of params requested by QGC
-    std::queue<Parameter> requested_params;
-    std::mutex requested_params_lock;
+    /// queue a PARAM_VALUE for the ParameterTable entry at position
+    void request_param(int position);
 
     // Send rates for RC Channels and Control Effort
     std::atomic<int> rcChannelRate;
@@ -57,6 +57,16 @@ private:
     std::atomic<int> _frequencyHz; // frequency at which to send these messages.
     std::atomic_bool _sendSysStatus;
     std::atomic_bool _sendSysTime;
+    /// send the main loop phase percentiles
+    std::atomic_bool _sendLoopPhases;
+    /// send the compact telemetry profile
+    std::atomic_bool _compact;
+
+    /// ParameterTable positions of the params requested by QGC, a fixed size ring
+    std::array<int, 64> requested_params;
+    size_t requested_params_head;
+    size_t requested_params_tail;
+    std::mutex requested_params_lock;
 };
 
 #endif /* LINUX_H */
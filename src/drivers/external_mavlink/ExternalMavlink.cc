@@ -33,8 +33,13 @@ const std::string IMU_LOG_FILE_NAME = "external_mavlink_imu";
 const std::string IMU_LOG_FILE_FORMAT = "roll (rad)\tpitch (rad)\tyaw (rad)\troll speed (rad/s)\tpitch speed (rad/s)\tyaw speed (rad/s)";
 
 ExternalMavlink::ExternalMavlink()
-:Plugin("External Mavlink Source","external_mavlink", 50)
+:Plugin("External Mavlink Source","external_mavlink", 50),
+ _framer(mavlink_framer::AUTO, configGeti("custom_msgid_base", mavlink_framer::DEFAULT_CUSTOM_MSGID_BASE))
 {
+    configDescribe("custom_msgid_base",
+                   "int",
+                   "Offset the custom messages are received with in MAVLink 2 frames.");
+
     start(); // Start the plugin
 }
 
@@ -97,7 +102,7 @@ void ExternalMavlink::loop()
     // parse message
 	for (int i=0; i<bytes_received; i++)
 	{
-		if(mavlink_parse_char(MAVLINK_COMM_1, buf[i], &_msg, &_status))
+		if(_framer.parse(buf[i], _msg))
 		{
 			switch(_msg.msgid)
 			{
@@ -146,7 +151,7 @@ void ExternalMavlink::loop()
                 }
             default:
             // lf->logData(GPS_LOG_FILE_NAME, GPS_LOG_FILE_FORMAT);
-                if( _msg.msgid >= 150 && _msg.msgid <= 240)
+                if(mavlink_framer::is_custom(_msg.msgid))
                 {
                     trace() << "got custom message, ignoring it.";
                 }
@@ -161,7 +166,7 @@ void ExternalMavlink::loop()
 
 
 /**
-void ExternalMavlink::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void ExternalMavlink::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
@@ -169,9 +174,7 @@ void ExternalMavlink::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int u
     {
         debug() << "Sending CPU Utilization";
 
-        mavlink_message_t msg;
-        mavlink_msg_udenver_cpu_usage_pack(uasId, 40, &msg, cpu_utilization.get(), totalram.load(), freeram.load());
-        msgs.push_back(msg);
+        mavlink_msg_udenver_cpu_usage_pack(uasId, 40, msgs.next(), cpu_utilization.get(), totalram.load(), freeram.load());
     }
 };
 **/
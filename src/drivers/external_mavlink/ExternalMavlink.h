@@ -25,6 +25,7 @@
 #include "Plugin.h"
 #include "Singleton.h"
 #include "SystemStateParam.hpp"
+#include "mavlink_framer.h"
 
 
 /**
@@ -39,7 +40,9 @@ class ExternalMavlink: public Plugin, public Singleton<ExternalMavlink>
     friend class Singleton<ExternalMavlink>;
 
 public:
-//    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+//    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /// the one message sendMavlinkMsg writes once it is enabled
+    virtual size_t mavlinkMsgCapacity() override {return 1;}
     virtual bool init();
     virtual void loop();
     virtual void teardown();
@@ -57,7 +60,8 @@ private:
     bool _use_external_gps;
     
 	mavlink_message_t _msg;
-	mavlink_status_t _status;
+	/// accepts MAVLink 1 and MAVLink 2 frames
+	mavlink_framer _framer;
 };
 
 #endif /* EXTERNAL_MAVLINK_H */
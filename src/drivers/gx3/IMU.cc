@@ -31,6 +31,7 @@
 #include "util/AutopilotMath.hpp"
 #include "Control.h"
 #include "SystemState.h"
+#include "LogFile.h"
 
 /* File Handling Headers */
 #include <sys/types.h>
@@ -40,11 +41,14 @@
 #include <unistd.h>
 #include <errno.h>
 #include <cstdlib>
+#include <cstdio>
 #include <math.h>
 #include <mavlink.h>
 
 
 /* Boost Headers */
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/math/constants/constants.hpp>
 
 
@@ -52,6 +56,8 @@
 const std::string IMU_SERIAL_PORT_CONFIG_NAME = "serial_port";
 const std::string IMU_SERIAL_PORT_CONFIG_DEFAULT = "/dev/ser2";
 
+const std::string IMU::LOG_VIBRATION = "GX3 Vibration";
+
 
 IMU::IMU()
     :Driver("GX3 IMU", "gx3"),
@@ -66,7 +72,10 @@ IMU::IMU()
      nav_angular_rate(blas::zero_vector<double>(3)),
      ahrs_angular_rate(blas::zero_vector<double>(3)),
     attitude_source_connection(QGCLink::getInstance()->attitude_source.connect(
-                                    boost::bind(&IMU::set_use_nav_attitude, this, _1)))
+                                    boost::bind(&IMU::set_use_nav_attitude, this, _1))),
+     nav_attitude_source(-1),
+     ahrs_attitude_source(-1),
+     position_source(-1)
 {
     configDescribe("position_message_rate_hz",
                    "0 - 100",
@@ -80,6 +89,12 @@ IMU::IMU()
                    "hz");
     _attitudeSendRateHz = configGeti("attitude_message_rate_hz", 10);
 
+    configDescribe("vibration_message_rate_hz",
+                   "0 - 10",
+                   "Rate at which vibration peaks and band energies are sent.",
+                   "hz");
+    _vibrationSendRateHz = configGeti("vibration_message_rate_hz", 1);
+
     configDescribe("use_external_gps",
                    "true/false",
                    "Defines if IMU should use external GPS data.");
@@ -91,6 +106,8 @@ IMU::IMU()
         return;
     }
 
+    init_sources();
+
     if(!init_serial())
     {
         initFailed("could not open serial port");
@@ -98,6 +115,8 @@ IMU::IMU()
     }
 
 
+    init_vibration();
+
     new std::thread(read_serial());
     new std::thread(message_parser());
     new send_serial(this);
@@ -105,9 +124,96 @@ IMU::IMU()
 
 IMU::~IMU()
 {
+    if (vibration)
+        vibration->stop();
+    if (vibration_thread.joinable())
+        vibration_thread.join();
     close(fd_ser);
 }
 
+void IMU::init_vibration()
+{
+    configDescribe("vibration_window",
+                   "power of two",
+                   "Samples per vibration spectrum, 0 turns the analyzer off.");
+    const int window = configGeti("vibration_window", 256);
+
+    configDescribe("vibration_sample_rate_hz",
+                   "> 0",
+                   "Rate the ahrs accelerometer and gyro data arrive at.",
+                   "hz");
+    const double rate = configGetd("vibration_sample_rate_hz", 100);
+
+    configDescribe("vibration_bands_hz",
+                   "comma separated list",
+                   "Edges of the bands vibration energy is reported in.",
+                   "hz");
+    const std::string band_list = configGets("vibration_bands_hz", "1,5,15,30,50");
+
+    if (window <= 0)
+        return;
+
+    std::vector<double> edges;
+    std::vector<std::string> strs;
+    boost::split(strs, band_list, boost::is_any_of(","));
+    for (std::string& str : strs)
+    {
+        boost::algorithm::trim(str);
+        try
+        {
+            if (!str.empty())
+                edges.push_back(boost::lexical_cast<double>(str));
+        }
+        catch (const boost::bad_lexical_cast&)
+        {
+            warning() << "Ignoring vibration band edge " << str;
+        }
+    }
+
+    try
+    {
+        vibration.reset(new vibration_analyzer(window, rate, edges));
+    }
+    catch (const std::invalid_argument& e)
+    {
+        warning() << "Vibration analyzer off: " << e.what();
+        return;
+    }
+
+    std::string header;
+    const char* names[vibration_analyzer::CHANNELS] = {"Acc_X", "Acc_Y", "Acc_Z", "Gyr_X", "Gyr_Y", "Gyr_Z"};
+    for (const char* name : names)
+        header += std::string(name) + "_Hz " + name + "_Amp ";
+    for (const char* sensor : {"Acc", "Gyr"})
+    {
+        for (size_t b = 0; b < vibration->bands(); ++b)
+            header += std::string(sensor) + "_" + boost::lexical_cast<std::string>(vibration->band_low(b)) + "_"
+                      + boost::lexical_cast<std::string>(vibration->band_high(b)) + "_Hz ";
+    }
+    header += "Cpu_Percent";
+    LogFile::getInstance()->logHeader(LOG_VIBRATION, header);
+
+    vibration_thread = std::thread(&vibration_analyzer::run, vibration.get(), std::chrono::milliseconds(1000),
+                                   [this](const vibration_analyzer::summary& result)
+    {
+        log_vibration(result);
+    });
+}
+
+void IMU::log_vibration(const vibration_analyzer::summary& result)
+{
+    std::vector<double> log;
+    for (size_t c = 0; c < vibration_analyzer::CHANNELS; ++c)
+    {
+        log.push_back(result.peak_hz[c]);
+        log.push_back(result.peak_amplitude[c]);
+    }
+    for (const std::array<float, vibration_analyzer::MAX_BANDS>& bands : result.band_energy)
+        log.insert(log.end(), bands.begin(), bands.begin() + result.bands);
+    log.push_back(result.cpu_percent);
+    LogFile::getInstance()->logData(LOG_VIBRATION, log);
+}
+
 bool IMU::init_serial()
 {
     if(fd_ser != -1)
@@ -195,6 +301,48 @@ blas::matrix<double> IMU::euler_to_rotation(const blas::vector<double>& euler)
     return trans(rot);
 }
 
+void IMU::capture_telemetry(telemetry::snapshot& s) const
+{
+    GPSPosition position, origin;
+    {
+        std::unique_lock<std::mutex> position_guard(position_lock, std::defer_lock);
+        std::unique_lock<std::mutex> origin_guard(ned_origin_lock, std::defer_lock);
+        std::unique_lock<std::mutex> velocity_guard(velocity_lock, std::defer_lock);
+        std::unique_lock<std::mutex> nav_euler_guard(nav_euler_lock, std::defer_lock);
+        std::unique_lock<std::mutex> ahrs_euler_guard(ahrs_euler_lock, std::defer_lock);
+        std::unique_lock<std::mutex> nav_rate_guard(nav_angular_rate_lock, std::defer_lock);
+        std::unique_lock<std::mutex> ahrs_rate_guard(ahrs_angular_rate_lock, std::defer_lock);
+        std::lock(position_guard, origin_guard, velocity_guard, nav_euler_guard,
+                  ahrs_euler_guard, nav_rate_guard, ahrs_rate_guard);
+
+        position = _position;
+        origin = _ned_origin;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            s.ned_vel[i] = velocity[i];
+            s.nav_euler[i] = nav_euler[i];
+            s.ahrs_euler[i] = ahrs_euler[i];
+            s.nav_ang_rate[i] = nav_angular_rate[i];
+            s.ahrs_ang_rate[i] = ahrs_angular_rate[i];
+        }
+    }
+
+    s.time_ms = getMsSinceInit();
+    s.nav_attitude = get_use_nav_attitude();
+
+    s.llh_pos[0] = position.getLatitudeDD();
+    s.llh_pos[1] = position.getLongitudeDD();
+    s.llh_pos[2] = position.getHeightM();
+    s.ned_origin[0] = origin.getLatitudeDD();
+    s.ned_origin[1] = origin.getLongitudeDD();
+    s.ned_origin[2] = origin.getHeightM();
+
+    double ned[3];
+    position.ned(origin, ned);
+    for (size_t i = 0; i < 3; ++i)
+        s.ned_pos[i] = ned[i];
+}
+
 blas::matrix<double> IMU::get_heading_rotation() const
 {
     double heading = get_euler()(2);
@@ -210,84 +358,45 @@ blas::matrix<double> IMU::get_heading_rotation() const
 }
 
 
-void IMU::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void IMU::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
 
 
-    // UAlberta Position
-    if(shouldSendMavlinkMessage(msgNumber, sendRateHz, 20))
+    const bool send_position = shouldSendMavlinkMessage(msgNumber, sendRateHz, 20);
+    const bool send_attitude = shouldSendMavlinkMessage(msgNumber, sendRateHz, 20);
+    if (send_position || send_attitude)
     {
-        //trace() << "Sending mavlink_msg_ualberta_position_pack";
-
-        // get llh pos
-        std::vector<double> _llh_pos = getPosition().toLLH();
-        std::vector<float> llh_pos(_llh_pos.begin(), _llh_pos.end());
-
-        // get ned pos
-        blas::vector<double> _ned_pos = get_ned_position();
-        std::vector<float> ned_pos(_ned_pos.begin(), _ned_pos.end());
-
-        // get ned vel
-        blas::vector<double> _ned_vel(get_ned_velocity());
-        std::vector<float> ned_vel(_ned_vel.begin(), _ned_vel.end());
-
-        // get ned origin
-        std::vector<double> _ned_origin = getNedOriginPosition().toLLH();
-        std::vector<float> ned_origin(_ned_origin.begin(), _ned_origin.end());
-
-        Control *control = Control::getInstance();
-        // get reference position
-        blas::vector<double> _ref_pos(control->get_reference_position());
-        std::vector<float> ref_pos(_ref_pos.begin(), _ref_pos.end());
-
-        // get position error in body
-        blas::vector<double> _body_error(control->get_body_postion_error());
-        std::vector<float> body_error(_body_error.begin(), _body_error.end());
-
-        // get position error in ned
-        blas::vector<double> _ned_error(control->get_ned_position_error());
-        std::vector<float> ned_error(_ned_error.begin(), _ned_error.end());
-
-        mavlink_message_t msg;
-
-
-        mavlink_msg_ualberta_position_pack(
-            uasId,
-            heli::GX3_ID,
-            &msg,
-            &llh_pos[0], &ned_pos[0], &ned_vel[0], &ned_origin[0],
-            &ref_pos[0], &body_error[0], &ned_error[0],
-            getMsSinceInit());
-
-        msgs.push_back(msg);
+        telemetry::snapshot snapshot;
+        capture_telemetry(snapshot);
+        Control::getInstance()->capture_telemetry(snapshot);
+
+        if (send_position)
+            telemetry::encode_position(snapshot, uasId, heli::GX3_ID, msgs.next());
+        if (send_attitude)
+            telemetry::encode_attitude(snapshot, uasId, heli::GX3_ID, msgs.next());
     }
 
-    // UAlberta Attitude
-    if(shouldSendMavlinkMessage(msgNumber, sendRateHz, 20))
+    if(vibration && shouldSendMavlinkMessage(msgNumber, sendRateHz, _vibrationSendRateHz))
     {
-        //trace() << "Sending mavlink_msg_ualberta_attitude";
-
-        blas::vector<double> _nav_euler(get_nav_euler());
-        std::vector<float> nav_euler(_nav_euler.begin(), _nav_euler.end());
+        const vibration_analyzer::summary result = vibration->get_summary();
+        const uint32_t now = getMsSinceInit();
+        const char* names[vibration_analyzer::CHANNELS] = {"ax", "ay", "az", "gx", "gy", "gz"};
 
-        blas::vector<double> _nav_ang_rate(get_nav_angular_rate());
-        std::vector<float> nav_ang_rate(_nav_ang_rate.begin(), _nav_ang_rate.end());
-
-        blas::vector<double> _ahrs_euler(get_ahrs_euler());
-        std::vector<float> ahrs_euler(_ahrs_euler.begin(), _ahrs_euler.end());
-
-        blas::vector<double> _ahrs_ang_rate(get_ahrs_angular_rate());
-        std::vector<float> ahrs_ang_rate(_ahrs_ang_rate.begin(), _ahrs_ang_rate.end());
-
-        blas::vector<double> _attitude_reference(Control::getInstance()->get_reference_attitude());
-        std::vector<float> attitude_reference(_attitude_reference.begin(), _attitude_reference.end());
-
-        mavlink_message_t msg;
-        mavlink_msg_ualberta_attitude_pack(uasId, heli::GX3_ID, &msg,
-                                           &nav_euler[0], &nav_ang_rate[0], &ahrs_euler[0], &ahrs_ang_rate[0], &attitude_reference[0],
-                                           getMsSinceInit());
-
-        msgs.push_back(msg);
+        char name[11];
+        for (size_t c = 0; result.count > 0 && c < vibration_analyzer::CHANNELS; ++c)
+        {
+            snprintf(name, sizeof(name), "vib_%s_hz", names[c]);
+            mavlink_msg_named_value_float_pack(uasId, heli::GX3_ID, msgs.next(), now, name, result.peak_hz[c]);
+            snprintf(name, sizeof(name), "vib_%s_amp", names[c]);
+            mavlink_msg_named_value_float_pack(uasId, heli::GX3_ID, msgs.next(), now, name, result.peak_amplitude[c]);
+        }
+        for (size_t b = 0; result.count > 0 && b < result.bands; ++b)
+        {
+            snprintf(name, sizeof(name), "vib_acc_b%zu", b);
+            mavlink_msg_named_value_float_pack(uasId, heli::GX3_ID, msgs.next(), now, name, result.band_energy[0][b]);
+            snprintf(name, sizeof(name), "vib_gyr_b%zu", b);
+            mavlink_msg_named_value_float_pack(uasId, heli::GX3_ID, msgs.next(), now, name, result.band_energy[1][b]);
+        }
     }
 
     if(_newStatusMessage.load())
@@ -295,33 +404,76 @@ void IMU::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int se
         std::string message(status_message);
         _newStatusMessage = false;
         message.resize(49); // leave room for \0
-        mavlink_message_t msg;
-        mavlink_msg_ualberta_gx3_message_pack(uasId, heli::GX3_ID, &msg, message.c_str());
-
-        msgs.push_back(msg);
+        mavlink_msg_ualberta_gx3_message_pack(uasId, heli::GX3_ID, msgs.next(), message.c_str());
     }
 
 };
 
-void IMU::writeToSystemState()
+size_t IMU::mavlinkMsgCapacity()
 {
+    // position, attitude and a status message
+    size_t capacity = 3;
+    if (vibration)
+        capacity += 2*vibration_analyzer::CHANNELS + 2*vibration->bands();
+    return capacity;
+}
 
-    SystemState *state = SystemState::getInstance();
+void IMU::init_sources()
+{
+    configDescribe("nav_rate_hz", "> 0", "Rate of the nav filter's attitude, for the state selection.", "hz");
+    configDescribe("ahrs_rate_hz", "> 0", "Rate of the AHRS attitude, for the state selection.", "hz");
+    configDescribe("position_rate_hz", "> 0", "Rate of the nav filter's position, for the state selection.", "hz");
 
-    // no need to lock for the position because it uses SystemStateObjParams
+    SystemState* state = SystemState::getInstance();
+    nav_attitude_source = state->attitude_sources.add_source("gx3_nav", configGetd("nav_rate_hz", 100));
+    ahrs_attitude_source = state->attitude_sources.add_source("gx3_ahrs", configGetd("ahrs_rate_hz", 100));
+    position_source = state->position_sources.add_source("gx3", configGetd("position_rate_hz", 10));
+
+    attitude_selection_connection = state->attitude_sources.selection_changed.connect([this](int, int to)
     {
-        double accuracy = externGPS ? 0 : 50; // high if we are using our own as it isn't very precise.
-        state->position.set(getPosition(), accuracy);
-    }
+        if (! SystemState::getInstance()->attitude_sources.enforced())
+            return;
+        if (to == nav_attitude_source && ! get_use_nav_attitude())
+            set_use_nav_attitude(true);
+        else if (to == ahrs_attitude_source && get_use_nav_attitude())
+            set_use_nav_attitude(false);
+    });
+}
 
-    state->nedOrigin.set(getNedOriginPosition(), 0);
+void IMU::publish_attitude(int source, const blas::vector<double>& euler)
+{
+    const state_selector::value_type value = {{euler[0], euler[1], euler[2]}};
+    SystemState::getInstance()->attitude_sources.publish(source, value, 0);
+}
 
+void IMU::publish_position(GPSPosition position)
+{
+    // high if we are using our own as it isn't very precise.
+    const double accuracy = externGPS ? 0 : 50;
+    const state_selector::value_type value = {{position.getLatitudeDD(), position.getLongitudeDD(), position.getHeightM()}};
+    SystemState::getInstance()->position_sources.publish(position_source, value, accuracy);
+}
 
-    // set the rotation
-    auto euler = get_euler();
-    EulerAngles ea(euler[0], euler[1], euler[2]);
-    debug() << "Roll: " << euler[0] << " Pitch: " << euler[1] << " Yaw: " << euler[2];
-    state->rotation.set(ea, 0);
+bool IMU::attitude_source_selected() const
+{
+    const state_selector& sources = SystemState::getInstance()->attitude_sources;
+    const int selected = sources.selected();
+    return ! sources.enforced() || (selected >= 0 && (selected == nav_attitude_source || selected == ahrs_attitude_source));
+}
+
+bool IMU::position_source_selected() const
+{
+    const state_selector& sources = SystemState::getInstance()->position_sources;
+    return ! sources.enforced() || (position_source >= 0 && sources.selected() == position_source);
+}
+
+void IMU::writeToSystemState()
+{
+
+    SystemState *state = SystemState::getInstance();
+
+    // the position and rotation are published to the state selection as they arrive
+    state->nedOrigin.set(getNedOriginPosition(), 0);
 
     // set the angular rates.
     auto eulerrate =  get_euler_rate();
@@ -29,6 +29,7 @@
 #include <vector>
 #include <mutex>
 #include <atomic>
+#include <memory>
 #include <thread>
 
 /* Project Headers */
@@ -37,6 +38,8 @@
 #include "ThreadSafeVariable.h"
 #include "Singleton.h"
 #include "GPSPosition.h"
+#include "vibration_analyzer.h"
+#include "telemetry_encoders.h"
 
 namespace blas = boost::numeric::ublas;
 
@@ -148,7 +151,15 @@ public:
 
     static blas::matrix<double> euler_to_rotation(const blas::vector<double>& euler);
 
-	virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /**
+     * Copy the position, velocity, origin and attitude in to the snapshot,
+     * all taken under one acquisition of their locks so they describe the
+     * same instant.  Does not allocate.
+     */
+    void capture_telemetry(telemetry::snapshot& s) const;
+
+	virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+	virtual size_t mavlinkMsgCapacity() override;
 
     virtual void writeToSystemState() override;
 
@@ -160,6 +171,14 @@ public:
     /// should we use an external gps?
     bool externGPS;
 
+    /**
+     * @returns false if the state selection is enforced and has not selected
+     * the GX3 nav or AHRS attitude, which the controllers read
+     */
+    bool attitude_source_selected() const;
+    /// @returns false if the state selection is enforced and has not selected the GX3 position
+    bool position_source_selected() const;
+
     /// threadsafe set position
     inline void setPosition(const GPSPosition& position)
     {
@@ -314,10 +333,33 @@ private:
 
     std::atomic_int _positionSendRateHz;
     std::atomic_int _attitudeSendRateHz;
+    std::atomic_int _vibrationSendRateHz;
+
+    static const std::string LOG_VIBRATION;
+    /// spectra of the raw ahrs accelerometer and gyro data, null if turned off
+    std::unique_ptr<vibration_analyzer> vibration;
+    /// runs vibration at idle priority, away from the parser and control threads
+    std::thread vibration_thread;
+    /// start the vibration analyzer if it is configured
+    void init_vibration();
+    void log_vibration(const vibration_analyzer::summary& result);
 
     /// connection to allow use_nav_attitude to be set from qgc
     boost::signals2::scoped_connection attitude_source_connection;
 
+    /// the GX3's slots in the SystemState attitude and position sources
+    int nav_attitude_source;
+    int ahrs_attitude_source;
+    int position_source;
+    /// connection to switch use_nav_attitude with the attitude selection
+    boost::signals2::scoped_connection attitude_selection_connection;
+    /// register the sources and follow the attitude selection
+    void init_sources();
+    /// publish an attitude measurement in to source's slot
+    void publish_attitude(int source, const blas::vector<double>& euler);
+    /// publish a position measurement in to the GX3's position slot
+    void publish_position(GPSPosition position);
+
     /// threadsafe get nav_euler
     inline blas::vector<double> get_nav_euler() const // 2014-06-23 -- now only used internally
     {
@@ -21,7 +21,8 @@
 
 #include <algorithm>
 
-IMU_Filter::IMU_Filter()
+template <typename Scalar>
+basic_imu_filter<Scalar>::basic_imu_filter()
     : inputs(64, 0)
 {
     inputs.assign(inputs.size(), 0);
@@ -50,22 +51,28 @@ IMU_Filter::IMU_Filter()
     std::copy(filter_coeffs, filter_coeffs + 64, numerator_coeffs.begin());
 }
 
-double IMU_Filter::operator()(double current_input)
+template <typename Scalar>
+Scalar basic_imu_filter<Scalar>::operator()(Scalar current_input)
 {
     inputs.push_back(current_input);
 
-    double output = 0;
+    Scalar output = 0;
     for (int i = 0; i< 64; ++i)
         output += numerator_coeffs[i] * inputs[63-i];
     return output;
 }
 
-void IMU_Filter::reset()
+template <typename Scalar>
+void basic_imu_filter<Scalar>::reset()
 {
     inputs.assign(inputs.size(), 0);
 }
 
-IMU_Filter::~IMU_Filter()
+template <typename Scalar>
+basic_imu_filter<Scalar>::~basic_imu_filter()
 {
 
 }
+
+template class basic_imu_filter<float>;
+template class basic_imu_filter<double>;
@@ -20,21 +20,34 @@
 #ifndef IMU_FILTER_H_
 #define IMU_FILTER_H_
 
+/* STL Headers */
+#include <array>
+
 /* Boost Headers*/
 #include <boost/circular_buffer.hpp>
 
-class IMU_Filter
+/* Project Headers */
+#include "scalar_types.h"
+
+/**
+ * 64 tap low-pass FIR smoothing one gx3 measurement, computed in Scalar.
+ * Instantiated for float and double, see scalar_types.h.
+ */
+template <typename Scalar>
+class basic_imu_filter
 {
 public:
-    IMU_Filter();
-    virtual ~IMU_Filter();
+    basic_imu_filter();
+    virtual ~basic_imu_filter();
 
-    double operator()(double current_input);
+    Scalar operator()(Scalar current_input);
 
     void reset();
 private:
-    std::array<double, 64> numerator_coeffs;
-    boost::circular_buffer<double> inputs;
+    std::array<Scalar, 64> numerator_coeffs;
+    boost::circular_buffer<Scalar> inputs;
 };
 
+typedef basic_imu_filter<filter_scalar> IMU_Filter;
+
 #endif
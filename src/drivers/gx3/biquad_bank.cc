@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "biquad_bank.h"
+
+/* STL Headers */
+#include <cmath>
+#include <complex>
+
+const size_t biquad_bank::AXES;
+
+namespace
+{
+/// group delay in samples of c[0] + c[1] z^-1 + c[2] z^-2 at w radians per sample
+double polynomial_delay(double c0, double c1, double c2, double w)
+{
+    const std::complex<double> z1 = std::polar(1.0, -w);
+    const std::complex<double> z2 = std::polar(1.0, -2 * w);
+    const std::complex<double> value = c0 + c1 * z1 + c2 * z2;
+    if (std::abs(value) < 1e-12)
+        return 0;
+    return std::real((c1 * z1 + 2.0 * c2 * z2) / value);
+}
+}
+
+biquad_bank::biquad_bank(double sample_rate_hz)
+    : sample_rate_hz(sample_rate_hz),
+      head_speed_hz(0)
+{
+}
+
+void biquad_bank::add_low_pass(double cutoff_hz, double q)
+{
+    add(LOW_PASS, cutoff_hz, q, false);
+}
+
+void biquad_bank::add_notch(double center_hz, double q)
+{
+    add(NOTCH, center_hz, q, false);
+}
+
+void biquad_bank::add_tracking_notch(double harmonic, double q)
+{
+    add(NOTCH, harmonic, q, true);
+}
+
+void biquad_bank::add(section_type type, double frequency, double q, bool tracking)
+{
+    section s;
+    s.type = type;
+    s.frequency = frequency;
+    s.q = q;
+    s.tracking = tracking;
+    compute(s);
+    sections.push_back(s);
+
+    for (std::vector<std::array<double, 2> >& axis : state)
+        axis.push_back(std::array<double, 2> {{0, 0}});
+}
+
+bool biquad_bank::set_head_speed(double hz)
+{
+    // a bad reading would leave NaN coefficients that poison the state for good
+    if (!std::isfinite(hz) || hz < 0 || hz == head_speed_hz)
+        return false;
+
+    head_speed_hz = hz;
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        if (!sections[i].tracking)
+            continue;
+
+        // the history of the old coefficients is a transient with the new ones
+        compute(sections[i]);
+        for (std::vector<std::array<double, 2> >& axis : state)
+            axis[i].fill(0);
+    }
+    return true;
+}
+
+void biquad_bank::compute(section& s) const
+{
+    // pass through until the section has somewhere sensible to sit
+    s.b0 = 1;
+    s.b1 = s.b2 = s.a1 = s.a2 = 0;
+
+    double f = s.tracking ? s.frequency * head_speed_hz : s.frequency;
+    if (f <= 0 || s.q <= 0 || sample_rate_hz <= 0)
+        return;
+
+    // fold on to the frequency it aliases to
+    f = std::fmod(f, sample_rate_hz);
+    if (f > sample_rate_hz / 2)
+        f = sample_rate_hz - f;
+
+    const double w = 2 * M_PI * f / sample_rate_hz;
+    if (w <= 0 || w >= M_PI)
+        return;
+
+    const double cosw = std::cos(w);
+    const double alpha = std::sin(w) / (2 * s.q);
+    const double a0 = 1 + alpha;
+
+    switch (s.type)
+    {
+    case LOW_PASS:
+        s.b0 = (1 - cosw) / 2 / a0;
+        s.b1 = (1 - cosw) / a0;
+        s.b2 = s.b0;
+        break;
+    case NOTCH:
+        s.b0 = 1 / a0;
+        s.b1 = -2 * cosw / a0;
+        s.b2 = s.b0;
+        break;
+    }
+    s.a1 = -2 * cosw / a0;
+    s.a2 = (1 - alpha) / a0;
+}
+
+double biquad_bank::operator()(size_t axis, double input)
+{
+    std::vector<std::array<double, 2> >& z = state[axis];
+    double x = input;
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        const section& s = sections[i];
+        const double y = s.b0 * x + z[i][0];
+        z[i][0] = s.b1 * x - s.a1 * y + z[i][1];
+        z[i][1] = s.b2 * x - s.a2 * y;
+        x = y;
+    }
+    return x;
+}
+
+void biquad_bank::reset()
+{
+    for (std::vector<std::array<double, 2> >& axis : state)
+    {
+        for (std::array<double, 2>& z : axis)
+            z.fill(0);
+    }
+}
+
+double biquad_bank::group_delay(double frequency_hz) const
+{
+    if (sample_rate_hz <= 0)
+        return 0;
+
+    const double w = 2 * M_PI * frequency_hz / sample_rate_hz;
+    double samples = 0;
+    for (const section& s : sections)
+        samples += polynomial_delay(s.b0, s.b1, s.b2, w) - polynomial_delay(1, s.a1, s.a2, w);
+    return samples / sample_rate_hz;
+}
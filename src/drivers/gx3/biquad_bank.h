@@ -0,0 +1,108 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef BIQUAD_BANK_H_
+#define BIQUAD_BANK_H_
+
+/* STL Headers */
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A cascade of second order low-pass and notch sections for three axes
+ *
+ * Most of the gyro noise on the helicopter sits in narrow bands at the main
+ * and tail rotor harmonics, so a few notches and a gentle low-pass reject it
+ * with a small fraction of the phase lag of the 64 tap IMU_Filter.
+ *
+ * Sections are evaluated in transposed direct form II.  A notch is either
+ * fixed or tracks a harmonic of the head speed given to set_head_speed();
+ * centers above the Nyquist frequency are folded back to where they alias.
+ * Coefficients are only recomputed when the head speed changes, and a
+ * tracking notch passes everything while the head speed is unknown.
+ *
+ * Sections are added at configuration time, filtering does not allocate.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class biquad_bank
+{
+public:
+    static const size_t AXES = 3;
+
+    explicit biquad_bank(double sample_rate_hz = 100);
+
+    /// add a Butterworth-like low-pass section, q of 0.707 is maximally flat
+    void add_low_pass(double cutoff_hz, double q = 0.7071);
+    /// add a notch at a fixed frequency
+    void add_notch(double center_hz, double q);
+    /// add a notch at harmonic times the head speed
+    void add_tracking_notch(double harmonic, double q);
+
+    /**
+     * Move the tracking notches and clear their history, does nothing if the
+     * speed has not changed or is negative or not finite.
+     * @param hz head speed in revolutions per second, 0 if unknown
+     * @returns true if the coefficients were recomputed
+     */
+    bool set_head_speed(double hz);
+
+    /// filter one sample of the given axis
+    double operator()(size_t axis, double input);
+
+    /// clear the filter history of every axis
+    void reset();
+
+    /// @returns the delay of the whole bank at frequency_hz in seconds
+    double group_delay(double frequency_hz) const;
+
+    double sample_rate() const
+    {
+        return sample_rate_hz;
+    }
+
+    size_t size() const
+    {
+        return sections.size();
+    }
+
+    bool empty() const
+    {
+        return sections.empty();
+    }
+
+private:
+    enum section_type
+    {
+        LOW_PASS,
+        NOTCH
+    };
+
+    struct section
+    {
+        section_type type;
+        /// center or cutoff frequency, for tracking notches the harmonic
+        double frequency;
+        double q;
+        bool tracking;
+
+        /// coefficients normalized so a0 is 1
+        double b0, b1, b2, a1, a2;
+    };
+
+    void add(section_type type, double frequency, double q, bool tracking);
+    void compute(section& s) const;
+
+    double sample_rate_hz;
+    double head_speed_hz;
+    std::vector<section> sections;
+    /// the two delay elements of every section for each axis
+    std::array<std::vector<std::array<double, 2> >, AXES> state;
+};
+
+#endif
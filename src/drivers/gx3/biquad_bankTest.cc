@@ -0,0 +1,184 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "biquad_bank.h"
+#include "IMU_Filter.h"
+#include "gx3_recording.h"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+/// steady state amplitude of a unit sine at hz through axis 0 of bank
+double gain(biquad_bank& bank, double hz)
+{
+    bank.reset();
+    const double fs = bank.sample_rate();
+    double peak = 0;
+    for (int n = 0; n < 4000; ++n)
+    {
+        const double y = bank(0, std::sin(2 * M_PI * hz * n / fs));
+        if (n > 3000)
+            peak = std::max(peak, std::fabs(y));
+    }
+    return peak;
+}
+
+/// root mean square of x after the first skip samples
+double rms(const std::vector<double>& x, size_t skip)
+{
+    double sum = 0;
+    for (size_t n = skip; n < x.size(); ++n)
+        sum += x[n] * x[n];
+    return std::sqrt(sum / (x.size() - skip));
+}
+
+/// the delay in samples at which y best matches x
+int best_lag(const std::vector<double>& x, const std::vector<double>& y, int max_lag, size_t skip)
+{
+    int lag = 0;
+    double best = -1e300;
+    for (int k = 0; k <= max_lag; ++k)
+    {
+        double sum = 0;
+        for (size_t n = skip; n < y.size(); ++n)
+            sum += y[n] * x[n - k];
+        if (sum > best)
+        {
+            best = sum;
+            lag = k;
+        }
+    }
+    return lag;
+}
+}
+
+// TESTS
+TEST(biquad_bank, NOTCH_TRACKS_HEAD_SPEED)
+{
+    biquad_bank bank(100);
+    bank.add_tracking_notch(1, 5);
+
+    // no head speed, no notch
+    EXPECT_NEAR(1, gain(bank, 25), 0.01);
+
+    EXPECT_TRUE(bank.set_head_speed(25));
+    EXPECT_FALSE(bank.set_head_speed(25));
+    EXPECT_LT(gain(bank, 25), 0.01);
+    EXPECT_NEAR(1, gain(bank, 2), 0.01);
+
+    // the fourth harmonic of 30 Hz aliases to 20 Hz at 100 Hz sampling
+    biquad_bank aliased(100);
+    aliased.add_tracking_notch(4, 5);
+    aliased.set_head_speed(30);
+    EXPECT_LT(gain(aliased, 20), 0.01);
+}
+
+TEST(biquad_bank, LESS_DELAY_THAN_FIR)
+{
+    biquad_bank bank(100);
+    bank.add_low_pass(20);
+    bank.add_tracking_notch(1, 3);
+    bank.set_head_speed(25);
+
+    // the 64 tap FIR is linear phase, 31.5 samples late at every frequency
+    const double fir_delay = 31.5 / 100;
+    EXPECT_GT(bank.group_delay(2), 0);
+    EXPECT_LT(bank.group_delay(2), fir_delay / 10);
+
+    // a step settles on the same value through both axes independently
+    double y = 0, z = 0;
+    for (int n = 0; n < 200; ++n)
+    {
+        y = bank(1, 1);
+        z = bank(2, -1);
+    }
+    EXPECT_NEAR(1, y, 1e-6);
+    EXPECT_NEAR(-1, z, 1e-6);
+}
+
+TEST(biquad_bank, BAD_HEAD_SPEED_IS_IGNORED)
+{
+    biquad_bank bank(100);
+    bank.add_tracking_notch(1, 5);
+    bank.set_head_speed(25);
+
+    // a zero time measurement on the servo switch is an infinite speed
+    EXPECT_FALSE(bank.set_head_speed(1 / 0.0));
+    EXPECT_FALSE(bank.set_head_speed(std::nan("")));
+    EXPECT_FALSE(bank.set_head_speed(-5));
+    EXPECT_LT(gain(bank, 25), 0.01);
+
+    // and the notch still moves once the speed is good again
+    EXPECT_TRUE(bank.set_head_speed(20));
+    double y = 0;
+    for (int n = 0; n < 100; ++n)
+        y = bank(0, 1);
+    EXPECT_TRUE(std::isfinite(y));
+    EXPECT_NEAR(1, y, 1e-3);
+}
+
+TEST(biquad_bank, REPLAY_AGAINST_FIR)
+{
+    const std::vector<gx3_recording::ahrs_sample> samples = gx3_recording::read_ahrs();
+    ASSERT_GT(samples.size(), 1000u);
+
+    // the recording is on the bench, so a main rotor at 25 Hz is added to the roll rate
+    const double head_speed = 25;
+    const double fs = gx3_recording::SAMPLE_RATE_HZ;
+    std::vector<double> rate, rotor;
+    double mean = 0;
+    for (const gx3_recording::ahrs_sample& s : samples)
+        mean += s.rate[0] / samples.size();
+    for (size_t n = 0; n < samples.size(); ++n)
+    {
+        rotor.push_back(0.2 * std::sin(2 * M_PI * head_speed * n / fs + 0.3));
+        rate.push_back(samples[n].rate[0] - mean);
+    }
+
+    // the default gx3.rate_filter_* configuration
+    biquad_bank bank(fs);
+    bank.add_low_pass(20);
+    bank.add_tracking_notch(1, 3);
+    bank.set_head_speed(head_speed);
+    IMU_Filter fir;
+
+    std::vector<double> bank_rate, fir_rate, bank_rotor, fir_rotor;
+    for (size_t n = 0; n < samples.size(); ++n)
+    {
+        bank_rate.push_back(bank(0, rate[n] + rotor[n]));
+        fir_rate.push_back(fir(rate[n] + rotor[n]));
+    }
+    // the filters are linear, so the rotor left in the output is the rotor filtered alone
+    bank.reset();
+    fir.reset();
+    for (size_t n = 0; n < samples.size(); ++n)
+    {
+        bank_rotor.push_back(bank(0, rotor[n]));
+        fir_rotor.push_back(fir(rotor[n]));
+    }
+
+    const size_t settled = 200;
+    const int bank_lag = best_lag(rate, bank_rate, 50, settled);
+    const int fir_lag = best_lag(rate, fir_rate, 50, settled);
+    std::cout << "rotor " << rms(rotor, settled) << " rad/s, left by bank " << rms(bank_rotor, settled)
+              << " fir " << rms(fir_rotor, settled) << "; rates " << rms(rate, settled) << " rad/s, bank "
+              << rms(bank_rate, settled) << " fir " << rms(fir_rate, settled) << "; lag bank " << bank_lag
+              << " fir " << fir_lag << " samples" << std::endl;
+
+    // the notch takes out the rotor at least as well as the FIR
+    EXPECT_LT(rms(bank_rotor, settled), rms(fir_rotor, settled));
+    EXPECT_LT(rms(bank_rotor, settled), rms(rotor, settled) / 100);
+    // the FIR is 31.5 samples late and the bank a small fraction of that
+    EXPECT_NEAR(31.5, fir_lag, 1.5);
+    EXPECT_LE(bank_lag, 3);
+    // the 20 Hz low-pass passes more of the broadband bench noise than the
+    // FIR, but never amplifies it
+    EXPECT_LT(rms(bank_rate, settled), rms(rate, settled) * 1.05);
+}
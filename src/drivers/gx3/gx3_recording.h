@@ -0,0 +1,107 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef GX3_RECORDING_H_
+#define GX3_RECORDING_H_
+
+/* STL Headers */
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Reads the gx3 packets in recorded_data/imu_data.bin for the tests that
+ * replay them, from the repository or the build directory.
+ */
+namespace gx3_recording
+{
+/// an ahrs packet's euler angles and angular rates
+struct ahrs_sample
+{
+    std::array<double, 3> euler;
+    std::array<double, 3> rate;
+};
+
+/// the recording samples at 100 Hz
+const double SAMPLE_RATE_HZ = 100;
+
+inline float big_endian_float(const uint8_t* data)
+{
+    const uint32_t bits = (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// the ahrs packets with both euler angles and rates, empty if the recording is missing
+inline std::vector<ahrs_sample> read_ahrs()
+{
+    std::ifstream in("../recorded_data/imu_data.bin", std::ios::binary);
+    if (! in)
+        in.open("recorded_data/imu_data.bin", std::ios::binary);
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<ahrs_sample> samples;
+    size_t i = 0;
+    while (i + 6 <= bytes.size())
+    {
+        if (bytes[i] != 0x75 || bytes[i + 1] != 0x65)
+        {
+            ++i;
+            continue;
+        }
+
+        const size_t length = bytes[i + 3];
+        if (i + 6 + length > bytes.size())
+            break;
+
+        // fletcher checksum over the header and payload
+        uint8_t a = 0, b = 0;
+        for (size_t j = i; j < i + 4 + length; ++j)
+        {
+            a += bytes[j];
+            b += a;
+        }
+        if (a != bytes[i + 4 + length] || b != bytes[i + 5 + length])
+        {
+            ++i;
+            continue;
+        }
+
+        if (bytes[i + 2] == 0x80)
+        {
+            ahrs_sample sample;
+            bool have_euler = false, have_rate = false;
+            for (size_t field = i + 4; field + 1 < i + 4 + length && bytes[field] >= 2; field += bytes[field])
+            {
+                const uint8_t* data = &bytes[field + 2];
+                if (bytes[field + 1] == 0x0C && bytes[field] == 14)
+                {
+                    for (size_t axis = 0; axis < 3; ++axis)
+                        sample.euler[axis] = big_endian_float(data + 4 * axis);
+                    have_euler = true;
+                }
+                else if (bytes[field + 1] == 0x05 && bytes[field] == 14)
+                {
+                    for (size_t axis = 0; axis < 3; ++axis)
+                        sample.rate[axis] = big_endian_float(data + 4 * axis);
+                    have_rate = true;
+                }
+            }
+            if (have_euler && have_rate)
+                samples.push_back(sample);
+        }
+        i += 6 + length;
+    }
+    return samples;
+}
+}
+
+#endif
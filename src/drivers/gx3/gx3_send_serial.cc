@@ -136,7 +136,8 @@ void IMU::send_serial::ping()
 
 void IMU::send_serial::ahrs_message_format()
 {
-    std::vector<uint8_t> ahrs_format = {0x75, 0x65, 0x0C, 0x0A, 0x0A, 0x08, 0x01, 0x02, 0x0C, 0, 0x01, 0x05, 0, 0x01};
+    // euler angles, gyro and accelerometer (for vibration analysis) at full rate
+    std::vector<uint8_t> ahrs_format = {0x75, 0x65, 0x0C, 0x0D, 0x0D, 0x08, 0x01, 0x03, 0x0C, 0, 0x01, 0x05, 0, 0x01, 0x04, 0, 0x01};
     finish_packet_and_alert(ahrs_format, 0x08, "AHRS format");
 }
 
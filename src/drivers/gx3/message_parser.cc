@@ -24,8 +24,11 @@
 #include <bitset>
 #include <thread>
 #include <chrono>
+#include <cmath>
 
 /* Boost Headers */
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 namespace blas = boost::numeric::ublas;
@@ -36,6 +39,9 @@ namespace blas = boost::numeric::ublas;
 /* Project Headers */
 #include "Debug.h"
 #include "LogFile.h"
+#include "SystemState.h"
+#include "SensorStream.h"
+#include "deadline_watchdog.h"
 
 // Constants
 std::string const IMU::message_parser::LOG_LLH_POS = "GX3 Estimated LLH Position";
@@ -47,9 +53,15 @@ std::string const IMU::message_parser::LOG_EULER = "GX3 Nav Euler Angles";
 std::string const IMU::message_parser::Log_AHRS_Euler = "GX3 AHRS Euler Angles";
 std::string const IMU::message_parser::Log_AHRS_Ang_Rate = "GX3 AHRS Angular Rates";
 std::string const IMU::message_parser::Log_AHRS_Ang_Rate_Filtered = "GX3 AHRS Angular Rates Filtered";
+std::string const IMU::message_parser::LOG_RATE_FILTER = "GX3 Rate Filter";
+
+/// the FIR is linear phase, half its 64 taps late at every frequency
+const double FIR_DELAY_SAMPLES = 31.5;
 
 
 IMU::message_parser::message_parser()
+    : use_biquad(false),
+      crossover_hz(2)
 {
 
 }
@@ -88,8 +100,12 @@ void IMU::message_parser::operator()()
     log->logHeader(LOG_EULER, "Roll Pitch Yaw Valid");
     log->logData(LOG_EULER, std::vector<double>());
 
+    configure_rate_filter();
+
     while (true)
     {
+        deadline_watchdog::check_in("GX3 parser", std::chrono::milliseconds(10));
+
         // parse messages in order of priority
         while (!IMU::getInstance()->nav_queue.empty())
         {
@@ -113,59 +129,191 @@ void IMU::message_parser::operator()()
     }
 }
 
-void IMU::message_parser::parse_ahrs_message(const std::vector<uint8_t>& message)
+void IMU::message_parser::configure_rate_filter()
 {
     IMU* imu = IMU::getInstance();
 
-    // divide message into fields
-    std::vector<std::vector<uint8_t> > payload;
+    imu->configDescribe("rate_filter",
+                        "fir/biquad",
+                        "Filter for the angular rates, the 64 tap FIR or the low delay biquad bank.");
+    use_biquad = imu->configGets("rate_filter", "fir") == "biquad";
+
+    imu->configDescribe("rate_filter_sample_rate_hz",
+                        "> 0",
+                        "Rate the angular rates arrive at.",
+                        "hz");
+    const double sample_rate = imu->configGetd("rate_filter_sample_rate_hz", 100);
+
+    imu->configDescribe("rate_filter_low_pass_hz",
+                        ">= 0",
+                        "Cutoff of the biquad low-pass section, 0 for none.",
+                        "hz");
+    const double low_pass = imu->configGetd("rate_filter_low_pass_hz", 20);
+
+    imu->configDescribe("rate_filter_notch_hz",
+                        ">= 0",
+                        "Center of a fixed biquad notch, 0 for none.",
+                        "hz");
+    const double notch = imu->configGetd("rate_filter_notch_hz", 0);
+
+    imu->configDescribe("rate_filter_harmonics",
+                        "comma separated list",
+                        "Multiples of the head speed to place tracking notches on, e.g. 1,2 for the main rotor.");
+    std::vector<std::string> harmonics;
+    const std::string harmonic_list = imu->configGets("rate_filter_harmonics", "1");
+    boost::split(harmonics, harmonic_list, boost::is_any_of(","));
+
+    imu->configDescribe("rate_filter_notch_q",
+                        "> 0",
+                        "Quality factor of the notches, higher is narrower.");
+    const double q = imu->configGetd("rate_filter_notch_q", 3);
+
+    imu->configDescribe("rate_filter_crossover_hz",
+                        "> 0",
+                        "Attitude loop crossover frequency the rate filter delay is reported at.",
+                        "hz");
+    crossover_hz = imu->configGetd("rate_filter_crossover_hz", 2);
+
+    for (biquad_bank* bank : {&nav_bank, &ahrs_bank})
     {
-        std::vector<uint8_t>::const_iterator it = message.begin() + 4;
-        while (it != message.end())
+        *bank = biquad_bank(sample_rate);
+        if (low_pass > 0)
+            bank->add_low_pass(low_pass);
+        if (notch > 0)
+            bank->add_notch(notch, q);
+        for (std::string& harmonic : harmonics)
         {
-            payload.push_back(std::vector<uint8_t>(it, it + *it));
-            it += *it;
+            boost::algorithm::trim(harmonic);
+            if (harmonic.empty())
+                continue;
+            try
+            {
+                bank->add_tracking_notch(boost::lexical_cast<double>(harmonic), q);
+            }
+            catch (const boost::bad_lexical_cast&)
+            {
+                imu->warning() << "Message Parser: ignoring rate filter harmonic " << harmonic;
+            }
         }
     }
-    for (std::vector<std::vector<uint8_t> >::const_iterator it = payload.begin();
-            it != payload.end(); ++it)
+
+    const double fir_delay_ms = FIR_DELAY_SAMPLES / sample_rate * 1000;
+
+    LogFile::getInstance()->logHeader(LOG_RATE_FILTER, "Head_Speed_Hz Delay_ms FIR_Delay_ms");
+    if (use_biquad)
     {
-        switch ((*it)[1])
+        imu->message() << "Rate filter: " << nav_bank.size() << " biquad sections, "
+                       << nav_bank.group_delay(crossover_hz) * 1000 << " ms delay at " << crossover_hz
+                       << " Hz rather than " << fir_delay_ms << " ms for the FIR.";
+    }
+}
+
+void IMU::message_parser::track_head_speed()
+{
+    if (!use_biquad)
+        return;
+
+    // a tenth of a hertz is well inside a notch, don't recompute for jitter
+    const double hz = std::round(SystemState::getInstance()->headSpeed_hz.get() * 10) / 10;
+    if (!nav_bank.set_head_speed(hz))
+        return;
+    ahrs_bank.set_head_speed(hz);
+
+    std::vector<double> log;
+    log.push_back(hz);
+    log.push_back(nav_bank.group_delay(crossover_hz) * 1000);
+    log.push_back(FIR_DELAY_SAMPLES / nav_bank.sample_rate() * 1000);
+    LogFile::getInstance()->logData(LOG_RATE_FILTER, log);
+}
+
+IMU::message_parser::ahrs_fields IMU::message_parser::read_ahrs_fields(const std::vector<uint8_t>& message)
+{
+    ahrs_fields fields;
+    fields.euler.fill(0);
+    fields.gyro.fill(0);
+    fields.accel.fill(0);
+    fields.have_euler = fields.have_gyro = fields.have_accel = false;
+
+    std::vector<uint8_t>::const_iterator it = message.begin() + 4;
+    while (it + 1 < message.end() && *it >= 2)
+    {
+        std::array<float, 3>* field = NULL;
+        bool* have = NULL;
+        switch (it[1])
         {
+        case 0x04: // scaled accelerometer
+            field = &fields.accel;
+            have = &fields.have_accel;
+            break;
         case 0x05: // scaled gyro
+            field = &fields.gyro;
+            have = &fields.have_gyro;
+            break;
+        case 0x0C: //euler angles
+            field = &fields.euler;
+            have = &fields.have_euler;
+            break;
+        }
+
+        // each is a length, a descriptor and three floats
+        if (field && *it >= 14 && message.end() - it >= 14)
         {
-            blas::vector<double> ang_rate(3);
-            ang_rate.clear();
-            std::vector<uint8_t>::const_iterator first_data = (*it).begin() + 2;
-            ang_rate[0] = raw_to_float(first_data);
-            ang_rate[1] = raw_to_float(first_data + 4);
-            ang_rate[2] = raw_to_float(first_data + 8);
-            LogFile::getInstance()->logData(Log_AHRS_Ang_Rate, ang_rate);
+            std::vector<uint8_t>::const_iterator first_data = it + 2;
             for (int i=0; i<3; ++i)
-                ang_rate[i] = ahrs_filters[i](ang_rate[i]);
-            LogFile::getInstance()->logData(Log_AHRS_Ang_Rate_Filtered, ang_rate);
-            imu->set_ahrs_angular_rate(ang_rate);
-//			debug() << "ahrs ang rage" << ang_rate;
-            break;
+                (*field)[i] = raw_to_float(first_data + 4*i);
+            *have = true;
         }
-        case 0x0C: //euler angles
+        else
         {
-            blas::vector<double> euler(3);
-            euler.clear();
-            std::vector<uint8_t>::const_iterator first_data = (*it).begin() + 2;
-            euler[0] = raw_to_float(first_data);
-            euler[1] = raw_to_float(first_data + 4);
-            euler[2] = raw_to_float(first_data + 8);
-            LogFile::getInstance()->logData(Log_AHRS_Euler, euler);
-            imu->set_ahrs_euler(euler);
-			imu->debug() << "AHRS Euler roll: " << euler[0] << " pitch: " << euler[1] << " yaw: " << euler[2];
-            break;
+            fields.unhandled.push_back(it[1]);
         }
-        default:
-            imu->warning() << "Message Parser: Received unhandled AHRS message with descriptor: " << std::hex << it->at(1);
+
+        if (message.end() - it <= *it)
             break;
-        }
+        it += *it;
+    }
+    return fields;
+}
+
+void IMU::message_parser::parse_ahrs_message(const std::vector<uint8_t>& message)
+{
+    IMU* imu = IMU::getInstance();
+    const ahrs_fields fields = read_ahrs_fields(message);
+
+    if (fields.have_euler)
+    {
+        blas::vector<double> euler(3);
+        for (int i=0; i<3; ++i)
+            euler[i] = fields.euler[i];
+        LogFile::getInstance()->logData(Log_AHRS_Euler, euler);
+        imu->set_ahrs_euler(euler);
+        imu->publish_attitude(imu->ahrs_attitude_source, euler);
+        imu->debug() << "AHRS Euler roll: " << euler[0] << " pitch: " << euler[1] << " yaw: " << euler[2];
     }
+
+    // the accelerometer is used for vibration analysis and the sensor stream
+    if (fields.have_accel && imu->vibration)
+        imu->vibration->push(vibration_analyzer::ACCEL_X, fields.accel[0], fields.accel[1], fields.accel[2]);
+
+    if (fields.have_gyro)
+    {
+        blas::vector<double> ang_rate(3);
+        for (int i=0; i<3; ++i)
+            ang_rate[i] = fields.gyro[i];
+        LogFile::getInstance()->logData(Log_AHRS_Ang_Rate, ang_rate);
+        // the accelerometer field follows the gyro, so both are streamed once the whole message is read
+        SensorStream::getInstance()->add_imu(fields.gyro, fields.accel);
+        if (imu->vibration)
+            imu->vibration->push(vibration_analyzer::GYRO_X, ang_rate[0], ang_rate[1], ang_rate[2]);
+        track_head_speed();
+        for (int i=0; i<3; ++i)
+            ang_rate[i] = use_biquad ? ahrs_bank(i, ang_rate[i]) : ahrs_filters[i](ang_rate[i]);
+        LogFile::getInstance()->logData(Log_AHRS_Ang_Rate_Filtered, ang_rate);
+        imu->set_ahrs_angular_rate(ang_rate);
+    }
+
+    for (uint8_t descriptor : fields.unhandled)
+        imu->warning() << "Message Parser: Received unhandled AHRS message with descriptor: " << std::hex << int(descriptor);
 }
 
 void IMU::message_parser::parse_nav_message(const std::vector<uint8_t>& message)
@@ -266,6 +414,7 @@ void IMU::message_parser::parse_nav_message(const std::vector<uint8_t>& message)
             {
                 // update current position measurement
                 IMU::getInstance()->setPosition(pos);
+                IMU::getInstance()->publish_position(pos);
             }
 
             break;
@@ -340,6 +489,7 @@ void IMU::message_parser::parse_nav_message(const std::vector<uint8_t>& message)
             if (valid)
             {
                 IMU::getInstance()->set_nav_euler(euler);
+                IMU::getInstance()->publish_attitude(IMU::getInstance()->nav_attitude_source, euler);
             }
             break;
         }
@@ -358,9 +508,10 @@ void IMU::message_parser::parse_nav_message(const std::vector<uint8_t>& message)
 
             if (valid)
             {
+                track_head_speed();
                 for (int i=0; i<3; ++i)
                 {
-                    angular_rate[i] = nav_filters[i](angular_rate[i]);
+                    angular_rate[i] = use_biquad ? nav_bank(i, angular_rate[i]) : nav_filters[i](angular_rate[i]);
                 }
                 LogFile::getInstance()->logData(LOG_ANG_RATE_FILTERED, angular_rate);
                 IMU::getInstance()->set_nav_angular_rate(angular_rate);
@@ -22,6 +22,7 @@
 
 #include "IMU.h"
 #include "IMU_Filter.h"
+#include "biquad_bank.h"
 
 /* STL HEADERS */
 #include <bitset>
@@ -38,6 +39,22 @@ public:
     virtual ~message_parser();
     void operator()();
 
+    /// the fields of an ahrs message, which the gx3 sends in the order they were requested
+    struct ahrs_fields
+    {
+        std::array<float, 3> euler;
+        std::array<float, 3> gyro;
+        std::array<float, 3> accel;
+        bool have_euler;
+        bool have_gyro;
+        bool have_accel;
+        /// descriptors of the fields that were not understood
+        std::vector<uint8_t> unhandled;
+    };
+
+    /// decode every field of an ahrs message, whatever order they come in
+    static ahrs_fields read_ahrs_fields(const std::vector<uint8_t>& message);
+
 private:
 
     static std::string const LOG_LLH_POS;
@@ -49,9 +66,15 @@ private:
     static std::string const Log_AHRS_Euler;
     static std::string const Log_AHRS_Ang_Rate;
     static std::string const Log_AHRS_Ang_Rate_Filtered;
+    static std::string const LOG_RATE_FILTER;
 
 
 
+    /// read the gx3.rate_filter configuration and build the biquad banks
+    void configure_rate_filter();
+    /// move the rotor harmonic notches to the current head speed
+    void track_head_speed();
+
     /// parse nav filter data message and take appropriate action
     void parse_nav_message(const std::vector<uint8_t>& message);
     /// parse command message and take appropriate action
@@ -95,6 +118,15 @@ private:
     /// filters for the ahrs gyro measurements
     std::array<IMU_Filter, 3> ahrs_filters;
 
+    /// use the biquad banks rather than the FIR filters
+    bool use_biquad;
+    /// frequency the rate filter delay is reported at, the attitude loop crossover
+    double crossover_hz;
+    /// low delay notch and low-pass filters for the nav gyro measurements
+    biquad_bank nav_bank;
+    /// low delay notch and low-pass filters for the ahrs gyro measurements
+    biquad_bank ahrs_bank;
+
 };
 
 template <typename InputIterator>
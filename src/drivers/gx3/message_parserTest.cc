@@ -0,0 +1,70 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "message_parser.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+/// a field of three big endian floats
+void add_field(std::vector<uint8_t>& message, uint8_t descriptor, float x, float y, float z)
+{
+    message.push_back(14);
+    message.push_back(descriptor);
+    for (float value : {x, y, z})
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            message.push_back(bits >> shift);
+    }
+}
+
+/// an ahrs message in the order IMU::send_serial::ahrs_message_format asks for
+std::vector<uint8_t> ahrs_message()
+{
+    std::vector<uint8_t> message = {0x75, 0x65, 0x80, 0};
+    add_field(message, 0x0C, 0.1f, -0.2f, 3.0f);
+    add_field(message, 0x05, 0.01f, 0.02f, -0.03f);
+    add_field(message, 0x04, 0.05f, -0.1f, -1.0f);
+    message[3] = message.size() - 4;
+    return message;
+}
+}
+
+// TESTS
+TEST(message_parser, AHRS_ACCEL_AFTER_GYRO)
+{
+    const IMU::message_parser::ahrs_fields fields = IMU::message_parser::read_ahrs_fields(ahrs_message());
+
+    ASSERT_TRUE(fields.have_euler);
+    ASSERT_TRUE(fields.have_gyro);
+    ASSERT_TRUE(fields.have_accel);
+    EXPECT_TRUE(fields.unhandled.empty());
+
+    EXPECT_FLOAT_EQ(3.0f, fields.euler[2]);
+    EXPECT_FLOAT_EQ(0.02f, fields.gyro[1]);
+    // the accelerometer comes last and is still read with the gyro
+    EXPECT_FLOAT_EQ(0.05f, fields.accel[0]);
+    EXPECT_FLOAT_EQ(-0.1f, fields.accel[1]);
+    EXPECT_FLOAT_EQ(-1.0f, fields.accel[2]);
+}
+
+TEST(message_parser, AHRS_TRUNCATED_FIELD)
+{
+    std::vector<uint8_t> message = ahrs_message();
+    message.resize(message.size() - 5);
+    message[3] = message.size() - 4;
+
+    const IMU::message_parser::ahrs_fields fields = IMU::message_parser::read_ahrs_fields(message);
+    EXPECT_TRUE(fields.have_euler);
+    EXPECT_TRUE(fields.have_gyro);
+    EXPECT_FALSE(fields.have_accel);
+    ASSERT_EQ(1u, fields.unhandled.size());
+    EXPECT_EQ(0x04, fields.unhandled[0]);
+}
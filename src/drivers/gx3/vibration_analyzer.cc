@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "vibration_analyzer.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+/* System Headers */
+#include <pthread.h>
+#include <sched.h>
+
+const size_t vibration_analyzer::SENSORS;
+const size_t vibration_analyzer::MAX_BANDS;
+
+vibration_analyzer::vibration_analyzer(size_t window, double sample_rate_hz, const std::vector<double>& band_edges_hz)
+    : fft(window),
+      bin_hz(sample_rate_hz / window),
+      hann(window),
+      hann_sum(0),
+      hann_power(0),
+      samples(window),
+      spectrum(fft.bins()),
+      latest(),
+      running(false)
+{
+    for (size_t i = 0; i < window; ++i)
+    {
+        hann[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / window);
+        hann_sum += hann[i];
+        hann_power += hann[i] * hann[i];
+    }
+
+    for (size_t i = 1; i < band_edges_hz.size() && band_bins.size() < MAX_BANDS; ++i)
+    {
+        const size_t low = std::max<size_t>(1, std::lround(band_edges_hz[i - 1] / bin_hz));
+        const size_t high = std::min<size_t>(fft.bins(), std::lround(band_edges_hz[i] / bin_hz));
+        if (high > low)
+            band_bins.push_back(std::make_pair(low, high));
+    }
+    latest.bands = band_bins.size();
+
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+        std::vector<std::atomic<float> > ring(2 * window);
+        for (std::atomic<float>& sample : ring)
+            sample.store(0, std::memory_order_relaxed);
+        rings[c].swap(ring);
+        written[c].store(0, std::memory_order_relaxed);
+    }
+}
+
+void vibration_analyzer::push(channel first, double x, double y, double z)
+{
+    const double values[3] = {x, y, z};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const size_t c = first + i;
+        const size_t count = written[c].load(std::memory_order_relaxed);
+        rings[c][count % rings[c].size()].store(values[i], std::memory_order_relaxed);
+        written[c].store(count + 1, std::memory_order_release);
+    }
+}
+
+bool vibration_analyzer::analyze()
+{
+    const size_t n = fft.size();
+    summary result = get_summary();
+
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+        // the latest window, oldest sample first
+        const std::vector<std::atomic<float> >& ring = rings[c];
+        const size_t end = written[c].load(std::memory_order_acquire);
+        if (end < n)
+            return false;
+        for (size_t i = 0; i < n; ++i)
+            samples[i] = ring[(end - n + i) % ring.size()].load(std::memory_order_relaxed);
+
+        // the parser only reaches the window once it has filled the rest of the ring
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (written[c].load(std::memory_order_relaxed) - end > ring.size() - n)
+            return false;
+
+        // gravity and gyro bias would swamp everything else
+        float mean = 0;
+        for (float s : samples)
+            mean += s;
+        mean /= n;
+        for (size_t i = 0; i < n; ++i)
+            samples[i] = (samples[i] - mean) * hann[i];
+
+        fft.transform(&samples[0], &spectrum[0]);
+
+        size_t peak = 1;
+        for (size_t k = 2; k + 1 < spectrum.size(); ++k)
+        {
+            if (std::norm(spectrum[k]) > std::norm(spectrum[peak]))
+                peak = k;
+        }
+
+        // fit a parabola through the peak and its neighbours for a finer frequency
+        const float left = std::abs(spectrum[peak - 1]);
+        const float middle = std::abs(spectrum[peak]);
+        const float right = std::abs(spectrum[peak + 1]);
+        const float curvature = left - 2 * middle + right;
+        const float offset = (curvature < 0) ? 0.5f * (left - right) / curvature : 0;
+
+        result.peak_hz[c] = (peak + offset) * bin_hz;
+        result.peak_amplitude[c] = 2 * middle / hann_sum;
+
+        const size_t sensor = c / 3;
+        for (size_t b = 0; b < band_bins.size(); ++b)
+        {
+            if (c % 3 == 0)
+                result.band_energy[sensor][b] = 0;
+
+            float energy = 0;
+            for (size_t k = band_bins[b].first; k < band_bins[b].second; ++k)
+                energy += std::norm(spectrum[k]);
+            result.band_energy[sensor][b] += 2 * energy / (n * hann_power);
+        }
+    }
+
+    ++result.count;
+    std::lock_guard<std::mutex> lock(latest_lock);
+    latest = result;
+    return true;
+}
+
+void vibration_analyzer::run(std::chrono::milliseconds period, std::function<void (const summary&)> analyzed)
+{
+#ifdef SCHED_IDLE
+    // only use time nothing else wants
+    struct sched_param param = {0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    running = true;
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while (running)
+    {
+        next += period;
+        std::this_thread::sleep_until(next);
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!analyze())
+            continue;
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        summary result;
+        {
+            std::lock_guard<std::mutex> lock(latest_lock);
+            latest.cpu_percent = 100 * seconds / std::chrono::duration<double>(period).count();
+            result = latest;
+        }
+        if (analyzed)
+            analyzed(result);
+    }
+}
+
+void vibration_analyzer::stop()
+{
+    running = false;
+}
+
+vibration_analyzer::summary vibration_analyzer::get_summary() const
+{
+    std::lock_guard<std::mutex> lock(latest_lock);
+    return latest;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef VIBRATION_ANALYZER_H_
+#define VIBRATION_ANALYZER_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/* Project Headers */
+#include "real_fft.h"
+
+/**
+ * @brief Finds the vibration peaks in the accelerometer and gyro data
+ *
+ * The parser thread push()es every sample in to a ring buffer per channel
+ * without taking a lock, so it is never held up by the analysis.  run()
+ * wakes up once a period at idle priority, copies the latest window of each
+ * channel, removes its mean, applies a Hann window and takes its spectrum.
+ * The rings hold two windows so the parser can keep writing while a window
+ * is copied; a copy it laps is thrown away and tried again next period.
+ * The strongest peak of each channel and the energy of the accelerometer and
+ * gyro axes in each configured band are kept in a summary.
+ *
+ * All buffers are allocated by the constructor.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class vibration_analyzer
+{
+public:
+    enum channel
+    {
+        ACCEL_X,
+        ACCEL_Y,
+        ACCEL_Z,
+        GYRO_X,
+        GYRO_Y,
+        GYRO_Z,
+        CHANNELS
+    };
+
+    /// accelerometer and gyro
+    static const size_t SENSORS = 2;
+    static const size_t MAX_BANDS = 8;
+
+    struct summary
+    {
+        /// frequency of the strongest component of each channel
+        std::array<float, CHANNELS> peak_hz;
+        /// amplitude of that component in the channel's units
+        std::array<float, CHANNELS> peak_amplitude;
+        /// mean square of the three axes of each sensor in each band
+        std::array<std::array<float, MAX_BANDS>, SENSORS> band_energy;
+        size_t bands;
+        /// time spent analyzing as a percentage of the period
+        float cpu_percent;
+        /// number of analyses so far
+        uint32_t count;
+    };
+
+    /**
+     * @param window samples per spectrum, a power of two
+     * @param sample_rate_hz rate samples are pushed at
+     * @param band_edges_hz increasing frequencies, n edges make n - 1 bands
+     */
+    vibration_analyzer(size_t window, double sample_rate_hz, const std::vector<double>& band_edges_hz);
+
+    /// add a sample of three axes starting at first, called by the parser thread
+    void push(channel first, double x, double y, double z);
+
+    /**
+     * @returns false if there is not a full window of every channel yet, or
+     * it was overwritten while copied
+     */
+    bool analyze();
+
+    /**
+     * Analyze once a period until stop() is called.
+     * @param analyzed called after each analysis
+     */
+    void run(std::chrono::milliseconds period, std::function<void (const summary&)> analyzed);
+    void stop();
+
+    summary get_summary() const;
+
+    size_t bands() const
+    {
+        return band_bins.size();
+    }
+    double band_low(size_t band) const
+    {
+        return band_bins[band].first * bin_hz;
+    }
+    double band_high(size_t band) const
+    {
+        return band_bins[band].second * bin_hz;
+    }
+
+private:
+    real_fft fft;
+    double bin_hz;
+    /// first bin and one past the last bin of each band
+    std::vector<std::pair<size_t, size_t> > band_bins;
+    std::vector<float> hann;
+    /// sum of the window and of its square for scaling
+    float hann_sum;
+    float hann_power;
+
+    /// written by push() only, read by analyze() only
+    std::array<std::vector<std::atomic<float> >, CHANNELS> rings;
+    /// samples pushed to each channel, published after the sample
+    std::array<std::atomic<size_t>, CHANNELS> written;
+
+    std::vector<float> samples;
+    std::vector<std::complex<float> > spectrum;
+
+    summary latest;
+    mutable std::mutex latest_lock;
+
+    std::atomic_bool running;
+};
+
+#endif
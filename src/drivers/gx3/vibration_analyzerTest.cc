@@ -0,0 +1,81 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "vibration_analyzer.h"
+#include <atomic>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <thread>
+
+// TESTS
+TEST(vibration_analyzer, FINDS_ROTOR_PEAK)
+{
+    const double rate = 100;
+    vibration_analyzer analyzer(256, rate, {1, 10, 30, 50});
+    ASSERT_EQ(3u, analyzer.bands());
+
+    // not a full window yet
+    analyzer.push(vibration_analyzer::ACCEL_X, 0, 0, 0);
+    EXPECT_FALSE(analyzer.analyze());
+
+    for (int i = 0; i < 512; ++i)
+    {
+        const double t = i / rate;
+        // a 1 m/s^2 23.3 Hz rotor vibration on x on top of gravity on z
+        analyzer.push(vibration_analyzer::ACCEL_X, std::sin(2 * M_PI * 23.3 * t), 0, -9.8);
+        analyzer.push(vibration_analyzer::GYRO_X, 0, 0.2 * std::sin(2 * M_PI * 4 * t), 0.01);
+    }
+    ASSERT_TRUE(analyzer.analyze());
+
+    const vibration_analyzer::summary s = analyzer.get_summary();
+    EXPECT_EQ(1u, s.count);
+    EXPECT_NEAR(23.3, s.peak_hz[vibration_analyzer::ACCEL_X], 0.2);
+    EXPECT_NEAR(1.0, s.peak_amplitude[vibration_analyzer::ACCEL_X], 0.2);
+    EXPECT_LT(s.peak_amplitude[vibration_analyzer::ACCEL_Z], 0.01);
+    EXPECT_NEAR(4, s.peak_hz[vibration_analyzer::GYRO_Y], 0.2);
+
+    // a unit sine has a mean square of one half, all of it in the middle band
+    EXPECT_NEAR(0.5, s.band_energy[0][1], 0.05);
+    EXPECT_LT(s.band_energy[0][0], 0.01);
+    EXPECT_NEAR(0.02, s.band_energy[1][0], 0.005);
+}
+
+TEST(vibration_analyzer, PARSER_PUSHES_DURING_ANALYSIS)
+{
+    const double rate = 100;
+    vibration_analyzer analyzer(256, rate, {1, 10, 30, 50});
+
+    // the parser keeps pushing a 12 Hz vibration while the analysis runs
+    std::atomic_bool done(false);
+    std::thread parser([&]()
+    {
+        for (int i = 0; !done; ++i)
+        {
+            const double t = i / rate;
+            analyzer.push(vibration_analyzer::ACCEL_X, std::sin(2 * M_PI * 12 * t), 0, -9.8);
+            analyzer.push(vibration_analyzer::GYRO_X, 0.1 * std::sin(2 * M_PI * 12 * t), 0, 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+
+    int analyses = 0;
+    for (int tries = 0; tries < 20000 && analyses < 50; ++tries)
+    {
+        // until the window fills, or when the parser laps the copy
+        if (!analyzer.analyze())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        ++analyses;
+        const vibration_analyzer::summary s = analyzer.get_summary();
+        ASSERT_NEAR(12, s.peak_hz[vibration_analyzer::ACCEL_X], 0.2);
+        ASSERT_NEAR(12, s.peak_hz[vibration_analyzer::GYRO_X], 0.2);
+    }
+    done = true;
+    parser.join();
+    EXPECT_EQ(50, analyses);
+}
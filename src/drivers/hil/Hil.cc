@@ -7,14 +7,24 @@
 
 #include "Hil.h"
 #include "mavlink_types.h"
+#include <algorithm>
 #include <sys/time.h>
 #include <time.h>
 #include "mavlink.h"
 #include "SystemState.h"
 
 Hil::Hil()
-:Plugin("Hardware in the Loop","hil", 2)
+:Plugin("Hardware in the Loop","hil", 2),
+ _attitudeSource(-1),
+ _positionSource(-1)
 {
+    if(! isEnabled()) return;
+
+    configDescribe("state_rate_hz", "> 0", "Rate the simulator sends its state at, for the state selection.", "hz");
+    const double rate = configGetd("state_rate_hz", 50);
+    auto ss = SystemState::getInstance();
+    _attitudeSource = ss->attitude_sources.add_source("hil", rate);
+    _positionSource = ss->position_sources.add_source("hil", rate);
 }
 
 Hil::~Hil()
@@ -36,7 +46,7 @@ void Hil::teardown()
 {
 }
 
-void Hil::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void Hil::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
@@ -44,13 +54,15 @@ void Hil::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int se
     if(shouldSendMavlinkMessage(msgNumber, sendRateHz, 20)) // limit to 10 hz then burst all messages
     {
         std::lock_guard<std::mutex> lock(_messageQueueLock);
-        for(mavlink_message_t& msg : _messageQueue)
+        // at most the slots this driver reserved, the rest go with the next burst
+        const size_t count = std::min(_messageQueue.size(), std::min(mavlinkMsgCapacity(), msgs.remaining()));
+        for(size_t i = 0; i < count; i++)
         {
-            debug() << "sending message with id: " << msg.msgid;
-            msgs.push_back(msg);
+            debug() << "sending message with id: " << _messageQueue[i].msgid;
+            msgs.push_back(_messageQueue[i]);
         }
 
-        _messageQueue.empty();
+        _messageQueue.erase(_messageQueue.begin(), _messageQueue.begin() + count);
     }
 
     // HIL_CONTROLS
@@ -111,16 +123,16 @@ bool Hil::recvMavlinkMsg(const mavlink_message_t& msg)
                 double lon = ((double)pkt.lon) / 1E7f; // long (wgs87)
                 double alt = ((double)pkt.alt) / 1000; // alt in m
 
-                GPSPosition gps(lat, lon, alt, 0);
-
                 float* quat = pkt.attitude_quaternion; // in format w,x,y,z
                 EulerAngles ea = EulerAngles::fromQuaternion(quat[0], quat[1], quat[2], quat[3]);
 
 
                 auto ss = SystemState::getInstance();
 
-                ss->rotation.set(ea,0);
-                ss->position.set(gps,0);
+                const state_selector::value_type attitude = {{ea.getRollRad(), ea.getPitchRad(), ea.getYawRad()}};
+                const state_selector::value_type position = {{lat, lon, alt}};
+                ss->attitude_sources.publish(_attitudeSource, attitude, 0);
+                ss->position_sources.publish(_positionSource, position, 0);
                 ss->rollSpeed_radPerS.set(pkt.rollspeed,0);
                 ss->pitchSpeed_radPerS.set(pkt.pitchspeed,0);
                 ss->yawSpeed_radPerS.set(pkt.yawspeed,0);
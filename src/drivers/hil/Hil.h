@@ -27,7 +27,9 @@ public:
     /**
     Returns the one allowed instance of this Driver
     **/
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /// the most queued messages sent in one burst
+    virtual size_t mavlinkMsgCapacity() override {return 16;}
     virtual bool recvMavlinkMsg(const mavlink_message_t& msg) override;
 
 
@@ -48,6 +50,9 @@ private:
     virtual ~Hil();
     std::mutex _messageQueueLock;
     std::vector<mavlink_message_t> _messageQueue;
+    /// the simulator's slots in the SystemState attitude and position sources
+    int _attitudeSource;
+    int _positionSource;
 };
 
 #endif /* HIL_H */
@@ -19,23 +19,396 @@
 
 #include "Linux.h"
 #include <sys/sysinfo.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "SystemState.h"
+#include "LogFile.h"
+
+const std::string Linux::LOG_LINUX_HEALTH = "Linux Health";
+const std::string Linux::LOG_LINUX_THREADS = "Linux Threads";
+
+namespace
+{
+
+/// open a file for repeated pread, returns -1 if it does not exist
+int open_source(const std::string& path)
+{
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+/// re-read a proc or sysfs file from the start in to buf as a null terminated string
+bool read_source(int fd, char* buf, size_t size)
+{
+    if (fd < 0)
+        return false;
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = '\0';
+    return true;
+}
+
+/// the "some avg10" percentage from a /proc/pressure file
+bool parse_pressure(const char* buf, float& avg10)
+{
+    const char* some = strstr(buf, "some avg10=");
+    if (some == NULL)
+        return false;
+    avg10 = strtof(some + strlen("some avg10="), NULL);
+    return true;
+}
+
+/// utime + stime from /proc/<pid>/task/<tid>/stat
+bool parse_task_ticks(const char* buf, unsigned long long& ticks)
+{
+    // the command name may contain spaces and parentheses, the fields start after the last ')'
+    const char* field = strrchr(buf, ')');
+    if (field == NULL)
+        return false;
+    ++field;
+
+    // utime and stime are fields 14 and 15, field 3 (state) is the first after the name
+    char* end = NULL;
+    for (int i = 3; i < 14; ++i)
+    {
+        field = strchr(field + 1, ' ');
+        if (field == NULL)
+            return false;
+    }
+    unsigned long long utime = strtoull(field, &end, 10);
+    unsigned long long stime = strtoull(end, NULL, 10);
+    ticks = utime + stime;
+    return true;
+}
+
+/// context switch counts from /proc/<pid>/task/<tid>/status
+bool parse_switches(const char* buf, unsigned long& voluntary, unsigned long& involuntary)
+{
+    const char* v = strstr(buf, "\nvoluntary_ctxt_switches:");
+    const char* nv = strstr(buf, "\nnonvoluntary_ctxt_switches:");
+    if (v == NULL || nv == NULL)
+        return false;
+    voluntary = strtoul(v + strlen("\nvoluntary_ctxt_switches:"), NULL, 10);
+    involuntary = strtoul(nv + strlen("\nnonvoluntary_ctxt_switches:"), NULL, 10);
+    return true;
+}
+
+/// completed writes and milliseconds spent writing from /sys/dev/block/<dev>/stat
+bool parse_disk_stat(const char* buf, unsigned long long& writes, unsigned long long& write_ticks)
+{
+    return sscanf(buf, "%*u %*u %*u %*u %llu %*u %*u %llu", &writes, &write_ticks) == 2;
+}
+
+double seconds_between(const struct timespec& start, const struct timespec& end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+}
 
 Linux::Linux()
 :Plugin("Linux CPU Info","linux_cpu_info", 1),
-cpu_utilization(0)
+cpu_utilization(0),
+send_health(true),
+thread_scan_interval(10),
+samples_since_scan(0),
+psi_cpu_fd(-1),
+psi_io_fd(-1),
+psi_memory_fd(-1),
+disk_stat_fd(-1),
+clock_ticks(sysconf(_SC_CLK_TCK)),
+last_disk_writes(0),
+last_disk_write_ticks(0),
+cpu_mhz(0),
+temperature_c(0),
+psi_cpu(0),
+psi_io(0),
+psi_memory(0),
+busiest_thread_percent(0),
+busiest_thread(0),
+involuntary_switch_rate(0),
+disk_write_latency_ms(0)
 {
+    clock_gettime(CLOCK_MONOTONIC, &last_sample);
     start(); // Start the plugin
     cpu_utilization.notifySet(SystemState::getInstance()->cpu_load);
 }
 
 bool Linux::init()
 {
+    configDescribe("send_health",
+                   "true/false",
+                   "Enables/disables sending cpu frequency, temperature, pressure, thread load and disk latency to the ground station.");
+    send_health = configGetb("send_health", true);
+
+    configDescribe("thread_scan_interval",
+                   "1 - 3600",
+                   "How often the list of threads is refreshed.",
+                   "s");
+    thread_scan_interval = std::max(1, configGeti("thread_scan_interval", 10));
+
+    LogFile* log = LogFile::getInstance();
+    log->logHeader(LOG_LINUX_HEALTH, "CPU_MHz Temperature_C PSI_CPU PSI_IO PSI_Memory Busiest_Thread_Percent Busiest_Thread_TID Involuntary_Switches_Per_s Disk_Write_Latency_ms");
+    log->logHeader(LOG_LINUX_THREADS, "TID CPU_Percent Voluntary_Switches_Per_s Involuntary_Switches_Per_s");
+
+    open_sources();
+    scan_threads();
+
     return true; // we setup correctly.
 }
 
 void Linux::teardown()
 {
+    close_sources();
+}
+
+void Linux::open_sources()
+{
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (long cpu = 0; cpu < cpus; ++cpu)
+    {
+        int fd = open_source("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_cur_freq");
+        if (fd >= 0)
+            cpufreq_fds.push_back(fd);
+    }
+
+    for (int zone = 0; ; ++zone)
+    {
+        int fd = open_source("/sys/class/thermal/thermal_zone" + std::to_string(zone) + "/temp");
+        if (fd < 0)
+            break;
+        thermal_fds.push_back(fd);
+    }
+
+    psi_cpu_fd = open_source("/proc/pressure/cpu");
+    psi_io_fd = open_source("/proc/pressure/io");
+    psi_memory_fd = open_source("/proc/pressure/memory");
+
+    struct stat log_stat;
+    std::string log_folder(LogFile::getInstance()->getLogFolder().toString());
+    if (stat(log_folder.c_str(), &log_stat) == 0)
+    {
+        disk_stat_fd = open_source("/sys/dev/block/" + std::to_string(major(log_stat.st_dev)) + ":" +
+                                   std::to_string(minor(log_stat.st_dev)) + "/stat");
+    }
+
+    char buf[256];
+    if (read_source(disk_stat_fd, buf, sizeof(buf)))
+        parse_disk_stat(buf, last_disk_writes, last_disk_write_ticks);
+
+    debug() << "Health sources: " << cpufreq_fds.size() << " cpufreq, " << thermal_fds.size() << " thermal zones, "
+            << "pressure " << (psi_cpu_fd >= 0 ? "available" : "unavailable") << ", "
+            << "log disk statistics " << (disk_stat_fd >= 0 ? "available" : "unavailable");
+}
+
+void Linux::scan_threads()
+{
+    DIR* tasks = opendir("/proc/self/task");
+    if (tasks == NULL)
+        return;
+
+    for (auto& thread : threads)
+        thread.second.seen = false;
+
+    while (struct dirent* entry = readdir(tasks))
+    {
+        pid_t tid = atoi(entry->d_name);
+        if (tid <= 0)
+            continue;
+
+        auto existing = threads.find(tid);
+        if (existing != threads.end())
+        {
+            existing->second.seen = true;
+            continue;
+        }
+
+        const std::string task("/proc/self/task/" + std::string(entry->d_name));
+        thread_sample thread;
+        thread.stat_fd = open_source(task + "/stat");
+        thread.status_fd = open_source(task + "/status");
+        thread.ticks = 0;
+        thread.voluntary_switches = 0;
+        thread.involuntary_switches = 0;
+        thread.seen = true;
+        if (thread.stat_fd < 0 || thread.status_fd < 0)
+        {
+            if (thread.stat_fd >= 0)
+                close(thread.stat_fd);
+            if (thread.status_fd >= 0)
+                close(thread.status_fd);
+            continue;
+        }
+
+        // take the baseline so the first delta is not the thread's whole lifetime
+        std::vector<double> unused;
+        sample_thread(tid, thread, 0, unused);
+        threads[tid] = thread;
+
+        char name[32];
+        int comm_fd = open_source(task + "/comm");
+        if (read_source(comm_fd, name, sizeof(name)))
+            debug() << "Monitoring thread " << tid << ": " << strtok(name, "\n");
+        if (comm_fd >= 0)
+            close(comm_fd);
+    }
+    closedir(tasks);
+
+    for (auto it = threads.begin(); it != threads.end(); )
+    {
+        if (!it->second.seen)
+        {
+            close(it->second.stat_fd);
+            close(it->second.status_fd);
+            it = threads.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+bool Linux::sample_thread(pid_t tid, thread_sample& thread, double elapsed, std::vector<double>& log_row)
+{
+    char buf[2048];
+    unsigned long long ticks;
+    unsigned long voluntary, involuntary;
+    if (!(read_source(thread.stat_fd, buf, sizeof(buf)) && parse_task_ticks(buf, ticks)))
+        return false;
+    if (!(read_source(thread.status_fd, buf, sizeof(buf)) && parse_switches(buf, voluntary, involuntary)))
+        return false;
+
+    if (elapsed > 0)
+    {
+        log_row[0] = tid;
+        log_row[1] = 100.0 * (ticks - thread.ticks) / clock_ticks / elapsed;
+        log_row[2] = (voluntary - thread.voluntary_switches) / elapsed;
+        log_row[3] = (involuntary - thread.involuntary_switches) / elapsed;
+    }
+
+    thread.ticks = ticks;
+    thread.voluntary_switches = voluntary;
+    thread.involuntary_switches = involuntary;
+    return true;
+}
+
+void Linux::sample_health()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double elapsed = seconds_between(last_sample, now);
+    last_sample = now;
+    if (elapsed <= 0)
+        return;
+
+    char buf[256];
+
+    double khz = 0;
+    int cpus = 0;
+    for (int fd : cpufreq_fds)
+    {
+        if (read_source(fd, buf, sizeof(buf)))
+        {
+            khz += strtod(buf, NULL);
+            ++cpus;
+        }
+    }
+    cpu_mhz = (cpus > 0) ? khz / cpus / 1000 : 0;
+
+    float hottest = 0;
+    for (int fd : thermal_fds)
+    {
+        if (read_source(fd, buf, sizeof(buf)))
+            hottest = std::max(hottest, strtof(buf, NULL) / 1000);
+    }
+    temperature_c = hottest;
+
+    float pressure = 0;
+    if (read_source(psi_cpu_fd, buf, sizeof(buf)) && parse_pressure(buf, pressure))
+        psi_cpu = pressure;
+    if (read_source(psi_io_fd, buf, sizeof(buf)) && parse_pressure(buf, pressure))
+        psi_io = pressure;
+    if (read_source(psi_memory_fd, buf, sizeof(buf)) && parse_pressure(buf, pressure))
+        psi_memory = pressure;
+
+    unsigned long long writes, write_ticks;
+    if (read_source(disk_stat_fd, buf, sizeof(buf)) && parse_disk_stat(buf, writes, write_ticks))
+    {
+        // average over the writes completed since the last sample, unchanged if there were none
+        if (writes > last_disk_writes)
+            disk_write_latency_ms = static_cast<float>(write_ticks - last_disk_write_ticks) / (writes - last_disk_writes);
+        last_disk_writes = writes;
+        last_disk_write_ticks = write_ticks;
+    }
+
+    if (++samples_since_scan >= thread_scan_interval)
+    {
+        samples_since_scan = 0;
+        scan_threads();
+    }
+
+    LogFile* log = LogFile::getInstance();
+    std::vector<double> thread_row(4, 0);
+    double busiest = 0;
+    pid_t busiest_tid = 0;
+    double switches = 0;
+    bool exited = false;
+    for (auto& thread : threads)
+    {
+        if (!sample_thread(thread.first, thread.second, elapsed, thread_row))
+        {
+            exited = true;
+            continue;
+        }
+        log->logData(LOG_LINUX_THREADS, thread_row);
+
+        switches += thread_row[3];
+        if (thread_row[1] >= busiest)
+        {
+            busiest = thread_row[1];
+            busiest_tid = thread.first;
+        }
+    }
+    // rescan on the next sample to close the descriptors of exited threads
+    if (exited)
+        samples_since_scan = thread_scan_interval;
+
+    busiest_thread_percent = busiest;
+    busiest_thread = busiest_tid;
+    involuntary_switch_rate = switches;
+
+    std::vector<float> health {cpu_mhz, temperature_c, psi_cpu, psi_io, psi_memory,
+                               busiest_thread_percent, static_cast<float>(busiest_thread.load()),
+                               involuntary_switch_rate, disk_write_latency_ms};
+    log->logData(LOG_LINUX_HEALTH, health);
+}
+
+void Linux::close_sources()
+{
+    for (int fd : cpufreq_fds)
+        close(fd);
+    cpufreq_fds.clear();
+    for (int fd : thermal_fds)
+        close(fd);
+    thermal_fds.clear();
+    for (int fd : {psi_cpu_fd, psi_io_fd, psi_memory_fd, disk_stat_fd})
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+    psi_cpu_fd = psi_io_fd = psi_memory_fd = disk_stat_fd = -1;
+    for (auto& thread : threads)
+    {
+        close(thread.second.stat_fd);
+        close(thread.second.status_fd);
+    }
+    threads.clear();
 }
 
 
@@ -53,9 +426,11 @@ void Linux::loop()
     int totalraml = (int)totalram.load();
     int freeraml = (int)freeram.load();
     trace() << "Got Load of: " << util << " memtotal: " << totalraml << " mb free: " << freeraml << " mb";
+
+    sample_health();
 }
 
-void Linux::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void Linux::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
@@ -63,9 +438,26 @@ void Linux::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int
     {
         debug() << "Sending CPU Utilization";
 
-        mavlink_message_t msg;
-        mavlink_msg_udenver_cpu_usage_pack(uasId, 40, &msg, cpu_utilization.get(), totalram.load(), freeram.load());
-        msgs.push_back(msg);
+        mavlink_msg_udenver_cpu_usage_pack(uasId, 40, msgs.next(), cpu_utilization.get(), totalram.load(), freeram.load());
+
+        if (send_health)
+        {
+            const uint32_t now = getMsSinceInit();
+            const std::pair<const char*, float> values[] = {
+                {"cpu_mhz", cpu_mhz},
+                {"temp_c", temperature_c},
+                {"psi_cpu", psi_cpu},
+                {"psi_io", psi_io},
+                {"psi_mem", psi_memory},
+                {"thr_load", busiest_thread_percent},
+                {"thr_tid", static_cast<float>(busiest_thread.load())},
+                {"ctxsw_inv", involuntary_switch_rate},
+                {"disk_wr_ms", disk_write_latency_ms}
+            };
+            for (const auto& value : values)
+            {
+                mavlink_msg_named_value_float_pack(uasId, 40, msgs.next(), now, value.first, value.second);
+            }
+        }
     }
 };
-
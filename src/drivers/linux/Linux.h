@@ -21,19 +21,36 @@
 #define LINUX_H
 
 #include <atomic>  // Used for atomic types
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
 #include "Plugin.h"
 #include "Singleton.h"
 #include "SystemStateParam.hpp"
 
 /**
  * Provides an interface to the performance of Linux.
+ *
+ * Besides the load average and memory from sysinfo, once a second the plugin
+ * samples the current cpu frequency, the hottest thermal zone, the pressure
+ * stall information for cpu, io and memory, the cpu time and context switches
+ * of every thread in the process and the average write latency of the block
+ * device holding the log folder.
+ *
+ * Every file is opened once (threads are picked up as they are created) and
+ * re-read with pread so a sample costs a handful of system calls and no
+ * allocation.  Sources which do not exist on the running kernel are skipped.
  **/
 class Linux: public Plugin, public Singleton<Linux>
 {
     friend class Singleton<Linux>;
 
 public:
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /// the cpu usage and the nine health values
+    virtual size_t mavlinkMsgCapacity() override {return 10;}
     virtual bool init();
     virtual void loop();
     virtual void teardown();
@@ -43,10 +60,61 @@ private:
 
     static void cpuInfo(Linux* instance);
 
+    static const std::string LOG_LINUX_HEALTH;
+    static const std::string LOG_LINUX_THREADS;
+
+    /// per thread counters from the previous sample
+    struct thread_sample
+    {
+        int stat_fd;
+        int status_fd;
+        unsigned long long ticks;
+        unsigned long voluntary_switches;
+        unsigned long involuntary_switches;
+        bool seen;
+    };
+
+    /// open the cpufreq, thermal, pressure and disk statistics files
+    void open_sources();
+    /// pick up threads created since the last scan and drop the ones that exited
+    void scan_threads();
+    /// sample the per thread counters, returns false if the thread has exited
+    bool sample_thread(pid_t tid, thread_sample& thread, double elapsed, std::vector<double>& log_row);
+    void sample_health();
+    /// close every descriptor opened by open_sources and scan_threads
+    void close_sources();
+
     SystemStateParam<float> cpu_utilization;
     std::atomic<long> uptime_seconds;
     std::atomic<long> load1, load5, load15, totalram, freeram;
     std::atomic<short> procs;
+
+    /// send the extended health values as NAMED_VALUE_FLOAT messages
+    std::atomic_bool send_health;
+    /// rescan /proc/self/task every this many samples
+    int thread_scan_interval;
+    int samples_since_scan;
+
+    std::vector<int> cpufreq_fds;
+    std::vector<int> thermal_fds;
+    int psi_cpu_fd;
+    int psi_io_fd;
+    int psi_memory_fd;
+    int disk_stat_fd;
+    std::map<pid_t, thread_sample> threads;
+
+    long clock_ticks;
+    struct timespec last_sample;
+    unsigned long long last_disk_writes;
+    unsigned long long last_disk_write_ticks;
+
+    std::atomic<float> cpu_mhz;
+    std::atomic<float> temperature_c;
+    std::atomic<float> psi_cpu, psi_io, psi_memory;
+    std::atomic<float> busiest_thread_percent;
+    std::atomic<int> busiest_thread;
+    std::atomic<float> involuntary_switch_rate;
+    std::atomic<float> disk_write_latency_ms;
 };
 
 #endif /* LINUX_H */
@@ -125,17 +125,14 @@ void MdlAltimeter::mainLoop()
     }
 }
 
-void MdlAltimeter::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void MdlAltimeter::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
     if(has_new_distance) // only send message for new distance
     {
-		mavlink_message_t msg;
-        mavlink_msg_ualberta_altimeter_pack(uasId, heli::ALTIMETER_ID, &msg, distance);
+        mavlink_msg_ualberta_altimeter_pack(uasId, heli::ALTIMETER_ID, msgs.next(), distance);
         has_new_distance = false;
-
-        msgs.push_back(msg);
     }
 };
 
@@ -18,7 +18,8 @@ public:
     static MdlAltimeter* getInstance();
     float distance;
     void mainLoop();
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual size_t mavlinkMsgCapacity() override {return 1;}
     virtual void writeToSystemState() override;
 private:
     static MdlAltimeter* _instance; /// pointer to the instance of Alitimiter
@@ -27,9 +27,13 @@
 #include "SystemState.h"
 #include "heli.h"
 
+// STL Headers
+#include <algorithm>
+
 
 GPS::GPS()
     :Driver("NovAtel GPS","novatel"),
+     position_source(-1),
      read_serial_thread(ReadSerial()),
      llh_position(blas::vector<double>(0,3)),
      ned_velocity(blas::vector<double>(0,3)),
@@ -47,7 +51,7 @@ void GPS::writeToSystemState()
 {
     SystemState *state = SystemState::getInstance();
 
-    // no need to lock for the position because it uses SystemStateObjParams
+    // the selection decides whether this or another source's position is used
     {
         blas::vector<double> llh_position = get_llh_position();
         blas::vector<double> llh_errors = get_pos_sigma();
@@ -59,8 +63,11 @@ void GPS::writeToSystemState()
             max = llh_errors[i] > max? llh_errors[i] : max;
         }
 
-        GPSPosition pos(llh_position[0], llh_position[1], llh_position[2], max);
-        state->position.set(pos, 0); // TODO find a suitable number for this
+        if (max >= 0)
+        {
+            const state_selector::value_type value = {{llh_position[0], llh_position[1], llh_position[2]}};
+            state->position_sources.publish(position_source, value, max);
+        }
     }
     /**
     // TODO add the traits back in that we need.
@@ -79,29 +86,29 @@ void GPS::writeToSystemState()
     **/
 }
 
-void GPS::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void GPS::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(msgNumber % (sendRateHz / 10) == 0)
     {
         auto gps = GPS::getInstance();
         gps->trace() << "Sending novatel gps raw message";
 
-        blas::vector<double> _pos_error(get_pos_sigma());
-        std::vector<float> pos_error(_pos_error.begin(), _pos_error.end());
-        blas::vector<double> _vel_error(get_vel_sigma());
-        std::vector<float> vel_error(_vel_error.begin(), _vel_error.end());
+        const blas::vector<double> _pos_error(get_pos_sigma());
+        const blas::vector<double> _vel_error(get_vel_sigma());
+        // empty until the first BESTXYZ
+        float pos_error[3] = {0}, vel_error[3] = {0};
+        std::copy_n(_pos_error.begin(), std::min<size_t>(_pos_error.size(), 3), pos_error);
+        std::copy_n(_vel_error.begin(), std::min<size_t>(_vel_error.size(), 3), vel_error);
 
-        mavlink_message_t msg;
         mavlink_msg_novatel_gps_raw_pack(uasId,
                                          heli::NOVATEL_ID,
-                                         &msg,
+                                         msgs.next(),
                                          get_position_type(),
                                          get_position_status(),
                                          get_num_sats(),
-                                         &pos_error[0],
+                                         pos_error,
                                          get_velocity_type(),
-                                         &vel_error[0],
+                                         vel_error,
                                          getMsSinceInit());
-        msgs.push_back(msg);
     }
 }
@@ -25,6 +25,7 @@
 #include <string>
 #include <mutex>
 #include <thread>
+#include <atomic>
 
 /* Boost Headers */
 #include <boost/numeric/ublas/vector.hpp>
@@ -59,7 +60,8 @@ class GPS : public Driver, public Singleton<GPS>
 
 public:
 
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual size_t mavlinkMsgCapacity() override {return 1;}
 
     virtual void writeToSystemState() override;
 
@@ -137,6 +139,9 @@ private:
 
     virtual ~GPS();
 
+    /// slot in the SystemState position sources, -1 until the position log is scheduled
+    std::atomic<int> position_source;
+
     /// thread used to communicate with the GPS
     std::thread read_serial_thread;
 
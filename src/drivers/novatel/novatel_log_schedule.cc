@@ -0,0 +1,211 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "novatel_log_schedule.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+const uint32_t novatel_log_schedule::PORT_COM1;
+const uint32_t novatel_log_schedule::PORT_COM2;
+const uint32_t novatel_log_schedule::PORT_COM3;
+const uint32_t novatel_log_schedule::PORT_THISPORT;
+const size_t novatel_log_schedule::FRAMING_BYTES;
+
+namespace
+{
+struct known_log
+{
+    const char* name;
+    uint16_t id;
+    /// payload bytes, for PSRDOP with 12 satellites and RANGECMP with 24 observations
+    size_t payload;
+    bool position;
+    bool feeds_state;
+};
+
+// OEM6 firmware reference manual
+const known_log KNOWN_LOGS[] =
+{
+    {"BESTXYZ", 241, 112, true, true},
+    {"RTKXYZ", 244, 112, true, true},
+    {"BESTPOS", 42, 72, true, false},
+    {"BESTVEL", 99, 44, false, false},
+    {"PSRDOP", 174, 40 + 4 * 12, false, false},
+    {"RANGECMP", 140, 4 + 24 * 24, false, false},
+    {"REFSTATION", 175, 32, false, false},
+};
+
+const known_log* lookup(const std::string& name)
+{
+    for (const known_log& log : KNOWN_LOGS)
+    {
+        if (name == log.name)
+            return &log;
+    }
+    return nullptr;
+}
+}
+
+double novatel_log_schedule::entry::period() const
+{
+    if (when != ONTIME)
+        return 0;
+    return rate_hz >= 1 ? 1 / rate_hz : std::round(1 / rate_hz);
+}
+
+bool novatel_log_schedule::parse_trigger(const std::string& name, trigger& out)
+{
+    if (name == "ONTIME")
+        out = ONTIME;
+    else if (name == "ONCHANGED")
+        out = ONCHANGED;
+    else if (name == "ONNEW")
+        out = ONNEW;
+    else
+        return false;
+    return true;
+}
+
+bool novatel_log_schedule::parse_port(const std::string& name, uint32_t& out)
+{
+    if (name == "THISPORT")
+        out = PORT_THISPORT;
+    else if (name == "COM1")
+        out = PORT_COM1;
+    else if (name == "COM2")
+        out = PORT_COM2;
+    else if (name == "COM3")
+        out = PORT_COM3;
+    else
+        return false;
+    return true;
+}
+
+bool novatel_log_schedule::valid_rate(double hz)
+{
+    if (hz <= 0)
+        return false;
+
+    const double high_rates[] = {20, 10, 5, 4, 2, 1};
+    for (double rate : high_rates)
+    {
+        if (std::fabs(hz - rate) < 1e-6)
+            return true;
+    }
+
+    const double period = 1 / hz;
+    return period > 1 && std::fabs(period - std::round(period)) < 1e-6;
+}
+
+std::vector<std::string> novatel_log_schedule::known_logs()
+{
+    std::vector<std::string> names;
+    for (const known_log& log : KNOWN_LOGS)
+        names.push_back(log.name);
+    return names;
+}
+
+std::string novatel_log_schedule::add(const std::string& name, const std::string& when, double rate_hz, const std::string& port)
+{
+    const known_log* log = lookup(name);
+    if (log == nullptr)
+        return "unknown log " + name;
+
+    entry e;
+    e.name = name;
+    e.id = log->id;
+    e.rate_hz = rate_hz;
+    e.position = log->position;
+    e.feeds_state = log->feeds_state;
+    e.bytes = FRAMING_BYTES + log->payload;
+
+    if (! parse_trigger(when, e.when))
+        return "unknown trigger " + when + " for " + name;
+    if (! parse_port(port, e.port))
+        return "unknown port " + port + " for " + name;
+    if (e.when == ONTIME && ! valid_rate(rate_hz))
+    {
+        std::ostringstream reason;
+        reason << name << " can not be logged ONTIME at " << rate_hz << " Hz";
+        return reason.str();
+    }
+    if (rate_hz <= 0)
+        return "give the expected rate of " + name;
+
+    _entries.erase(std::remove_if(_entries.begin(), _entries.end(), [&](const entry& other)
+    {
+        return other.id == e.id;
+    }), _entries.end());
+    _entries.push_back(e);
+    return "";
+}
+
+std::vector<std::string> novatel_log_schedule::drop_redundant()
+{
+    std::vector<entry>::iterator best = _entries.end();
+    for (std::vector<entry>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        if (! it->position)
+            continue;
+        if (best == _entries.end() || it->feeds_state > best->feeds_state ||
+                (it->feeds_state == best->feeds_state && it->rate_hz > best->rate_hz))
+            best = it;
+    }
+
+    std::vector<std::string> dropped;
+    if (best == _entries.end())
+        return dropped;
+
+    const uint16_t keep = best->id;
+    std::vector<entry> kept;
+    for (const entry& e : _entries)
+    {
+        if (e.position && e.id != keep)
+            dropped.push_back(e.name);
+        else
+            kept.push_back(e);
+    }
+    _entries.swap(kept);
+    return dropped;
+}
+
+double novatel_log_schedule::load(uint32_t port) const
+{
+    double total = 0;
+    for (const entry& e : _entries)
+    {
+        if (e.port == port)
+            total += e.bytes_per_second();
+    }
+    return total;
+}
+
+std::vector<std::string> novatel_log_schedule::fit(uint32_t port, double bytes_per_second)
+{
+    std::vector<std::string> dropped;
+    for (size_t i = _entries.size(); i-- > 0 && load(port) > bytes_per_second; )
+    {
+        if (_entries[i].port != port || _entries[i].position)
+            continue;
+        dropped.push_back(_entries[i].name);
+        _entries.erase(_entries.begin() + i);
+    }
+    return dropped;
+}
+
+const novatel_log_schedule::entry* novatel_log_schedule::find(uint16_t id) const
+{
+    for (const entry& e : _entries)
+    {
+        if (e.id == id)
+            return &e;
+    }
+    return nullptr;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef NOVATEL_LOG_SCHEDULE_H_
+#define NOVATEL_LOG_SCHEDULE_H_
+
+/* STL Headers */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The set of logs requested from the NovAtel and what they cost
+ *
+ * Each entry is a binary log, its trigger, the rate it is expected at and
+ * the receiver port it is sent on.  The schedule knows the size of the logs
+ * the autopilot reads so the bytes per second a port has to carry can be
+ * checked against its baud rate before the LOG commands are sent.
+ *
+ * RTKXYZ, BESTXYZ and BESTPOS all give the position; only one is kept,
+ * preferring the Cartesian logs the navigation state is fed from, then the
+ * higher rate.
+ *
+ * Trigger and port values are those of the OEM6 LOG command.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class novatel_log_schedule
+{
+public:
+    enum trigger
+    {
+        ONNEW = 0,
+        ONCHANGED = 1,
+        ONTIME = 2
+    };
+
+    static const uint32_t PORT_COM1 = 32;
+    static const uint32_t PORT_COM2 = 64;
+    static const uint32_t PORT_COM3 = 96;
+    static const uint32_t PORT_THISPORT = 192;
+
+    /// binary header and CRC around every log
+    static const size_t FRAMING_BYTES = 28 + 4;
+
+    struct entry
+    {
+        std::string name;
+        uint16_t id;
+        trigger when;
+        /// the rate asked for, or expected for ONNEW and ONCHANGED
+        double rate_hz;
+        uint32_t port;
+        /// the log gives the position
+        bool position;
+        /// the log feeds the navigation state
+        bool feeds_state;
+        /// bytes of one log on the wire, typical for the variable length ones
+        size_t bytes;
+
+        /// the period of the LOG command, 0 for the triggers that have none
+        double period() const;
+        double bytes_per_second() const
+        {
+            return rate_hz * bytes;
+        }
+    };
+
+    /// parse ONTIME, ONCHANGED or ONNEW, @returns false if unknown
+    static bool parse_trigger(const std::string& name, trigger& out);
+    /// parse THISPORT, COM1, COM2 or COM3, @returns false if unknown
+    static bool parse_port(const std::string& name, uint32_t& out);
+    /// the receiver logs ONTIME at 20, 10, 5, 4, 2 and 1 Hz or every whole number of seconds
+    static bool valid_rate(double hz);
+
+    /// the names of the logs the schedule knows
+    static std::vector<std::string> known_logs();
+
+    /**
+     * Add a log, replacing an earlier entry for the same log.
+     * @returns an empty string, or why the log was not added
+     */
+    std::string add(const std::string& name, const std::string& when, double rate_hz, const std::string& port);
+
+    /// keep only the best position log, @returns the names of the ones removed
+    std::vector<std::string> drop_redundant();
+
+    /// bytes per second scheduled on port
+    double load(uint32_t port) const;
+
+    /**
+     * Remove the logs that do not give the position, last first, until port
+     * carries no more than bytes_per_second.
+     * @returns the names of the logs removed
+     */
+    std::vector<std::string> fit(uint32_t port, double bytes_per_second);
+
+    const std::vector<entry>& entries() const
+    {
+        return _entries;
+    }
+
+    /// the scheduled log with the given message id, nullptr if there is none
+    const entry* find(uint16_t id) const;
+
+private:
+    std::vector<entry> _entries;
+};
+
+#endif
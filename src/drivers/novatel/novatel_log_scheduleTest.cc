@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "novatel_log_schedule.h"
+#include <gtest/gtest.h>
+
+// TESTS
+TEST(novatel_log_schedule, RATES)
+{
+    EXPECT_TRUE(novatel_log_schedule::valid_rate(20));
+    EXPECT_TRUE(novatel_log_schedule::valid_rate(4));
+    EXPECT_TRUE(novatel_log_schedule::valid_rate(0.5));
+    EXPECT_FALSE(novatel_log_schedule::valid_rate(8));
+    EXPECT_FALSE(novatel_log_schedule::valid_rate(50));
+    EXPECT_FALSE(novatel_log_schedule::valid_rate(0.4));
+
+    novatel_log_schedule schedule;
+    EXPECT_EQ("", schedule.add("BESTXYZ", "ONTIME", 20, "THISPORT"));
+    EXPECT_NE("", schedule.add("BESTXYZ", "ONTIME", 8, "THISPORT"));
+    EXPECT_NE("", schedule.add("BESTFOO", "ONTIME", 1, "THISPORT"));
+    EXPECT_NE("", schedule.add("BESTVEL", "SOMETIMES", 1, "THISPORT"));
+    EXPECT_EQ("", schedule.add("PSRDOP", "ONCHANGED", 0.1, "COM2"));
+
+    ASSERT_EQ(2u, schedule.entries().size());
+    EXPECT_DOUBLE_EQ(0.05, schedule.entries()[0].period());
+    EXPECT_DOUBLE_EQ(0, schedule.entries()[1].period());
+}
+
+TEST(novatel_log_schedule, DROPS_REDUNDANT_POSITION)
+{
+    novatel_log_schedule schedule;
+    schedule.add("BESTPOS", "ONTIME", 20, "THISPORT");
+    schedule.add("RTKXYZ", "ONTIME", 4, "THISPORT");
+    schedule.add("BESTVEL", "ONTIME", 20, "THISPORT");
+    schedule.add("BESTXYZ", "ONTIME", 10, "THISPORT");
+
+    const std::vector<std::string> dropped = schedule.drop_redundant();
+    ASSERT_EQ(2u, dropped.size());
+    EXPECT_EQ("BESTPOS", dropped[0]);
+    EXPECT_EQ("RTKXYZ", dropped[1]);
+
+    ASSERT_EQ(2u, schedule.entries().size());
+    EXPECT_EQ("BESTVEL", schedule.entries()[0].name);
+    EXPECT_EQ("BESTXYZ", schedule.entries()[1].name);
+}
+
+TEST(novatel_log_schedule, FITS_PORT_BANDWIDTH)
+{
+    novatel_log_schedule schedule;
+    schedule.add("BESTXYZ", "ONTIME", 20, "THISPORT");
+    schedule.add("BESTVEL", "ONTIME", 20, "THISPORT");
+    schedule.add("RANGECMP", "ONTIME", 1, "COM2");
+
+    // 144 bytes at 20 Hz and 76 at 20 Hz
+    EXPECT_DOUBLE_EQ(4400, schedule.load(novatel_log_schedule::PORT_THISPORT));
+
+    // 80% of 38400 baud 8N1
+    const std::vector<std::string> dropped = schedule.fit(novatel_log_schedule::PORT_THISPORT, 0.8 * 3840);
+    ASSERT_EQ(1u, dropped.size());
+    EXPECT_EQ("BESTVEL", dropped[0]);
+    EXPECT_DOUBLE_EQ(2880, schedule.load(novatel_log_schedule::PORT_THISPORT));
+
+    // the position log is never removed
+    EXPECT_EQ(0u, schedule.fit(novatel_log_schedule::PORT_THISPORT, 100).size());
+    EXPECT_EQ(2u, schedule.entries().size());
+}
@@ -31,6 +31,7 @@
 #include <thread>
 #include <chrono>
 #include <string>
+#include <algorithm>
 
 /* C Headers */
 #include <termios.h>
@@ -43,7 +44,9 @@
 #include "MainApp.h"
 #include "qnx2linux.h"
 #include "LogFile.h"
+#include "SystemState.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/assign.hpp>
 // this scope only pollutes the global namespace in a minimal way consistent with the stl global operators
 using namespace boost::assign;
@@ -69,6 +72,7 @@ const std::string GPS_LOGFILE_HEADER = "Time_Status Week Milliseconds P-sol_stat
 
 /* read_serial functions */
 GPS::ReadSerial::ReadSerial()
+    : log_sent_ms(0)
 {
     LogFile::getInstance()->logHeader(LOG_NOVATEL_GPS, GPS_LOGFILE_HEADER);
 }
@@ -85,6 +89,7 @@ void GPS::ReadSerial::operator()()
     gps->debug() << "Initialize the NovAtel serial port";
     if(initPort())
     {
+        configureSchedule();
         gps->debug() << "Waiting a moment to startup";
         std::this_thread::sleep_for( std::chrono::milliseconds( 1000 ) );
         //send_log_command();
@@ -135,6 +140,13 @@ bool GPS::ReadSerial::synchronize()
         // Check for overall timeout.
 
         auto ms_since_init = gps->getMsSinceInit();
+        if (! unanswered_logs.empty() && ms_since_init - log_sent_ms > 2000)
+        {
+            gps->warning() << "NovAtel: no response to the LOG command for "
+                           << boost::algorithm::join(unanswered_logs, ", ");
+            unanswered_logs.clear();
+        }
+
         if ((ms_since_init - last_data) / 1000 > 10)
         {
             gps->warning() << "NovAtel: Stopped receiving data, attempting restart.";
@@ -255,35 +267,16 @@ void GPS::ReadSerial::readPort()
         case OEM6_COMMAND_LOG: // log command (response)
             if (is_response(header))
             {
-                switch(parse_enum(log_data))
-                {
-                case OEM6_OK:
-                    gps->message() << "data logging successfully initialized: \""  << std::string(log_data.begin() + 4, log_data.end()) << '"';;
-                    break;
-                case OEM6_INVALID_CHECKSUM:
-                    gps->warning("checksum failure");
-                    break;
-                default:
-                    gps->warning() << "RX Message: \"" << std::string(log_data.begin() + 4, log_data.end()) << '"';
-                }
-            }
-        case OEM6_LOG_RTKXYZ:  // RTKXYZ
-            if (!is_response(header))
-            {
-                gps->trace() << "Received RTKXYZ data";
-                parse_rtkxyz(log_data);
+                verifyLogResponse(log_data);
             }
             break;
 
         case OEM6_LOG_REFSTATION:
-            gps->trace() << "\n\nrefstation\n\n";
             if(!is_response(header))
             {
-                gps->trace() << "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
                 gps->trace() << "Received base station health report";
-                gps->trace() << "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
-                break;
             }
+            break;
 
         case OEM6_LOG_BESTPOS:
         {
@@ -297,23 +290,47 @@ void GPS::ReadSerial::readPort()
                          << "\tECEF position: " << position << std::endl
                          << "\tLLH: " << ecef_to_llh(position) << std::endl
                          << "\t# of sats visible: " << log_data[64] << "]" << std::endl;
+            last_data = gps->getMsSinceInit();
             break;
         }
 
-        case OEM6_LOG_BESTXYZ:  // RTKXYZ
+        case OEM6_LOG_RTKXYZ:  // same layout as BESTXYZ
+        case OEM6_LOG_BESTXYZ:
             if (!is_response(header))
             {
-                gps->trace() << "Received BESTXYZ data";
+                gps->trace() << "Received " << (message_id == OEM6_LOG_RTKXYZ ? "RTKXYZ" : "BESTXYZ") << " data";
 
                 std::vector<double> log;
                 parse_header(header, log);
                 parse_log(log_data, log);
                 last_data = gps->getMsSinceInit();
-                //GPS::getInstance()->gps_updated();
                 LogFile::getInstance()->logData(LOG_NOVATEL_GPS, log);
             }
             break;
 
+        case OEM6_LOG_BESTVEL:
+            gps->trace() << "[Velocity: Status: " << solStatusToString(parse_enum(log_data)) << std::endl
+                         << "\tVelocity type: " << posVelTypeToString(parse_enum(log_data, 4)) << std::endl
+                         << "\tLatency(s): " << raw_to_float<float>(log_data.begin() + 8, log_data.begin() + 12) << std::endl
+                         << "\tHorizontal speed: " << raw_to_float<double>(log_data.begin() + 16, log_data.begin() + 24) << std::endl
+                         << "\tTrack over ground: " << raw_to_float<double>(log_data.begin() + 24, log_data.begin() + 32) << std::endl
+                         << "\tVertical speed: " << raw_to_float<double>(log_data.begin() + 32, log_data.begin() + 40) << "]";
+            last_data = gps->getMsSinceInit();
+            break;
+
+        case OEM6_LOG_PSRDOP:
+            gps->trace() << "[DOP: GDOP: " << raw_to_float<float>(log_data.begin(), log_data.begin() + 4)
+                         << " PDOP: " << raw_to_float<float>(log_data.begin() + 4, log_data.begin() + 8)
+                         << " HDOP: " << raw_to_float<float>(log_data.begin() + 8, log_data.begin() + 12)
+                         << " satellites: " << parse_enum(log_data, 24) << "]";
+            last_data = gps->getMsSinceInit();
+            break;
+
+        case OEM6_LOG_RANGECMP:
+            gps->trace() << "Received RANGECMP with " << parse_enum(log_data) << " observations";
+            last_data = gps->getMsSinceInit();
+            break;
+
         default:
             gps->warning() << "Received unexpected message id: " << message_id;
             continue;
@@ -545,7 +562,7 @@ blas::vector<double> GPS::ReadSerial::ecef_to_llh(const blas::vector<double>& ec
 void GPS::ReadSerial::_genericLog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message, OEM6_LOG_TRIGGERS trigger, double period)
 {
     GPS* gps = GPS::getInstance();
-    gps->trace() << "NovAtel: [Log msg: " << message << ", trigger: " << trigger << ", period: " << (1/period) << "HZ, on: " << port << "]";
+    gps->trace() << "NovAtel: [Log msg: " << message << ", trigger: " << trigger << ", period: " << period << "s, on: " << port << "]";
 
     // generate header
     std::vector<uint8_t> command(generate_header(OEM6_COMMAND_LOG, 32));
@@ -566,7 +583,7 @@ void GPS::ReadSerial::_genericLog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message, O
     command.insert(command.end(), triggerBuffer.begin(), triggerBuffer.end());
 
     // append period
-    std::vector<uint8_t> periodBuffer(float_to_raw(period)); // send every 1/4 second
+    std::vector<uint8_t> periodBuffer(float_to_raw(period));
     command.insert(command.end(), periodBuffer.begin(), periodBuffer.end());
 
     // append offset
@@ -587,18 +604,21 @@ void GPS::ReadSerial::_genericLog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message, O
 
 void GPS::ReadSerial::send_unlog_command()
 {
-    _genericUnlog(OEM6_LOG_RTKXYZ);
-    _genericUnlog(OEM6_LOG_REFSTATION);
+    for (const novatel_log_schedule::entry& log : schedule.entries())
+    {
+        _genericUnlog(static_cast<OEM6_PORT_IDENTIFIER>(log.port), static_cast<OEM6_LOG>(log.id));
+    }
+    unanswered_logs.clear();
 }
 
-void GPS::ReadSerial::_genericUnlog(OEM6_LOG message)
+void GPS::ReadSerial::_genericUnlog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message)
 {
     GPS* gps = GPS::getInstance();
 
     std::vector<uint8_t> command(generate_header(OEM6_COMMAND_UNLOG, 8));
 
-    std::vector<uint8_t> port(int_to_raw(OEM6_PORT_THISPORT));
-    command.insert(command.end(), port.begin(), port.end());
+    std::vector<uint8_t> portBuffer(int_to_raw(port));
+    command.insert(command.end(), portBuffer.begin(), portBuffer.end());
 
     std::vector<uint8_t> id(int_to_raw(static_cast<uint16_t>(message)));
     command.insert(command.end(), id.begin(), id.end());
@@ -635,13 +655,115 @@ std::vector<uint8_t> GPS::ReadSerial::generate_header(uint16_t message_id, uint1
     return header;
 }
 
+void GPS::ReadSerial::configureSchedule()
+{
+    GPS* gps = GPS::getInstance();
+
+    gps->configDescribe("logs",
+                        boost::algorithm::join(novatel_log_schedule::known_logs(), ", "),
+                        "Comma separated logs to request, each is set up under novatel.log.");
+    std::vector<std::string> names;
+    boost::split(names, gps->configGets("logs", "BESTXYZ"), boost::is_any_of(","));
+
+    for (std::string& name : names)
+    {
+        boost::algorithm::trim(name);
+        if (name.empty())
+        {
+            continue;
+        }
+
+        const std::string key = "log." + name;
+        gps->configDescribe(key + ".trigger", "ONTIME/ONCHANGED/ONNEW", "When the receiver sends " + name + ".");
+        gps->configDescribe(key + ".rate_hz",
+                            "20, 10, 5, 4, 2, 1 or 1/n",
+                            "Rate " + name + " is sent at ONTIME, or is expected at for the bandwidth check.",
+                            "hz");
+        gps->configDescribe(key + ".port", "THISPORT/COM1/COM2/COM3", "Receiver port " + name + " is sent on.");
+
+        const std::string problem = schedule.add(name,
+                                                 gps->configGets(key + ".trigger", "ONTIME"),
+                                                 gps->configGetd(key + ".rate_hz", 20),
+                                                 gps->configGets(key + ".port", "THISPORT"));
+        if (! problem.empty())
+        {
+            gps->warning() << "NovAtel: not logging " << name << ", " << problem;
+        }
+    }
+
+    for (const std::string& name : schedule.drop_redundant())
+    {
+        gps->warning() << "NovAtel: not logging " << name << ", another position log is scheduled";
+    }
+
+    // 8N1 takes ten bits a byte
+    const int baudrate = gps->configGeti("terminal.port.baudrate", 38400);
+    gps->configDescribe("max_port_load", "0 - 1", "Fraction of the serial port the scheduled logs may use.");
+    const double capacity = gps->configGetd("max_port_load", 0.8) * baudrate / 10.0;
+
+    const double load = schedule.load(OEM6_PORT_THISPORT);
+    for (const std::string& name : schedule.fit(OEM6_PORT_THISPORT, capacity))
+    {
+        gps->warning() << "NovAtel: not logging " << name << ", " << load << " B/s of logs does not fit in "
+                       << capacity << " B/s at " << baudrate << " baud";
+    }
+    if (schedule.load(OEM6_PORT_THISPORT) > capacity)
+    {
+        gps->critical() << "NovAtel: the position log needs " << schedule.load(OEM6_PORT_THISPORT)
+                        << " B/s, more than " << capacity << " B/s at " << baudrate << " baud";
+    }
+
+    for (const novatel_log_schedule::entry& log : schedule.entries())
+    {
+        gps->message() << "NovAtel: scheduled " << log.name << " at " << log.rate_hz << " Hz, "
+                       << log.bytes_per_second() << " B/s";
+
+        // the state selection expects positions at the rate of the position log
+        if (log.position && gps->position_source < 0)
+            gps->position_source = SystemState::getInstance()->position_sources.add_source("novatel", log.rate_hz);
+    }
+}
+
 void GPS::ReadSerial::setupLogging()
 {
-    GPS::getInstance()->trace() << "Setting up logging";
-    _genericLog(OEM6_PORT_THISPORT, OEM6_LOG_RTKXYZ, ONTIME, OEM6_LOG_4_HZ);
-    //_genericLog(OEM6_PORT_THISPORT, OEM6_LOG_REFSTATION, ONNEW, OEM6_LOG_4_HZ);
-    _genericLog(OEM6_PORT_THISPORT, OEM6_LOG_BESTPOS, ONTIME, OEM6_LOG_4_HZ);
-    _genericLog(OEM6_PORT_THISPORT, OEM6_LOG_BESTXYZ, ONTIME, OEM6_LOG_4_HZ);
+    GPS* gps = GPS::getInstance();
+    gps->trace() << "Setting up logging";
+
+    unanswered_logs.clear();
+    for (const novatel_log_schedule::entry& log : schedule.entries())
+    {
+        _genericLog(static_cast<OEM6_PORT_IDENTIFIER>(log.port),
+                    static_cast<OEM6_LOG>(log.id),
+                    static_cast<OEM6_LOG_TRIGGERS>(log.when),
+                    log.period());
+        unanswered_logs.push_back(log.name);
+    }
+    log_sent_ms = gps->getMsSinceInit();
+}
+
+void GPS::ReadSerial::verifyLogResponse(const std::vector<uint8_t>& log_data)
+{
+    GPS* gps = GPS::getInstance();
+
+    const std::string text(log_data.begin() + std::min<size_t>(4, log_data.size()), log_data.end());
+    std::string name = "an unknown log";
+    if (! unanswered_logs.empty())
+    {
+        name = unanswered_logs.front();
+        unanswered_logs.pop_front();
+    }
+
+    switch(parse_enum(log_data))
+    {
+    case OEM6_OK:
+        gps->message() << "NovAtel: logging " << name;
+        break;
+    case OEM6_INVALID_CHECKSUM:
+        gps->warning() << "NovAtel: LOG command for " << name << " failed its checksum";
+        break;
+    default:
+        gps->warning() << "NovAtel: receiver refused " << name << ": \"" << text << '"';
+    }
 }
 
 std::vector<uint8_t> GPS::ReadSerial::compute_checksum(const std::vector<uint8_t>& message)
@@ -26,6 +26,8 @@
 #include <math.h>
 
 /* STL Headers */
+#include <deque>
+#include <string>
 #include <vector>
 
 /* Boost Headers */
@@ -36,6 +38,7 @@ namespace blas = boost::numeric::ublas;
 /* Project Headers */
 #include "GPS.h"
 #include "ThreadSafeVariable.h"
+#include "novatel_log_schedule.h"
 
 /**
  * @brief Class to send commands to, and receive data from the GPS unit.
@@ -563,6 +566,12 @@ private:
      */
     bool initPort();
 
+    /**
+     * Read the log schedule from novatel.logs, drop the redundant position
+     * logs and the optional logs the port can not carry.
+     */
+    void configureSchedule();
+
     /**
      * Requests all desired logs from the GPS unit.
      */
@@ -574,6 +583,18 @@ private:
      */
     void send_unlog_command();
 
+    /// match a LOG command response to the oldest log request without one
+    void verifyLogResponse(const std::vector<uint8_t>& log_data);
+
+    /// the logs requested from the receiver
+    novatel_log_schedule schedule;
+
+    /// names of the logs whose LOG command has not been answered, oldest first
+    std::deque<std::string> unanswered_logs;
+
+    /// when the last LOG command was sent
+    long log_sent_ms;
+
     /// generate a message header for the novatel
     static std::vector<uint8_t> generate_header(uint16_t message_id, uint16_t message_length);
 
@@ -628,9 +649,9 @@ private:
     void _genericLog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message, OEM6_LOG_TRIGGERS trigger, double period);
 
     /**
-     * Tells the NovAtel to stop sending the given log.
+     * Tells the NovAtel to stop sending the given log on port.
      */
-    void _genericUnlog(OEM6_LOG message);
+    void _genericUnlog(OEM6_PORT_IDENTIFIER port, OEM6_LOG message);
 
     /**
      * Reads a packet from the NovAtel. Returns false if the system was terminated
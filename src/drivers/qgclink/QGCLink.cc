@@ -24,9 +24,17 @@
 #include "QGCReceive.h"
 #include "QGCSend.h"
 #include "Configuration.h"
+#include "LogFile.h"
 
 #include <asio.hpp>
 
+/* STL Headers */
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+
 /* Mavlink Headers */
 #include <mavlink.h>
 
@@ -37,6 +45,9 @@ const std::string QGCLINK_HOST_ADDRESS_DEFAULT = "0.0.0.0";
 const std::string QGCLINK_HOST_PORT_PARAM = "qgroundcontrol.host.port";
 const int QGCLINK_HOST_PORT_DEFAULT = 14550;
 
+const std::string LOG_QGCLINK_THROUGHPUT = "QGCLink Throughput";
+const std::string LOG_QGCLINK_RADIO = "QGCLink Radio";
+
 // Function definitions
 
 QGCLink::QGCLink()
@@ -44,13 +55,40 @@ QGCLink::QGCLink()
   socket(io_service),
   heartbeat_rate(10),
   position_rate(10),
-  attitude_rate(10)
+  attitude_rate(10),
+  framer(static_cast<mavlink_framer::version_mode>(configGeti("mavlink_version", mavlink_framer::AUTO)),
+         configGeti("custom_msgid_base", mavlink_framer::DEFAULT_CUSTOM_MSGID_BASE)),
+  sent_bytes(0),
+  sent_messages(0),
+  throughput_start(std::chrono::steady_clock::now()),
+  send_save_fd(-1),
+  serial_fd(-1),
+  hardware_flow(false)
 {
 	configDescribe("UASidentifier",
                    "int",
                    "Unique numeric identifier for this system.");
 	uasId = configGeti("UASidentifier", 100);
 
+	configDescribe("mavlink_version",
+                   "0:auto, 1:MAVLink 1, 2:MAVLink 2",
+                   "Framing used to QGroundControl, auto sends MAVLink 1 until QGroundControl sends MAVLink 2.");
+
+	configDescribe("custom_msgid_base",
+                   "int",
+                   "Offset added to the id of the custom messages when they are sent as MAVLink 2.");
+
+	configDescribe("send_save_path",
+                   "path to a file or blank to not save",
+                   "A location on the filesystem where every frame sent to QGroundControl will be appended.");
+	const std::string send_save_path = configGets("send_save_path", "");
+	if (!send_save_path.empty())
+	{
+		send_save_fd = open(send_save_path.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+		if (send_save_fd < 0)
+			warning() << "Could not open " << send_save_path << " to save sent frames";
+	}
+
 	init();
 }
 
@@ -58,17 +96,44 @@ void QGCLink::init()
 {
 	try
 	{
-		Configuration* cfg = Configuration::getInstance();
-		std::string ip_addr = cfg->gets(QGCLINK_HOST_ADDRESS_PARAM, QGCLINK_HOST_ADDRESS_DEFAULT);
+		configDescribe("serial_port",
+		               "device path or blank to use UDP",
+		               "Telemetry radio to talk to QGroundControl through instead of the UDP host.");
+		const std::string serial_port = configGets("serial_port", "");
+
+		if (serial_port.empty())
+		{
+			Configuration* cfg = Configuration::getInstance();
+			std::string ip_addr = cfg->gets(QGCLINK_HOST_ADDRESS_PARAM, QGCLINK_HOST_ADDRESS_DEFAULT);
 
-		qgc.address(asio::ip::address::from_string(ip_addr));
-		info() << "Opening socket to " << qgc.address().to_string();
+			qgc.address(asio::ip::address::from_string(ip_addr));
+			info() << "Opening socket to " << qgc.address().to_string();
 
 
-		qgc.port(cfg->geti(QGCLINK_HOST_PORT_PARAM, QGCLINK_HOST_PORT_DEFAULT));
+			qgc.port(cfg->geti(QGCLINK_HOST_PORT_PARAM, QGCLINK_HOST_PORT_DEFAULT));
 
-		// FIXME we didn't check to make sure the address is indeed IPV4 - Joseph
-		socket.open(asio::ip::udp::v4());
+			// FIXME we didn't check to make sure the address is indeed IPV4 - Joseph
+			socket.open(asio::ip::udp::v4());
+		}
+		else
+		{
+			info() << "Opening radio on " << serial_port;
+			serial_fd = open(serial_port.c_str(), O_RDWR | O_NOCTTY);
+			if (serial_fd < 0 || !namedTerminalSettings("radio", serial_fd, 57600, "8N1", false, true))
+				throw std::runtime_error("could not open the telemetry radio on " + serial_port);
+
+			configDescribe("radio_queue_seconds",
+			               "seconds",
+			               "Longest a frame may wait in the serial and radio buffers before telemetry is dropped and slowed.");
+			const int baudrate = configGeti("terminal.radio.baudrate", 57600);
+			hardware_flow = configGetb("terminal.radio.hardware_flow_control", false);
+			// 8N1 puts ten bits on the wire per byte
+			flow.configure(baudrate / 10.0, configGetd("radio_queue_seconds", 0.25));
+
+			LogFile::getInstance()->logHeader(LOG_QGCLINK_RADIO, "Stream_Scale Radio_Free_Percent Remote_RSSI Dropped_Frames");
+		}
+
+		LogFile::getInstance()->logHeader(LOG_QGCLINK_THROUGHPUT, "Bytes_Per_s Messages_Per_s MAVLink_Version Dropped_Frames");
 
 		receive_thread = std::thread(QGCReceive());
 
@@ -82,3 +147,73 @@ void QGCLink::init()
 		throw e;
 	}
 }
+
+void QGCLink::send(std::vector<uint8_t> &buffer)
+{
+	if (serial_fd >= 0)
+	{
+		const uint32_t msgid = mavlink_framer::frame_msgid(&buffer[0]);
+		const bool essential = msgid == MAVLINK_MSG_ID_HEARTBEAT ||
+		                       msgid == MAVLINK_MSG_ID_PARAM_VALUE ||
+		                       msgid == MAVLINK_MSG_ID_STATUSTEXT;
+		if (!flow.admit(buffer.size(), essential, std::chrono::steady_clock::now()))
+			return;
+
+		if (write(serial_fd, &buffer[0], buffer.size()) < 0)
+			warning() << "Could not write to the radio";
+	}
+	else
+	{
+		socket.send_to(asio::buffer(buffer), qgc);
+	}
+	sent_bytes += buffer.size();
+	++sent_messages;
+
+	if (send_save_fd >= 0 && write(send_save_fd, &buffer[0], buffer.size()) < 0)
+	{
+		warning() << "Could not save sent frame, no longer saving";
+		close(send_save_fd);
+		send_save_fd = -1;
+	}
+}
+
+void QGCLink::log_throughput()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(now - throughput_start).count();
+	throughput_start = now;
+	if (seconds <= 0)
+		return;
+
+	std::vector<double> throughput {sent_bytes.exchange(0) / seconds,
+	                                sent_messages.exchange(0) / seconds,
+	                                static_cast<double>(framer.version()),
+	                                static_cast<double>(framer.dropped())};
+	LogFile::getInstance()->logData(LOG_QGCLINK_THROUGHPUT, throughput);
+
+	if (serial_fd >= 0)
+	{
+		std::vector<double> radio {flow.scale(),
+		                           static_cast<double>(flow.txbuf()),
+		                           static_cast<double>(flow.remote_rssi()),
+		                           static_cast<double>(flow.dropped())};
+		LogFile::getInstance()->logData(LOG_QGCLINK_RADIO, radio);
+	}
+}
+
+void QGCLink::update_flow()
+{
+	if (serial_fd < 0)
+		return;
+
+	int queued = 0;
+	if (ioctl(serial_fd, TIOCOUTQ, &queued) < 0)
+		queued = 0;
+
+	bool clear_to_send = true;
+	int lines = 0;
+	if (hardware_flow && ioctl(serial_fd, TIOCMGET, &lines) == 0)
+		clear_to_send = lines & TIOCM_CTS;
+
+	flow.update(queued, clear_to_send, std::chrono::steady_clock::now());
+}
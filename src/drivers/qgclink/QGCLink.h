@@ -29,6 +29,8 @@
 #include "heli.h"
 #include "Driver.h"
 #include "Singleton.h"
+#include "mavlink_framer.h"
+#include "radio_flow.h"
 
 
 /* STL Headers */
@@ -37,12 +39,14 @@
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include <chrono>
 
 /**
- *  @brief Sends and receives data to QGroundControl via UDP.
+ *  @brief Sends and receives data to QGroundControl via UDP or a serial telemetry radio.
  *  This class handles all Mavlink communication to QGC.  It spawns a receive thread
  *  to receive data from a UDP socket, and a send thread to send data on the same UDP
- *  socket.
+ *  socket.  When a serial port is configured the same threads use the radio instead
+ *  and the telemetry streams are throttled to what the radio can carry, see radio_flow.
  *  @author Bryan Godbolt <godbolt@ece.ualberta.ca>
  *  @date July 8, 2011 : Created class
  *  @date October 20, 2011 : Modified send/receive calls to catch system_failure exception - ethernet cable can now be safely unplugged
@@ -72,11 +76,27 @@ public:
 	boost::signals2::signal<void (heli::Controller_Mode)> control_mode;
 
     /// Sends the given buffer out to QGroundControl
-    void send(std::vector<uint8_t> &buffer)
+    void send(std::vector<uint8_t> &buffer);
+
+    /// Frames msg into buffer in the MAVLink version negotiated with QGroundControl
+    void encode(const mavlink_message_t& msg, std::vector<uint8_t>& buffer)
+    {
+        buffer.resize(mavlink_framer::MAX_FRAME_LENGTH);
+        buffer.resize(framer.encode(msg, &buffer[0]));
+    }
+
+    /// Logs the bytes and messages sent per second since the last call
+    void log_throughput();
+
+    /// Factor the telemetry stream rates are multiplied by to fit the link
+    double stream_scale() const
     {
-        socket.send_to(asio::buffer(buffer), qgc);
+        return flow.scale();
     }
 
+    /// Samples the serial port queue and CTS line and adjusts the stream scale
+    void update_flow();
+
     /// Returns the uasid for this UAS
     int getUasId()
     {
@@ -125,6 +145,23 @@ private:
     inline void set_attitude_rate(int rate) {attitude_rate = rate;}
 
 	int uasId;
+
+	/// MAVLink 1/2 framing shared by the send and receive threads
+	mavlink_framer framer;
+
+	/// bytes and messages sent since the last call to log_throughput()
+	std::atomic<uint32_t> sent_bytes;
+	std::atomic<uint32_t> sent_messages;
+	std::chrono::steady_clock::time_point throughput_start;
+
+	/// file every sent frame is appended to for offline bandwidth analysis, -1 when disabled
+	int send_save_fd;
+
+	/// the telemetry radio, -1 when talking to QGC over UDP
+	int serial_fd;
+	/// true if the radio uses RTS/CTS
+	bool hardware_flow;
+	radio_flow flow;
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include "Helicopter.h"
 #include "Driver.h"
 #include "CommonMessages.h"
+#include "ParameterTable.h"
 #include "LogFile.h"
 
 /* Mavlink Headers */
@@ -38,12 +39,16 @@ using asio::ip::address;
 
 /* STL Headers */
 #include <vector>
+#include <cstring>
+#include <cerrno>
 #include <exception>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
 
 void QGCLink::QGCReceive::receive()
 {
 	mavlink_message_t msg;
-	mavlink_status_t status;
 
 	if (qgc == NULL)
 		qgc = QGCLink::getInstance();
@@ -53,18 +58,30 @@ void QGCLink::QGCReceive::receive()
 	{
 		// pull a datagram from the socket
 		int bytes_received = 0;
-		try
+		if (qgc->serial_fd >= 0)
 		{
-			bytes_received = qgc->socket.receive_from(asio::buffer(recv_buf), qgc->qgc);
+			bytes_received = read(qgc->serial_fd, &recv_buf[0], recv_buf.size());
+			if (bytes_received < 0)
+			{
+				qgc->warning() << "Error reading from the radio: " << strerror(errno);
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
 		}
-		catch (std::exception &err)
+		else
 		{
-			qgc->warning() << "Error recieving data: " << err.what();
+			try
+			{
+				bytes_received = qgc->socket.receive_from(asio::buffer(recv_buf), qgc->qgc);
+			}
+			catch (std::exception &err)
+			{
+				qgc->warning() << "Error recieving data: " << err.what();
+			}
 		}
 
 		for (int i=0; i<bytes_received; i++)
 		{
-			if(mavlink_parse_char(MAVLINK_COMM_0, recv_buf[i], &msg, &status))
+			if(qgc->framer.parse(recv_buf[i], msg))
 			{
 
                 for(Driver* d : Driver::getDrivers())
@@ -236,6 +253,13 @@ void QGCLink::QGCReceive::receive()
 					}
 					break;
 				}
+				case MAVLINK_MSG_ID_RADIO_STATUS:
+				{
+					mavlink_radio_status_t radio;
+					mavlink_msg_radio_status_decode(&msg, &radio);
+					qgc->flow.radio_status(radio.txbuf, radio.remrssi);
+					break;
+				}
 				case MAVLINK_MSG_ID_REQUEST_DATA_STREAM:
 				{
 					qgc->debug("Request a Data Stream.");
@@ -284,46 +308,18 @@ void QGCLink::QGCReceive::receive()
 
 					if(((int)set.target_system) == qgc->uasId)
 					{
-						switch(set.target_component)
+						ParameterTable* parameters = ParameterTable::getInstance();
+						int position = parameters->find(set.target_component, set.param_id);
+						if (position < 0)
 						{
-						case heli::CONTROLLER_ID:
-						{
-							Control *control = Control::getInstance();
-							control->setParameter(Parameter(std::string((const char*)(set.param_id)), set.param_value));
-							std::vector<Parameter> plist = control->getParameters();
-							for (std::vector<Parameter>::iterator it = plist.begin(); it != plist.end(); ++it)
-							{
-								if ((*it).getParamID() == (const char*)(set.param_id))
-								{
-									std::lock_guard<std::mutex> lock(CommonMessages::getInstance()->requested_params_lock);
-									CommonMessages::getInstance()->requested_params.push(Parameter((*it).getParamID(), (*it).getValue(), heli::CONTROLLER_ID));
-									qgc->debug() << __FILE__ << __LINE__ << "Sending Parameter: " << (*it);
-								}
-							}
-							break;
-						}
-						case heli::HELICOPTER_ID:
-						{
-							Helicopter* bergen = Helicopter::getInstance();
-							bergen->setParameter(Parameter(std::string((const char*)(set.param_id)), set.param_value));
-							std::vector<Parameter> plist(bergen->getParameters());
-							bool param_found = false;
-							for (std::vector<Parameter>::iterator it = plist.begin(); it != plist.end() && !param_found; ++it)
-							{
-								if ((*it).getParamID() == (const char*)(set.param_id))
-								{
-									std::lock_guard<std::mutex> lock(CommonMessages::getInstance()->requested_params_lock);
-									CommonMessages::getInstance()->requested_params.push(Parameter((*it).getParamID(), (*it).getValue(), heli::HELICOPTER_ID));
-									qgc->debug() << __FILE__ << __LINE__ << "Sending Parameter: " << (*it);
-									param_found = true;
-								}
-							}
-							break;
-						}
-						default:
-							qgc->warning() << "Component id " << set.target_component << " cannot be mapped to an on-board component.";
+							qgc->warning() << "Component id " << static_cast<int>(set.target_component) << " has no parameter "
+							               << std::string(set.param_id, strnlen(set.param_id, ParameterTable::ID_LENGTH));
 							break;
 						}
+
+						// echo the value the component kept, even when it rejected the new one
+						parameters->set(position, set.param_value);
+						CommonMessages::getInstance()->request_param(position);
 					}
 					break;
 				}
@@ -334,67 +330,12 @@ void QGCLink::QGCReceive::receive()
 					mavlink_param_request_read_t set;
 					mavlink_msg_param_request_read_decode(&msg, &set);
 
-					switch(set.target_component)
-					{
-					case heli::NAVFILTER_ID:
-					{
-//						NavFilter *nav = NavFilter::getInstance();
-//						std::vector<Parameter> plist = nav->getParameters();
-//						for (std::vector<Parameter>::iterator it = plist.begin(); it != plist.end(); ++it)
-//						{
-//							if ((*it).getParamID() == (const char*)(set.param_id))
-//							{
-//								std::lock_guard<std::mutex> lock(CommonMessages::getInstance()->requested_params_lock);
-//								CommonMessages::getInstance()->requested_params.push(Parameter((*it).getParamID(), (*it).getValue(), heli::NAVFILTER_ID));
-//							}
-//						}
-					break;
-					}
-					case heli::CONTROLLER_ID:
-					{
-						std::vector<Parameter> plist(Control::getInstance()->getParameters());
-
-						qgc->trace() << "Searching for controller param with index: " << set.param_index << "from list size: " << plist.size();
-						if (set.param_index >= 0)
-						{
-							uint index = set.param_index;
-							if (index < plist.size())
-							{
-								qgc->trace() << "sending parameter: " << plist[index];
-								CommonMessages::getInstance()->requested_params.push(plist[index]);
-							}
-						}
-						else
-						{
-							bool param_found = false;
-							for (std::vector<Parameter>::iterator it = plist.begin(); (it != plist.end()) && (!param_found); ++it)
-							{
-								if (it->getParamID() == (const char*)(set.param_id))
-								{
-									std::lock_guard<std::mutex> lock(CommonMessages::getInstance()->requested_params_lock);
-									CommonMessages::getInstance()->requested_params.push(Parameter(it->getParamID(), it->getValue(), heli::CONTROLLER_ID));
-									param_found = true;
-								}
-							}
-						}
-						break;
-					}
-					case heli::HELICOPTER_ID:
-					{
-						std::vector<Parameter> plist(Helicopter::getInstance()->getParameters());
-						bool param_found = false;
-						for (std::vector<Parameter>::iterator it = plist.begin(); (it != plist.end()) && (!param_found); ++it)
-						{
-							if (it->getParamID() == (const char*)(set.param_id))
-							{
-								std::lock_guard<std::mutex> lock(CommonMessages::getInstance()->requested_params_lock);
-								CommonMessages::getInstance()->requested_params.push(Parameter(it->getParamID(), it->getValue(), heli::HELICOPTER_ID));
-								param_found = true;
-							}
-						}
-						break;
-					}
-					}
+					ParameterTable* parameters = ParameterTable::getInstance();
+					int position = (set.param_index >= 0) ? parameters->find(set.target_component, static_cast<int>(set.param_index))
+					                                      : parameters->find(set.target_component, set.param_id);
+					qgc->trace() << "Requested parameter index: " << set.param_index << " found at: " << position;
+					if (position >= 0)
+						CommonMessages::getInstance()->request_param(position);
 				}
 					break;
 				#ifdef MAVLINK_ENABLED_UALBERTA
@@ -28,7 +28,9 @@
 #include "MdlAltimeter.h"
 #include "Helicopter.h"
 #include "RateLimiter.h"
+#include "deadline_watchdog.h"
 #include "Debug.h"
+#include "LogFile.h"
 
 /* MAVLink Headers */
 #include <mavlink.h>
@@ -50,8 +52,14 @@ namespace blas = boost::numeric::ublas;
 
 #define NDEBUG
 
+const std::string QGCSend::LOG_QGCSEND_COLLECTION = "QGCSend Collection";
+
 QGCSend::QGCSend()
     :qgc(NULL),
+     collected(0),
+     overflowed(0),
+     allocated_bytes(0),
+     copied_bytes(0),
      servo_source(heli::NUM_AUTOPILOT_MODES),
      pilot_mode(heli::NUM_PILOT_MODES),
      filter_state(IMU::NUM_GX3_MODES),
@@ -79,6 +87,8 @@ void QGCSend::send()
     }
 
     int loop_count = 0;
+    int stream_count = 0;
+    double stream_phase = 0;
 
     // get initial system modes
     pilot_mode = servo_switch::getInstance()->get_pilot_mode();
@@ -96,9 +106,14 @@ void QGCSend::send()
     attitude_source_connection = QGCLink::getInstance()->attitude_source.connect(
                                      boost::bind(&QGCSend::set_attitude_source, this, _1));
 
+    LogFile::getInstance()->logHeader(LOG_QGCSEND_COLLECTION,
+                                      "Messages_Per_s Overflowed_Per_s Arena_Capacity Allocated_Bytes_Per_s Copied_Bytes_Per_s");
+    size_arena();
+
     while(true)
     {
         rl.wait();
+        deadline_watchdog::check_in("QGC send", std::chrono::milliseconds(5));
 
         if (should_run(qgc->get_heartbeat_rate(), send_rate, loop_count))
         {
@@ -112,17 +127,19 @@ void QGCSend::send()
             send_console_message(message_queue_pop(), send_queue);
         }
 
-        // Do bulk allocation of messages for drivers.
-        for(Driver* driver : Driver::getDrivers())
+        // The driver streams run on a clock slowed down to what the link can carry
+        stream_phase += qgc->stream_scale();
+        if (stream_phase >= 1)
         {
-        	std::vector<mavlink_message_t> msgs;
-        	driver->sendMavlinkMsg(msgs, qgc->getUasId(), send_rate, loop_count);
-        	for(mavlink_message_t &msg : msgs)
-        	{
-        		std::vector<uint8_t> buf(MAVLINK_MAX_PACKET_LEN);
-        		buf.resize(mavlink_msg_to_send_buffer(&buf[0], &msg));
-        		send_queue->push(buf);
-        	}
+            stream_phase -= 1;
+
+            // the drivers pack in to the arena, which only grows after an overflow
+            for(Driver* driver : drivers)
+            {
+                driver->sendMavlinkMsg(arena, qgc->getUasId(), send_rate, stream_count);
+            }
+
+            stream_count++;
         }
 
         /* actually send data to qgc */
@@ -130,21 +147,47 @@ void QGCSend::send()
         {
             while (!send_queue->empty())
             {
-                uint8_t sysid = send_queue->front().at(3);
-                uint8_t compid = send_queue->front().at(4);
-                uint8_t msgid = send_queue->front().at(5);
-                qgc->trace() << "Sending message system: " << sysid << " component: " << compid << " message: " << msgid;
+                qgc->trace() << "Sending message: " << mavlink_framer::frame_msgid(&send_queue->front()[0])
+                             << " length: " << send_queue->front().size();
 
                 qgc->send(send_queue->front());
                 send_queue->pop();
             }
 
+            for (const mavlink_message_t& msg : arena)
+            {
+                qgc->encode(msg, frame);
+                qgc->trace() << "Sending message: " << mavlink_framer::frame_msgid(&frame[0])
+                             << " length: " << frame.size();
+                qgc->send(frame);
+            }
         }
         catch (std::exception e)
         {
             qgc->warning() << e.what();
         }
 
+        collected += arena.size();
+        if (arena.overflowed() > 0)
+        {
+            overflowed += arena.overflowed();
+            qgc->warning() << "Dropped " << arena.overflowed() << " telemetry messages, growing the arena";
+            arena.reserve(arena.capacity() + arena.overflowed());
+        }
+        arena.clear();
+
+        if (loop_count % (send_rate / 10) == 0)
+        {
+            qgc->update_flow();
+        }
+
+        if (loop_count % send_rate == 0)
+        {
+            qgc->log_throughput();
+            log_collection(1);
+            size_arena();
+        }
+
         /* Increment loop count */
         loop_count++;
 
@@ -152,6 +195,33 @@ void QGCSend::send()
     }
 }
 
+void QGCSend::size_arena()
+{
+    drivers = Driver::getDrivers();
+
+    size_t capacity = 0;
+    for (Driver* driver : drivers)
+    {
+        capacity += driver->mavlinkMsgCapacity();
+    }
+    arena.reserve(capacity);
+}
+
+void QGCSend::log_collection(double seconds)
+{
+    std::vector<double> collection {collected / seconds,
+                                    overflowed / seconds,
+                                    static_cast<double>(arena.capacity()),
+                                    (arena.allocated_bytes() - allocated_bytes) / seconds,
+                                    (arena.copied_bytes() - copied_bytes) / seconds};
+    LogFile::getInstance()->logData(LOG_QGCSEND_COLLECTION, collection);
+
+    collected = 0;
+    overflowed = 0;
+    allocated_bytes = arena.allocated_bytes();
+    copied_bytes = arena.copied_bytes();
+}
+
 bool QGCSend::should_run(int stream_rate, int send_rate, int count)
 {
     if (stream_rate == 0 || stream_rate > send_rate)
@@ -186,10 +256,10 @@ void QGCSend::send_heartbeat(std::queue<std::vector<uint8_t> > *sendq)
     int autopilot_type = MAV_AUTOPILOT_UALBERTA;
 
     mavlink_message_t msg;
-    std::vector<uint8_t> buf(MAVLINK_MAX_PACKET_LEN);
+    std::vector<uint8_t> buf;
 
     mavlink_msg_heartbeat_pack(100, 200, &msg, system_type, autopilot_type, 0, 0, 0);
-    buf.resize(mavlink_msg_to_send_buffer(&buf[0], &msg));
+    qgc->encode(msg, buf);
 
     sendq->push(buf);
 
@@ -286,13 +356,13 @@ void QGCSend::send_status(std::queue<std::vector<uint8_t> >* sendq)
     }
 
     mavlink_message_t msg;
-    std::vector<uint8_t> buf(MAVLINK_MAX_PACKET_LEN);
+    std::vector<uint8_t> buf;
 
     mavlink_msg_ualberta_sys_status_pack(qgc->getUasId(), 200, &msg,
                                          qgc_servo_source, qgc_filter_state, qgc_pilot_mode, qgc_control_mode,(get_attitude_source()?UALBERTA_NAV_FILTER:UALBERTA_AHRS),
                                          0, 0, Helicopter::getInstance()->get_main_collective(), 0, 0, qgc_trajectory);
 
-    buf.resize(mavlink_msg_to_send_buffer(&buf[0], &msg));
+    qgc->encode(msg, buf);
 
     sendq->push(buf);
 }
@@ -311,9 +381,9 @@ void QGCSend::send_console_message(const std::string& message, std::queue<std::v
     console.resize(50);
 
     mavlink_message_t msg;
-    std::vector<uint8_t> buf(MAVLINK_MAX_PACKET_LEN);
+    std::vector<uint8_t> buf;
 
     ::mavlink_msg_statustext_pack(qgc->getUasId(), 0, &msg, (boost::algorithm::starts_with(console, "Critical")?255:0), console.c_str());
-    buf.resize(mavlink_msg_to_send_buffer(&buf[0], &msg));
+    qgc->encode(msg, buf);
     sendq->push(buf);
 }
@@ -24,6 +24,7 @@
 #include "QGCLink.h"
 #include "heli.h"
 #include "IMU.h"
+#include "mavlink_arena.h"
 
 /* STL Headers */
 #include <queue>
@@ -43,6 +44,7 @@ class QGCSend : public Singleton <QGCSend>
     friend Singleton<QGCSend>;
 
 public:
+    static const std::string LOG_QGCSEND_COLLECTION;
 
     /** queue stream messages and perform actual send */
 	void send();
@@ -60,6 +62,23 @@ private:
 	/// queue to store the message to be sent
 	std::queue<std::vector<uint8_t> > *send_queue;
 
+	/// the drivers' messages of one iteration, only touched by the send thread
+	mavlink_arena arena;
+	/// the drivers streaming, refreshed once a second
+	std::vector<Driver*> drivers;
+	/// reused to frame the messages in arena
+	std::vector<uint8_t> frame;
+	/// messages collected and dropped since the last log_collection()
+	size_t collected;
+	size_t overflowed;
+	uint64_t allocated_bytes;
+	uint64_t copied_bytes;
+
+	/// refresh drivers and grow arena to what they can write in one iteration
+	void size_arena();
+	/// log the messages collected, dropped and the bytes allocated and copied per second
+	void log_collection(double seconds);
+
 
 	/** queue up a heartbeat message
 	 * @param sendq queue to put heartbeat message in */
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "radio_flow.h"
+
+/* STL Headers */
+#include <algorithm>
+
+constexpr double radio_flow::MIN_SCALE;
+constexpr double radio_flow::SCALE_STEP;
+const uint8_t radio_flow::TXBUF_LOW;
+const uint8_t radio_flow::TXBUF_HIGH;
+
+radio_flow::radio_flow()
+    : bytes_per_second(0),
+      queue_seconds(0),
+      depth(0),
+      tokens(0),
+      last_fill(clock::now()),
+      last_decrease(last_fill),
+      _scale(1),
+      _dropped(0),
+      dropped_at_update(0),
+      _txbuf(100),
+      _remote_rssi(0),
+      status_pending(false)
+{
+}
+
+void radio_flow::configure(double bytes_per_second, double queue_seconds)
+{
+    this->bytes_per_second = std::max(0.0, bytes_per_second);
+    this->queue_seconds = std::max(0.0, queue_seconds);
+    depth = this->bytes_per_second * this->queue_seconds;
+    tokens = depth;
+    last_fill = clock::now();
+}
+
+bool radio_flow::admit(size_t bytes, bool essential, clock::time_point now)
+{
+    if (bytes_per_second <= 0)
+        return true;
+
+    const double elapsed = std::chrono::duration<double>(now - last_fill).count();
+    last_fill = now;
+    tokens = std::min(depth, tokens + std::max(0.0, elapsed) * bytes_per_second);
+
+    if (essential || tokens >= bytes)
+    {
+        tokens -= bytes;
+        return true;
+    }
+
+    ++_dropped;
+    return false;
+}
+
+void radio_flow::radio_status(uint8_t txbuf, uint8_t remote_rssi)
+{
+    _txbuf = txbuf;
+    _remote_rssi = remote_rssi;
+    status_pending = true;
+}
+
+void radio_flow::decrease(clock::time_point now)
+{
+    // give the queues time to drain before cutting again
+    if (std::chrono::duration<double>(now - last_decrease).count() < queue_seconds)
+        return;
+    last_decrease = now;
+    _scale = std::max(MIN_SCALE, _scale * 0.5);
+}
+
+void radio_flow::update(int queued, bool clear_to_send, clock::time_point now)
+{
+    if (bytes_per_second <= 0)
+        return;
+
+    const uint32_t dropped = _dropped;
+    const bool bucket_dropped = dropped != dropped_at_update;
+    dropped_at_update = dropped;
+
+    // the radio only reports every second or so, act on a low report once
+    const bool radio_full = status_pending.exchange(false) && _txbuf < TXBUF_LOW;
+
+    const bool congested = !clear_to_send || queued > depth || bucket_dropped || radio_full;
+    const bool relaxed = queued < depth / 4 && _txbuf > TXBUF_HIGH;
+
+    if (congested)
+        decrease(now);
+    else if (relaxed)
+        _scale = std::min(1.0, _scale + SCALE_STEP);
+}
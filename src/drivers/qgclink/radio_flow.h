@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef RADIO_FLOW_H_
+#define RADIO_FLOW_H_
+
+/* STL Headers */
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Keeps the queue in front of a slow telemetry radio shallow
+ *
+ * Two mechanisms work together:
+ *
+ * A token bucket at the serial bit rate, holding at most queue_seconds of
+ * data, decides whether a frame may be written at all.  Stream frames that do
+ * not fit are dropped rather than queued, since a newer sample is always on
+ * its way; essential frames (heartbeats, parameters, console text) are always
+ * written and simply borrow from the bucket.
+ *
+ * The stream scale in [MIN_SCALE, 1] multiplies every telemetry stream rate.
+ * It is cut in half (at most once per queue_seconds) when the radio reports
+ * less than TXBUF_LOW percent of its buffer free in RADIO_STATUS, when the
+ * radio holds CTS off, when the serial driver holds more than a bucket's worth
+ * of data or when the bucket had to drop frames.  It grows back by
+ * SCALE_STEP per update while the radio reports more than TXBUF_HIGH percent
+ * free and the serial queue is nearly empty.
+ *
+ * admit() and update() are called from the send thread, radio_status() from
+ * the receive thread.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class radio_flow
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    static constexpr double MIN_SCALE = 0.05;
+    static constexpr double SCALE_STEP = 0.02;
+    static const uint8_t TXBUF_LOW = 40;
+    static const uint8_t TXBUF_HIGH = 80;
+
+    radio_flow();
+
+    /**
+     * @param bytes_per_second what the serial link carries, 0 for no limit
+     * @param queue_seconds how long a frame may wait in the serial and radio buffers
+     */
+    void configure(double bytes_per_second, double queue_seconds);
+
+    /// @returns true if a frame of length bytes should be written now
+    bool admit(size_t bytes, bool essential, clock::time_point now);
+
+    /**
+     * Record a RADIO_STATUS from the local radio.
+     * @param txbuf percentage of the radio's transmit buffer that is free
+     * @param remote_rssi signal strength seen by the ground radio
+     */
+    void radio_status(uint8_t txbuf, uint8_t remote_rssi);
+
+    /**
+     * Adjust the stream scale, called periodically.
+     * @param queued bytes waiting in the serial driver
+     * @param clear_to_send false when the radio holds CTS off
+     */
+    void update(int queued, bool clear_to_send, clock::time_point now);
+
+    /// @returns the factor the telemetry stream rates are multiplied by
+    double scale() const
+    {
+        return _scale;
+    }
+
+    /// @returns the number of frames dropped by the bucket
+    uint32_t dropped() const
+    {
+        return _dropped;
+    }
+
+    uint8_t txbuf() const
+    {
+        return _txbuf;
+    }
+
+    uint8_t remote_rssi() const
+    {
+        return _remote_rssi;
+    }
+
+private:
+    void decrease(clock::time_point now);
+
+    double bytes_per_second;
+    double queue_seconds;
+    /// capacity of the bucket in bytes
+    double depth;
+    double tokens;
+    clock::time_point last_fill;
+    clock::time_point last_decrease;
+
+    std::atomic<double> _scale;
+    std::atomic<uint32_t> _dropped;
+    uint32_t dropped_at_update;
+
+    std::atomic<uint8_t> _txbuf;
+    std::atomic<uint8_t> _remote_rssi;
+    /// set by radio_status(), cleared when update() has acted on it
+    std::atomic_bool status_pending;
+};
+
+#endif
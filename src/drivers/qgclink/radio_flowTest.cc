@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "radio_flow.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+const radio_flow::clock::duration ms = std::chrono::milliseconds(1);
+}
+
+// TESTS
+TEST(radio_flow, BUCKET_LIMITS_STREAM_FRAMES)
+{
+    radio_flow flow;
+    flow.configure(5760, 0.1);
+    radio_flow::clock::time_point now = radio_flow::clock::now();
+
+    // 576 bytes of burst, then about 5.76 bytes per millisecond
+    int admitted = 0;
+    for (int i = 0; i < 20; ++i)
+        admitted += flow.admit(50, false, now);
+    EXPECT_EQ(11, admitted);
+    EXPECT_EQ(9u, flow.dropped());
+
+    // essential frames always go out
+    EXPECT_TRUE(flow.admit(50, true, now));
+    EXPECT_FALSE(flow.admit(50, false, now + 10*ms));
+    EXPECT_TRUE(flow.admit(50, false, now + 30*ms));
+
+    radio_flow unlimited;
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_TRUE(unlimited.admit(280, false, now));
+}
+
+TEST(radio_flow, SCALE_FOLLOWS_RADIO_STATUS)
+{
+    radio_flow flow;
+    flow.configure(5760, 0.1);
+    radio_flow::clock::time_point now = radio_flow::clock::now() + 1000*ms;
+
+    flow.radio_status(20, 150);
+    flow.update(0, true, now);
+    EXPECT_DOUBLE_EQ(0.5, flow.scale());
+
+    // the same report is only acted on once, a half full radio holds the scale
+    flow.radio_status(60, 150);
+    for (int i = 1; i <= 10; ++i)
+        flow.update(0, true, now + i*100*ms);
+    EXPECT_DOUBLE_EQ(0.5, flow.scale());
+
+    // an empty radio and serial queue let it grow back
+    flow.radio_status(100, 150);
+    for (int i = 11; i <= 20; ++i)
+        flow.update(0, true, now + i*100*ms);
+    EXPECT_NEAR(0.7, flow.scale(), 1e-9);
+
+    // CTS held off cuts it, but only once per queue_seconds
+    flow.update(0, false, now + 2100*ms);
+    flow.update(0, false, now + 2150*ms);
+    EXPECT_NEAR(0.35, flow.scale(), 1e-9);
+
+    for (int i = 0; i < 100; ++i)
+        flow.update(1000, true, now + (2300 + 100*i)*ms);
+    EXPECT_DOUBLE_EQ(radio_flow::MIN_SCALE, flow.scale());
+}
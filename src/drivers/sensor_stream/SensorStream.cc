@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "SensorStream.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <sstream>
+
+/* Project Headers */
+#include "LogFile.h"
+#include "heli.h"
+
+const std::string SensorStream::LOG_SENSOR_STREAM = "Sensor Stream";
+const size_t SensorStream::MAX_QUEUED;
+
+SensorStream::SensorStream()
+    : Driver("Sensor Stream", "sensor_stream"),
+      start(std::chrono::steady_clock::now()),
+      dropped(0),
+      sequence(0),
+      report_at_us(1000000),
+      samples(0),
+      datagrams(0),
+      bytes(0),
+      latency_sum_us(0)
+{
+    configDescribe("latency_ms",
+                   ">= 0",
+                   "Longest a partly filled batch is held before it is sent.",
+                   "ms");
+    latency_us = 1000 * std::max(0, configGeti("latency_ms", 50));
+
+    configDescribe("imu", "true/false", "Stream the GX3 gyro and accelerometer samples.");
+    imu_enabled = configGetb("imu", true);
+    configDescribe("servo", "true/false", "Stream the commanded servo pulse widths.");
+    servo_enabled = configGetb("servo", true);
+    configDescribe("rc", "true/false", "Stream the pilot input pulse widths.");
+    rc_enabled = configGetb("rc", true);
+
+    if (isEnabled())
+        LogFile::getInstance()->logHeader(LOG_SENSOR_STREAM,
+                                          "Samples Datagrams Bytes Samples_Per_Datagram Mean_Latency_ms Dropped_Batches");
+}
+
+uint64_t SensorStream::now_us() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SensorStream::close_batch()
+{
+    if (queued.size() == MAX_QUEUED)
+    {
+        queued.pop_front();
+        ++dropped;
+    }
+    queued.push_back(open);
+    open.clear();
+}
+
+void SensorStream::add_imu(const std::array<float, 3>& gyro, const std::array<float, 3>& accel)
+{
+    if (! isEnabled() || ! imu_enabled)
+        return;
+
+    const uint64_t time = now_us();
+    add([&](sensor_batch& batch)
+    {
+        return batch.add_imu(time, gyro, accel);
+    });
+}
+
+void SensorStream::add_servo(const std::array<uint16_t, 9>& widths)
+{
+    if (! isEnabled() || ! servo_enabled)
+        return;
+
+    const uint64_t time = now_us();
+    add([&](sensor_batch& batch)
+    {
+        return batch.add_pulses(sensor_batch::SERVO, time, widths);
+    });
+}
+
+void SensorStream::add_rc(const std::array<uint16_t, 8>& widths)
+{
+    if (! isEnabled() || ! rc_enabled)
+        return;
+
+    const uint64_t time = now_us();
+    add([&](sensor_batch& batch)
+    {
+        return batch.add_pulses(sensor_batch::RC, time, widths);
+    });
+}
+
+void SensorStream::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
+{
+    if (! isEnabled())
+        return;
+
+    const uint64_t now = now_us();
+    uint64_t dropped_batches;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (! open.empty() && now - open.first_time_us() >= latency_us)
+            close_batch();
+        dropped_batches = dropped;
+
+        // packing is a copy of the datagram, batches that do not fit wait a tick
+        while (! queued.empty() && msgs.remaining() > 0)
+        {
+            const sensor_batch& batch = queued.front();
+            mavlink_msg_encapsulated_data_pack(uasId, heli::LOGGER_ID, msgs.next(), sequence++, batch.data());
+
+            samples += batch.samples();
+            datagrams += 1;
+            bytes += batch.size();
+            latency_sum_us += now - batch.first_time_us();
+            queued.pop_front();
+        }
+    }
+
+    if (now < report_at_us)
+        return;
+    report_at_us = now + 1000000;
+
+    std::stringstream line;
+    line << samples << '\t' << datagrams << '\t' << bytes << '\t'
+         << (datagrams ? double(samples) / datagrams : 0) << '\t'
+         << (datagrams ? latency_sum_us / 1000.0 / datagrams : 0) << '\t' << dropped_batches;
+    LogFile::getInstance()->logMessage(LOG_SENSOR_STREAM, line.str());
+
+    samples = 0;
+    datagrams = 0;
+    bytes = 0;
+    latency_sum_us = 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef SENSORSTREAM_H_
+#define SENSORSTREAM_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Project Headers */
+#include "Driver.h"
+#include "Singleton.h"
+#include "sensor_batch.h"
+
+/**
+ * Streams the raw IMU, servo command and pilot input samples to the ground
+ * in batches rather than one message per sample.
+ *
+ * The producers add their samples to the open sensor_batch; when it is full
+ * it is queued and a new one opened.  Each QGCSend tick the queued batches
+ * are sent as ENCAPSULATED_DATA messages, one per datagram, as is the open
+ * batch once its first sample is sensor_stream.latency_ms old, so no sample
+ * waits longer than that plus a tick.  utils/sensor_stream.py decodes a
+ * recording of the link.
+ *
+ * LOG_SENSOR_STREAM records once a second how many datagrams were sent
+ * against the samples they carried, the datagrams per sample messages would
+ * have needed.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class SensorStream : public Driver, public Singleton<SensorStream>
+{
+    friend class Singleton<SensorStream>;
+
+public:
+    static const std::string LOG_SENSOR_STREAM;
+    /// completed batches kept while the link is slower than the sensors
+    static const size_t MAX_QUEUED = 16;
+
+    void add_imu(const std::array<float, 3>& gyro, const std::array<float, 3>& accel);
+    void add_servo(const std::array<uint16_t, 9>& widths);
+    void add_rc(const std::array<uint16_t, 8>& widths);
+
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /// every queued batch and the open one
+    virtual size_t mavlinkMsgCapacity() override {return MAX_QUEUED + 1;}
+
+private:
+    SensorStream();
+
+    /// microseconds since the stream was created
+    uint64_t now_us() const;
+
+    /// queue the open batch and open a new one, call with lock held
+    void close_batch();
+
+    template <typename Add>
+    void add(Add add_sample)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (add_sample(open))
+            return;
+        close_batch();
+        add_sample(open);
+    }
+
+    std::chrono::steady_clock::time_point start;
+    uint64_t latency_us;
+    std::atomic_bool imu_enabled;
+    std::atomic_bool servo_enabled;
+    std::atomic_bool rc_enabled;
+
+    std::mutex lock;
+    sensor_batch open;
+    std::deque<sensor_batch> queued;
+    uint64_t dropped;
+
+    /// only touched by the sending thread
+    uint16_t sequence;
+    uint64_t report_at_us;
+    uint64_t samples;
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t latency_sum_us;
+};
+
+#endif
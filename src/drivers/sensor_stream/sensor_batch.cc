@@ -0,0 +1,112 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "sensor_batch.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const uint8_t sensor_batch::VERSION;
+const size_t sensor_batch::CAPACITY;
+const size_t sensor_batch::MAX_CHANNELS;
+const int32_t sensor_batch::GYRO_SCALE;
+const int32_t sensor_batch::ACCEL_SCALE;
+
+namespace
+{
+/// version, sample count and the 32 bit time of the first sample
+const size_t HEADER_SIZE = 6;
+/// the longest varint of a 32 bit value
+const size_t MAX_VARINT = 5;
+
+size_t put_varint(uint8_t* out, uint32_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+uint32_t zigzag(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t quantize(float value, int32_t scale)
+{
+    return static_cast<int32_t>(std::lround(value * scale));
+}
+}
+
+sensor_batch::sensor_batch()
+{
+    clear();
+}
+
+void sensor_batch::clear()
+{
+    bytes.fill(0);
+    bytes[0] = VERSION;
+    length = HEADER_SIZE;
+    count = 0;
+    first_us = 0;
+    last_us = 0;
+    for (std::array<int32_t, MAX_CHANNELS>& channels : previous)
+        channels.fill(0);
+}
+
+bool sensor_batch::add(kind k, uint64_t time_us, const int32_t* values, size_t n)
+{
+    if (k <= 0 || k >= NUM_KINDS || n > MAX_CHANNELS || count == 255)
+        return false;
+
+    if (count == 0)
+    {
+        first_us = time_us;
+        last_us = time_us;
+    }
+
+    // encode in to the stack first, the sample is only kept if it all fits
+    uint8_t sample[1 + MAX_VARINT * (1 + MAX_CHANNELS)];
+    size_t used = 0;
+    sample[used++] = k;
+    used += put_varint(sample + used, static_cast<uint32_t>(time_us - last_us));
+    for (size_t i = 0; i < n; ++i)
+        used += put_varint(sample + used, zigzag(values[i] - previous[k][i]));
+
+    if (length + used > CAPACITY)
+        return false;
+
+    memcpy(&bytes[length], sample, used);
+    length += used;
+    std::copy(values, values + n, previous[k].begin());
+    last_us = time_us;
+    ++count;
+
+    bytes[1] = static_cast<uint8_t>(count);
+    const uint32_t first = static_cast<uint32_t>(first_us);
+    for (size_t i = 0; i < 4; ++i)
+        bytes[2 + i] = static_cast<uint8_t>(first >> (8 * i));
+
+    return true;
+}
+
+bool sensor_batch::add_imu(uint64_t time_us, const std::array<float, 3>& gyro, const std::array<float, 3>& accel)
+{
+    const int32_t values[6] =
+    {
+        quantize(gyro[0], GYRO_SCALE), quantize(gyro[1], GYRO_SCALE), quantize(gyro[2], GYRO_SCALE),
+        quantize(accel[0], ACCEL_SCALE), quantize(accel[1], ACCEL_SCALE), quantize(accel[2], ACCEL_SCALE)
+    };
+    return add(IMU, time_us, values, 6);
+}
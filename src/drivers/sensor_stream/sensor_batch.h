@@ -0,0 +1,105 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef SENSOR_BATCH_H_
+#define SENSOR_BATCH_H_
+
+/* STL Headers */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Packs consecutive sensor samples in to one message payload
+ *
+ * The payload is a version byte, the number of samples and the time of the
+ * first sample in microseconds (32 bits, little endian), followed by the
+ * samples.  A sample is its kind, the microseconds since the previous sample
+ * and the difference of each channel from the previous sample of the same
+ * kind, all as zigzag varints (utils/sensor_stream.py decodes them).  The
+ * first sample of each kind in a batch is relative to zero so every batch
+ * decodes on its own.
+ *
+ * Gyro rates are sent in units of GYRO_SCALE per rad/s, accelerations in
+ * ACCEL_SCALE per g and pulse widths in microseconds.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class sensor_batch
+{
+public:
+    enum kind
+    {
+        /// gyro x, y, z then accel x, y, z
+        IMU = 1,
+        /// the nine commanded servo pulse widths
+        SERVO = 2,
+        /// the eight pilot input pulse widths
+        RC = 3,
+        NUM_KINDS
+    };
+
+    static const uint8_t VERSION = 1;
+    /// the data field of ENCAPSULATED_DATA
+    static const size_t CAPACITY = 253;
+    static const size_t MAX_CHANNELS = 9;
+    static const int32_t GYRO_SCALE = 10000;
+    static const int32_t ACCEL_SCALE = 10000;
+
+    sensor_batch();
+
+    /// @returns false if the sample does not fit, the batch should be sent and cleared first
+    bool add(kind k, uint64_t time_us, const int32_t* values, size_t count);
+
+    bool add_imu(uint64_t time_us, const std::array<float, 3>& gyro, const std::array<float, 3>& accel);
+
+    template <size_t N>
+    bool add_pulses(kind k, uint64_t time_us, const std::array<uint16_t, N>& widths)
+    {
+        static_assert(N <= MAX_CHANNELS, "too many channels for one sample");
+        int32_t values[N];
+        for (size_t i = 0; i < N; ++i)
+            values[i] = widths[i];
+        return add(k, time_us, values, N);
+    }
+
+    void clear();
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+    size_t samples() const
+    {
+        return count;
+    }
+    uint64_t first_time_us() const
+    {
+        return first_us;
+    }
+
+    /// the payload, always CAPACITY bytes with the unused end zeroed
+    const uint8_t* data() const
+    {
+        return bytes.data();
+    }
+    /// bytes of the payload in use
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    std::array<uint8_t, CAPACITY> bytes;
+    size_t length;
+    size_t count;
+    uint64_t first_us;
+    uint64_t last_us;
+    std::array<std::array<int32_t, MAX_CHANNELS>, NUM_KINDS> previous;
+};
+
+#endif
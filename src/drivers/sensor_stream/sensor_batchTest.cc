@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "sensor_batch.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace
+{
+uint32_t get_varint(const uint8_t* data, size_t& pos)
+{
+    uint32_t value = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        const uint8_t byte = data[pos++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (! (byte & 0x80))
+            return value;
+    }
+}
+
+int32_t unzigzag(uint32_t value)
+{
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+}
+
+// TESTS
+TEST(sensor_batch, ROUND_TRIP)
+{
+    sensor_batch batch;
+    std::array<uint16_t, 8> rc;
+    rc.fill(1500);
+
+    ASSERT_TRUE(batch.add_imu(1000, {{0.1f, -0.2f, 0.3f}}, {{0, 0, -1}}));
+    ASSERT_TRUE(batch.add_pulses(sensor_batch::RC, 1500, rc));
+    rc[3] = 1490;
+    ASSERT_TRUE(batch.add_pulses(sensor_batch::RC, 3500, rc));
+    ASSERT_TRUE(batch.add_imu(11000, {{0.1f, -0.21f, 0.3f}}, {{0, 0.01f, -1}}));
+    EXPECT_EQ(4u, batch.samples());
+
+    const uint8_t* data = batch.data();
+    EXPECT_EQ(sensor_batch::VERSION, data[0]);
+    EXPECT_EQ(4, data[1]);
+    EXPECT_EQ(1000u, data[2] | (data[3] << 8) | (data[4] << 16) | (data[5] << 24));
+
+    size_t pos = 6;
+    std::vector<int32_t> rc_values(8, 0);
+    std::vector<int32_t> imu_values(6, 0);
+    uint32_t time = 1000;
+    for (int sample = 0; sample < 4; ++sample)
+    {
+        const uint8_t kind = data[pos++];
+        time += get_varint(data, pos);
+        std::vector<int32_t>& values = kind == sensor_batch::IMU ? imu_values : rc_values;
+        for (int32_t& value : values)
+            value += unzigzag(get_varint(data, pos));
+    }
+    EXPECT_EQ(batch.size(), pos);
+    EXPECT_EQ(11000u, time);
+    EXPECT_EQ(1490, rc_values[3]);
+    EXPECT_EQ(1500, rc_values[7]);
+    EXPECT_EQ(-2100, imu_values[1]);
+    EXPECT_EQ(100, imu_values[4]);
+    EXPECT_EQ(-10000, imu_values[5]);
+}
+
+TEST(sensor_batch, FILLS_AND_CLEARS)
+{
+    sensor_batch batch;
+    std::array<uint16_t, 9> servo;
+    servo.fill(1500);
+
+    // small changes between samples cost about a byte a channel
+    size_t added = 0;
+    while (batch.add_pulses(sensor_batch::SERVO, added * 20000, servo))
+    {
+        ++added;
+        servo[added % 9] += 3;
+    }
+    EXPECT_GT(added, 15u);
+    EXPECT_LE(batch.size(), sensor_batch::CAPACITY);
+
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+    EXPECT_TRUE(batch.add_pulses(sensor_batch::SERVO, 0, servo));
+}
@@ -22,17 +22,23 @@
 /* c headers */
 #include <stdint.h>
 #include <bitset>
+#include <cmath>
 #include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 
 // stl headers
 #include "Debug.h"
 #include "LogFile.h"
 #include "heli.h"
 #include "SystemState.h"
+#include "RCTrans.h"
+#include "host_self_test.h"
 
 /* File Handling Headers */
 #include "servo_switch.h"
-#include "RateLimiter.h"
+#include "SensorStream.h"
+#include "deadline_watchdog.h"
 
 // As defined in section 4.2 of the February 2, 2007 SSC Manual
 enum ServoMessageID
@@ -58,14 +64,52 @@ const std::string SERVO_SERIAL_PORT_CONFIG_DEFAULT = "/dev/ttyS0";
 const std::string servo_switch::LOG_INPUT_PULSE_WIDTHS = "Input Pulse Widths";
 const std::string servo_switch::LOG_OUTPUT_PULSE_WIDTHS = "Output Pulse Widths";
 const std::string servo_switch::LOG_INPUT_RPM = "Engine RPM";
+const std::string servo_switch::LOG_LINK_STATISTICS = "Servo Switch Link";
+const std::string servo_switch::LOG_PILOT_LATENCY = "Pilot Latency";
+
+const size_t servo_switch::NUM_CHANNELS;
+
+namespace
+{
+/// pulse input frames between link statistics
+const uint32_t STATISTICS_FRAMES = 50;
+/// time between stick to servo latency reports
+const std::chrono::seconds LATENCY_REPORT(1);
+
+double thread_cpu_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+}
 
 
 servo_switch::servo_switch()
     : Driver("Servo Switch","servo"),
-      raw_inputs(9, 0),
-      raw_outputs(9, 0),
-      pilot_mode(heli::PILOT_UNKNOWN)
+      raw_outputs(),
+      output_min_interval(5),
+      output_refresh(20),
+      pilot_mode(heli::PILOT_UNKNOWN),
+      head_speed_ratio(1)
 {
+    configDescribe("head_speed_ratio",
+                   "> 0",
+                   "Main rotor revolutions per pulse of the engine speed input, used to track rotor harmonics.");
+    head_speed_ratio = configGetd("head_speed_ratio", 1.0);
+
+    configDescribe("output_min_interval_ms",
+                   ">= 0",
+                   "Least time between pulse commands, changed outputs wait this long after the last write.",
+                   "ms");
+    output_min_interval = std::chrono::milliseconds(configGeti("output_min_interval_ms", 5));
+
+    configDescribe("output_refresh_ms",
+                   "> 0",
+                   "Most time between pulse commands, unchanged outputs are written again this often.",
+                   "ms");
+    output_refresh = std::chrono::milliseconds(std::max(1, configGeti("output_refresh_ms", 20)));
+
     if(!isEnabled())
     {
         warning() << "Servo switch disabled!";
@@ -80,6 +124,8 @@ servo_switch::servo_switch()
         log->logHeader(LOG_INPUT_PULSE_WIDTHS, "CH1 CH2 CH3 CH4 CH5 CH6 CH7 CH8 CH9");
         log->logHeader(LOG_OUTPUT_PULSE_WIDTHS, "CH1 CH2 CH3 CH4 CH5 CH6 CH7 CH8 CH9");
         log->logHeader(LOG_INPUT_RPM, "RPM");
+        log->logHeader(LOG_LINK_STATISTICS, "Frames Bad_Checksums Skipped_Bytes CPU_us_Per_Frame Available_us");
+        log->logHeader(LOG_PILOT_LATENCY, "Changes p50_us p99_us max_us");
     }
     else
     {
@@ -91,14 +137,19 @@ void servo_switch::writeToSystemState()
 {
     SystemState *state = SystemState::getInstance();
 
-    auto vec = get_raw_inputs();
+    const input_record record = inputs.load();
     std::array<uint16_t, 8> raw;
-    std::copy_n(vec.begin(), 8, raw.begin());
+    std::copy_n(record.pulse.begin(), 8, raw.begin());
     state->servoRawInputs.set(raw, 0);
 
+    std::array<uint16_t, NUM_CHANNELS> outputs;
+    {
+        std::lock_guard<std::mutex> lock(raw_outputs_lock);
+        outputs = raw_outputs;
+    }
 
     state->state_lock.lock();
-    state->servo_raw_outputs = raw_outputs;
+    state->servo_raw_outputs.assign(outputs.begin(), outputs.end());
     state->servo_pilot_mode.store(pilot_mode.load());
     state->state_lock.unlock();
 }
@@ -131,77 +182,86 @@ void servo_switch::set_pilot_mode(heli::PILOT_MODE mode)
         pilot_mode = mode;
         message() << "Pilot mode changed to: " << heli::PILOT_MODE_DESCRIPTOR[mode];
         pilot_mode_changed(mode);
+        LogFile::getInstance()->sync();
     }
 }
 
-std::vector<uint8_t> servo_switch::compute_checksum(uint8_t id, uint8_t count, const std::vector<uint8_t>& payload)
-{
-    std::vector<uint8_t> checksum(2, 0);
-    checksum[0] = id + count;
-    checksum[1] = 2*id + count;
-
-    for (std::vector<uint8_t>::const_iterator it = payload.begin(); it != payload.end(); ++it)
-    {
-        checksum[0] += *it;
-        checksum[1] += checksum[0];
-    }
-    return checksum;
-}
-
 /* read_serial functions */
 void servo_switch::read_serial::read_data()
 {
     servo_switch* servo = servo_switch::getInstance();
+    LogFile* log = LogFile::getInstance();
+
+    const int fd_ser = servo->fd_ser1;
+    ssc_decoder decoder;
+    ssc_decoder::frame frame;
+
+    // link statistics since the last report
+    uint32_t pulse_frames = 0;
+    double cpu_us = 0;
+    double available_us = 0;
+    uint64_t bad_checksums = 0;
+    uint64_t skipped = 0;
 
-    int fd_ser = servo->fd_ser1;
-    std::vector<uint8_t> payload;
-    std::vector<uint8_t> checksum(2);
     while(! servo->terminateRequested())
     {
-        servo->trace() << "searching for header";
-        find_next_header();
-
-        // get message id
-        uint8_t id = 0;
-        int idb = servo->readDevice(fd_ser, &id, 1);
+        size_t space = 0;
+        uint8_t* buf = decoder.write_space(space);
+        const int amt = servo->readDevice(fd_ser, buf, space);
+        if (amt <= 0)
+        {
+            continue;
+        }
 
-        // get message count
-        uint8_t count = 0;
-        int ctb = servo->readDevice(fd_ser, &count, 1);
+        const std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+        const double cpu_start = thread_cpu_us();
 
-        // allocate space for message
-        payload.resize(count);
-        // get message payload
-        int pldb = servo->readDevice(fd_ser, &payload[0], count);
+        decoder.commit(amt);
+        while (decoder.next(frame))
+        {
+            parse_message(frame, received);
 
-        // zero checksum
-        checksum.assign(checksum.size(), 0);
-        // get checksum
-        servo->readDevice(fd_ser, &checksum[0], 2);
+            if (frame.id == PULSE_INPUTS)
+            {
+                ++pulse_frames;
+                available_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - received).count();
+            }
+        }
 
-        servo->trace() << "ID ("<< idb <<"): " << id << " Count("<< ctb <<"): " << count << " payload("<< pldb<< "): " << count;
+        cpu_us += thread_cpu_us() - cpu_start;
 
-        if (checksum == compute_checksum(id, count, payload))
-        {
-            servo->trace() << "parsing message";
-            parse_message(id, payload);
-        }
-        else
+        if (pulse_frames >= STATISTICS_FRAMES)
         {
-            servo->trace() << "bad checksum";
+            const std::array<double, 5> statistics = {{
+                    static_cast<double>(pulse_frames),
+                    static_cast<double>(decoder.bad_checksums() - bad_checksums),
+                    static_cast<double>(decoder.skipped() - skipped),
+                    cpu_us / pulse_frames,
+                    available_us / pulse_frames
+                }};
+            log->logData(LOG_LINK_STATISTICS, statistics);
+
+            pulse_frames = 0;
+            cpu_us = 0;
+            available_us = 0;
+            bad_checksums = decoder.bad_checksums();
+            skipped = decoder.skipped();
         }
     }
 }
 
-void servo_switch::read_serial::parse_message(uint8_t id, const std::vector<uint8_t>& payload)
+void servo_switch::read_serial::parse_message(const ssc_decoder::frame& frame, std::chrono::steady_clock::time_point received)
 {
     servo_switch* servo = getInstance();
 
-    switch (id)
+    switch (frame.id)
     {
     case STATUS:
     {
-        uint16_t status =  payload[1];
+        if (frame.count < 2)
+            break;
+
+        uint16_t status =  frame.payload[1];
         // shift right to get command channel state
         status = (status & 0x6) >> 1;
         /** Section 4.2.1.1 of Servo Switch/Controller Users Manual February 2, 2007
@@ -226,55 +286,64 @@ void servo_switch::read_serial::parse_message(uint8_t id, const std::vector<uint
     }
 
     case PULSE_INPUTS:
-        parse_pulse_inputs(payload);
+        parse_pulse_inputs(frame, received);
         break;
 
     case AUXILIARY_INPUTS:
-        parse_aux_inputs(payload);
+        parse_aux_inputs(frame);
         break;
 
     default:
-        servo->debug() << "Received unknown message from servo switch id: " << id;
+        servo->debug() << "Received unknown message from servo switch id: " << frame.id;
     }
 }
 
-void servo_switch::read_serial::parse_pulse_inputs(const std::vector<uint8_t>& payload)
+void servo_switch::read_serial::parse_pulse_inputs(const ssc_decoder::frame& frame, std::chrono::steady_clock::time_point received)
 {
     servo_switch* servo = getInstance();
-    servo->debug("Parsing pulse inputs");
     const uint16_t upper_limit = 2200;
     const uint16_t lower_limit = 800;
-    std::vector<uint16_t> pulse_inputs(getInstance()->get_raw_inputs());  // no need for more than 9 channels
-    uint16_t pulse_width = 0;
-    for (uint32_t i=1; i<payload.size()/2 && i < pulse_inputs.size(); i++)
+
+    if (frame.count < 2)
+        return;
+
+    // a channel out of range keeps its last good width
+    input_record record = servo->inputs.load();
+    for (uint32_t i=1; i<frame.count/2u && i < record.pulse.size(); i++)
     {
-        pulse_width = (static_cast<uint16_t>(payload[i*2]) << 8) + payload[i*2+1];
-        servo->debug("Got pulse input: ");
-        servo->debug() << "Input " << i << "Payload: " << pulse_width;
+        const uint16_t pulse_width = (static_cast<uint16_t>(frame.payload[i*2]) << 8) + frame.payload[i*2+1];
         if (pulse_width > lower_limit && pulse_width < upper_limit)
         {
-            pulse_inputs[i-1] = pulse_width;
+            record.pulse[i-1] = pulse_width;
         }
     }
     // treat ch8 differently
-    pulse_inputs[7] = (static_cast<uint16_t>(payload[0]) << 8) + payload[1];
-
-    getInstance()->set_raw_inputs(pulse_inputs);
-    LogFile *log = LogFile::getInstance();
-    log->logData(LOG_INPUT_PULSE_WIDTHS, pulse_inputs);
-    getInstance()->writeToSystemState();
-
+    record.pulse[7] = (static_cast<uint16_t>(frame.payload[0]) << 8) + frame.payload[1];
+    record.received = received;
+    ++record.frame;
+
+    servo->inputs.store(record);
+    RCTrans::publish(record);
+    LogFile::getInstance()->logData(LOG_INPUT_PULSE_WIDTHS, record.pulse);
+
+    std::array<uint16_t, 8> rc;
+    std::copy_n(record.pulse.begin(), rc.size(), rc.begin());
+    SensorStream::getInstance()->add_rc(rc);
+    servo->writeToSystemState();
 }
 
-void servo_switch::read_serial::parse_aux_inputs(const std::vector<uint8_t>& payload)
+void servo_switch::read_serial::parse_aux_inputs(const ssc_decoder::frame& frame)
 {
     servo_switch& ss = *servo_switch::getInstance();
 
+    if (frame.count < 4)
+        return;
 
-    std::bitset<8> meas_byte (payload[2]);
+    std::bitset<8> meas_byte (frame.payload[2]);
     if(meas_byte.test(7))
     {
         ss.debug("Time measurement over range");
+        SystemState::getInstance()->headSpeed_hz.set(0, 0);
         return ;
     }
 
@@ -282,78 +351,101 @@ void servo_switch::read_serial::parse_aux_inputs(const std::vector<uint8_t>& pay
     meas_byte.set(6,0);
 
     uint16_t time_measurement;
-    time_measurement = (static_cast<uint16_t>(meas_byte.to_ulong()) << 8) + payload[3];
+    time_measurement = (static_cast<uint16_t>(meas_byte.to_ulong()) << 8) + frame.payload[3];
 
     // TODO extract out these constants to meaningful variables - Joseph
     double speed = 1 / (time_measurement*32.0*0.000001);
-    std::vector<double> speeds;
-    speeds.push_back(speed);
-    speeds.push_back(speed);
+    if (!std::isfinite(speed) || speed <= 0)
+    {
+        ss.debug("Time measurement of zero");
+        SystemState::getInstance()->headSpeed_hz.set(0, 0);
+        return ;
+    }
+    const std::array<double, 2> speeds = {{speed, speed}};
 
     LogFile *log = LogFile::getInstance();
     log->logData(LOG_INPUT_RPM, speeds);
-    getInstance()->writeToSystemState();
+    SystemState::getInstance()->headSpeed_hz.set(speed * ss.head_speed_ratio, 0);
+    ss.writeToSystemState();
 }
 
-
-void servo_switch::read_serial::find_next_header()
-{
-    servo_switch* servo = servo_switch::getInstance();
-    servo->trace() << "Finding next header";
-    bool synchronized = false;
-    int fd_ser = servo->fd_ser1;
-
-    bool found_first_byte = false;
-    uint8_t buf;
-    while (!synchronized && !servo->terminateRequested())
-    {
-        servo->readDevice(fd_ser, &buf, 1);
-        if (buf == 0x81) // first byte of header
-            found_first_byte = true;
-        else if (buf == 0xA1 && found_first_byte)
-            synchronized = true;
-        else
-            found_first_byte = false;
-    }
-}
 /* send_serial functions */
 
 void servo_switch::send_serial::operator()()
 {
     servo_switch* servo = getInstance();
+    LogFile* log = LogFile::getInstance();
 
-    RateLimiter rl(50);
-    while(true)
-    {
-        rl.wait();
+    ssc_pulse_command command;
+    std::array<uint16_t, NUM_CHANNELS> outputs;
+    outputs.fill(0);
+    std::chrono::steady_clock::time_point last_write;
 
-        // Construct outgoing message.
-        std::vector<uint16_t> raw_outputs(servo->get_raw_outputs());
-        std::vector<uint8_t> pulse_message {0x81, 0xA1, 20};
+    // stick to servo latency of each frame that changed the outputs
+    std::chrono::steady_clock::time_point source;
+    std::chrono::steady_clock::time_point timed_source;
+    std::vector<double> latency_us;
+    latency_us.reserve(256);
+    std::chrono::steady_clock::time_point next_report = std::chrono::steady_clock::now() + LATENCY_REPORT;
 
-        pulse_message.push_back(raw_outputs.size() * 2);
-        for (uint32_t i = 0; i < raw_outputs.size(); i++)
+    while(! servo->terminateRequested())
+    {
         {
-            pulse_message.push_back(static_cast<uint8_t>(raw_outputs[i] >> 8));
-            pulse_message.push_back(static_cast<uint8_t>(raw_outputs[i] & 0xFF));
+            std::unique_lock<std::mutex> lock(servo->raw_outputs_lock);
+
+            const std::chrono::steady_clock::time_point earliest = last_write + servo->output_min_interval;
+            if (std::chrono::steady_clock::now() < earliest)
+            {
+                lock.unlock();
+                std::this_thread::sleep_until(earliest);
+                lock.lock();
+            }
+
+            // write as soon as the outputs change, or again when the refresh is due
+            servo->outputs_changed.wait_until(lock, last_write + servo->output_refresh, [&]()
+            {
+                return servo->raw_outputs != outputs;
+            });
+            outputs = servo->raw_outputs;
+            source = servo->outputs_source;
         }
 
-        std::vector<uint8_t> checksum = compute_checksum(20, raw_outputs.size() * 2,
-                                                         std::vector<uint8_t>(pulse_message.begin()+4,
-                                                                              pulse_message.end()));
-
-        pulse_message.push_back(checksum[0]);
-        pulse_message.push_back(checksum[1]);
-
-        // Log our data.
-        LogFile::getInstance()->logData(LOG_OUTPUT_PULSE_WIDTHS, raw_outputs);
+        deadline_watchdog::check_in("Servo send", servo->output_refresh);
+        const bool changed = command.set(outputs);
 
         // Send message to servo switch.
-        while (write(servo->fd_ser1, &pulse_message[0], pulse_message.size()) < 0)
+        size_t done = 0;
+        while (done < command.size() && ! servo->terminateRequested())
         {
-            servo->debug("Error sending pulse output message to servo switch");
+            const ssize_t amt = write(servo->fd_ser1, command.data() + done, command.size() - done);
+            if (amt < 0)
+            {
+                servo->debug("Error sending pulse output message to servo switch");
+                continue;
+            }
+            done += amt;
         }
+        last_write = std::chrono::steady_clock::now();
 
-        rl.finishedCriticalSection();
+        // only the first change computed from a frame is the pilot's
+        if (changed && source != timed_source && latency_us.size() < latency_us.capacity())
+        {
+            latency_us.push_back(std::chrono::duration<double, std::micro>(last_write - source).count());
+            timed_source = source;
+        }
+        if (last_write >= next_report)
+        {
+            const host_self_test::percentiles latency = host_self_test::percentiles::of(latency_us);
+            const std::array<double, 4> report = {{
+                    static_cast<double>(latency.count), latency.p50, latency.p99, latency.max
+                }};
+            log->logData(LOG_PILOT_LATENCY, report);
+            latency_us.clear();
+            next_report = last_write + LATENCY_REPORT;
+        }
+
+        // Log our data.
+        log->logData(LOG_OUTPUT_PULSE_WIDTHS, outputs);
+        SensorStream::getInstance()->add_servo(outputs);
     }
 }
@@ -22,10 +22,14 @@
 #define SERVO_SWITCH_H_
 
 /* STL Headers */
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <sys/types.h>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 
 #include <boost/signals2.hpp>
@@ -34,6 +38,8 @@
 #include "Driver.h"
 #include "heli.h"
 #include "Singleton.h"
+#include "seqlock.h"
+#include "ssc_frame.h"
 
 
 
@@ -48,6 +54,18 @@
  * control channel (pilot manual or pilot auto).
  * @date February 2012: Class creation
  * @date May 1, 2012: Added auxiliary input for engine speed
+ *
+ * The receive thread reads the port in bulk in to an ssc_decoder and
+ * publishes each set of pulse inputs as one input_record through a seqlock,
+ * so readers never block it.  The send thread keeps a ready PULSE_COMMAND
+ * frame and writes it as soon as the commanded outputs change, at most every
+ * servo.output_min_interval_ms, and at least every servo.output_refresh_ms.
+ *
+ * Each frame of pulse inputs is also scaled and published by RCTrans as it
+ * arrives.  The main loop tells setOutputSource() which frame the outputs it
+ * sets were computed from, and the send thread logs the time from that frame
+ * arriving to the first write that changed the outputs as the stick to servo
+ * latency.
  */
 class servo_switch : public Driver, public Singleton<servo_switch>
 {
@@ -56,6 +74,18 @@ public:
 
     virtual void writeToSystemState() override;
 
+    static const size_t NUM_CHANNELS = ssc_pulse_command::CHANNELS;
+
+    /// one set of pilot inputs
+    struct input_record
+    {
+        std::array<uint16_t, NUM_CHANNELS> pulse;
+        /// when the read holding the end of the frame returned
+        std::chrono::steady_clock::time_point received;
+        /// number of pulse input frames before this one
+        uint32_t frame;
+    };
+
     class read_serial
     {
     public:
@@ -66,11 +96,9 @@ public:
 
     private:
         void read_data();
-        void sync();
-        void parse_message(uint8_t id, const std::vector<uint8_t>& payload);
-        void parse_pulse_inputs(const std::vector<uint8_t>& payload);
-        void parse_aux_inputs(const std::vector<uint8_t>& payload);
-        void find_next_header();
+        void parse_message(const ssc_decoder::frame& frame, std::chrono::steady_clock::time_point received);
+        void parse_pulse_inputs(const ssc_decoder::frame& frame, std::chrono::steady_clock::time_point received);
+        void parse_aux_inputs(const ssc_decoder::frame& frame);
     };
 
     class send_serial
@@ -83,23 +111,49 @@ public:
      */
     std::vector<uint16_t> getRaw()
     {
-        return get_raw_inputs();
+        const input_record record = inputs.load();
+        return std::vector<uint16_t>(record.pulse.begin(), record.pulse.end());
     }
     uint16_t getRaw(heli::Channel ch)
     {
-        return get_raw_inputs()[ch];
+        return inputs.load().pulse[ch];
+    }
+    /// the latest pilot inputs with the time they arrived
+    input_record getInputs() const
+    {
+        return inputs.load();
     }
     /// set the value of the servo outputs
     void setRaw(const std::vector<uint16_t>& raw_outputs)
     {
-        set_raw_outputs(raw_outputs);
-        //writeToSystemState();
+        std::lock_guard<std::mutex> lock(raw_outputs_lock);
+        std::copy_n(raw_outputs.begin(), std::min(raw_outputs.size(), NUM_CHANNELS), this->raw_outputs.begin());
+        outputs_changed.notify_one();
     }
     inline void setRaw(heli::Channel ch, uint16_t pulse_width)
     {
         std::lock_guard<std::mutex> lock(raw_outputs_lock);
         raw_outputs[ch] = pulse_width;
-        //writeToSystemState();
+        outputs_changed.notify_one();
+    }
+    /// set the first N servo outputs (starting at heli::CH1) under a single lock
+    template <size_t N>
+    inline void setRaw(const std::array<uint16_t, N>& pulse_widths)
+    {
+        static_assert(N <= NUM_CHANNELS, "the servo switch has 9 outputs");
+        std::lock_guard<std::mutex> lock(raw_outputs_lock);
+        std::copy(pulse_widths.begin(), pulse_widths.end(), raw_outputs.begin());
+        outputs_changed.notify_one();
+    }
+
+    /**
+     * The pilot inputs received at received are what the next outputs set are
+     * computed from, for timing the stick to servo latency.
+     */
+    void setOutputSource(std::chrono::steady_clock::time_point received)
+    {
+        std::lock_guard<std::mutex> lock(raw_outputs_lock);
+        outputs_source = received;
     }
 
     /// signal with new mode as argument
@@ -115,6 +169,8 @@ private:
     static const std::string LOG_INPUT_PULSE_WIDTHS ;
     static const std::string LOG_OUTPUT_PULSE_WIDTHS ;
     static const std::string LOG_INPUT_RPM ;
+    static const std::string LOG_LINK_STATISTICS ;
+    static const std::string LOG_PILOT_LATENCY ;
 
 
     /// @returns true if the port was successfully set up, false otherwise
@@ -125,37 +181,24 @@ private:
     std::thread receive;
     std::thread send;
 
-    static std::vector<uint8_t> compute_checksum(uint8_t id, uint8_t count, const std::vector<uint8_t>& payload);
-
-    std::vector<uint16_t> raw_inputs;
-    std::mutex raw_inputs_lock;
-    inline std::vector<uint16_t> get_raw_inputs()
-    {
-        std::lock_guard<std::mutex> lock(raw_inputs_lock);
-        return raw_inputs;
-    }
-    inline void set_raw_inputs(const std::vector<uint16_t>& raw_inputs)
-    {
-        std::lock_guard<std::mutex> lock(raw_inputs_lock);
-        this->raw_inputs = raw_inputs;
-    }
+    seqlock<input_record> inputs;
 
-    std::vector<uint16_t> raw_outputs;
+    std::array<uint16_t, NUM_CHANNELS> raw_outputs;
+    /// arrival of the pilot inputs raw_outputs are computed from
+    std::chrono::steady_clock::time_point outputs_source;
     std::mutex raw_outputs_lock;
-    inline std::vector<uint16_t> get_raw_outputs()
-    {
-        std::lock_guard<std::mutex> lock(raw_outputs_lock);
-        return raw_outputs;
-    }
-    inline void set_raw_outputs(const std::vector<uint16_t>& raw_outputs)
-    {
-        std::lock_guard<std::mutex> lock(raw_outputs_lock);
-        this->raw_outputs = raw_outputs;
-    }
+    /// wakes the send thread when raw_outputs is written
+    std::condition_variable outputs_changed;
+
+    std::chrono::milliseconds output_min_interval;
+    std::chrono::milliseconds output_refresh;
 
     std::atomic<heli::PILOT_MODE> pilot_mode;
     void set_pilot_mode(heli::PILOT_MODE mode);
 
+    /// main rotor revolutions per pulse on the engine speed input
+    double head_speed_ratio;
+
 
 };
 
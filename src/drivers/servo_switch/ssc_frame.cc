@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "ssc_frame.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cstring>
+
+const size_t ssc_decoder::BUFFER_SIZE;
+const size_t ssc_decoder::MAX_PAYLOAD;
+const size_t ssc_pulse_command::CHANNELS;
+const uint8_t ssc_pulse_command::ID;
+const size_t ssc_pulse_command::SIZE;
+
+namespace
+{
+const uint8_t SYNC1 = 0x81;
+const uint8_t SYNC2 = 0xA1;
+/// sync bytes, id and count
+const size_t HEADER_SIZE = 4;
+const size_t CHECKSUM_SIZE = 2;
+}
+
+ssc_decoder::ssc_decoder()
+    : head(0),
+      tail(0),
+      _frames(0),
+      _bad_checksums(0),
+      _skipped(0)
+{
+}
+
+uint8_t* ssc_decoder::write_space(size_t& length)
+{
+    const size_t offset = tail & (BUFFER_SIZE - 1);
+    length = std::min(BUFFER_SIZE - (tail - head), BUFFER_SIZE - offset);
+    return &buffer[offset];
+}
+
+void ssc_decoder::commit(size_t length)
+{
+    tail += length;
+}
+
+size_t ssc_decoder::feed(const uint8_t* data, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        size_t space = 0;
+        uint8_t* out = write_space(space);
+        if (space == 0)
+            break;
+        space = std::min(space, length - done);
+        memcpy(out, data + done, space);
+        commit(space);
+        done += space;
+    }
+    return done;
+}
+
+void ssc_decoder::checksum(uint8_t id, uint8_t count, const uint8_t* payload, uint8_t* out)
+{
+    uint8_t a = id + count;
+    uint8_t b = 2 * id + count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        a += payload[i];
+        b += a;
+    }
+    out[0] = a;
+    out[1] = b;
+}
+
+bool ssc_decoder::next(frame& out)
+{
+    while (tail - head >= HEADER_SIZE)
+    {
+        if (peek(0) != SYNC1 || peek(1) != SYNC2)
+        {
+            ++head;
+            ++_skipped;
+            continue;
+        }
+
+        const uint8_t count = peek(3);
+        if (tail - head < HEADER_SIZE + count + CHECKSUM_SIZE)
+            return false;
+
+        out.id = peek(2);
+        out.count = count;
+        for (size_t i = 0; i < count; ++i)
+            out.payload[i] = peek(HEADER_SIZE + i);
+
+        uint8_t expected[CHECKSUM_SIZE];
+        checksum(out.id, count, out.payload.data(), expected);
+        if (expected[0] != peek(HEADER_SIZE + count) || expected[1] != peek(HEADER_SIZE + count + 1))
+        {
+            // a false header, look for the next one from the byte after it
+            ++head;
+            ++_bad_checksums;
+            continue;
+        }
+
+        head += HEADER_SIZE + count + CHECKSUM_SIZE;
+        ++_frames;
+        return true;
+    }
+    return false;
+}
+
+ssc_pulse_command::ssc_pulse_command()
+{
+    bytes.fill(0);
+    bytes[0] = SYNC1;
+    bytes[1] = SYNC2;
+    bytes[2] = ID;
+    bytes[3] = 2 * CHANNELS;
+    ssc_decoder::checksum(ID, 2 * CHANNELS, &bytes[HEADER_SIZE], &bytes[HEADER_SIZE + 2 * CHANNELS]);
+}
+
+bool ssc_pulse_command::set(const std::array<uint16_t, CHANNELS>& widths)
+{
+    bool changed = false;
+    for (size_t i = 0; i < CHANNELS; ++i)
+    {
+        const uint8_t high = widths[i] >> 8;
+        const uint8_t low = widths[i] & 0xFF;
+        uint8_t* field = &bytes[HEADER_SIZE + 2 * i];
+        changed |= field[0] != high || field[1] != low;
+        field[0] = high;
+        field[1] = low;
+    }
+
+    if (changed)
+        ssc_decoder::checksum(ID, 2 * CHANNELS, &bytes[HEADER_SIZE], &bytes[HEADER_SIZE + 2 * CHANNELS]);
+    return changed;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef SSC_FRAME_H_
+#define SSC_FRAME_H_
+
+/* STL Headers */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Finds servo switch frames in the bytes read from its serial port
+ *
+ * A frame is 0x81 0xA1, the message id, the payload length, the payload and
+ * the two byte checksum from section 4.2 of the SSC manual.  Bytes are read
+ * straight in to a ring buffer (write_space() and commit()) in whatever
+ * amounts the port gives them and next() takes the frames back out, skipping
+ * anything that is not a frame with a good checksum.  Nothing is allocated.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class ssc_decoder
+{
+public:
+    /// a power of two larger than the largest frame
+    static const size_t BUFFER_SIZE = 1024;
+    static const size_t MAX_PAYLOAD = 255;
+
+    struct frame
+    {
+        uint8_t id;
+        uint8_t count;
+        std::array<uint8_t, MAX_PAYLOAD> payload;
+    };
+
+    ssc_decoder();
+
+    /// @returns where the next read should go, length is set to the contiguous space there
+    uint8_t* write_space(size_t& length);
+    /// length bytes were read in to write_space()
+    void commit(size_t length);
+    /// copy bytes in, @returns the number that fit
+    size_t feed(const uint8_t* data, size_t length);
+
+    /// take the next good frame out of the buffer, @returns false if there is none yet
+    bool next(frame& out);
+
+    /// the two checksum bytes of a message
+    static void checksum(uint8_t id, uint8_t count, const uint8_t* payload, uint8_t* out);
+
+    uint64_t frames() const
+    {
+        return _frames;
+    }
+    uint64_t bad_checksums() const
+    {
+        return _bad_checksums;
+    }
+    /// bytes dropped while looking for a header
+    uint64_t skipped() const
+    {
+        return _skipped;
+    }
+
+private:
+    uint8_t peek(size_t offset) const
+    {
+        return buffer[(head + offset) & (BUFFER_SIZE - 1)];
+    }
+
+    std::array<uint8_t, BUFFER_SIZE> buffer;
+    /// free running read and write positions
+    size_t head;
+    size_t tail;
+
+    uint64_t _frames;
+    uint64_t _bad_checksums;
+    uint64_t _skipped;
+};
+
+/**
+ * @brief A PULSE_COMMAND frame kept ready to write
+ *
+ * The header never changes; set() rewrites only the pulse widths and the
+ * checksum, and only when a width changed.
+ */
+class ssc_pulse_command
+{
+public:
+    static const size_t CHANNELS = 9;
+    static const uint8_t ID = 20;
+    static const size_t SIZE = 4 + 2 * CHANNELS + 2;
+
+    ssc_pulse_command();
+
+    /// @returns true if the widths differ from the last ones set
+    bool set(const std::array<uint16_t, CHANNELS>& widths);
+
+    const uint8_t* data() const
+    {
+        return bytes.data();
+    }
+    size_t size() const
+    {
+        return bytes.size();
+    }
+
+private:
+    std::array<uint8_t, SIZE> bytes;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "ssc_frame.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+std::vector<uint8_t> make_frame(uint8_t id, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> frame = {0x81, 0xA1, id, static_cast<uint8_t>(payload.size())};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    uint8_t sum[2];
+    ssc_decoder::checksum(id, payload.size(), payload.data(), sum);
+    frame.push_back(sum[0]);
+    frame.push_back(sum[1]);
+    return frame;
+}
+}
+
+// TESTS
+TEST(ssc_decoder, SKIPS_NOISE_AND_BAD_FRAMES)
+{
+    std::vector<uint8_t> stream = {0x00, 0x81, 0x13, 0xA1};
+    const std::vector<uint8_t> good = make_frame(13, {1, 2, 3, 4});
+    std::vector<uint8_t> bad = make_frame(14, {5, 6, 7, 8});
+    bad[5] ^= 0xFF;
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), bad.begin(), bad.end());
+    stream.insert(stream.end(), good.begin(), good.end());
+
+    // a byte at a time, as a slow port would give them
+    ssc_decoder decoder;
+    ssc_decoder::frame frame;
+    int found = 0;
+    for (uint8_t byte : stream)
+    {
+        ASSERT_EQ(1u, decoder.feed(&byte, 1));
+        while (decoder.next(frame))
+        {
+            ++found;
+            EXPECT_EQ(13, frame.id);
+            ASSERT_EQ(4, frame.count);
+            EXPECT_EQ(4, frame.payload[3]);
+        }
+    }
+    EXPECT_EQ(2, found);
+    EXPECT_EQ(1u, decoder.bad_checksums());
+    EXPECT_EQ(2u, decoder.frames());
+}
+
+TEST(ssc_pulse_command, ENCODES_ONLY_CHANGES)
+{
+    ssc_pulse_command command;
+    std::array<uint16_t, ssc_pulse_command::CHANNELS> widths;
+    widths.fill(1500);
+    EXPECT_TRUE(command.set(widths));
+    EXPECT_FALSE(command.set(widths));
+    widths[8] = 2000;
+    EXPECT_TRUE(command.set(widths));
+
+    ssc_decoder decoder;
+    ssc_decoder::frame frame;
+    decoder.feed(command.data(), command.size());
+    ASSERT_TRUE(decoder.next(frame));
+    EXPECT_EQ(ssc_pulse_command::ID, frame.id);
+    EXPECT_EQ(2000, (frame.payload[16] << 8) | frame.payload[17]);
+}
+
+TEST(ssc_decoder, PTY_LATENCY_AND_CPU)
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(0, grantpt(master));
+    ASSERT_EQ(0, unlockpt(master));
+    const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    ASSERT_GE(slave, 0);
+
+    struct termios raw;
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+
+    // the servo switch sends its inputs at about 50 Hz, this is faster
+    const int FRAMES = 200;
+    std::vector<std::chrono::steady_clock::time_point> sent(FRAMES);
+    std::thread emulator([&]()
+    {
+        for (int i = 0; i < FRAMES; ++i)
+        {
+            const std::vector<uint8_t> frame = make_frame(13, std::vector<uint8_t>(18, static_cast<uint8_t>(i)));
+            sent[i] = std::chrono::steady_clock::now();
+            ASSERT_EQ(static_cast<ssize_t>(frame.size()), write(master, frame.data(), frame.size()));
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    ssc_decoder decoder;
+    ssc_decoder::frame frame;
+    std::vector<double> latency_us;
+    double cpu_ns = 0;
+    while (static_cast<int>(latency_us.size()) < FRAMES)
+    {
+        size_t space = 0;
+        uint8_t* buf = decoder.write_space(space);
+        const ssize_t amt = read(slave, buf, space);
+        ASSERT_GT(amt, 0);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        decoder.commit(amt);
+        while (decoder.next(frame))
+            latency_us.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - sent[frame.payload[0]]).count());
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        cpu_ns += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    }
+    emulator.join();
+    close(slave);
+    close(master);
+
+    std::sort(latency_us.begin(), latency_us.end());
+    RecordProperty("latency_p50_us", static_cast<int>(latency_us[FRAMES / 2]));
+    RecordProperty("decode_cpu_ns_per_frame", static_cast<int>(cpu_ns / FRAMES));
+    EXPECT_EQ(0u, decoder.bad_checksums());
+    EXPECT_LT(latency_us[FRAMES / 2], 5000);
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "Watchdog.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <sstream>
+
+/* Project Headers */
+#include "LogFile.h"
+#include "RateLimiter.h"
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+
+/* System Headers */
+#include <signal.h>
+
+const std::string Watchdog::LOG_WATCHDOG = "Watchdog";
+
+Watchdog::Watchdog()
+    : Driver("Watchdog", "watchdog")
+{
+    configDescribe("check_hz",
+                   "1 - 1000",
+                   "Rate the check ins are polled at, a stall is noticed at most one poll late.",
+                   "hz");
+    check_hz = std::min(1000, std::max(1, configGeti("check_hz", 200)));
+
+    configDescribe("slack",
+                   ">= 0",
+                   "Fraction of its period a thread may check in late before it is stalled.");
+    slack = configGetd("slack", 0.5);
+
+    configDescribe("capture_timeout_ms",
+                   ">= 0",
+                   "Time to wait for a stalled thread to record its stack.",
+                   "ms");
+    capture_timeout = std::chrono::milliseconds(configGeti("capture_timeout_ms", 20));
+
+    configDescribe("failsafe_threads",
+                   "comma separated list of thread names",
+                   "Threads whose stall switches the servos to direct manual.");
+    const std::string names = configGets("failsafe_threads", "");
+    boost::split(failsafe_threads, names, boost::is_any_of(","));
+    for (std::string& name : failsafe_threads)
+        boost::algorithm::trim(name);
+    failsafe_threads.erase(std::remove(failsafe_threads.begin(), failsafe_threads.end(), std::string()),
+                           failsafe_threads.end());
+
+    if (! isEnabled())
+        return;
+
+    if (! deadline_watchdog::install(SIGRTMIN + 4))
+        warning() << "Could not install the stack capture handler, stalls will be logged without stacks";
+
+    LogFile::getInstance()->logHeader(LOG_WATCHDOG, "Event Thread Period_ms Late_ms Check_ins State Stack");
+
+    monitor_thread = std::thread(&Watchdog::monitor, this);
+    monitor_thread.detach();
+}
+
+void Watchdog::monitor()
+{
+    RateLimiter rl(check_hz);
+    LogFile* log = LogFile::getInstance();
+
+    std::vector<deadline_watchdog::stall> stalls;
+    std::vector<deadline_watchdog::recovery> recovered;
+
+    while (! terminateRequested())
+    {
+        rl.wait();
+
+        deadline_watchdog::poll(slack, capture_timeout, stalls, recovered);
+
+        for (const deadline_watchdog::stall& stall : stalls)
+        {
+            const double period_ms = std::chrono::duration<double, std::milli>(stall.period).count();
+            const double late_ms = std::chrono::duration<double, std::milli>(stall.overdue).count();
+
+            std::stringstream line;
+            line << "stall\t" << stall.name << '\t' << period_ms << '\t' << late_ms << '\t'
+                 << stall.check_ins << '\t' << stall.state << '\t'
+                 << (stall.stack.empty() ? std::string("not captured") : boost::algorithm::join(stall.stack, " | "));
+            log->logMessage(LOG_WATCHDOG, line.str());
+
+            warning() << stall.name << " missed its " << period_ms << " ms deadline (" << stall.state << ")";
+
+            if (std::find(failsafe_threads.begin(), failsafe_threads.end(), stall.name) != failsafe_threads.end())
+                failsafe(stall.name);
+        }
+
+        for (const deadline_watchdog::recovery& recovery : recovered)
+        {
+            const double stalled_ms = std::chrono::duration<double, std::milli>(recovery.stalled_for).count();
+
+            std::stringstream line;
+            line << "recovered\t" << recovery.name << "\t\t" << stalled_ms;
+            log->logMessage(LOG_WATCHDOG, line.str());
+
+            warning() << recovery.name << " checked in again after " << stalled_ms << " ms";
+        }
+
+        rl.finishedCriticalSection();
+    }
+}
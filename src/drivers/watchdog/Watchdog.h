@@ -0,0 +1,60 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+/* STL Headers */
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Project Headers */
+#include "Driver.h"
+#include "Singleton.h"
+#include "deadline_watchdog.h"
+
+/* Boost Headers */
+#include <boost/signals2.hpp>
+
+/**
+ * Watches the threads that check in with deadline_watchdog and logs the
+ * ones that miss their deadline.
+ *
+ * Every watchdog.check_hz the monitor thread polls the check ins; a thread
+ * more than watchdog.slack periods late has its stack, kernel state and
+ * wait channel written to LOG_WATCHDOG along with how late it is, and a
+ * second line when it checks in again says how long it was gone.  A stall
+ * of a thread named in watchdog.failsafe_threads raises failsafe.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class Watchdog : public Driver, public Singleton<Watchdog>
+{
+    friend class Singleton<Watchdog>;
+
+public:
+    static const std::string LOG_WATCHDOG;
+
+    /// raised from the monitor thread with the name of a stalled failsafe thread
+    boost::signals2::signal<void (const std::string&)> failsafe;
+
+private:
+    Watchdog();
+
+    /// poll the check ins until terminated
+    void monitor();
+
+    int check_hz;
+    double slack;
+    std::chrono::milliseconds capture_timeout;
+    std::vector<std::string> failsafe_threads;
+
+    std::thread monitor_thread;
+};
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "WaypointManager.h"
 #include "mavlink_types.h"
+#include <algorithm>
 #include <sys/time.h>
 #include <time.h>
 
@@ -101,7 +102,7 @@ void WaypointManager::teardown()
     // notify QGC that we are going down?
 }
 
-void WaypointManager::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber)
+void WaypointManager::sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber)
 {
     if(! isEnabled()) return;
 
@@ -109,14 +110,15 @@ void WaypointManager::sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int u
     if(shouldSendMavlinkMessage(msgNumber, sendRateHz, 5)) // limit to 5 hz then burst all messages
     {
         std::lock_guard<std::mutex> lock(_messageQueueLock);
-        for(mavlink_message_t& msg : _messageQueue)
+        // at most the slots this driver reserved, the rest go with the next burst
+        const size_t count = std::min(_messageQueue.size(), std::min(mavlinkMsgCapacity(), msgs.remaining()));
+        for(size_t i = 0; i < count; i++)
         {
-            debug() << "sending message with id: " << msg.msgid;
-            msgs.push_back(msg);
-
+            debug() << "sending message with id: " << _messageQueue[i].msgid;
+            msgs.push_back(_messageQueue[i]);
         }
 
-        _messageQueue.empty();
+        _messageQueue.erase(_messageQueue.begin(), _messageQueue.begin() + count);
     }
 };
 
@@ -26,7 +26,9 @@ public:
     /**
     Returns the one allowed instance of this Driver
     **/
-    virtual void sendMavlinkMsg(std::vector<mavlink_message_t>& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    virtual void sendMavlinkMsg(mavlink_arena& msgs, int uasId, int sendRateHz, int msgNumber) override;
+    /// the most queued messages sent in one burst
+    virtual size_t mavlinkMsgCapacity() override {return 16;}
     virtual bool recvMavlinkMsg(const mavlink_message_t& msg) override;
 
 
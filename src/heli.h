@@ -54,6 +54,7 @@ enum COMPONENT_ID
     NOVATEL_ID = 60,
     HELICOPTER_ID = 70,
     ALTIMETER_ID = 80,
+    LOGGER_ID = 90,
     NUM_COMPONENT_IDS
 };
 
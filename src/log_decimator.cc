@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "log_decimator.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <sstream>
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+
+const uint32_t log_decimator::PRODUCER_SAMPLE;
+
+log_decimator::log_decimator()
+    : _mode(FULL),
+      _n(1),
+      _period_us(1000000),
+      aggregates(MIN | MAX | MEAN | LAST),
+      _generation(0),
+      _producer_ns(0),
+      calls(0),
+      count(0),
+      window_mode(FULL)
+{
+}
+
+log_decimator::mode log_decimator::parse_mode(const std::string& name)
+{
+    if (name == "nth")
+        return EVERY_NTH;
+    if (name == "aggregate")
+        return AGGREGATE;
+    return FULL;
+}
+
+std::string log_decimator::mode_name(mode m)
+{
+    switch (m)
+    {
+    case EVERY_NTH:
+        return "nth";
+    case AGGREGATE:
+        return "aggregate";
+    default:
+        return "full";
+    }
+}
+
+int log_decimator::parse_aggregates(const std::string& list)
+{
+    std::vector<std::string> strs;
+    boost::split(strs, list, boost::is_any_of(","));
+
+    int flags = 0;
+    for (std::string& s : strs)
+    {
+        boost::algorithm::trim(s);
+        if (s == "min")
+            flags |= MIN;
+        else if (s == "max")
+            flags |= MAX;
+        else if (s == "mean")
+            flags |= MEAN;
+        else if (s == "last")
+            flags |= LAST;
+    }
+    return flags ? flags : (MIN | MAX | MEAN | LAST);
+}
+
+void log_decimator::set_mode(mode m)
+{
+    if (m >= NUM_MODES)
+        m = FULL;
+    if (_mode.exchange(m) != m)
+        ++_generation;
+}
+
+void log_decimator::set_n(uint32_t n)
+{
+    _n = std::max<uint32_t>(1, n);
+}
+
+void log_decimator::set_period(double seconds)
+{
+    _period_us = std::max<int64_t>(1000, static_cast<int64_t>(seconds * 1e6));
+}
+
+void log_decimator::set_aggregates(int flags)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    aggregates = flags;
+}
+
+std::string log_decimator::header(const std::string& columns) const
+{
+    if (_mode != AGGREGATE)
+        return columns;
+
+    std::vector<std::string> names;
+    boost::split(names, columns, boost::is_any_of(" \t,"), boost::token_compress_on);
+
+    std::string result;
+    const std::pair<int, const char*> suffixes[] = {{MIN, "_min"}, {MAX, "_max"}, {MEAN, "_mean"}, {LAST, "_last"}};
+    for (const std::string& name : names)
+    {
+        if (name.empty())
+            continue;
+        for (const auto& suffix : suffixes)
+        {
+            if (aggregates & suffix.first)
+                result += (result.empty() ? "" : " ") + name + suffix.second;
+        }
+    }
+    return result + " Samples";
+}
+
+std::string log_decimator::describe() const
+{
+    std::ostringstream out;
+    out << mode_name(_mode);
+    if (_mode == EVERY_NTH)
+        out << '/' << _n;
+    else if (_mode == AGGREGATE)
+        out << '/' << get_period() << 's';
+    return out.str();
+}
+
+void log_decimator::start_window(clock::time_point now)
+{
+    window_end = now + std::chrono::microseconds(_period_us.load());
+    std::fill(minimum.begin(), minimum.end(), std::numeric_limits<double>::max());
+    std::fill(maximum.begin(), maximum.end(), -std::numeric_limits<double>::max());
+    std::fill(sum.begin(), sum.end(), 0);
+    count = 0;
+}
+
+void log_decimator::summarize(std::vector<double>& summary)
+{
+    summary.clear();
+    for (size_t column = 0; column < sum.size(); ++column)
+    {
+        if (aggregates & MIN)
+            summary.push_back(minimum[column]);
+        if (aggregates & MAX)
+            summary.push_back(maximum[column]);
+        if (aggregates & MEAN)
+            summary.push_back(sum[column] / count);
+        if (aggregates & LAST)
+            summary.push_back(last_value[column]);
+    }
+    summary.push_back(count);
+}
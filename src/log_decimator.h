@@ -0,0 +1,201 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef LOG_DECIMATOR_H_
+#define LOG_DECIMATOR_H_
+
+/* STL Headers */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Decides which rows of a log channel are written
+ *
+ * Evaluated by the thread calling LogFile::logData() before the row is
+ * formatted, so dropped rows cost one atomic load (FULL) or a counter
+ * (EVERY_NTH).  AGGREGATE keeps the minimum, maximum, sum and last value of
+ * every column and writes one summary row per period with the selected
+ * aggregates of each column in turn.
+ *
+ * The mode, n and period may be changed at any time (e.g. from a PARAM_SET);
+ * a mode change bumps generation() so the writer can emit the new header.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class log_decimator
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    enum mode
+    {
+        FULL = 0,
+        EVERY_NTH = 1,
+        AGGREGATE = 2,
+        NUM_MODES
+    };
+
+    enum aggregate
+    {
+        MIN = 1,
+        MAX = 2,
+        MEAN = 4,
+        LAST = 8
+    };
+
+    /// what to do with a row given to admit()
+    enum decision
+    {
+        SKIP,
+        RAW,
+        SUMMARY
+    };
+
+    log_decimator();
+
+    /// parse "full", "nth" or "aggregate", FULL if unknown
+    static mode parse_mode(const std::string& name);
+    /// the name parse_mode() takes for m
+    static std::string mode_name(mode m);
+    /// parse a comma separated list of min, max, mean and last
+    static int parse_aggregates(const std::string& list);
+
+    void set_mode(mode m);
+    /// keep every nth row in EVERY_NTH
+    void set_n(uint32_t n);
+    /// length of an AGGREGATE window
+    void set_period(double seconds);
+    /// aggregate flags, set before the first row
+    void set_aggregates(int flags);
+
+    mode get_mode() const
+    {
+        return _mode;
+    }
+    uint32_t get_n() const
+    {
+        return _n;
+    }
+    double get_period() const
+    {
+        return _period_us / 1e6;
+    }
+    uint32_t generation() const
+    {
+        return _generation;
+    }
+
+    /// the column names of the rows this policy writes, given the channel's header
+    std::string header(const std::string& columns) const;
+    /// short description for reports: full, nth/10 or aggregate/0.5s
+    std::string describe() const;
+
+    /**
+     * Offer a row.
+     * @param summary filled with the aggregated row when SUMMARY is returned
+     * @param now the time of the row, read from the clock only in AGGREGATE if not given
+     */
+    template <typename InputIterator>
+    decision admit(InputIterator first, InputIterator last, std::vector<double>& summary,
+                   clock::time_point now = clock::time_point());
+
+    /// @returns true for one in PRODUCER_SAMPLE calls, the ones that should be timed
+    bool sample_producer()
+    {
+        return (++calls % PRODUCER_SAMPLE) == 0;
+    }
+    static const uint32_t PRODUCER_SAMPLE = 16;
+
+    /// time a sampled call spent deciding and formatting, for the cost report
+    void add_producer_time(std::chrono::nanoseconds spent)
+    {
+        _producer_ns += spent.count() * PRODUCER_SAMPLE;
+    }
+    uint64_t producer_ns() const
+    {
+        return _producer_ns;
+    }
+
+private:
+    void start_window(clock::time_point now);
+    void summarize(std::vector<double>& summary);
+
+    std::atomic<mode> _mode;
+    std::atomic<uint32_t> _n;
+    std::atomic<int64_t> _period_us;
+    int aggregates;
+    std::atomic<uint32_t> _generation;
+    std::atomic<uint64_t> _producer_ns;
+    std::atomic<uint32_t> calls;
+
+    std::mutex lock;
+    uint32_t count;
+    mode window_mode;
+    clock::time_point window_end;
+    std::vector<double> minimum;
+    std::vector<double> maximum;
+    std::vector<double> sum;
+    std::vector<double> last_value;
+};
+
+template <typename InputIterator>
+log_decimator::decision log_decimator::admit(InputIterator first, InputIterator last, std::vector<double>& summary, clock::time_point now)
+{
+    const mode m = _mode;
+    if (m == FULL)
+        return RAW;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (m != window_mode)
+    {
+        window_mode = m;
+        count = 0;
+        window_end = clock::time_point();
+    }
+
+    if (m == EVERY_NTH)
+        return (count++ % _n == 0) ? RAW : SKIP;
+
+    if (now == clock::time_point())
+        now = clock::now();
+    if (window_end == clock::time_point())
+        start_window(now);
+
+    size_t column = 0;
+    for (InputIterator it = first; it != last; ++it, ++column)
+    {
+        const double value = *it;
+        if (column == sum.size())
+        {
+            minimum.push_back(std::numeric_limits<double>::max());
+            maximum.push_back(-std::numeric_limits<double>::max());
+            sum.push_back(0);
+            last_value.push_back(0);
+        }
+        if (value < minimum[column])
+            minimum[column] = value;
+        if (value > maximum[column])
+            maximum[column] = value;
+        sum[column] += value;
+        last_value[column] = value;
+    }
+    ++count;
+
+    if (now < window_end)
+        return SKIP;
+
+    summarize(summary);
+    start_window(now);
+    return SUMMARY;
+}
+
+#endif
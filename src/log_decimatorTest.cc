@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "log_decimator.h"
+#include <array>
+#include <gtest/gtest.h>
+
+// TESTS
+TEST(log_decimator, EVERY_NTH)
+{
+    log_decimator d;
+    std::vector<double> summary;
+    std::array<float, 2> row = {{1, 2}};
+
+    EXPECT_EQ(log_decimator::RAW, d.admit(row.begin(), row.end(), summary));
+
+    d.set_mode(log_decimator::EVERY_NTH);
+    d.set_n(3);
+    EXPECT_EQ(1u, d.generation());
+    int kept = 0;
+    for (int i = 0; i < 9; ++i)
+        kept += d.admit(row.begin(), row.end(), summary) == log_decimator::RAW;
+    EXPECT_EQ(3, kept);
+    EXPECT_EQ("A B", d.header("A B"));
+    EXPECT_EQ("nth/3", d.describe());
+}
+
+TEST(log_decimator, AGGREGATE)
+{
+    log_decimator d;
+    d.set_mode(log_decimator::AGGREGATE);
+    d.set_period(0.1);
+    d.set_aggregates(log_decimator::parse_aggregates("min, max,mean"));
+    EXPECT_EQ("X_min X_max X_mean Y_min Y_max Y_mean Samples", d.header("X Y"));
+
+    const log_decimator::clock::time_point start = log_decimator::clock::now();
+    std::vector<double> summary;
+    for (int i = 0; i < 10; ++i)
+    {
+        std::vector<int> row = {i, -i};
+        ASSERT_EQ(log_decimator::SKIP, d.admit(row.begin(), row.end(), summary, start + std::chrono::milliseconds(10 * i)));
+    }
+    std::vector<int> row = {10, -10};
+    ASSERT_EQ(log_decimator::SUMMARY, d.admit(row.begin(), row.end(), summary, start + std::chrono::milliseconds(100)));
+    const std::vector<double> expected = {0, 10, 5, -10, 0, -5, 11};
+    EXPECT_EQ(expected, summary);
+}
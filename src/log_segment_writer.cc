@@ -0,0 +1,309 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "log_segment_writer.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/* Boost Headers */
+#include <boost/algorithm/string.hpp>
+
+/* System Headers */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t log_segment_writer::LATENCY_SAMPLES;
+const size_t log_segment_writer::DIRECT_ALIGNMENT;
+
+namespace
+{
+const size_t STAGING_BYTES = 64 * 1024;
+
+/// the file offset of this segment's last byte is made durable by raising durable to end
+void close_segment(int fd, uint64_t length, bool sync, std::atomic<uint64_t>* durable, uint64_t end)
+{
+    // give back what was preallocated and drop direct mode's padding
+    if (ftruncate(fd, length) != 0)
+        sync = false;
+    if (sync && fdatasync(fd) == 0)
+    {
+        uint64_t current = *durable;
+        while (current < end && !durable->compare_exchange_weak(current, end))
+            ;
+    }
+    ::close(fd);
+}
+}
+
+log_segment_writer::options::options()
+    : segment_bytes(64 * 1024 * 1024),
+      preallocate(true),
+      direct(false),
+      sync(SYNC_SEGMENT | SYNC_PERIODIC | SYNC_REQUESTED),
+      sync_seconds(5)
+{
+}
+
+int log_segment_writer::parse_sync_policy(const std::string& list)
+{
+    std::vector<std::string> strs;
+    boost::split(strs, list, boost::is_any_of(","));
+
+    int policy = SYNC_NONE;
+    for (std::string& s : strs)
+    {
+        boost::algorithm::trim(s);
+        if (s == "segment")
+            policy |= SYNC_SEGMENT;
+        else if (s == "periodic")
+            policy |= SYNC_PERIODIC;
+        else if (s == "requested")
+            policy |= SYNC_REQUESTED;
+    }
+    return policy;
+}
+
+std::string log_segment_writer::segment_name(const std::string& path, size_t segment)
+{
+    if (segment == 0)
+        return path;
+
+    const size_t slash = path.rfind('/');
+    const size_t dot = path.rfind('.');
+    const std::string number = "." + std::to_string(segment);
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + number;
+    return path.substr(0, dot) + number + path.substr(dot);
+}
+
+log_segment_writer::log_segment_writer(const std::string& path, const options& opts, const std::string& header)
+    : base_path(path),
+      header(header),
+      opts(opts),
+      fd(-1),
+      segment(0),
+      alignment(1),
+      staging(nullptr),
+      staging_size(STAGING_BYTES),
+      staged(0),
+      staged_offset(0),
+      segment_length(0),
+      _accepted(0),
+      _durable(0),
+      last_sync(clock::now()),
+      latencies(LATENCY_SAMPLES, 0),
+      latency_count(0),
+      sorted(LATENCY_SAMPLES)
+{
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, DIRECT_ALIGNMENT, staging_size) == 0)
+        staging = static_cast<char*>(buffer);
+
+    open();
+}
+
+log_segment_writer::~log_segment_writer()
+{
+    close();
+    free(staging);
+}
+
+void log_segment_writer::open()
+{
+    current_path = segment_name(base_path, segment);
+    staged = 0;
+    segment_length = 0;
+    alignment = 1;
+
+    if (staging == nullptr)
+        return;
+
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+#ifdef O_DIRECT
+    if (opts.direct)
+    {
+        fd = ::open(current_path.c_str(), flags | O_DIRECT, 0644);
+        alignment = DIRECT_ALIGNMENT;
+    }
+#endif
+    // not every filesystem takes O_DIRECT
+    if (fd < 0)
+    {
+        fd = ::open(current_path.c_str(), flags, 0644);
+        alignment = 1;
+    }
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+        segment_length = st.st_size;
+
+    // appending to an existing file in direct mode needs an aligned end
+    if (alignment > 1 && segment_length % alignment != 0)
+    {
+        ::close(fd);
+        fd = ::open(current_path.c_str(), flags, 0644);
+        alignment = 1;
+        if (fd < 0)
+            return;
+    }
+    staged_offset = segment_length;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    if (opts.preallocate && opts.segment_bytes > segment_length)
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, segment_length, opts.segment_bytes - segment_length);
+#endif
+
+    if (segment_length == 0 && !header.empty())
+    {
+        const size_t length = std::min(header.size(), staging_size);
+        memcpy(staging, header.data(), length);
+        staged = length;
+        segment_length = length;
+        _accepted += length;
+        flush();
+    }
+}
+
+bool log_segment_writer::flush()
+{
+    if (fd < 0)
+        return false;
+    if (staged == 0)
+        return true;
+
+    // direct writes go out in whole blocks, pad the last one with zeros
+    const size_t padded = (staged + alignment - 1) / alignment * alignment;
+    memset(staging + staged, 0, padded - staged);
+
+    size_t done = 0;
+    while (done < padded)
+    {
+        const ssize_t amt = pwrite(fd, staging + done, padded - done, staged_offset + done);
+        if (amt <= 0)
+            return false;
+        done += amt;
+    }
+
+#ifdef SYNC_FILE_RANGE_WRITE
+    // start the writeback now so a later fdatasync has little left to do
+    if (alignment == 1)
+        sync_file_range(fd, staged_offset, staged, SYNC_FILE_RANGE_WRITE);
+#endif
+
+    // the partial block is written again, with more data, next time
+    const size_t keep = staged % alignment;
+    memmove(staging, staging + (staged - keep), keep);
+    staged_offset += staged - keep;
+    staged = keep;
+    return true;
+}
+
+bool log_segment_writer::write(const std::string& data, clock::time_point now)
+{
+    if (fd < 0)
+        return false;
+
+    const clock::time_point start = clock::now();
+
+    if (opts.segment_bytes > 0 && segment_length > header.size() &&
+            segment_length + data.size() > opts.segment_bytes)
+    {
+        close_async();
+        ++segment;
+        open();
+        if (fd < 0)
+            return false;
+    }
+
+    bool ok = true;
+    size_t done = 0;
+    while (ok && done < data.size())
+    {
+        const size_t length = std::min(data.size() - done, staging_size - staged);
+        memcpy(staging + staged, data.data() + done, length);
+        staged += length;
+        done += length;
+        ok = flush();
+    }
+    segment_length += done;
+    _accepted += done;
+
+    latencies[latency_count++ % LATENCY_SAMPLES] =
+        std::chrono::duration<float, std::micro>(clock::now() - start).count();
+
+    if ((opts.sync & SYNC_PERIODIC) && std::chrono::duration<double>(now - last_sync).count() >= opts.sync_seconds)
+    {
+        last_sync = now;
+        sync();
+    }
+
+    return ok;
+}
+
+void log_segment_writer::sync_requested()
+{
+    if (opts.sync & SYNC_REQUESTED)
+        sync();
+}
+
+void log_segment_writer::sync()
+{
+    if (closing.valid())
+        closing.wait();
+    if (fd >= 0 && fdatasync(fd) == 0)
+        _durable = _accepted;
+}
+
+void log_segment_writer::close_async()
+{
+    if (fd < 0)
+        return;
+
+    if (closing.valid())
+        closing.wait();
+
+    flush();
+    closing = std::async(std::launch::async, close_segment, fd, segment_length, (opts.sync & SYNC_SEGMENT) != 0,
+                         &_durable, _accepted);
+    fd = -1;
+}
+
+void log_segment_writer::close()
+{
+    close_async();
+    if (closing.valid())
+        closing.wait();
+}
+
+double log_segment_writer::latency_percentile(double p) const
+{
+    const size_t n = std::min(latency_count, LATENCY_SAMPLES);
+    if (n == 0)
+        return 0;
+
+    std::copy(latencies.begin(), latencies.begin() + n, sorted.begin());
+    const size_t rank = std::min(n - 1, static_cast<size_t>(p * n));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + n);
+    return sorted[rank];
+}
+
+double log_segment_writer::latency_max() const
+{
+    const size_t n = std::min(latency_count, LATENCY_SAMPLES);
+    return n == 0 ? 0 : *std::max_element(latencies.begin(), latencies.begin() + n);
+}
+
+void log_segment_writer::clear_latency()
+{
+    latency_count = 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef LOG_SEGMENT_WRITER_H_
+#define LOG_SEGMENT_WRITER_H_
+
+/* STL Headers */
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes a log channel as a series of fixed size segment files
+ *
+ * The first segment is the path given to the constructor, later ones insert
+ * the segment number before the extension (name.dat, name.1.dat, ...).
+ * Every segment starts with the header so it can be read on its own.
+ *
+ * Each segment is preallocated with fallocate() so appending does not wait
+ * on the filesystem finding blocks.  With direct set writes bypass the page
+ * cache through O_DIRECT in whole, aligned blocks; the last partial block is
+ * padded with zeros until the segment is closed and truncated.
+ *
+ * Written data is handed to the kernel with sync_file_range() as soon as it
+ * is written and made durable with fdatasync() when the sync policy says:
+ * when a segment is finished, every sync_seconds and/or when
+ * sync_requested() is called on mode changes.  Finished segments are closed
+ * on another thread so rotating does not stall the caller.
+ *
+ * accepted() - durable() is what a power cut would lose right now.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class log_segment_writer
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    enum sync_policy
+    {
+        SYNC_NONE = 0,
+        SYNC_SEGMENT = 1,
+        SYNC_PERIODIC = 2,
+        SYNC_REQUESTED = 4
+    };
+
+    struct options
+    {
+        options();
+
+        /// size a segment is rotated at, 0 for one segment
+        size_t segment_bytes;
+        bool preallocate;
+        bool direct;
+        /// sync_policy flags
+        int sync;
+        double sync_seconds;
+    };
+
+    /// parse a comma separated list of "segment", "periodic" and "requested"
+    static int parse_sync_policy(const std::string& list);
+
+    /// number of write latencies kept for the percentiles
+    static const size_t LATENCY_SAMPLES = 1024;
+    static const size_t DIRECT_ALIGNMENT = 4096;
+
+    /// @param header the first line of every segment
+    log_segment_writer(const std::string& path, const options& opts, const std::string& header = "");
+    ~log_segment_writer();
+
+    /// change the first line of the segments that follow
+    void set_header(const std::string& header)
+    {
+        this->header = header;
+    }
+
+    /// append data, rotating and syncing as configured, @returns false on an io error
+    bool write(const std::string& data, clock::time_point now = clock::now());
+
+    /// make everything written so far durable if the policy includes SYNC_REQUESTED
+    void sync_requested();
+    /// make everything written so far durable
+    void sync();
+
+    /// close the current segment and wait for all closes to finish
+    void close();
+
+    /// @returns the write() latency in microseconds at fraction p of the recent samples
+    double latency_percentile(double p) const;
+    double latency_max() const;
+    void clear_latency();
+
+    uint64_t accepted() const
+    {
+        return _accepted;
+    }
+    uint64_t durable() const
+    {
+        return _durable;
+    }
+    size_t segments() const
+    {
+        return segment + 1;
+    }
+    const std::string& segment_path() const
+    {
+        return current_path;
+    }
+
+    /// path of the given segment of the log at path
+    static std::string segment_name(const std::string& path, size_t segment);
+
+private:
+    void open();
+    /// close the current segment on another thread
+    void close_async();
+    /// write out the staged data, a partial block stays staged in direct mode
+    bool flush();
+
+    std::string base_path;
+    std::string current_path;
+    std::string header;
+    options opts;
+
+    int fd;
+    size_t segment;
+    size_t alignment;
+
+    /// staging buffer, aligned for O_DIRECT, starting at file offset staged_offset
+    char* staging;
+    size_t staging_size;
+    size_t staged;
+    uint64_t staged_offset;
+    /// bytes of data in the current segment, not counting padding
+    uint64_t segment_length;
+
+    uint64_t _accepted;
+    /// raised by the closing thread as well
+    std::atomic<uint64_t> _durable;
+    clock::time_point last_sync;
+
+    std::vector<float> latencies;
+    size_t latency_count;
+    mutable std::vector<float> sorted;
+
+    /// the previous segment being closed
+    std::future<void> closing;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "log_segment_writer.h"
+#include "Path.h"
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+
+namespace
+{
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+/// write 100 lines at 100 Hz of simulated time, cut the power after cut_after lines
+void write_lines(bool direct, size_t cut_after, std::string* expected, uint64_t* lost, size_t* segments)
+{
+    Path("/tmp/log_segment_writer").remove_all();
+    Path("/tmp/log_segment_writer").create_directories();
+
+    log_segment_writer::options opts;
+    opts.segment_bytes = 256;
+    opts.direct = direct;
+    opts.sync = log_segment_writer::SYNC_SEGMENT | log_segment_writer::SYNC_PERIODIC;
+    opts.sync_seconds = 0.1;
+
+    const log_segment_writer::clock::time_point start = log_segment_writer::clock::now();
+    log_segment_writer writer("/tmp/log_segment_writer/test.dat", opts, "Time\tValue\n");
+    for (size_t i = 0; i < 100; ++i)
+    {
+        const std::string line = std::to_string(i) + "\t" + std::to_string(i * i) + "\n";
+        expected->append(line);
+        EXPECT_TRUE(writer.write(line, start + std::chrono::milliseconds(10 * i)));
+
+        if (i + 1 == cut_after)
+        {
+            // everything not known to be durable is gone
+            *lost = writer.accepted() - writer.durable();
+            return;
+        }
+    }
+    writer.close();
+    *lost = writer.accepted() - writer.durable();
+    *segments = writer.segments();
+    EXPECT_LT(writer.latency_percentile(0.5), writer.latency_max() + 1);
+}
+}
+
+// TESTS
+TEST(log_segment_writer, SEGMENT_NAMES)
+{
+    EXPECT_EQ("/a/b.dat", log_segment_writer::segment_name("/a/b.dat", 0));
+    EXPECT_EQ("/a/b.2.dat", log_segment_writer::segment_name("/a/b.dat", 2));
+    EXPECT_EQ("/a.x/b.1", log_segment_writer::segment_name("/a.x/b", 1));
+    EXPECT_EQ(log_segment_writer::SYNC_SEGMENT | log_segment_writer::SYNC_REQUESTED,
+              log_segment_writer::parse_sync_policy("segment, requested,bogus"));
+}
+
+TEST(log_segment_writer, ROTATES_AND_KEEPS_EVERYTHING)
+{
+    for (bool direct : {false, true})
+    {
+        std::string expected;
+        uint64_t lost = 0;
+        size_t segments = 0;
+        write_lines(direct, 0, &expected, &lost, &segments);
+        EXPECT_EQ(0u, lost);
+        ASSERT_GT(segments, 1u);
+
+        std::string contents;
+        for (size_t s = 0; s < segments; ++s)
+        {
+            const std::string segment = read_file(log_segment_writer::segment_name("/tmp/log_segment_writer/test.dat", s));
+            EXPECT_LE(segment.size(), 256u);
+            ASSERT_EQ(0u, segment.find("Time\tValue\n"));
+            contents += segment.substr(11);
+        }
+        EXPECT_EQ(expected, contents);
+    }
+}
+
+TEST(log_segment_writer, POWER_CUT_LOSES_ONE_SYNC_PERIOD)
+{
+    std::string expected;
+    uint64_t lost = 0;
+    size_t segments = 0;
+    write_lines(false, 57, &expected, &lost, &segments);
+
+    // at most the lines written since the last 100 ms sync
+    EXPECT_GT(lost, 0u);
+    EXPECT_LE(lost, 11u * 10);
+}
+
+TEST(log_segment_writer, PERIODIC_ONLY_DOES_NOT_SYNC_ON_ROTATION)
+{
+    Path("/tmp/log_segment_writer").remove_all();
+    Path("/tmp/log_segment_writer").create_directories();
+
+    log_segment_writer::options opts;
+    opts.segment_bytes = 256;
+    opts.sync = log_segment_writer::SYNC_PERIODIC;
+    opts.sync_seconds = 1000;
+
+    const log_segment_writer::clock::time_point start = log_segment_writer::clock::now();
+    log_segment_writer writer("/tmp/log_segment_writer/test.dat", opts, "Time\tValue\n");
+    for (size_t i = 0; i < 100; ++i)
+        EXPECT_TRUE(writer.write(std::to_string(i) + "\n", start + std::chrono::milliseconds(10 * i)));
+    writer.close();
+
+    // rotated and closed, but the sync period never came around
+    EXPECT_GT(writer.segments(), 1u);
+    EXPECT_EQ(0u, writer.durable());
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "mavlink_arena.h"
+
+/* STL Headers */
+#include <algorithm>
+
+mavlink_arena::mavlink_arena(size_t capacity)
+    : _capacity(0),
+      _size(0),
+      _overflowed(0),
+      scratch(),
+      _allocated_bytes(0),
+      _copied_bytes(0)
+{
+    reserve(capacity);
+}
+
+void mavlink_arena::reserve(size_t capacity)
+{
+    if (capacity <= _capacity)
+        return;
+
+    std::unique_ptr<mavlink_message_t[]> grown(new mavlink_message_t[capacity]);
+    std::copy(slots.get(), slots.get() + _size, grown.get());
+    slots.swap(grown);
+
+    _allocated_bytes += capacity*sizeof(mavlink_message_t);
+    _copied_bytes += _size*sizeof(mavlink_message_t);
+    _capacity = capacity;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef MAVLINK_ARENA_H_
+#define MAVLINK_ARENA_H_
+
+/* STL Headers */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/* Mavlink Headers */
+#include <mavlink.h>
+
+/**
+ * @brief Fixed block of messages the drivers pack their telemetry in to
+ *
+ * QGCSend owns one arena, sizes it from what the drivers say one call of
+ * Driver::sendMavlinkMsg() can write and clear()s it every iteration, so
+ * collecting the messages never allocates.  Drivers pack straight in to the
+ * slot next() hands out:
+ *
+ *     mavlink_msg_heartbeat_pack(uasId, compid, msgs.next(), ...);
+ *
+ * Once the arena is full next() hands out a scratch slot instead, the message
+ * is dropped and counted in overflowed(), so a driver never has to check.
+ * Drivers forwarding a queue should send remaining() and keep the rest.
+ *
+ * Only the sending thread touches an arena.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class mavlink_arena
+{
+public:
+    explicit mavlink_arena(size_t capacity = 0);
+
+    /// the slot to pack the next message in to
+    mavlink_message_t* next()
+    {
+        if (_size == _capacity)
+        {
+            ++_overflowed;
+            return &scratch;
+        }
+        return &slots[_size++];
+    }
+
+    /// copy a message that was packed elsewhere in to the next slot
+    void push_back(const mavlink_message_t& msg)
+    {
+        *next() = msg;
+        _copied_bytes += sizeof(mavlink_message_t);
+    }
+
+    /// number of messages that can still be written this iteration
+    size_t remaining() const
+    {
+        return _capacity - _size;
+    }
+
+    /// forget the messages of the last iteration
+    void clear()
+    {
+        _size = 0;
+        _overflowed = 0;
+    }
+
+    /// grow to hold capacity messages, keeping the ones written
+    void reserve(size_t capacity);
+
+    const mavlink_message_t* begin() const
+    {
+        return slots.get();
+    }
+    const mavlink_message_t* end() const
+    {
+        return slots.get() + _size;
+    }
+    size_t size() const
+    {
+        return _size;
+    }
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+    /// messages dropped since the last clear()
+    size_t overflowed() const
+    {
+        return _overflowed;
+    }
+
+    /// bytes allocated for slots since construction
+    uint64_t allocated_bytes() const
+    {
+        return _allocated_bytes;
+    }
+    /// bytes copied by push_back() and reserve() since construction
+    uint64_t copied_bytes() const
+    {
+        return _copied_bytes;
+    }
+
+private:
+    mavlink_arena(const mavlink_arena&) = delete;
+    mavlink_arena& operator=(const mavlink_arena&) = delete;
+
+    std::unique_ptr<mavlink_message_t[]> slots;
+    size_t _capacity;
+    size_t _size;
+    size_t _overflowed;
+    /// written instead of a slot once the arena is full
+    mavlink_message_t scratch;
+
+    uint64_t _allocated_bytes;
+    uint64_t _copied_bytes;
+};
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "mavlink_arena.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const int SEND_RATE_HZ = 200;
+/// messages a handful of drivers write in one iteration
+const size_t PER_DRIVER[] = {2, 4, 1, 0, 3, 1};
+
+uint64_t vector_allocated = 0;
+
+/// counts the bytes a std::vector allocates
+template <typename T>
+struct counting_allocator
+{
+    typedef T value_type;
+
+    counting_allocator() {}
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        vector_allocated += n*sizeof(T);
+        return static_cast<T*>(::operator new(n*sizeof(T)));
+    }
+    void deallocate(T* p, size_t)
+    {
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&)
+{
+    return true;
+}
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&)
+{
+    return false;
+}
+
+/// a heartbeat from system i
+void pack(size_t i, mavlink_message_t* msg)
+{
+    mavlink_msg_heartbeat_pack(i, 200, msg, 4, 12, 0, 0, 0);
+}
+}
+
+TEST(mavlink_arena, NEXT_HANDS_OUT_SLOTS_IN_ORDER)
+{
+    mavlink_arena arena(3);
+    pack(1, arena.next());
+    pack(2, arena.next());
+
+    ASSERT_EQ(2u, arena.size());
+    EXPECT_EQ(1u, arena.remaining());
+    EXPECT_EQ(1, arena.begin()->sysid);
+    EXPECT_EQ(2, (arena.begin() + 1)->sysid);
+    EXPECT_EQ(arena.begin() + 2, arena.end());
+}
+
+TEST(mavlink_arena, OVERFLOW_IS_DROPPED_AND_COUNTED)
+{
+    mavlink_arena arena(2);
+    for (size_t i = 0; i < 5; ++i)
+        pack(i, arena.next());
+
+    EXPECT_EQ(2u, arena.size());
+    EXPECT_EQ(0u, arena.remaining());
+    EXPECT_EQ(3u, arena.overflowed());
+    EXPECT_EQ(1, (arena.begin() + 1)->sysid);
+
+    arena.clear();
+    EXPECT_EQ(0u, arena.size());
+    EXPECT_EQ(0u, arena.overflowed());
+    EXPECT_EQ(2u, arena.remaining());
+}
+
+TEST(mavlink_arena, RESERVE_KEEPS_MESSAGES)
+{
+    mavlink_arena arena(1);
+    pack(7, arena.next());
+    arena.reserve(4);
+    arena.reserve(2);
+
+    EXPECT_EQ(4u, arena.capacity());
+    ASSERT_EQ(1u, arena.size());
+    EXPECT_EQ(7, arena.begin()->sysid);
+    EXPECT_EQ(5*sizeof(mavlink_message_t), arena.allocated_bytes());
+    EXPECT_EQ(sizeof(mavlink_message_t), arena.copied_bytes());
+}
+
+TEST(mavlink_arena, COLLECTION_DOES_NOT_ALLOCATE)
+{
+    size_t capacity = 0;
+    for (size_t count : PER_DRIVER)
+        capacity += count;
+
+    // one second of the old collection, a vector per driver that the messages are copied in to
+    uint64_t vector_copied = 0;
+    vector_allocated = 0;
+    for (int i = 0; i < SEND_RATE_HZ; ++i)
+    {
+        for (size_t count : PER_DRIVER)
+        {
+            std::vector<mavlink_message_t, counting_allocator<mavlink_message_t> > msgs;
+            for (size_t m = 0; m < count; ++m)
+            {
+                const size_t before = msgs.capacity();
+                mavlink_message_t msg;
+                pack(m, &msg);
+                msgs.push_back(msg);
+                vector_copied += sizeof(msg);
+                if (msgs.capacity() != before)
+                    vector_copied += (msgs.size() - 1)*sizeof(msg);
+            }
+        }
+    }
+
+    // and with the arena
+    mavlink_arena arena(capacity);
+    const uint64_t allocated_at_start = arena.allocated_bytes();
+    for (int i = 0; i < SEND_RATE_HZ; ++i)
+    {
+        for (size_t count : PER_DRIVER)
+        {
+            for (size_t m = 0; m < count; ++m)
+                pack(m, arena.next());
+        }
+        EXPECT_EQ(0u, arena.overflowed());
+        arena.clear();
+    }
+
+    std::cout << "vector collection: " << vector_allocated << " B/s allocated, "
+              << vector_copied << " B/s copied" << std::endl;
+    std::cout << "arena collection: " << arena.allocated_bytes() - allocated_at_start << " B/s allocated, "
+              << arena.copied_bytes() << " B/s copied" << std::endl;
+
+    EXPECT_GT(vector_allocated, 0u);
+    EXPECT_EQ(allocated_at_start, arena.allocated_bytes());
+    EXPECT_EQ(0u, arena.copied_bytes());
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "mavlink_framer.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cstring>
+
+const uint8_t mavlink_framer::V1_STX;
+const uint8_t mavlink_framer::V2_STX;
+const size_t mavlink_framer::MAX_FRAME_LENGTH;
+const uint8_t mavlink_framer::CUSTOM_FIRST;
+const uint8_t mavlink_framer::CUSTOM_LAST;
+const uint32_t mavlink_framer::DEFAULT_CUSTOM_MSGID_BASE;
+const size_t mavlink_framer::V1_HEADER_LENGTH;
+const size_t mavlink_framer::V2_HEADER_LENGTH;
+const size_t mavlink_framer::SIGNATURE_LENGTH;
+const uint8_t mavlink_framer::INCOMPAT_SIGNED;
+
+namespace
+{
+
+/// per message checksum seeds and payload lengths of the dialect
+const uint8_t MESSAGE_CRCS[256] = MAVLINK_MESSAGE_CRCS;
+const uint8_t MESSAGE_LENGTHS[256] = MAVLINK_MESSAGE_LENGTHS;
+
+}
+
+mavlink_framer::mavlink_framer(version_mode mode, uint32_t custom_msgid_base)
+    : mode(mode),
+      custom_msgid_base(custom_msgid_base),
+      _version(mode == V2 ? 2 : 1),
+      received(0),
+      expected(0),
+      _dropped(0)
+{
+    buffer.fill(0);
+}
+
+size_t mavlink_framer::encode(const mavlink_message_t& msg, uint8_t* frame) const
+{
+    if (_version == 2)
+        return encode_v2(msg, frame);
+    return mavlink_msg_to_send_buffer(frame, &msg);
+}
+
+size_t mavlink_framer::encode_v2(const mavlink_message_t& msg, uint8_t* frame) const
+{
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(_MAV_PAYLOAD(&msg));
+    uint8_t length = msg.len;
+    while (length > 1 && payload[length - 1] == 0)
+        --length;
+
+    const uint32_t msgid = wire_msgid(msg.msgid);
+    frame[0] = V2_STX;
+    frame[1] = length;
+    frame[2] = 0; // incompatible flags
+    frame[3] = 0; // compatible flags
+    frame[4] = msg.seq;
+    frame[5] = msg.sysid;
+    frame[6] = msg.compid;
+    frame[7] = msgid & 0xFF;
+    frame[8] = (msgid >> 8) & 0xFF;
+    frame[9] = (msgid >> 16) & 0xFF;
+    std::memcpy(&frame[V2_HEADER_LENGTH], payload, length);
+
+    uint16_t crc;
+    crc_init(&crc);
+    crc_accumulate_buffer(&crc, reinterpret_cast<const char*>(&frame[1]), V2_HEADER_LENGTH - 1 + length);
+    crc_accumulate(MESSAGE_CRCS[msg.msgid], &crc);
+    frame[V2_HEADER_LENGTH + length] = crc & 0xFF;
+    frame[V2_HEADER_LENGTH + length + 1] = crc >> 8;
+
+    return V2_HEADER_LENGTH + length + 2;
+}
+
+uint32_t mavlink_framer::frame_msgid(const uint8_t* frame)
+{
+    if (frame[0] == V2_STX)
+        return frame[7] | (frame[8] << 8) | (frame[9] << 16);
+    return frame[5];
+}
+
+bool mavlink_framer::parse(uint8_t c, mavlink_message_t& msg)
+{
+    if (received == 0)
+    {
+        // wait for the start of a frame
+        if (c == V1_STX || c == V2_STX)
+            buffer[received++] = c;
+        return false;
+    }
+
+    buffer[received++] = c;
+
+    if (expected == 0)
+    {
+        const bool v2 = buffer[0] == V2_STX;
+        if (received < (v2 ? V2_HEADER_LENGTH : V1_HEADER_LENGTH))
+            return false;
+
+        expected = (v2 ? V2_HEADER_LENGTH : V1_HEADER_LENGTH) + buffer[1] + 2;
+        if (v2 && (buffer[2] & INCOMPAT_SIGNED))
+            expected += SIGNATURE_LENGTH;
+    }
+
+    if (received < expected)
+        return false;
+
+    const bool valid = unpack(msg);
+    if (!valid)
+        ++_dropped;
+    received = 0;
+    expected = 0;
+    return valid;
+}
+
+int mavlink_framer::local_msgid(uint32_t wire_id) const
+{
+    if (wire_id >= custom_msgid_base + CUSTOM_FIRST && wire_id <= custom_msgid_base + CUSTOM_LAST)
+        return wire_id - custom_msgid_base;
+    if (wire_id < 256 && !is_custom(wire_id))
+        return wire_id;
+    return -1;
+}
+
+bool mavlink_framer::unpack(mavlink_message_t& msg)
+{
+    const bool v2 = buffer[0] == V2_STX;
+    const size_t header = v2 ? V2_HEADER_LENGTH : V1_HEADER_LENGTH;
+    const uint8_t length = buffer[1];
+
+    uint8_t seq, sysid, compid;
+    int msgid;
+    if (v2)
+    {
+        if (buffer[2] & ~INCOMPAT_SIGNED)
+            return false;
+        seq = buffer[4];
+        sysid = buffer[5];
+        compid = buffer[6];
+        msgid = local_msgid(buffer[7] | (buffer[8] << 8) | (buffer[9] << 16));
+    }
+    else
+    {
+        seq = buffer[2];
+        sysid = buffer[3];
+        compid = buffer[4];
+        msgid = buffer[5];
+    }
+
+    if (msgid < 0 || MESSAGE_LENGTHS[msgid] == 0)
+        return false;
+
+    uint16_t crc;
+    crc_init(&crc);
+    crc_accumulate_buffer(&crc, reinterpret_cast<const char*>(&buffer[1]), header - 1 + length);
+    crc_accumulate(MESSAGE_CRCS[msgid], &crc);
+    if ((crc & 0xFF) != buffer[header + length] || (crc >> 8) != buffer[header + length + 1])
+        return false;
+
+    // put back the zeros a MAVLink 2 sender truncated
+    const uint8_t full_length = MESSAGE_LENGTHS[msgid];
+    const uint8_t copied = std::min(length, full_length);
+    char* payload = _MAV_PAYLOAD_NON_CONST(&msg);
+    std::memcpy(payload, &buffer[header], copied);
+    std::memset(payload + copied, 0, full_length - copied);
+
+    msg.magic = MAVLINK_STX;
+    msg.len = full_length;
+    msg.seq = seq;
+    msg.sysid = sysid;
+    msg.compid = compid;
+    msg.msgid = msgid;
+
+    // checksum of the equivalent MAVLink 1 frame so the message can be forwarded as is
+    crc_init(&crc);
+    crc_accumulate(full_length, &crc);
+    crc_accumulate(seq, &crc);
+    crc_accumulate(sysid, &crc);
+    crc_accumulate(compid, &crc);
+    crc_accumulate(msgid, &crc);
+    crc_accumulate_buffer(&crc, payload, full_length);
+    crc_accumulate(MESSAGE_CRCS[msgid], &crc);
+    msg.checksum = crc;
+
+    if (mode == AUTO)
+    {
+        if (v2)
+            _version = 2;
+        else if (msgid == MAVLINK_MSG_ID_HEARTBEAT)
+            _version = 1;
+    }
+
+    return true;
+}
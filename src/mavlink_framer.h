@@ -0,0 +1,128 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef MAVLINK_FRAMER_H_
+#define MAVLINK_FRAMER_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/* Mavlink Headers */
+#include <mavlink.h>
+
+/**
+ * @brief MAVLink 1 and MAVLink 2 framing for messages packed with the v1 dialect
+ *
+ * The dialect library only knows MAVLink 1, so messages are still packed and
+ * decoded with it and this class only changes how they go on the wire.
+ *
+ * A MAVLink 2 frame carries the same payload with the trailing zero bytes
+ * removed (at least one byte is always kept) and a 24 bit message id.  The
+ * custom dialect messages (ids CUSTOM_FIRST to CUSTOM_LAST) are moved up by
+ * custom_msgid_base so they can never collide with a public MAVLink 2 message.
+ * The receiver puts the zeros back so the v1 decode functions see the full
+ * length payload.  Signed frames are accepted but the signature is not checked.
+ *
+ * In AUTO mode messages are framed as MAVLink 1 until a valid MAVLink 2 frame
+ * arrives from the other end, and go back to MAVLink 1 if the other end later
+ * sends a MAVLink 1 heartbeat.
+ *
+ * encode() may be called from one thread while parse() is called from another.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class mavlink_framer
+{
+public:
+    enum version_mode
+    {
+        AUTO = 0,
+        V1 = 1,
+        V2 = 2
+    };
+
+    static const uint8_t V1_STX = 0xFE;
+    static const uint8_t V2_STX = 0xFD;
+    /// largest frame of either version, a signed MAVLink 2 frame with a full payload
+    static const size_t MAX_FRAME_LENGTH = 10 + 255 + 2 + 13;
+
+    /// range of the custom dialect message ids
+    static const uint8_t CUSTOM_FIRST = 150;
+    static const uint8_t CUSTOM_LAST = 240;
+    static const uint32_t DEFAULT_CUSTOM_MSGID_BASE = 0x10000;
+
+    mavlink_framer(version_mode mode = AUTO, uint32_t custom_msgid_base = DEFAULT_CUSTOM_MSGID_BASE);
+
+    /**
+     * Frame msg in the version currently in use.
+     * @param frame at least MAX_FRAME_LENGTH bytes
+     * @returns the length of the frame
+     */
+    size_t encode(const mavlink_message_t& msg, uint8_t* frame) const;
+
+    /**
+     * Feed one received byte of either version.
+     * @returns true when msg holds a complete message with a valid checksum
+     */
+    bool parse(uint8_t c, mavlink_message_t& msg);
+
+    /// @returns 1 or 2, the version encode() uses
+    int version() const
+    {
+        return _version;
+    }
+
+    /// @returns the id msgid is sent with in a MAVLink 2 frame
+    uint32_t wire_msgid(uint8_t msgid) const
+    {
+        return is_custom(msgid) ? custom_msgid_base + msgid : msgid;
+    }
+
+    /// @returns the message id of a frame of either version
+    static uint32_t frame_msgid(const uint8_t* frame);
+
+    static bool is_custom(uint32_t msgid)
+    {
+        return msgid >= CUSTOM_FIRST && msgid <= CUSTOM_LAST;
+    }
+
+    /// number of frames dropped for a bad checksum, unknown id or unsupported flags
+    uint32_t dropped() const
+    {
+        return _dropped;
+    }
+
+private:
+    static const size_t V1_HEADER_LENGTH = 6;
+    static const size_t V2_HEADER_LENGTH = 10;
+    static const size_t SIGNATURE_LENGTH = 13;
+    static const uint8_t INCOMPAT_SIGNED = 0x01;
+
+    size_t encode_v2(const mavlink_message_t& msg, uint8_t* frame) const;
+
+    /// check the frame in buffer and unpack it into msg
+    bool unpack(mavlink_message_t& msg);
+
+    /// @returns the v1 id of a message received with id wire_id or -1 if it is unknown
+    int local_msgid(uint32_t wire_id) const;
+
+    const version_mode mode;
+    const uint32_t custom_msgid_base;
+    std::atomic<int> _version;
+
+    /// the frame being received
+    std::array<uint8_t, MAX_FRAME_LENGTH> buffer;
+    size_t received;
+    /// length of the frame being received once its header is complete, 0 before
+    size_t expected;
+    std::atomic<uint32_t> _dropped;
+};
+
+#endif
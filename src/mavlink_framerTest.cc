@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "mavlink_framer.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace
+{
+
+/// feed a frame to the parser, @returns the number of messages it produced
+int feed(mavlink_framer& framer, const uint8_t* frame, size_t length, mavlink_message_t& msg)
+{
+    int messages = 0;
+    for (size_t i = 0; i < length; ++i)
+        if (framer.parse(frame[i], msg))
+            ++messages;
+    return messages;
+}
+
+}
+
+// TESTS
+TEST(mavlink_framer, V2_TRUNCATES_AND_RESTORES_PAYLOAD)
+{
+    mavlink_message_t sent;
+    mavlink_msg_heartbeat_pack(100, 200, &sent, 4, 12, 0, 0, 0);
+
+    mavlink_framer sender(mavlink_framer::V2);
+    uint8_t frame[mavlink_framer::MAX_FRAME_LENGTH];
+    const size_t length = sender.encode(sent, frame);
+
+    // custom mode and base mode are zero, everything from type to the version is kept
+    EXPECT_EQ(mavlink_framer::V2_STX, frame[0]);
+    EXPECT_EQ(9u, frame[1]);
+    EXPECT_EQ(10u + 9 + 2, length);
+
+    mavlink_framer receiver(mavlink_framer::V1);
+    mavlink_message_t received;
+    ASSERT_EQ(1, feed(receiver, frame, length, received));
+    EXPECT_EQ(sent.len, received.len);
+    EXPECT_EQ(sent.sysid, received.sysid);
+    EXPECT_EQ(sent.compid, received.compid);
+    EXPECT_EQ(sent.seq, received.seq);
+    EXPECT_EQ(sent.checksum, received.checksum);
+    EXPECT_EQ(0, std::memcmp(_MAV_PAYLOAD(&sent), _MAV_PAYLOAD(&received), sent.len));
+
+    // only trailing zeros go, at least one payload byte is always sent
+    std::memset(_MAV_PAYLOAD_NON_CONST(&sent), 0, sent.len);
+    EXPECT_EQ(10u + 1 + 2, sender.encode(sent, frame));
+}
+
+TEST(mavlink_framer, CUSTOM_MESSAGES_USE_24_BIT_IDS)
+{
+    mavlink_message_t sent;
+    std::memset(&sent, 0, sizeof(sent));
+    sent.msgid = mavlink_framer::CUSTOM_FIRST;
+    sent.len = 20;
+    _MAV_PAYLOAD_NON_CONST(&sent)[3] = 7;
+
+    mavlink_framer sender(mavlink_framer::V2, 0x20000);
+    uint8_t frame[mavlink_framer::MAX_FRAME_LENGTH];
+    const size_t length = sender.encode(sent, frame);
+    EXPECT_EQ(0x20000u + mavlink_framer::CUSTOM_FIRST, mavlink_framer::frame_msgid(frame));
+
+    mavlink_message_t received;
+    mavlink_framer matching(mavlink_framer::AUTO, 0x20000);
+    ASSERT_EQ(1, feed(matching, frame, length, received));
+    EXPECT_EQ(mavlink_framer::CUSTOM_FIRST, received.msgid);
+    EXPECT_EQ(20, received.len);
+    EXPECT_EQ(7, _MAV_PAYLOAD(&received)[3]);
+
+    mavlink_framer other_base(mavlink_framer::AUTO, 0x30000);
+    EXPECT_EQ(0, feed(other_base, frame, length, received));
+    EXPECT_EQ(1u, other_base.dropped());
+}
+
+TEST(mavlink_framer, AUTO_FOLLOWS_THE_PEER)
+{
+    mavlink_message_t msg;
+    mavlink_msg_heartbeat_pack(1, 1, &msg, 6, 8, 0, 0, 0);
+
+    uint8_t v1_frame[mavlink_framer::MAX_FRAME_LENGTH];
+    const size_t v1_length = mavlink_framer(mavlink_framer::V1).encode(msg, v1_frame);
+    uint8_t v2_frame[mavlink_framer::MAX_FRAME_LENGTH];
+    const size_t v2_length = mavlink_framer(mavlink_framer::V2).encode(msg, v2_frame);
+
+    mavlink_framer link(mavlink_framer::AUTO);
+    EXPECT_EQ(1, link.version());
+
+    mavlink_message_t received;
+    ASSERT_EQ(1, feed(link, v2_frame, v2_length, received));
+    EXPECT_EQ(2, link.version());
+
+    ASSERT_EQ(1, feed(link, v1_frame, v1_length, received));
+    EXPECT_EQ(1, link.version());
+
+    // a fixed version never changes
+    mavlink_framer fixed(mavlink_framer::V1);
+    feed(fixed, v2_frame, v2_length, received);
+    EXPECT_EQ(1, fixed.version());
+}
+
+TEST(mavlink_framer, REJECTS_CORRUPT_FRAMES_AND_RESYNCS)
+{
+    mavlink_message_t msg;
+    mavlink_msg_heartbeat_pack(1, 1, &msg, 6, 8, 0, 0, 0);
+
+    mavlink_framer link(mavlink_framer::V2);
+    uint8_t frame[mavlink_framer::MAX_FRAME_LENGTH];
+    const size_t length = link.encode(msg, frame);
+
+    uint8_t stream[2*mavlink_framer::MAX_FRAME_LENGTH + 3] = {0x00, 0x42};
+    std::memcpy(&stream[2], frame, length);
+    stream[2 + 12] ^= 0x01;
+    std::memcpy(&stream[2 + length], frame, length);
+
+    mavlink_message_t received;
+    EXPECT_EQ(1, feed(link, stream, 2 + 2*length, received));
+    EXPECT_EQ(1u, link.dropped());
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "state_selector.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cmath>
+
+const size_t state_selector::MAX_SOURCES;
+const size_t state_selector::COMPONENTS;
+
+namespace
+{
+const double PI = 3.14159265358979323846;
+const double EARTH_RADIUS_M = 6371000;
+/// weight of the newest interval in the smoothed publish interval
+const double INTERVAL_WEIGHT = 0.1;
+/// fresh sources needed to tell which one disagrees
+const size_t QUORUM = 3;
+
+double seconds(state_selector::clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+}
+
+state_selector::slot::slot()
+    : expected_rate_hz(0),
+      published(false),
+      value(),
+      accuracy(0),
+      latency(0),
+      interval(0)
+{
+    scored.rate_hz = 0;
+    scored.latency = 0;
+    scored.innovation = 0;
+    scored.accuracy = 0;
+    scored.score = 0;
+    scored.usable = false;
+}
+
+state_selector::state_selector(distance_function distance)
+    : distance(distance),
+      sources(0),
+      _enforced(false),
+      _selected(-1),
+      challenger(-1)
+{
+    _tuning.latency_scale = 0.05;
+    _tuning.innovation_scale = 1;
+    _tuning.accuracy_scale = 1;
+    _tuning.timeout_periods = 5;
+    _tuning.min_score = 0.25;
+    _tuning.switch_margin = 0.2;
+    _tuning.hold = std::chrono::seconds(1);
+}
+
+double state_selector::angle_distance(const value_type& a, const value_type& b)
+{
+    double largest = 0;
+    for (size_t i = 0; i < COMPONENTS; ++i)
+    {
+        const double difference = std::remainder(a[i] - b[i], 2*PI);
+        largest = std::max(largest, std::fabs(difference));
+    }
+    return largest;
+}
+
+double state_selector::llh_distance(const value_type& a, const value_type& b)
+{
+    const double to_radians = PI/180;
+    const double north = (a[0] - b[0])*to_radians*EARTH_RADIUS_M;
+    const double east = (a[1] - b[1])*to_radians*EARTH_RADIUS_M*std::cos((a[0] + b[0])/2*to_radians);
+    const double down = a[2] - b[2];
+    return std::sqrt(north*north + east*east + down*down);
+}
+
+void state_selector::set_tuning(const tuning& t)
+{
+    std::lock_guard<std::mutex> lock(tuning_lock);
+    _tuning = t;
+}
+
+state_selector::tuning state_selector::get_tuning() const
+{
+    std::lock_guard<std::mutex> lock(tuning_lock);
+    return _tuning;
+}
+
+int state_selector::add_source(const std::string& name, double expected_rate_hz)
+{
+    std::lock_guard<std::mutex> guard(add_lock);
+    const size_t index = sources;
+    if (index == MAX_SOURCES)
+        return -1;
+
+    slot& s = slots[index];
+    {
+        std::lock_guard<std::mutex> lock(s.lock);
+        s.name = name;
+        s.expected_rate_hz = expected_rate_hz;
+        s.scored.name = name;
+    }
+    sources = index + 1;
+    return index;
+}
+
+void state_selector::publish(int source, const value_type& value, double accuracy, clock::time_point measured)
+{
+    if (source < 0 || static_cast<size_t>(source) >= sources)
+        return;
+
+    const clock::time_point now = clock::now();
+    slot& s = slots[source];
+    std::lock_guard<std::mutex> lock(s.lock);
+
+    if (s.published)
+    {
+        const double interval = seconds(now - s.arrived);
+        s.interval = s.interval == 0 ? interval : s.interval + INTERVAL_WEIGHT*(interval - s.interval);
+    }
+    s.published = true;
+    s.value = value;
+    s.accuracy = std::fabs(accuracy);
+    s.arrived = now;
+    s.latency = measured == clock::time_point() ? 0 : std::max(0.0, seconds(now - measured));
+}
+
+int state_selector::select(clock::time_point now)
+{
+    const tuning t(get_tuning());
+    const size_t count = sources;
+
+    // copy the slots out so drivers are held up for a copy only
+    bool fresh[MAX_SOURCES];
+    value_type values[MAX_SOURCES];
+    health scores[MAX_SOURCES];
+    for (size_t i = 0; i < count; ++i)
+    {
+        slot& s = slots[i];
+        std::lock_guard<std::mutex> lock(s.lock);
+        health& h = scores[i];
+        h = s.scored;
+        values[i] = s.value;
+
+        // a source that stopped publishing is slowing down as far as the rate is concerned
+        const double since = s.published ? seconds(now - s.arrived) : 0;
+        const double interval = std::max(s.interval, since);
+        h.rate_hz = interval > 0 ? 1/interval : 0;
+        h.latency = s.latency;
+        h.accuracy = s.accuracy;
+        fresh[i] = s.published && s.expected_rate_hz > 0 && since*s.expected_rate_hz <= t.timeout_periods;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        health& h = scores[i];
+
+        double distances[MAX_SOURCES];
+        size_t others = 0;
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (j != i && fresh[j])
+                distances[others++] = distance(values[i], values[j]);
+        }
+        h.innovation = 0;
+        if (others > 0)
+        {
+            // the lower median, so of two others the one that agrees counts
+            const size_t median = (others - 1)/2;
+            std::nth_element(distances, distances + median, distances + others);
+            h.innovation = distances[median];
+        }
+
+        // of two sources that disagree either may be wrong, so without a
+        // quorum the innovation is reported but does not count
+        const double expected = slots[i].expected_rate_hz;
+        const double rate_score = expected > 0 ? std::min(1.0, h.rate_hz/expected) : 0;
+        const double innovation = others + 1 >= QUORUM ? h.innovation/t.innovation_scale : 0;
+        h.score = rate_score
+                  / (1 + h.latency/t.latency_scale)
+                  / (1 + innovation*innovation)
+                  / (1 + h.accuracy/t.accuracy_scale);
+        h.usable = fresh[i] && h.score >= t.min_score;
+    }
+
+    int best = -1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (scores[i].usable && (best < 0 || scores[i].score > scores[best].score))
+            best = i;
+    }
+
+    const int current = _selected;
+    int next = current;
+    if (best < 0 && current >= 0 && fresh[current])
+    {
+        // nothing is usable, the selected source is still the best there is
+        challenger = -1;
+    }
+    else if (current < 0 || ! scores[current].usable)
+    {
+        next = best;
+        challenger = -1;
+    }
+    else if (best != current && scores[best].score > scores[current].score*(1 + t.switch_margin))
+    {
+        if (challenger != best)
+        {
+            challenger = best;
+            challenged_at = now;
+        }
+        else if (now - challenged_at >= t.hold)
+        {
+            next = best;
+            challenger = -1;
+        }
+    }
+    else
+    {
+        challenger = -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(report_lock);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::lock_guard<std::mutex> slot_lock(slots[i].lock);
+            slots[i].scored = scores[i];
+        }
+    }
+
+    if (next != current)
+    {
+        _selected = next;
+        selection_changed(current, next);
+    }
+    return next;
+}
+
+std::string state_selector::name(int source) const
+{
+    if (source < 0 || static_cast<size_t>(source) >= sources)
+        return std::string();
+
+    std::lock_guard<std::mutex> lock(slots[source].lock);
+    return slots[source].name;
+}
+
+bool state_selector::latest(int source, value_type& value, double& accuracy) const
+{
+    if (source < 0 || static_cast<size_t>(source) >= sources)
+        return false;
+
+    const slot& s = slots[source];
+    std::lock_guard<std::mutex> lock(s.lock);
+    value = s.value;
+    accuracy = s.accuracy;
+    return s.published;
+}
+
+std::vector<state_selector::health> state_selector::report() const
+{
+    std::vector<health> healths;
+    std::lock_guard<std::mutex> lock(report_lock);
+    for (size_t i = 0; i < sources; ++i)
+    {
+        std::lock_guard<std::mutex> slot_lock(slots[i].lock);
+        healths.push_back(slots[i].scored);
+    }
+    return healths;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef STATE_SELECTOR_H_
+#define STATE_SELECTOR_H_
+
+/* STL Headers */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Boost Headers */
+#include <boost/signals2.hpp>
+
+/**
+ * @brief Chooses one of several drivers that measure the same state
+ *
+ * Each driver that can measure the state (e.g. the attitude from the GX3 nav
+ * filter, the GX3 AHRS and HIL) registers a slot with add_source() and
+ * publish()es every measurement in to it with the time it was measured and
+ * the accuracy it reports.  Publishing only takes the slot's own lock.
+ *
+ * select() is called at control rate by one thread.  It scores every source
+ * between 0 and 1 as the product of
+ *  - the rate it is publishing at over the rate it should (at most 1),
+ *  - 1/(1 + latency/latency_scale) for the time from measurement to publish,
+ *  - 1/(1 + (innovation/innovation_scale)^2) for its (lower) median distance
+ *    from the other fresh sources, only once three sources are fresh since
+ *    of two that disagree either may be wrong,
+ *  - 1/(1 + accuracy/accuracy_scale) for the accuracy it reports.
+ * A source is usable if it published within timeout_periods of its period and
+ * scores at least min_score.  The selection moves at once when the selected
+ * source stops being usable, otherwise only to a source that beats it by
+ * switch_margin for hold.  If no source is usable the selected source is kept
+ * for as long as it is fresh.  selection_changed is emitted from select().
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class state_selector
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    static const size_t MAX_SOURCES = 8;
+    static const size_t COMPONENTS = 3;
+    typedef std::array<double, COMPONENTS> value_type;
+    /// how far apart two measurements are, in the units of innovation_scale
+    typedef double (*distance_function)(const value_type& a, const value_type& b);
+
+    struct tuning
+    {
+        /// latency at which the latency score halves, seconds
+        double latency_scale;
+        /// disagreement at which the innovation score halves
+        double innovation_scale;
+        /// reported accuracy at which the accuracy score halves
+        double accuracy_scale;
+        /// a source is stale after this many of its periods without a publish
+        double timeout_periods;
+        /// least score of a usable source
+        double min_score;
+        /// fraction a source must beat the selected source's score by to take over
+        double switch_margin;
+        /// time a source must keep beating the selected source for
+        clock::duration hold;
+    };
+
+    /// the score of one source and what it is made of
+    struct health
+    {
+        std::string name;
+        double rate_hz;
+        double latency;
+        double innovation;
+        double accuracy;
+        double score;
+        bool usable;
+    };
+
+    explicit state_selector(distance_function distance);
+
+    /// largest absolute difference of three angles in radians, wrapped to +/- pi
+    static double angle_distance(const value_type& a, const value_type& b);
+    /// horizontal and vertical distance in metres between two latitude, longitude, height triples
+    static double llh_distance(const value_type& a, const value_type& b);
+
+    void set_tuning(const tuning& t);
+    tuning get_tuning() const;
+
+    /**
+     * Register a source, once per driver.  threadsafe
+     * @param expected_rate_hz the rate the source publishes at when healthy
+     * @returns the slot to publish to, -1 if every slot is taken
+     */
+    int add_source(const std::string& name, double expected_rate_hz);
+
+    /**
+     * Store a measurement in source's slot.  threadsafe
+     * @param accuracy the error the source reports, in the units of accuracy_scale
+     * @param measured when the state was measured, the time of publishing if not known
+     */
+    void publish(int source, const value_type& value, double accuracy,
+                 clock::time_point measured = clock::time_point());
+
+    /// score the sources and update the selection, from one thread only
+    int select(clock::time_point now = clock::now());
+
+    /// @returns the selected slot, -1 if there is no fresh source to keep
+    int selected() const
+    {
+        return _selected;
+    }
+    /// @returns the name of slot source, empty if it is not registered
+    std::string name(int source) const;
+    /// the latest measurement of source, @returns false if it has none
+    bool latest(int source, value_type& value, double& accuracy) const;
+    /// the health of every registered source as of the last select()
+    std::vector<health> report() const;
+
+    /// true if the controllers must stop when their source is not selected
+    void set_enforced(bool enforced)
+    {
+        _enforced = enforced;
+    }
+    bool enforced() const
+    {
+        return _enforced;
+    }
+
+    /// emitted with the old and new selected slot
+    boost::signals2::signal<void (int, int)> selection_changed;
+
+private:
+    struct slot
+    {
+        slot();
+
+        std::string name;
+        double expected_rate_hz;
+
+        mutable std::mutex lock;
+        bool published;
+        value_type value;
+        double accuracy;
+        clock::time_point arrived;
+        double latency;
+        /// smoothed time between publishes, seconds
+        double interval;
+
+        health scored;
+    };
+
+    distance_function distance;
+    tuning _tuning;
+    mutable std::mutex tuning_lock;
+
+    slot slots[MAX_SOURCES];
+    std::atomic<size_t> sources;
+    mutable std::mutex add_lock;
+
+    std::atomic<bool> _enforced;
+    std::atomic<int> _selected;
+    int challenger;
+    clock::time_point challenged_at;
+    mutable std::mutex report_lock;
+};
+
+#endif
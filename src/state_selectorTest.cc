@@ -0,0 +1,186 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "state_selector.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+const state_selector::value_type LEVEL = {{0, 0, 0}};
+
+std::chrono::milliseconds ms(int count)
+{
+    return std::chrono::milliseconds(count);
+}
+}
+
+TEST(state_selector, ANGLE_DISTANCE_WRAPS)
+{
+    const state_selector::value_type a = {{0, 0, 3.1}};
+    const state_selector::value_type b = {{0, 0, -3.1}};
+    EXPECT_NEAR(2*M_PI - 6.2, state_selector::angle_distance(a, b), 1e-9);
+}
+
+TEST(state_selector, LLH_DISTANCE)
+{
+    const state_selector::value_type a = {{39.6766, -104.9619, 1600}};
+    const state_selector::value_type b = {{39.6766 + 1e-4, -104.9619, 1603}};
+    // 1e-4 degrees of latitude is about 11 m
+    EXPECT_NEAR(std::hypot(11.12, 3), state_selector::llh_distance(a, b), 0.05);
+}
+
+TEST(state_selector, NOTHING_SELECTED_WITHOUT_MEASUREMENTS)
+{
+    state_selector selector(&state_selector::angle_distance);
+    selector.add_source("a", 1);
+    EXPECT_EQ(-1, selector.select());
+}
+
+TEST(state_selector, STALE_SOURCE_IS_DROPPED_AT_ONCE)
+{
+    state_selector selector(&state_selector::angle_distance);
+    const int fast = selector.add_source("fast", 100);
+    const int slow = selector.add_source("slow", 1);
+
+    selector.publish(fast, LEVEL, 0);
+    selector.publish(slow, LEVEL, 0.5);
+    EXPECT_EQ(fast, selector.select());
+
+    // fast stops for more than five of its periods
+    std::this_thread::sleep_for(ms(100));
+    selector.publish(slow, LEVEL, 0.5);
+    EXPECT_EQ(slow, selector.select());
+    EXPECT_FALSE(selector.report()[fast].usable);
+
+    // and nothing is left once slow stops too
+    EXPECT_EQ(-1, selector.select(state_selector::clock::now() + std::chrono::seconds(6)));
+}
+
+TEST(state_selector, BETTER_SOURCE_MUST_HOLD)
+{
+    state_selector selector(&state_selector::angle_distance);
+    const int worse = selector.add_source("worse", 1);
+    const int better = selector.add_source("better", 1);
+
+    int changes = 0;
+    selector.selection_changed.connect([&](int, int){ ++changes; });
+
+    selector.publish(worse, LEVEL, 0.5);
+    const state_selector::clock::time_point start = state_selector::clock::now();
+    EXPECT_EQ(worse, selector.select(start));
+
+    selector.publish(better, LEVEL, 0);
+    EXPECT_EQ(worse, selector.select(start + ms(10)));
+    EXPECT_EQ(worse, selector.select(start + ms(500)));
+    EXPECT_EQ(better, selector.select(start + ms(1100)));
+    EXPECT_EQ(2, changes);
+
+    std::vector<state_selector::health> healths(selector.report());
+    ASSERT_EQ(2u, healths.size());
+    EXPECT_EQ("better", healths[better].name);
+    EXPECT_GT(healths[better].score, healths[worse].score);
+}
+
+TEST(state_selector, SMALL_ADVANTAGE_DOES_NOT_SWITCH)
+{
+    state_selector selector(&state_selector::angle_distance);
+    const int first = selector.add_source("first", 1);
+    const int second = selector.add_source("second", 1);
+
+    selector.publish(first, LEVEL, 0.1);
+    const state_selector::clock::time_point start = state_selector::clock::now();
+    EXPECT_EQ(first, selector.select(start));
+
+    // 1/1.05 over 1/1.1 is less than the 20% margin
+    selector.publish(second, LEVEL, 0.05);
+    for (int t = 0; t <= 3000; t += 100)
+        EXPECT_EQ(first, selector.select(start + ms(t)));
+}
+
+TEST(state_selector, DISAGREEING_SOURCE_IS_NOT_USED)
+{
+    state_selector selector(&state_selector::angle_distance);
+    state_selector::tuning t(selector.get_tuning());
+    t.innovation_scale = 0.05;
+    selector.set_tuning(t);
+
+    const int nav = selector.add_source("nav", 1);
+    const int ahrs = selector.add_source("ahrs", 1);
+    const int hil = selector.add_source("hil", 1);
+
+    // nav has drifted 0.3 rad in roll from the two that agree, and reports itself best
+    const state_selector::value_type drifted = {{0.3, 0, 0}};
+    selector.publish(nav, drifted, 0);
+    selector.publish(ahrs, LEVEL, 0.1);
+    selector.publish(hil, LEVEL, 0.2);
+
+    const int chosen = selector.select();
+    EXPECT_EQ(ahrs, chosen);
+    std::vector<state_selector::health> healths(selector.report());
+    EXPECT_FALSE(healths[nav].usable);
+    EXPECT_NEAR(0.3, healths[nav].innovation, 1e-9);
+    EXPECT_NEAR(0, healths[ahrs].innovation, 1e-9);
+}
+
+TEST(state_selector, TWO_DISAGREEING_SOURCES_STAY_USABLE)
+{
+    state_selector selector(&state_selector::angle_distance);
+    state_selector::tuning t(selector.get_tuning());
+    t.innovation_scale = 0.05;
+    selector.set_tuning(t);
+
+    const int nav = selector.add_source("nav", 1);
+    const int ahrs = selector.add_source("ahrs", 1);
+
+    // ten degrees apart in yaw, with nothing to say which is right
+    const state_selector::value_type yawed = {{0, 0, 0.17}};
+    selector.publish(nav, LEVEL, 0);
+    selector.publish(ahrs, yawed, 0.1);
+
+    EXPECT_EQ(nav, selector.select());
+    std::vector<state_selector::health> healths(selector.report());
+    EXPECT_TRUE(healths[nav].usable);
+    EXPECT_TRUE(healths[ahrs].usable);
+    EXPECT_NEAR(0.17, healths[nav].innovation, 1e-9);
+}
+
+TEST(state_selector, SELECTION_KEPT_WHILE_NOTHING_IS_USABLE)
+{
+    state_selector selector(&state_selector::angle_distance);
+    state_selector::tuning t(selector.get_tuning());
+    t.min_score = 0.5;
+    selector.set_tuning(t);
+
+    const int only = selector.add_source("only", 1);
+    selector.publish(only, LEVEL, 0);
+    const state_selector::clock::time_point start = state_selector::clock::now();
+    EXPECT_EQ(only, selector.select(start));
+
+    // it reports itself worse than min_score but is all there is
+    selector.publish(only, LEVEL, 5);
+    EXPECT_EQ(only, selector.select(start + ms(10)));
+    EXPECT_FALSE(selector.report()[only].usable);
+
+    // until it goes stale
+    EXPECT_EQ(-1, selector.select(start + std::chrono::seconds(6)));
+}
+
+TEST(state_selector, LATENCY_LOWERS_THE_SCORE)
+{
+    state_selector selector(&state_selector::angle_distance);
+    const int prompt = selector.add_source("prompt", 1);
+    const int late = selector.add_source("late", 1);
+
+    selector.publish(late, LEVEL, 0, state_selector::clock::now() - ms(200));
+    selector.publish(prompt, LEVEL, 0, state_selector::clock::now());
+    EXPECT_EQ(prompt, selector.select());
+
+    std::vector<state_selector::health> healths(selector.report());
+    EXPECT_NEAR(0.2, healths[late].latency, 0.05);
+    EXPECT_LT(healths[late].score, healths[prompt].score);
+}
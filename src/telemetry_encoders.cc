@@ -0,0 +1,49 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "telemetry_encoders.h"
+
+/* STL Headers */
+#include <cmath>
+
+namespace telemetry
+{
+
+void ned_to_body(const float euler[3], const float ned[3], float body[3])
+{
+    // the rows of the ned to body rotation, see IMU::euler_to_rotation()
+    const double sr = sin(euler[0]), cr = cos(euler[0]);
+    const double sp = sin(euler[1]), cp = cos(euler[1]);
+    const double sy = sin(euler[2]), cy = cos(euler[2]);
+
+    body[0] = cy*cp*ned[0] + sy*cp*ned[1] - sp*ned[2];
+    body[1] = (-sy*cr + cy*sp*sr)*ned[0] + (cy*cr + sy*sp*sr)*ned[1] + cp*sr*ned[2];
+    body[2] = (sy*sr + cy*sp*cr)*ned[0] + (-cy*sr + sy*sp*cr)*ned[1] + cp*cr*ned[2];
+}
+
+void encode_position(const snapshot& s, uint8_t system_id, uint8_t component_id, mavlink_message_t* msg)
+{
+    mavlink_msg_ualberta_position_pack(system_id, component_id, msg,
+                                       s.llh_pos, s.ned_pos, s.ned_vel, s.ned_origin,
+                                       s.ref_pos, s.body_error, s.ned_error,
+                                       s.time_ms);
+}
+
+void encode_attitude(const snapshot& s, uint8_t system_id, uint8_t component_id, mavlink_message_t* msg)
+{
+    mavlink_msg_ualberta_attitude_pack(system_id, component_id, msg,
+                                       s.nav_euler, s.nav_ang_rate, s.ahrs_euler, s.ahrs_ang_rate,
+                                       s.attitude_reference,
+                                       s.time_ms);
+}
+
+void encode_control_effort(const float effort[6], uint8_t system_id, uint8_t component_id, mavlink_message_t* msg)
+{
+    mavlink_msg_ualberta_control_effort_pack(system_id, component_id, msg, effort);
+}
+
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef TELEMETRY_ENCODERS_H_
+#define TELEMETRY_ENCODERS_H_
+
+/* STL Headers */
+#include <cstdint>
+
+/* Mavlink Headers */
+#include <mavlink.h>
+
+/**
+ * @brief Encoders for the custom telemetry messages sent by QGCSend
+ *
+ * A snapshot holds everything the ualberta_position and ualberta_attitude
+ * messages report, captured at one instant: IMU::capture_telemetry() copies
+ * the estimator state under all of its locks at once and
+ * Control::capture_telemetry() adds the references and the errors computed
+ * from that same state.  The encoders then hand the snapshot's arrays straight
+ * to the dialect's pack functions, so building a message on the send thread
+ * allocates nothing.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+namespace telemetry
+{
+
+struct snapshot
+{
+    uint32_t time_ms;
+    /// true if the nav filter attitude is the one in use, otherwise the ahrs
+    bool nav_attitude;
+
+    float llh_pos[3];
+    float ned_pos[3];
+    float ned_vel[3];
+    float ned_origin[3];
+    float ref_pos[3];
+    float body_error[3];
+    float ned_error[3];
+
+    float nav_euler[3];
+    float nav_ang_rate[3];
+    float ahrs_euler[3];
+    float ahrs_ang_rate[3];
+    float attitude_reference[3];
+
+    /// the euler angles in use
+    const float* euler() const
+    {
+        return nav_attitude ? nav_euler : ahrs_euler;
+    }
+};
+
+/// rotate a ned vector in to the body frame given by euler (roll, pitch, yaw)
+void ned_to_body(const float euler[3], const float ned[3], float body[3]);
+
+void encode_position(const snapshot& s, uint8_t system_id, uint8_t component_id, mavlink_message_t* msg);
+void encode_attitude(const snapshot& s, uint8_t system_id, uint8_t component_id, mavlink_message_t* msg);
+void encode_control_effort(const float effort[6], uint8_t system_id, uint8_t component_id, mavlink_message_t* msg);
+
+}
+
+#endif
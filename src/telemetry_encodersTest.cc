@@ -0,0 +1,114 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "telemetry_encoders.h"
+#include <boost/numeric/ublas/vector.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace blas = boost::numeric::ublas;
+
+namespace
+{
+typedef std::chrono::steady_clock clock_type;
+
+const size_t ROUNDS = 20000;
+
+blas::vector<double> vec3(double a, double b, double c)
+{
+    blas::vector<double> v(3);
+    v[0] = a;
+    v[1] = b;
+    v[2] = c;
+    return v;
+}
+
+/// the estimator state as the getters return it
+struct state
+{
+    blas::vector<double> euler = vec3(0.1, -0.2, 1.5);
+    blas::vector<double> rate = vec3(0.01, 0.02, -0.03);
+    blas::vector<double> reference = vec3(0.05, -0.05, 0);
+};
+
+/// the attitude message built the way IMU::sendMavlinkMsg() used to
+void encode_with_vectors(const state& st, mavlink_message_t* msg)
+{
+    blas::vector<double> _nav_euler(st.euler);
+    std::vector<float> nav_euler(_nav_euler.begin(), _nav_euler.end());
+    blas::vector<double> _nav_ang_rate(st.rate);
+    std::vector<float> nav_ang_rate(_nav_ang_rate.begin(), _nav_ang_rate.end());
+    blas::vector<double> _ahrs_euler(st.euler);
+    std::vector<float> ahrs_euler(_ahrs_euler.begin(), _ahrs_euler.end());
+    blas::vector<double> _ahrs_ang_rate(st.rate);
+    std::vector<float> ahrs_ang_rate(_ahrs_ang_rate.begin(), _ahrs_ang_rate.end());
+    blas::vector<double> _attitude_reference(st.reference);
+    std::vector<float> attitude_reference(_attitude_reference.begin(), _attitude_reference.end());
+
+    mavlink_msg_ualberta_attitude_pack(1, 2, msg, &nav_euler[0], &nav_ang_rate[0], &ahrs_euler[0],
+                                       &ahrs_ang_rate[0], &attitude_reference[0], 1234);
+}
+
+void fill(const state& st, telemetry::snapshot& s)
+{
+    for (size_t i = 0; i < 3; ++i)
+    {
+        s.nav_euler[i] = s.ahrs_euler[i] = st.euler[i];
+        s.nav_ang_rate[i] = s.ahrs_ang_rate[i] = st.rate[i];
+        s.attitude_reference[i] = st.reference[i];
+    }
+    s.time_ms = 1234;
+}
+}
+
+// TESTS
+TEST(telemetry_encoders, NED_TO_BODY)
+{
+    // facing east, north is to the left
+    const float euler[3] = {0, 0, static_cast<float>(M_PI / 2)};
+    const float ned[3] = {1, 0, 0};
+    float body[3];
+    telemetry::ned_to_body(euler, ned, body);
+    EXPECT_NEAR(0, body[0], 1e-6);
+    EXPECT_NEAR(-1, body[1], 1e-6);
+    EXPECT_NEAR(0, body[2], 1e-6);
+
+    // pitched up, down has a forward component
+    const float pitched[3] = {0, static_cast<float>(M_PI / 2), 0};
+    const float down[3] = {0, 0, 1};
+    telemetry::ned_to_body(pitched, down, body);
+    EXPECT_NEAR(-1, body[0], 1e-6);
+}
+
+TEST(telemetry_encoders, MATCHES_VECTOR_PATH_AND_REPORTS_COST)
+{
+    const state st;
+    mavlink_message_t before, after;
+
+    const clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < ROUNDS; ++i)
+        encode_with_vectors(st, &before);
+    const clock_type::time_point middle = clock_type::now();
+    for (size_t i = 0; i < ROUNDS; ++i)
+    {
+        telemetry::snapshot s;
+        fill(st, s);
+        telemetry::encode_attitude(s, 1, 2, &after);
+    }
+    const clock_type::time_point end = clock_type::now();
+
+    EXPECT_EQ(before.len, after.len);
+    EXPECT_EQ(0, memcmp(_MAV_PAYLOAD(&before), _MAV_PAYLOAD(&after), before.len));
+
+    const double vector_ns = std::chrono::duration<double, std::nano>(middle - start).count() / ROUNDS;
+    const double snapshot_ns = std::chrono::duration<double, std::nano>(end - middle).count() / ROUNDS;
+    std::cout << "ualberta_attitude encode: " << vector_ns << " ns with vectors, "
+              << snapshot_ns << " ns from a snapshot" << std::endl;
+}
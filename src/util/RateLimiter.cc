@@ -48,9 +48,7 @@ float RateLimiter::wait()
 
     if(_checkload)
     {
-        std::chrono::high_resolution_clock::time_point const now = std::chrono::high_resolution_clock::now();
-        float used = std::chrono::duration_cast<std::chrono::milliseconds>(now - _nextTime).count() + _msPerLoop;
-        ret = used / _msPerLoop;
+        ret = load(std::chrono::high_resolution_clock::now());
     }
 
     std::chrono::high_resolution_clock::time_point const timeout = _nextTime;
@@ -67,6 +65,26 @@ float RateLimiter::wait()
     return ret;
 }
 
+float RateLimiter::busy() const
+{
+    if(_checkload)
+    {
+        return load(std::chrono::high_resolution_clock::now());
+    }
+    return 0;
+}
+
+void RateLimiter::restart()
+{
+    _nextTime = std::chrono::high_resolution_clock::now() + _msToWait;
+}
+
+float RateLimiter::load(std::chrono::high_resolution_clock::time_point now) const
+{
+    float used = std::chrono::duration_cast<std::chrono::milliseconds>(now - _nextTime).count() + _msPerLoop;
+    return used / _msPerLoop;
+}
+
 void RateLimiter::finishedCriticalSection()
 {
     // yield the thread so others can execute now.
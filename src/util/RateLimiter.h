@@ -19,6 +19,9 @@ private:
     bool _checkload;
     float _msPerLoop;
 
+    /// proportion of the period used if the loop woke now
+    float load(std::chrono::high_resolution_clock::time_point now) const;
+
 public:
     /**
      * Provides a limiting mechanism to functions
@@ -41,6 +44,19 @@ public:
      */
     float wait();
 
+    /**
+     * For a loop woken by something other than wait(), the proportion of the
+     * period used since it last woke, 0 if load checking is off.  Call it
+     * when the work is done and before waiting, as wait() does.
+     */
+    float busy() const;
+
+    /**
+     * For a loop woken by something other than wait(), start the next period
+     * from now so wait() does not hurry to catch up.
+     */
+    void restart();
+
     /**
      * This function is called when the loop is finished with one iteration,
      * it gives the OS an opportunity to do some cleanup and go about doing other
@@ -49,3 +49,18 @@ TEST(RateLimiter, Frequency_Acceptable_10HZ)
 
     EXPECT_LT(error, 10);
 }
+
+TEST(RateLimiter, BUSY_IS_THE_WORK_NOT_THE_WAIT)
+{
+    RateLimiter rl(10, true);
+
+    // woken by something else, works for 30 ms of the 100 ms period
+    rl.restart();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_NEAR(0.3, rl.busy(), 0.05);
+
+    // and waits for the rest, which is not load
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    rl.restart();
+    EXPECT_NEAR(0, rl.busy(), 0.05);
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "deadline_watchdog.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/* System Headers */
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const size_t deadline_watchdog::MAX_THREADS;
+const size_t deadline_watchdog::MAX_FRAMES;
+const size_t deadline_watchdog::NAME_LENGTH;
+
+namespace
+{
+struct slot
+{
+    std::atomic<bool> used;
+    char name[deadline_watchdog::NAME_LENGTH];
+    pthread_t thread;
+    pid_t tid;
+
+    std::atomic<int64_t> period_ns;
+    std::atomic<int64_t> last_ns;
+    std::atomic<uint64_t> check_ins;
+
+    /// written by the signal handler, -1 while a capture is outstanding
+    std::atomic<int> depth;
+    void* frames[deadline_watchdog::MAX_FRAMES];
+
+    /// only touched by poll()
+    bool stalled;
+    int64_t stalled_since_ns;
+};
+
+slot slots[deadline_watchdog::MAX_THREADS];
+std::mutex enroll_lock;
+std::atomic<int> capture_signal(0);
+
+thread_local slot* current = nullptr;
+thread_local bool enroll_failed = false;
+
+/// gives the slot back when the thread exits
+struct retirer
+{
+    ~retirer()
+    {
+        if (current != nullptr)
+            current->used = false;
+        current = nullptr;
+    }
+};
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               deadline_watchdog::clock::now().time_since_epoch()).count();
+}
+
+slot* enroll(const char* name, int64_t period_ns)
+{
+    std::lock_guard<std::mutex> guard(enroll_lock);
+    for (slot& s : slots)
+    {
+        if (s.used)
+            continue;
+
+        strncpy(s.name, name, sizeof(s.name) - 1);
+        s.name[sizeof(s.name) - 1] = '\0';
+        s.thread = pthread_self();
+        s.tid = syscall(SYS_gettid);
+        s.period_ns = period_ns;
+        s.last_ns = now_ns();
+        s.check_ins = 0;
+        s.depth = 0;
+        s.stalled = false;
+        s.used = true;
+        return &s;
+    }
+    return nullptr;
+}
+
+void capture_stack(int)
+{
+    slot* s = current;
+    if (s == nullptr)
+        return;
+
+    const int saved_errno = errno;
+    s->depth.store(backtrace(s->frames, deadline_watchdog::MAX_FRAMES), std::memory_order_release);
+    errno = saved_errno;
+}
+
+std::string read_proc(pid_t tid, const char* file)
+{
+    std::ifstream in(("/proc/self/task/" + std::to_string(tid) + "/" + file).c_str());
+    std::string contents;
+    std::getline(in, contents);
+    return contents;
+}
+
+/// the run state, wait channel and system call of thread tid
+std::string describe_thread(pid_t tid)
+{
+    std::stringstream out;
+
+    // the state follows the parenthesised command name
+    const std::string stat = read_proc(tid, "stat");
+    const size_t paren = stat.rfind(')');
+    if (paren != std::string::npos && paren + 2 < stat.size())
+        out << "state " << stat[paren + 2];
+
+    out << " wchan " << read_proc(tid, "wchan");
+
+    // "number arg1 ...", the first argument of a futex wait is the lock word
+    const std::string call = read_proc(tid, "syscall");
+    std::istringstream fields(call);
+    long number = -1;
+    std::string address;
+    fields >> number >> address;
+#ifdef SYS_futex
+    if (number == SYS_futex)
+        out << " futex " << address;
+    else
+#endif
+        out << " syscall " << call;
+
+    return out.str();
+}
+}
+
+void deadline_watchdog::check_in(const char* name, clock::duration period)
+{
+    const int64_t period_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+    if (current == nullptr)
+    {
+        if (enroll_failed)
+            return;
+
+        static thread_local retirer retire;
+        (void)retire;
+
+        current = enroll(name, period_ns);
+        if (current == nullptr)
+        {
+            enroll_failed = true;
+            return;
+        }
+    }
+
+    current->period_ns.store(period_ns, std::memory_order_relaxed);
+    current->last_ns.store(now_ns(), std::memory_order_release);
+    current->check_ins.fetch_add(1, std::memory_order_relaxed);
+}
+
+void deadline_watchdog::check_out()
+{
+    if (current != nullptr)
+        current->used = false;
+    current = nullptr;
+}
+
+bool deadline_watchdog::install(int signal)
+{
+    // the first backtrace() loads the unwinder, which is not safe in a handler
+    void* frames[1];
+    backtrace(frames, 1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = capture_stack;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(signal, &action, nullptr) != 0)
+        return false;
+
+    capture_signal = signal;
+    return true;
+}
+
+void deadline_watchdog::poll(double slack, clock::duration capture_timeout,
+                             std::vector<stall>& stalls, std::vector<recovery>& recovered)
+{
+    stalls.clear();
+    recovered.clear();
+
+    for (slot& s : slots)
+    {
+        if (! s.used)
+            continue;
+
+        const int64_t period = s.period_ns.load(std::memory_order_relaxed);
+        const int64_t last = s.last_ns.load(std::memory_order_acquire);
+        const int64_t now = now_ns();
+        const int64_t deadline = last + static_cast<int64_t>(period * (1 + slack));
+
+        if (s.stalled && last != s.stalled_since_ns)
+        {
+            s.stalled = false;
+            recovered.push_back({s.name, std::chrono::nanoseconds(last - s.stalled_since_ns)});
+        }
+
+        if (s.stalled || now <= deadline)
+            continue;
+
+        s.stalled = true;
+        s.stalled_since_ns = last;
+
+        stall event;
+        event.name = s.name;
+        event.tid = s.tid;
+        event.period = std::chrono::nanoseconds(period);
+        event.overdue = std::chrono::nanoseconds(now - deadline);
+        event.check_ins = s.check_ins.load(std::memory_order_relaxed);
+
+        s.depth.store(-1, std::memory_order_relaxed);
+        if (capture_signal != 0 && pthread_kill(s.thread, capture_signal) == 0)
+        {
+            // a thread in uninterruptible sleep runs the handler only when it wakes
+            const clock::time_point give_up = clock::now() + capture_timeout;
+            while (s.depth.load(std::memory_order_acquire) < 0 && clock::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+
+        event.state = describe_thread(s.tid);
+
+        const int depth = s.depth.load(std::memory_order_acquire);
+        if (depth > 0)
+        {
+            char** symbols = backtrace_symbols(s.frames, depth);
+            // skip the handler and the signal trampoline
+            for (int i = std::min(2, depth - 1); symbols != nullptr && i < depth; ++i)
+                event.stack.push_back(symbols[i]);
+            free(symbols);
+        }
+
+        stalls.push_back(event);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef DEADLINE_WATCHDOG_H_
+#define DEADLINE_WATCHDOG_H_
+
+/* STL Headers */
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* System Headers */
+#include <sys/types.h>
+
+/**
+ * @brief Tracks periodic threads and notices when one misses its deadline
+ *
+ * A watched thread calls check_in() once per period.  The first call takes a
+ * slot from a fixed table under a lock, every later one is three relaxed
+ * atomic stores so the watched threads never wait on the watchdog.  A thread's
+ * slot is given back when it exits or calls check_out().
+ *
+ * poll() is called by a monitor thread.  A thread whose last check in is more
+ * than (1 + slack) periods old is stalled: it is sent a signal whose handler
+ * backtrace()s in to the slot's preallocated frame buffer, and its kernel
+ * state, wait channel and current system call (which names the futex of a
+ * lock it is blocked on) are read from /proc.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class deadline_watchdog
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    static const size_t MAX_THREADS = 128;
+    static const size_t MAX_FRAMES = 32;
+    static const size_t NAME_LENGTH = 32;
+
+    /// a thread that missed its deadline
+    struct stall
+    {
+        std::string name;
+        pid_t tid;
+        clock::duration period;
+        /// time since the deadline that was missed
+        clock::duration overdue;
+        uint64_t check_ins;
+        /// state, wait channel and system call from /proc
+        std::string state;
+        /// empty if the thread did not run the signal handler in time
+        std::vector<std::string> stack;
+    };
+
+    /// a stalled thread that checked in again
+    struct recovery
+    {
+        std::string name;
+        /// time between the check ins either side of the stall
+        clock::duration stalled_for;
+    };
+
+    /// watch the calling thread under name, which is copied on the first call
+    static void check_in(const char* name, clock::duration period);
+    /// stop watching the calling thread, e.g. before it blocks indefinitely
+    static void check_out();
+
+    /// install the stack capture handler for signal, @returns false if it could not be
+    static bool install(int signal);
+
+    /**
+     * Find threads that missed their deadline since the last poll and those
+     * that recovered.
+     *
+     * @param slack fraction of a period a check in may be late by
+     * @param capture_timeout time to wait for a stalled thread's stack
+     */
+    static void poll(double slack, clock::duration capture_timeout,
+                     std::vector<stall>& stalls, std::vector<recovery>& recovered);
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "deadline_watchdog.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <signal.h>
+#include <gtest/gtest.h>
+
+// TESTS
+TEST(deadline_watchdog, CAPTURES_A_THREAD_BLOCKED_ON_A_LOCK)
+{
+    ASSERT_TRUE(deadline_watchdog::install(SIGRTMIN + 4));
+
+    std::mutex held;
+    std::atomic<bool> done(false);
+    held.lock();
+
+    std::thread worker([&]()
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            deadline_watchdog::check_in("test worker", std::chrono::milliseconds(10));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        held.lock();
+        deadline_watchdog::check_in("test worker", std::chrono::milliseconds(10));
+        held.unlock();
+        while (! done)
+        {
+            deadline_watchdog::check_in("test worker", std::chrono::milliseconds(10));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        deadline_watchdog::check_out();
+    });
+
+    std::vector<deadline_watchdog::stall> stalls;
+    std::vector<deadline_watchdog::recovery> recovered;
+    std::vector<deadline_watchdog::stall> found;
+    for (int i = 0; i < 200 && found.empty(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        deadline_watchdog::poll(0.5, std::chrono::milliseconds(50), found, recovered);
+    }
+
+    ASSERT_EQ(1u, found.size());
+    EXPECT_EQ("test worker", found[0].name);
+    EXPECT_EQ(5u, found[0].check_ins);
+    EXPECT_GT(found[0].overdue.count(), 0);
+    EXPECT_FALSE(found[0].stack.empty());
+    EXPECT_NE(std::string::npos, found[0].state.find("state"));
+
+    // reported once per stall
+    deadline_watchdog::poll(0.5, std::chrono::milliseconds(50), stalls, recovered);
+    EXPECT_TRUE(stalls.empty());
+
+    held.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    deadline_watchdog::poll(0.5, std::chrono::milliseconds(50), stalls, recovered);
+    ASSERT_EQ(1u, recovered.size());
+    EXPECT_GE(recovered[0].stalled_for, std::chrono::milliseconds(15));
+
+    done = true;
+    worker.join();
+}
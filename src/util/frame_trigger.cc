@@ -0,0 +1,55 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "frame_trigger.h"
+
+frame_trigger::frame_trigger(clock::duration period)
+    : period(period),
+      last_tick(),
+      last_frame(),
+      interval(clock::duration::zero()),
+      long_gaps(0)
+{
+}
+
+void frame_trigger::started(clock::time_point now, clock::time_point received)
+{
+    last_tick = now;
+    if (received == last_frame)
+        return;
+
+    // the interval is smoothed over the jitter of the reads, a single long gap
+    // is lost frames and two in a row are a slower rate
+    if (last_frame != clock::time_point())
+    {
+        const clock::duration gap = received - last_frame;
+        if (interval != clock::duration::zero() && gap < interval * 3 / 2)
+        {
+            interval += (gap - interval) / 8;
+            long_gaps = 0;
+        }
+        else if (interval == clock::duration::zero() || ++long_gaps >= 2)
+        {
+            interval = gap;
+            long_gaps = 0;
+        }
+    }
+    last_frame = received;
+}
+
+frame_trigger::clock::time_point frame_trigger::deadline() const
+{
+    clock::time_point due = last_tick + period;
+    if (interval <= clock::duration::zero())
+        return due;
+
+    // the first frame due after the last tick
+    const clock::time_point expected = last_frame + ((last_tick - last_frame) / interval + 1) * interval;
+    if (due > expected - period / 2 && due < expected + period / 2)
+        due = expected + period / 2;
+    return due;
+}
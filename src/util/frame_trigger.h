@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef FRAME_TRIGGER_H_
+#define FRAME_TRIGGER_H_
+
+/* STL Headers */
+#include <chrono>
+
+/**
+ * @brief Schedules a loop that starts a tick when an input frame arrives and
+ * fills in with timed ticks between frames
+ *
+ * The loop waits for a frame until deadline(), but not before earliest(), and
+ * calls started() at the top of every tick.  Timed ticks come a period after
+ * the last tick.  Since the inputs come at their own rate, a timed tick that
+ * would land within half a period of the next frame is moved to half a period
+ * after it, so once a few frames have given the interval a frame on time
+ * starts its own tick instead of waiting behind a timed one.  If frames stop
+ * the loop runs on the timer alone.  No tick starts within half a period of
+ * the last one, so a fast input can not run the loop at more than twice its
+ * rate.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class frame_trigger
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    explicit frame_trigger(clock::duration period);
+
+    /**
+     * A tick started at now.
+     * @param received when the newest frame arrived, the same as last time if none came
+     */
+    void started(clock::time_point now, clock::time_point received);
+
+    /// the first time a frame may start the next tick
+    clock::time_point earliest() const
+    {
+        return last_tick + period / 2;
+    }
+
+    /// when the next tick starts if no frame arrives first
+    clock::time_point deadline() const;
+
+    /// the last time between frames, zero until two have arrived
+    clock::duration frame_interval() const
+    {
+        return interval;
+    }
+
+private:
+    const clock::duration period;
+    clock::time_point last_tick;
+    clock::time_point last_frame;
+    clock::duration interval;
+    /// gaps in a row too long to be the interval
+    unsigned long_gaps;
+};
+
+#endif
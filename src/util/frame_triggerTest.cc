@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "frame_trigger.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+typedef frame_trigger::clock clock;
+typedef std::chrono::microseconds us;
+
+const us PERIOD(10000);
+
+struct tick
+{
+    clock::time_point at;
+    /// the frame it started for, -1 for a timed tick
+    int frame;
+};
+
+/// run a loop against frames arriving at the given times until end
+std::vector<tick> run(const std::vector<clock::time_point>& frames, clock::time_point start, clock::time_point end)
+{
+    frame_trigger trigger(PERIOD);
+    trigger.started(start, clock::time_point());
+
+    std::vector<tick> ticks;
+    size_t next = 0;
+    clock::time_point received;
+    while (true)
+    {
+        // the loop sleeps until earliest() and then waits for a frame until deadline()
+        tick t = {trigger.deadline(), -1};
+        if (next < frames.size() && frames[next] <= t.at)
+        {
+            t.at = std::max(frames[next], trigger.earliest());
+            t.frame = next;
+            received = frames[next++];
+        }
+        if (t.at >= end)
+            return ticks;
+
+        trigger.started(t.at, received);
+        ticks.push_back(t);
+    }
+}
+}
+
+TEST(frame_trigger, FRAMES_START_TICKS_AND_THE_TIMER_FILLS_IN)
+{
+    // the servo switch at 50 Hz with a couple of milliseconds of jitter
+    const clock::time_point start = clock::now();
+    std::vector<clock::time_point> frames;
+    srand(1);
+    for (int i = 1; i <= 500; ++i)
+        frames.push_back(start + i * us(20000) + us(rand() % 4000 - 2000));
+
+    const std::vector<tick> ticks = run(frames, start, frames.back() + us(1));
+
+    size_t framed = 0;
+    for (size_t i = 0; i < ticks.size(); ++i)
+    {
+        // once the interval is known no frame waits for its tick
+        if (ticks[i].frame >= 3)
+        {
+            EXPECT_EQ(frames[ticks[i].frame], ticks[i].at) << "frame " << ticks[i].frame;
+        }
+        if (ticks[i].frame >= 0)
+        {
+            EXPECT_LE(ticks[i].at - frames[ticks[i].frame], PERIOD / 2);
+            ++framed;
+        }
+        if (i > 0)
+        {
+            EXPECT_GE(ticks[i].at - ticks[i - 1].at, PERIOD / 2);
+            EXPECT_LE(ticks[i].at - ticks[i - 1].at, PERIOD * 3 / 2);
+        }
+    }
+    EXPECT_EQ(frames.size(), framed);
+    // and a timed tick between each pair of frames keeps the loop near its rate
+    EXPECT_NEAR(2 * frames.size(), ticks.size(), 5);
+}
+
+TEST(frame_trigger, LOST_FRAMES_FALL_BACK_TO_THE_TIMER)
+{
+    const clock::time_point start = clock::now();
+    std::vector<clock::time_point> frames;
+    for (int i = 1; i <= 10; ++i)
+    {
+        // every third frame is lost
+        if (i % 3 != 0)
+            frames.push_back(start + i * us(20000));
+    }
+    // and then they stop
+    const clock::time_point end = frames.back() + us(200000);
+    const std::vector<tick> ticks = run(frames, start, end);
+
+    for (size_t i = 1; i < ticks.size(); ++i)
+    {
+        EXPECT_GE(ticks[i].at - ticks[i - 1].at, PERIOD / 2);
+        EXPECT_LE(ticks[i].at - ticks[i - 1].at, PERIOD * 3 / 2);
+        if (ticks[i].frame >= 0)
+        {
+            EXPECT_EQ(frames[ticks[i].frame], ticks[i].at);
+        }
+    }
+    EXPECT_GE(ticks.back().at, end - PERIOD);
+}
+
+TEST(frame_trigger, FRAME_INTERVAL_IGNORES_A_LOST_FRAME)
+{
+    frame_trigger trigger(PERIOD);
+    const clock::time_point start = clock::now();
+    trigger.started(start, start);
+    EXPECT_EQ(clock::duration::zero(), trigger.frame_interval());
+
+    trigger.started(start + us(20000), start + us(20000));
+    EXPECT_EQ(us(20000), trigger.frame_interval());
+
+    // one lost
+    trigger.started(start + us(60000), start + us(60000));
+    EXPECT_EQ(us(20000), trigger.frame_interval());
+    trigger.started(start + us(80000), start + us(80000));
+    EXPECT_EQ(us(20000), trigger.frame_interval());
+
+    // a slower rate is taken on the second long gap
+    trigger.started(start + us(110000), start + us(110000));
+    trigger.started(start + us(140000), start + us(140000));
+    EXPECT_EQ(us(30000), trigger.frame_interval());
+}
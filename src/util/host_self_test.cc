@@ -0,0 +1,282 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "host_self_test.h"
+
+/* STL Headers */
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+/* System Headers */
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+double microseconds(host_self_test::clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+/// the /proc/stat line of cpu, or of all CPUs if negative
+std::string cpu_times(int cpu)
+{
+    const std::string name = cpu < 0 ? "cpu" : "cpu" + std::to_string(cpu);
+    std::ifstream stat("/proc/stat");
+    std::string line;
+    while (std::getline(stat, line))
+    {
+        if (line.compare(0, name.size() + 1, name + " ") == 0)
+            return line;
+    }
+    return std::string();
+}
+
+speed_t baud_constant(int baudrate)
+{
+    switch (baudrate)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    default:
+        return B115200;
+    }
+}
+}
+
+host_self_test::percentiles host_self_test::percentiles::of(std::vector<double> samples_us)
+{
+    percentiles result = {samples_us.size(), 0, 0, 0};
+    if (samples_us.empty())
+        return result;
+
+    std::sort(samples_us.begin(), samples_us.end());
+    const size_t last = samples_us.size() - 1;
+    result.p50 = samples_us[last / 2];
+    result.p99 = samples_us[(last * 99) / 100];
+    result.max = samples_us[last];
+    return result;
+}
+
+host_self_test::percentiles host_self_test::wakeup_jitter(double rate_hz, clock::duration length, int cpu)
+{
+    std::vector<double> late_us;
+    std::thread sampler([&]()
+    {
+        if (cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+
+        const clock::duration period = std::chrono::duration_cast<clock::duration>(
+                                           std::chrono::duration<double>(1 / rate_hz));
+        const clock::time_point end = clock::now() + length;
+        late_us.reserve(length / period + 1);
+
+        clock::time_point next = clock::now();
+        while (next < end)
+        {
+            next += period;
+            std::this_thread::sleep_until(next);
+            late_us.push_back(microseconds(clock::now() - next));
+        }
+    });
+    sampler.join();
+
+    return percentiles::of(late_us);
+}
+
+host_self_test::percentiles host_self_test::serial_round_trip(int fd, const std::string& probe, const std::string& reply,
+                                                              size_t count, clock::duration timeout, size_t* lost)
+{
+    const std::string& expected = reply.empty() ? probe : reply;
+    std::vector<double> round_trip_us;
+    *lost = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        tcflush(fd, TCIFLUSH);
+
+        const clock::time_point start = clock::now();
+        if (write(fd, probe.data(), probe.size()) != static_cast<ssize_t>(probe.size()))
+        {
+            ++*lost;
+            continue;
+        }
+
+        std::string received;
+        const clock::time_point give_up = start + timeout;
+        bool answered = false;
+        while (! answered)
+        {
+            const int remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(give_up - clock::now()).count();
+            struct pollfd readable = {fd, POLLIN, 0};
+            if (remaining_ms <= 0 || poll(&readable, 1, remaining_ms) <= 0)
+                break;
+
+            char buffer[256];
+            const ssize_t got = read(fd, buffer, sizeof(buffer));
+            if (got <= 0)
+                break;
+            received.append(buffer, got);
+            answered = received.find(expected) != std::string::npos;
+        }
+
+        if (answered)
+            round_trip_us.push_back(microseconds(clock::now() - start));
+        else
+            ++*lost;
+    }
+
+    return percentiles::of(round_trip_us);
+}
+
+host_self_test::write_latency host_self_test::log_volume(const std::string& directory, size_t block_bytes, size_t count)
+{
+    std::vector<double> write_us, sync_us;
+    const std::string path = directory + "/self_test.dat";
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        const std::string block(block_bytes, 'x');
+        for (size_t i = 0; i < count; ++i)
+        {
+            const clock::time_point start = clock::now();
+            if (write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size()))
+                break;
+            const clock::time_point written = clock::now();
+            if (fdatasync(fd) != 0)
+                break;
+            write_us.push_back(microseconds(written - start));
+            sync_us.push_back(microseconds(clock::now() - written));
+        }
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    write_latency result = {percentiles::of(write_us), percentiles::of(sync_us)};
+    return result;
+}
+
+double host_self_test::cpu_headroom(clock::duration length, int cpu)
+{
+    const std::string before = cpu_times(cpu);
+    std::this_thread::sleep_for(length);
+    return idle_fraction(before, cpu_times(cpu));
+}
+
+double host_self_test::idle_fraction(const std::string& before, const std::string& after)
+{
+    // user nice system idle iowait irq softirq steal
+    unsigned long long first[8] = {0}, second[8] = {0};
+    std::istringstream a(before), b(after);
+    std::string name;
+    a >> name;
+    b >> name;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        a >> first[i];
+        b >> second[i];
+    }
+
+    double total = 0, idle = 0;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        const double spent = second[i] >= first[i] ? second[i] - first[i] : 0;
+        total += spent;
+        if (i == 3 || i == 4)
+            idle += spent;
+    }
+    return total > 0 ? idle / total : 0;
+}
+
+int host_self_test::open_port(const std::string& device, int baudrate)
+{
+    const int fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+
+    struct termios options;
+    if (tcgetattr(fd, &options) == 0)
+    {
+        cfmakeraw(&options);
+        cfsetispeed(&options, baud_constant(baudrate));
+        cfsetospeed(&options, baud_constant(baudrate));
+        options.c_cc[VMIN] = 0;
+        options.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &options);
+    }
+    return fd;
+}
+
+bool host_self_test::parse_hex(const std::string& hex, std::string& bytes)
+{
+    bytes.clear();
+    if (hex.size() % 2 != 0)
+        return false;
+
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        const std::string pair = hex.substr(i, 2);
+        if (! isxdigit(static_cast<unsigned char>(pair[0])) || ! isxdigit(static_cast<unsigned char>(pair[1])))
+            return false;
+        bytes.push_back(static_cast<char>(strtol(pair.c_str(), nullptr, 16)));
+    }
+    return true;
+}
+
+void host_self_test::expect_at_most(const std::string& name, double value, double limit, const std::string& units)
+{
+    _checks.push_back({name, value, limit, units, true});
+}
+
+void host_self_test::expect_at_least(const std::string& name, double value, double limit, const std::string& units)
+{
+    _checks.push_back({name, value, limit, units, false});
+}
+
+void host_self_test::fail(const std::string& name, const std::string& reason)
+{
+    _failures.push_back(name + ": " + reason);
+}
+
+bool host_self_test::passed() const
+{
+    return _failures.empty() && std::all_of(_checks.begin(), _checks.end(),
+                                            [](const check& c){ return c.passed(); });
+}
+
+std::string host_self_test::report() const
+{
+    std::ostringstream out;
+    for (const check& c : _checks)
+    {
+        out << (c.passed() ? "PASS " : "FAIL ") << c.name << ' ' << c.value << ' ' << c.units
+            << (c.at_most ? " (limit <= " : " (limit >= ") << c.limit << ")\n";
+    }
+    for (const std::string& failure : _failures)
+        out << "FAIL " << failure << '\n';
+    out << (passed() ? "PASSED" : "FAILED") << '\n';
+    return out.str();
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef HOST_SELF_TEST_H_
+#define HOST_SELF_TEST_H_
+
+/* STL Headers */
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Measures whether the host can keep up with the configured rates
+ *
+ * Each measurement stands alone so it can be pointed at a pty pair or a tmpfs
+ * directory in tests:
+ *  - wakeup_jitter() sleeps to absolute deadlines at a given rate, optionally
+ *    on one CPU, and records how late each wakeup was.
+ *  - serial_round_trip() writes a probe to a port and times the reply, which
+ *    is the probe itself on a loopback or a device's answer to an echo command.
+ *  - log_volume() times write() and fdatasync() of log sized blocks.
+ *  - cpu_headroom() is the idle fraction of one or all CPUs from /proc/stat.
+ *
+ * The results are compared against limits with expect_at_most() and
+ * expect_at_least() and written out with report().
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class host_self_test
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    /// summary of a set of latencies, in microseconds
+    struct percentiles
+    {
+        size_t count;
+        double p50;
+        double p99;
+        double max;
+
+        static percentiles of(std::vector<double> samples_us);
+    };
+
+    /// write and fdatasync latencies of one log_volume() run
+    struct write_latency
+    {
+        percentiles write;
+        percentiles sync;
+    };
+
+    /// one comparison of a measurement against its limit
+    struct check
+    {
+        std::string name;
+        double value;
+        double limit;
+        std::string units;
+        /// true if value must not exceed limit, false if it must reach it
+        bool at_most;
+
+        bool passed() const
+        {
+            return at_most ? value <= limit : value >= limit;
+        }
+    };
+
+    /**
+     * How late wakeups at rate_hz are for length.
+     * @param cpu run on this CPU, any CPU if negative
+     */
+    static percentiles wakeup_jitter(double rate_hz, clock::duration length, int cpu = -1);
+
+    /**
+     * Time count exchanges of probe and reply on fd.
+     * @param reply what the other end answers, the probe itself if empty
+     * @param lost set to the number of exchanges that timed out
+     */
+    static percentiles serial_round_trip(int fd, const std::string& probe, const std::string& reply,
+                                         size_t count, clock::duration timeout, size_t* lost);
+
+    /// time count writes of block_bytes, each followed by an fdatasync, in directory
+    static write_latency log_volume(const std::string& directory, size_t block_bytes, size_t count);
+
+    /// idle fraction of cpu (all CPUs if negative) over length
+    static double cpu_headroom(clock::duration length, int cpu = -1);
+    /// idle fraction between two /proc/stat cpu lines
+    static double idle_fraction(const std::string& before, const std::string& after);
+
+    /// open a serial device raw at baudrate, @returns -1 on failure
+    static int open_port(const std::string& device, int baudrate);
+    /// decode a string of hex digit pairs, @returns false if it is not one
+    static bool parse_hex(const std::string& hex, std::string& bytes);
+
+    void expect_at_most(const std::string& name, double value, double limit, const std::string& units);
+    void expect_at_least(const std::string& name, double value, double limit, const std::string& units);
+    /// record a measurement that could not be made
+    void fail(const std::string& name, const std::string& reason);
+
+    /// @returns true if every check passed
+    bool passed() const;
+    const std::vector<check>& checks() const
+    {
+        return _checks;
+    }
+    /// one line per check, then the failures
+    std::string report() const;
+
+private:
+    std::vector<check> _checks;
+    std::vector<std::string> _failures;
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "host_self_test.h"
+#include "Path.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+/// a pty pair with a thread on the master side answering every read with reply
+struct pty_device
+{
+    int master;
+    std::string slave;
+    std::atomic<bool> running;
+    std::thread responder;
+
+    explicit pty_device(const std::string& reply)
+        : master(posix_openpt(O_RDWR | O_NOCTTY)),
+          running(true)
+    {
+        grantpt(master);
+        unlockpt(master);
+        slave = ptsname(master);
+        responder = std::thread([this, reply]()
+        {
+            char buffer[64];
+            while (running)
+            {
+                struct pollfd readable = {master, POLLIN, 0};
+                if (poll(&readable, 1, 10) <= 0)
+                    continue;
+                const ssize_t got = read(master, buffer, sizeof(buffer));
+                if (got > 0 && write(master, reply.empty() ? buffer : reply.data(),
+                                     reply.empty() ? got : reply.size()) < 0)
+                    break;
+            }
+        });
+    }
+
+    ~pty_device()
+    {
+        running = false;
+        responder.join();
+        close(master);
+    }
+};
+}
+
+// TESTS
+TEST(host_self_test, PERCENTILES)
+{
+    std::vector<double> samples;
+    for (int i = 100; i > 0; --i)
+        samples.push_back(i);
+    const host_self_test::percentiles p = host_self_test::percentiles::of(samples);
+    EXPECT_EQ(100u, p.count);
+    EXPECT_EQ(50, p.p50);
+    EXPECT_EQ(99, p.p99);
+    EXPECT_EQ(100, p.max);
+    EXPECT_EQ(0u, host_self_test::percentiles::of(std::vector<double>()).count);
+}
+
+TEST(host_self_test, WAKEUP_JITTER)
+{
+    const host_self_test::percentiles p = host_self_test::wakeup_jitter(200, std::chrono::milliseconds(200), 0);
+    EXPECT_GE(p.count, 39u);
+    EXPECT_LE(p.count, 41u);
+    EXPECT_GE(p.p50, 0);
+    EXPECT_LE(p.p50, p.max);
+}
+
+TEST(host_self_test, SERIAL_LOOPBACK_AND_ECHO_COMMAND)
+{
+    size_t lost = 0;
+    {
+        pty_device loopback("");
+        const int fd = host_self_test::open_port(loopback.slave, 115200);
+        ASSERT_GE(fd, 0);
+        const host_self_test::percentiles p = host_self_test::serial_round_trip(fd, "ping", "", 10, std::chrono::milliseconds(500), &lost);
+        EXPECT_EQ(10u, p.count);
+        EXPECT_EQ(0u, lost);
+        EXPECT_GT(p.max, 0);
+        close(fd);
+    }
+
+    {
+        std::string probe, reply;
+        ASSERT_TRUE(host_self_test::parse_hex("75650101", probe));
+        ASSERT_TRUE(host_self_test::parse_hex("7565f1", reply));
+        EXPECT_EQ(std::string("\x75\x65\x01\x01", 4), probe);
+        EXPECT_FALSE(host_self_test::parse_hex("7g", reply));
+
+        pty_device device("OK\r\n");
+        const int fd = host_self_test::open_port(device.slave, 9600);
+        ASSERT_GE(fd, 0);
+        host_self_test::serial_round_trip(fd, probe, "OK", 5, std::chrono::milliseconds(500), &lost);
+        EXPECT_EQ(0u, lost);
+
+        // an answer that never comes
+        const host_self_test::percentiles p = host_self_test::serial_round_trip(fd, probe, "NO", 2, std::chrono::milliseconds(20), &lost);
+        EXPECT_EQ(0u, p.count);
+        EXPECT_EQ(2u, lost);
+        close(fd);
+    }
+}
+
+TEST(host_self_test, LOG_VOLUME)
+{
+    // tmpfs where there is one, the latencies are then those of the page cache
+    const std::string directory = Path("/dev/shm").exists() ? "/dev/shm" : "/tmp";
+    const host_self_test::write_latency latency = host_self_test::log_volume(directory, 4096, 20);
+    EXPECT_EQ(20u, latency.write.count);
+    EXPECT_EQ(20u, latency.sync.count);
+    EXPECT_FALSE(Path(directory + "/self_test.dat").exists());
+
+    EXPECT_EQ(0u, host_self_test::log_volume("/nonexistent", 4096, 20).sync.count);
+}
+
+TEST(host_self_test, CPU_IDLE_AND_REPORT)
+{
+    EXPECT_DOUBLE_EQ(0.75, host_self_test::idle_fraction("cpu  100 0 100 500 0 0 0 0 0 0",
+                                                         "cpu  110 0 110 560 0 0 0 0 0 0"));
+    const double headroom = host_self_test::cpu_headroom(std::chrono::milliseconds(50));
+    EXPECT_GE(headroom, 0);
+    EXPECT_LE(headroom, 1);
+
+    host_self_test test;
+    test.expect_at_most("jitter_p99", 100, 2000, "us");
+    test.expect_at_least("cpu_headroom", 0.5, 0.3, "");
+    EXPECT_TRUE(test.passed());
+    test.expect_at_most("sync_p99", 80, 50, "ms");
+    EXPECT_FALSE(test.passed());
+    test.fail("serial gx3", "could not open /dev/ser2");
+
+    const std::string report = test.report();
+    EXPECT_NE(std::string::npos, report.find("PASS jitter_p99 100 us (limit <= 2000)"));
+    EXPECT_NE(std::string::npos, report.find("FAIL sync_p99"));
+    EXPECT_NE(std::string::npos, report.find("FAIL serial gx3: could not open /dev/ser2"));
+    EXPECT_NE(std::string::npos, report.find("FAILED"));
+}
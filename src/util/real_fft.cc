@@ -0,0 +1,77 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "real_fft.h"
+
+/* STL Headers */
+#include <cmath>
+#include <stdexcept>
+
+real_fft::real_fft(size_t n)
+    : n(n)
+{
+    if (n < 4 || !is_power_of_two(n))
+        throw std::invalid_argument("real_fft size must be a power of two of at least 4");
+
+    const size_t m = n / 2;
+
+    twiddle.resize(m / 2);
+    for (size_t k = 0; k < twiddle.size(); ++k)
+        twiddle[k] = std::polar(1.0f, static_cast<float>(-2 * M_PI * k / m));
+
+    split.resize(m + 1);
+    for (size_t k = 0; k < split.size(); ++k)
+        split[k] = std::polar(1.0f, static_cast<float>(-2 * M_PI * k / n));
+
+    size_t bits = 0;
+    while ((size_t(1) << bits) < m)
+        ++bits;
+    reversed.resize(m);
+    for (size_t i = 0; i < m; ++i)
+    {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+    }
+
+    work.resize(m);
+}
+
+void real_fft::transform(const float* in, std::complex<float>* out)
+{
+    const size_t m = n / 2;
+
+    // even samples are the real part, odd samples the imaginary part
+    for (size_t i = 0; i < m; ++i)
+        work[reversed[i]] = std::complex<float>(in[2 * i], in[2 * i + 1]);
+
+    for (size_t length = 2; length <= m; length *= 2)
+    {
+        const size_t half = length / 2;
+        const size_t stride = m / length;
+        for (size_t start = 0; start < m; start += length)
+        {
+            for (size_t k = 0; k < half; ++k)
+            {
+                const std::complex<float> t = twiddle[k * stride] * work[start + k + half];
+                work[start + k + half] = work[start + k] - t;
+                work[start + k] += t;
+            }
+        }
+    }
+
+    // untangle the spectra of the even and odd samples
+    for (size_t k = 0; k <= m; ++k)
+    {
+        const std::complex<float> a = work[k % m];
+        const std::complex<float> b = std::conj(work[(m - k) % m]);
+        const std::complex<float> even = 0.5f * (a + b);
+        const std::complex<float> odd = std::complex<float>(0, -0.5f) * (a - b);
+        out[k] = even + split[k] * odd;
+    }
+}
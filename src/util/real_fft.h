@@ -0,0 +1,65 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef REAL_FFT_H_
+#define REAL_FFT_H_
+
+/* STL Headers */
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Fixed size FFT of real input
+ *
+ * The n real samples are packed into n/2 complex ones, transformed with an
+ * iterative radix-2 FFT and separated into the n/2 + 1 bins of the real
+ * spectrum.  Twiddle factors, the bit reversal table and the work buffer are
+ * allocated once by the constructor so transform() does not allocate.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class real_fft
+{
+public:
+    /// @param n number of samples, a power of two no smaller than 4
+    explicit real_fft(size_t n);
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    /// @returns the number of bins transform() writes, n/2 + 1
+    size_t bins() const
+    {
+        return n / 2 + 1;
+    }
+
+    /**
+     * Transform n samples.
+     * @param in n real samples
+     * @param out bins() complex bins, from 0 to the Nyquist frequency
+     */
+    void transform(const float* in, std::complex<float>* out);
+
+    static bool is_power_of_two(size_t n)
+    {
+        return n != 0 && (n & (n - 1)) == 0;
+    }
+
+private:
+    size_t n;
+    /// exp(-2 pi i k / (n/2)) for the half size complex transform
+    std::vector<std::complex<float> > twiddle;
+    /// exp(-2 pi i k / n) for separating the packed spectrum
+    std::vector<std::complex<float> > split;
+    std::vector<size_t> reversed;
+    std::vector<std::complex<float> > work;
+};
+
+#endif
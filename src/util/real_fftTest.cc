@@ -0,0 +1,37 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "real_fft.h"
+#include <cmath>
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+// TESTS
+TEST(real_fft, MATCHES_DFT)
+{
+    const size_t n = 64;
+    real_fft fft(n);
+    ASSERT_EQ(33u, fft.bins());
+
+    std::vector<float> x(n);
+    for (size_t i = 0; i < n; ++i)
+        x[i] = std::sin(0.3 * i) + 0.5 * std::cos(1.7 * i + 0.2) + (i % 5 == 0 ? 1 : 0);
+
+    std::vector<std::complex<float> > out(fft.bins());
+    fft.transform(&x[0], &out[0]);
+
+    for (size_t k = 0; k < fft.bins(); ++k)
+    {
+        std::complex<double> dft = 0;
+        for (size_t i = 0; i < n; ++i)
+            dft += double(x[i]) * std::polar(1.0, -2 * M_PI * k * i / n);
+        EXPECT_NEAR(dft.real(), out[k].real(), 1e-3) << "bin " << k;
+        EXPECT_NEAR(dft.imag(), out[k].imag(), 1e-3) << "bin " << k;
+    }
+
+    EXPECT_THROW(real_fft(48), std::invalid_argument);
+    EXPECT_THROW(real_fft(2), std::invalid_argument);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef SCALAR_TYPES_H_
+#define SCALAR_TYPES_H_
+
+/**
+ * @file
+ * The arithmetic types of the IMU filter, controllers and trajectories,
+ * chosen at build time.
+ *
+ * Single precision runs several times faster on the ARM boards' NEON units.
+ * Each stage can be switched to float on its own with SCALAR_FLAGS, e.g.
+ * make SCALAR_FLAGS="-DAUTOPILOT_FLOAT_FILTER -DAUTOPILOT_FLOAT_ATTITUDE":
+ *  - AUTOPILOT_FLOAT_FILTER runs the IMU_Filter smoothing the gx3 measurements
+ *  - AUTOPILOT_FLOAT_ATTITUDE runs attitude_pid's channels
+ *  - AUTOPILOT_FLOAT_TRANSLATION runs translation_outer_pid and tail_sbf, their
+ *    channels, body rotations and feed forward
+ *  - AUTOPILOT_FLOAT_TRAJECTORY runs the circle and line offsets
+ *
+ * Positions and GPSPosition stay double in every configuration, single
+ * precision cannot hold a geodetic position to centimetres.  The controllers
+ * difference positions, and the trajectories reduce their elapsed time to a
+ * lap or segment, in double before the per tick math in controller_math.h
+ * sees them.  translation_outer_mpc stays double.  The bound on the
+ * difference between the scalars is checked by scalar_typesTest and
+ * controller_mathTest.
+ */
+
+#ifdef AUTOPILOT_FLOAT_FILTER
+typedef float filter_scalar;
+#else
+typedef double filter_scalar;
+#endif
+
+#ifdef AUTOPILOT_FLOAT_ATTITUDE
+typedef float attitude_scalar;
+#else
+typedef double attitude_scalar;
+#endif
+
+#ifdef AUTOPILOT_FLOAT_TRANSLATION
+typedef float translation_scalar;
+#else
+typedef double translation_scalar;
+#endif
+
+#ifdef AUTOPILOT_FLOAT_TRAJECTORY
+typedef float trajectory_scalar;
+#else
+typedef double trajectory_scalar;
+#endif
+
+#endif
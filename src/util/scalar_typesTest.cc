@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "scalar_types.h"
+#include "pid_channel.h"
+#include "IMU_Filter.h"
+#include "gx3_recording.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+using gx3_recording::ahrs_sample;
+
+gain_schedule::point nowhere()
+{
+    gain_schedule::point p;
+    p.value.fill(0);
+    return p;
+}
+
+template <typename Scalar>
+basic_pid_channel<Scalar> attitude_channel()
+{
+    basic_pid_channel<Scalar> ch(0.5);
+    ch.gains().setProportional(0.8);
+    ch.gains().setDerivative(0.15);
+    ch.gains().setIntegral(0.4);
+    ch.set_derivative_time_constant(1 / (2 * M_PI * 20));
+    return ch;
+}
+}
+
+// TESTS
+TEST(scalar_types, FLOAT_TRACKS_DOUBLE_ON_RECORDED_FLIGHT)
+{
+    const std::vector<ahrs_sample> samples = gx3_recording::read_ahrs();
+    ASSERT_GT(samples.size(), 1000u);
+
+    std::array<basic_imu_filter<float>, 3> float_filters;
+    std::array<basic_imu_filter<double>, 3> double_filters;
+    basic_pid_channel<float> float_roll(attitude_channel<float>()), float_pitch(attitude_channel<float>());
+    basic_pid_channel<double> double_roll(attitude_channel<double>()), double_pitch(attitude_channel<double>());
+
+    double filter_difference = 0, effort_difference = 0, integral_difference = 0;
+    for (const ahrs_sample& s : samples)
+    {
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            const double difference = float_filters[axis](s.rate[axis]) - double_filters[axis](s.rate[axis]);
+            filter_difference = std::max(filter_difference, std::abs(difference));
+        }
+
+        // hold a few degrees off level, as the attitude loop does
+        float_roll.error().setProportional(s.euler[0] - 0.05);
+        float_roll.error().setDerivative(s.rate[0]);
+        double_roll.error().setProportional(s.euler[0] - 0.05);
+        double_roll.error().setDerivative(s.rate[0]);
+        float_pitch.error().setProportional(s.euler[1] + 0.05);
+        float_pitch.error().setDerivative(s.rate[1]);
+        double_pitch.error().setProportional(s.euler[1] + 0.05);
+        double_pitch.error().setDerivative(s.rate[1]);
+
+        effort_difference = std::max(effort_difference, std::abs(float_roll.compute_pid(0.01, 1, nowhere())
+                                                                 - double_roll.compute_pid(0.01, 1, nowhere())));
+        effort_difference = std::max(effort_difference, std::abs(float_pitch.compute_pid(0.01, 1, nowhere())
+                                                                 - double_pitch.compute_pid(0.01, 1, nowhere())));
+        integral_difference = std::max(integral_difference, std::abs(float_roll.error().getIntegral()
+                                                                     - double_roll.error().getIntegral()));
+    }
+
+    // rad/s, and a fraction of full scale servo travel
+    EXPECT_LT(filter_difference, 1e-5);
+    EXPECT_LT(effort_difference, 1e-4);
+    EXPECT_LT(integral_difference, 1e-4);
+    std::cout << samples.size() << " samples: filter " << filter_difference << " rad/s, effort "
+              << effort_difference << ", integral " << integral_difference << std::endl;
+}
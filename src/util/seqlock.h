@@ -0,0 +1,80 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+/* STL Headers */
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Publishes a small, trivially copyable record from one writer to any
+ * number of readers without locks
+ *
+ * The writer makes the sequence odd, copies the record in and makes it even
+ * again.  Readers copy the record out and retry if the sequence was odd or
+ * changed while they copied, so a reader always gets a whole record and the
+ * writer never waits.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+template <typename T>
+class seqlock
+{
+public:
+    seqlock()
+        : sequence(0),
+          value()
+    {
+    }
+
+    explicit seqlock(const T& initial)
+        : sequence(0),
+          value(initial)
+    {
+    }
+
+    /// publish v, only one thread may store
+    void store(const T& v)
+    {
+        const uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = v;
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    /// @returns the last record stored
+    T load() const
+    {
+        T copy;
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            copy = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        }
+        while (before != after || (before & 1));
+        return copy;
+    }
+
+    /// incremented twice by every store()
+    uint32_t version() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<uint32_t> sequence;
+    T value;
+};
+
+#endif
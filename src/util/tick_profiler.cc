@@ -0,0 +1,133 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#include "tick_profiler.h"
+
+/* STL Headers */
+#include <algorithm>
+
+const size_t tick_profiler::SUB_BUCKET_BITS;
+const size_t tick_profiler::BUCKETS;
+
+thread_local tick_profiler* tick_profiler::running = nullptr;
+
+namespace
+{
+const size_t SUB_BUCKETS = size_t(1) << tick_profiler::SUB_BUCKET_BITS;
+
+/// the bucket holding the rank-th smallest of count times
+size_t rank_bucket(const std::array<uint32_t, tick_profiler::BUCKETS>& histogram, uint32_t rank)
+{
+    uint32_t seen = 0;
+    for (size_t b = 0; b < histogram.size(); ++b)
+    {
+        seen += histogram[b];
+        if (seen > rank)
+            return b;
+    }
+    return histogram.size() - 1;
+}
+}
+
+tick_profiler::tick_profiler()
+    : start(0),
+      last(0),
+      ticks(0)
+{
+    record.fill(0);
+    for (std::array<uint32_t, BUCKETS>& histogram : histograms)
+        histogram.fill(0);
+    max_ns.fill(0);
+}
+
+const char* tick_profiler::name(phase p)
+{
+    switch (p)
+    {
+    case SELECT:
+        return "sel";
+    case RC:
+        return "rc";
+    case LOG:
+        return "log";
+    case CONTROL:
+        return "ctl";
+    case MIX:
+        return "mix";
+    case LOCK_WAIT:
+        return "lock";
+    case TICK:
+        return "tick";
+    default:
+        return "";
+    }
+}
+
+size_t tick_profiler::bucket(uint64_t ns)
+{
+    if (ns < SUB_BUCKETS)
+        return ns;
+
+    const size_t msb = 63 - __builtin_clzll(ns);
+    const size_t shift = msb - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) + ((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t tick_profiler::bucket_limit(size_t b)
+{
+    if (b < SUB_BUCKETS)
+        return b;
+
+    const size_t shift = (b >> SUB_BUCKET_BITS) - 1;
+    const uint64_t lower = (SUB_BUCKETS + (b & (SUB_BUCKETS - 1))) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void tick_profiler::begin_tick()
+{
+    record.fill(0);
+    running = this;
+    start = now_ns();
+    last = start;
+}
+
+void tick_profiler::end_tick()
+{
+    record[TICK] = now_ns() - start;
+    running = nullptr;
+
+    for (size_t p = 0; p < PHASES; ++p)
+    {
+        ++histograms[p][bucket(record[p])];
+        max_ns[p] = std::max(max_ns[p], record[p]);
+    }
+    ++ticks;
+}
+
+tick_profiler::summary tick_profiler::summarize()
+{
+    summary s;
+    s.ticks = ticks;
+    for (size_t p = 0; p < PHASES; ++p)
+    {
+        percentiles& result = s.phases[p];
+        result.p50_us = result.p99_us = result.max_us = 0;
+        if (ticks > 0)
+        {
+            // the top of a bucket can be past the largest time in it
+            const uint64_t max = max_ns[p];
+            const uint32_t last_rank = ticks - 1;
+            result.p50_us = std::min(bucket_limit(rank_bucket(histograms[p], last_rank/2)), max)/1000.0;
+            result.p99_us = std::min(bucket_limit(rank_bucket(histograms[p], last_rank*99/100)), max)/1000.0;
+            result.max_us = max/1000.0;
+        }
+        histograms[p].fill(0);
+        max_ns[p] = 0;
+    }
+    ticks = 0;
+    return s;
+}
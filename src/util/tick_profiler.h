@@ -0,0 +1,164 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+
+#ifndef TICK_PROFILER_H_
+#define TICK_PROFILER_H_
+
+/* STL Headers */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/* System Headers */
+#include <time.h>
+
+/**
+ * @brief Splits each main loop tick in to the time spent in each phase
+ *
+ * The main loop calls begin_tick() when it wakes, lap() at the end of each
+ * phase and end_tick() when it is done.  A lap charges the time since the
+ * previous mark to its phase, so the phases partition the tick.  LOCK_WAIT is
+ * nested instead: the controllers take their per-tick locks with
+ * tick_profiler::lock_guard, which adds the time spent waiting for a contended
+ * lock to the tick running on the calling thread and is a plain lock elsewhere.
+ *
+ * Times come from CLOCK_MONOTONIC_RAW, which is read without a system call
+ * and is not slewed by NTP.  The tick is kept in a fixed record and folded in
+ * to a fixed log-linear histogram per phase (8 buckets per doubling, so a
+ * percentile is within 12.5%), nothing allocates and a tick of the main loop
+ * costs seven clock reads.  summarize() is called from the same thread once a second and
+ * gives the p50, p99 and max of each phase since the last call.
+ *
+ * @author Joseph Lewis <joseph@josephlewis.net>
+ */
+class tick_profiler
+{
+public:
+    enum phase
+    {
+        /// state source selection
+        SELECT,
+        /// taking the tick's frame of pilot inputs and the flight log marker
+        RC,
+        /// logging the scaled inputs
+        LOG,
+        /// Control::operator() and its runnable checks
+        CONTROL,
+        /// Helicopter::setScaled, or the raw pass through in direct manual
+        MIX,
+        /// waiting on the controllers' locks, nested in CONTROL
+        LOCK_WAIT,
+        /// begin_tick() to end_tick()
+        TICK,
+        PHASES
+    };
+
+    /// short name of p, at most 4 characters so telemetry names fit
+    static const char* name(phase p);
+
+    struct percentiles
+    {
+        double p50_us;
+        double p99_us;
+        double max_us;
+    };
+
+    struct summary
+    {
+        uint32_t ticks;
+        std::array<percentiles, PHASES> phases;
+    };
+
+    tick_profiler();
+
+    static uint64_t now_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec)*1000000000u + ts.tv_nsec;
+    }
+
+    /// start a tick on the calling thread
+    void begin_tick();
+
+    /// charge the time since the last mark to p
+    void lap(phase p)
+    {
+        const uint64_t now = now_ns();
+        record[p] += now - last;
+        last = now;
+    }
+
+    /// charge ns to p without moving the mark
+    void add(phase p, uint64_t ns)
+    {
+        record[p] += ns;
+    }
+
+    /// finish the tick and add it to the histograms
+    void end_tick();
+
+    /// percentiles of every phase since the last call, which clears them
+    summary summarize();
+
+    /// the profiler with a tick running on the calling thread, nullptr if none
+    static tick_profiler* current()
+    {
+        return running;
+    }
+
+    /// std::lock_guard that charges the time spent waiting to LOCK_WAIT
+    template <typename Mutex>
+    class lock_guard
+    {
+    public:
+        explicit lock_guard(Mutex& m)
+            : m(m)
+        {
+            // an uncontended lock has nothing to wait for and is not timed
+            if (m.try_lock())
+                return;
+
+            tick_profiler* profiler = current();
+            const uint64_t start = profiler ? now_ns() : 0;
+            m.lock();
+            if (profiler)
+                profiler->add(LOCK_WAIT, now_ns() - start);
+        }
+
+        ~lock_guard()
+        {
+            m.unlock();
+        }
+
+    private:
+        lock_guard(const lock_guard&) = delete;
+        lock_guard& operator=(const lock_guard&) = delete;
+
+        Mutex& m;
+    };
+
+    static const size_t SUB_BUCKET_BITS = 3;
+    static const size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+    /// histogram bucket of a time
+    static size_t bucket(uint64_t ns);
+    /// largest time in bucket b
+    static uint64_t bucket_limit(size_t b);
+
+private:
+    static thread_local tick_profiler* running;
+
+    uint64_t start;
+    uint64_t last;
+    std::array<uint64_t, PHASES> record;
+
+    uint32_t ticks;
+    std::array<std::array<uint32_t, BUCKETS>, PHASES> histograms;
+    std::array<uint64_t, PHASES> max_ns;
+};
+
+#endif
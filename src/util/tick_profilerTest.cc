@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+ *
+ * This file is part of University of Denver Autopilot.
+ * Dual licensed under the GPL v 3 and the Apache 2.0 License
+ */
+#include "tick_profiler.h"
+#include <gtest/gtest.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+TEST(tick_profiler, BUCKET_HOLDS_ITS_TIMES)
+{
+    for (uint64_t ns : {0ull, 7ull, 8ull, 17ull, 999ull, 1000ull, 123456789ull, ~0ull})
+    {
+        const size_t b = tick_profiler::bucket(ns);
+        ASSERT_LT(b, tick_profiler::BUCKETS);
+        EXPECT_GE(tick_profiler::bucket_limit(b), ns);
+        if (b > 0)
+        {
+            EXPECT_LT(tick_profiler::bucket_limit(b - 1), ns);
+        }
+        // within an eighth of the time
+        EXPECT_LE(tick_profiler::bucket_limit(b) - ns, ns/8);
+    }
+}
+
+TEST(tick_profiler, PERCENTILES_OF_A_PHASE)
+{
+    tick_profiler profiler;
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+        profiler.begin_tick();
+        profiler.add(tick_profiler::CONTROL, i*1000);
+        profiler.end_tick();
+    }
+
+    tick_profiler::summary s = profiler.summarize();
+    EXPECT_EQ(100u, s.ticks);
+    const tick_profiler::percentiles& control = s.phases[tick_profiler::CONTROL];
+    EXPECT_NEAR(50, control.p50_us, 50/8.0);
+    EXPECT_NEAR(99, control.p99_us, 99/8.0);
+    EXPECT_EQ(100, control.max_us);
+    EXPECT_EQ(0, s.phases[tick_profiler::MIX].max_us);
+
+    // and summarize() starts over
+    s = profiler.summarize();
+    EXPECT_EQ(0u, s.ticks);
+    EXPECT_EQ(0, s.phases[tick_profiler::CONTROL].max_us);
+}
+
+TEST(tick_profiler, CONTENDED_LOCK_WAIT_ONLY_DURING_A_TICK)
+{
+    std::mutex m;
+    tick_profiler profiler;
+    EXPECT_EQ(nullptr, tick_profiler::current());
+    {
+        tick_profiler::lock_guard<std::mutex> lock(m);
+    }
+
+    profiler.begin_tick();
+    EXPECT_EQ(&profiler, tick_profiler::current());
+    {
+        // uncontended
+        tick_profiler::lock_guard<std::mutex> lock(m);
+    }
+    {
+        std::unique_lock<std::mutex> held(m);
+        std::thread holder([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            held.unlock();
+        });
+        tick_profiler::lock_guard<std::mutex> lock(m);
+        holder.join();
+    }
+    profiler.lap(tick_profiler::CONTROL);
+    profiler.end_tick();
+    EXPECT_EQ(nullptr, tick_profiler::current());
+
+    const tick_profiler::summary s = profiler.summarize();
+    EXPECT_GE(s.phases[tick_profiler::LOCK_WAIT].max_us, 4000);
+    EXPECT_LE(s.phases[tick_profiler::LOCK_WAIT].max_us, s.phases[tick_profiler::CONTROL].max_us);
+    EXPECT_LE(s.phases[tick_profiler::CONTROL].max_us, s.phases[tick_profiler::TICK].max_us);
+}
+
+TEST(tick_profiler, OVERHEAD_UNDER_A_MICROSECOND)
+{
+    const int TICKS = 100000;
+    std::mutex m;
+    tick_profiler profiler;
+
+    // the controller locks alone
+    uint64_t start = tick_profiler::now_ns();
+    for (int i = 0; i < TICKS; ++i)
+    {
+        for (int l = 0; l < 4; ++l)
+            std::lock_guard<std::mutex> lock(m);
+    }
+    const double bare_ns = double(tick_profiler::now_ns() - start)/TICKS;
+
+    // and with the main loop's marks
+    start = tick_profiler::now_ns();
+    for (int i = 0; i < TICKS; ++i)
+    {
+        profiler.begin_tick();
+        profiler.lap(tick_profiler::SELECT);
+        profiler.lap(tick_profiler::RC);
+        profiler.lap(tick_profiler::LOG);
+        for (int l = 0; l < 4; ++l)
+            tick_profiler::lock_guard<std::mutex> lock(m);
+        profiler.lap(tick_profiler::CONTROL);
+        profiler.lap(tick_profiler::MIX);
+        profiler.end_tick();
+    }
+    const double profiled_ns = double(tick_profiler::now_ns() - start)/TICKS;
+    profiler.summarize();
+
+    std::cout << "profiling costs " << profiled_ns - bare_ns << " ns per tick" << std::endl;
+    EXPECT_LT(profiled_ns - bare_ns, 1000);
+}
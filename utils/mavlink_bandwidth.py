@@ -0,0 +1,112 @@
+'''
+
+mavlink_bandwidth.py - telemetry bandwidth of a recorded MAVLink session.
+
+Reads the frames the autopilot sent to QGroundControl (saved with the
+qgroundcontrol.send_save_path option) and prints the bytes per second each
+message type uses as MAVLink 1 and as MAVLink 2 with payload truncation, so
+framings and telemetry profiles can be compared on the same session.
+
+Record with qgroundcontrol.mavlink_version set to 1 so both columns can be
+computed; MAVLink 2 frames are counted as sent.
+
+Usage: mavlink_bandwidth.py recording [duration_seconds]
+
+Without a duration the length of the session is taken from the SYSTEM_TIME
+messages in the recording.
+
+Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+Dual licensed under the GPL v 3 and the Apache 2.0 License
+'''
+
+
+from __future__ import print_function
+import struct
+import sys
+
+V1_STX = 0xFE
+V2_STX = 0xFD
+MSG_ID_SYSTEM_TIME = 2
+CUSTOM_FIRST = 150
+CUSTOM_LAST = 240
+
+
+def frames(data):
+	'''yields (version, msgid, payload) for every frame in data'''
+	i = 0
+	while i + 1 < len(data):
+		stx = data[i]
+		length = data[i + 1]
+		if stx == V1_STX and i + 8 + length <= len(data):
+			yield 1, data[i + 5], data[i + 6:i + 6 + length]
+			i += 8 + length
+		elif stx == V2_STX and i + 12 + length <= len(data):
+			msgid = data[i + 7] | (data[i + 8] << 8) | (data[i + 9] << 16)
+			signed = 13 if data[i + 2] & 0x01 else 0
+			yield 2, msgid, data[i + 10:i + 10 + length]
+			i += 12 + length + signed
+		else:
+			i += 1
+
+
+def v2_length(payload):
+	'''length of a MAVLink 2 frame carrying payload with trailing zeros removed'''
+	length = len(payload)
+	while length > 1 and payload[length - 1] == 0:
+		length -= 1
+	return 12 + length
+
+
+def main(path, duration=None):
+	with open(path, 'rb') as f:
+		data = bytearray(f.read())
+
+	stats = {}
+	first_time = last_time = None
+	v2_frames = 0
+
+	for version, msgid, payload in frames(data):
+		# fold 24 bit custom ids back on to their MAVLink 1 ids
+		if msgid > 255 and CUSTOM_FIRST <= msgid & 0xFF <= CUSTOM_LAST:
+			msgid &= 0xFF
+		count, v1_bytes, v2_bytes = stats.get(msgid, (0, 0, 0))
+		if version == 1:
+			stats[msgid] = (count + 1, v1_bytes + 8 + len(payload), v2_bytes + v2_length(payload))
+		else:
+			v2_frames += 1
+			stats[msgid] = (count + 1, v1_bytes, v2_bytes + 12 + len(payload))
+
+		if msgid == MSG_ID_SYSTEM_TIME:
+			padded = bytes(payload) + b'\0' * (8 - min(8, len(payload)))
+			usec = struct.unpack('<Q', padded[:8])[0]
+			if usec != 0:
+				first_time = usec if first_time is None else first_time
+				last_time = usec
+
+	if duration is None:
+		if first_time is None or last_time == first_time:
+			print("No SYSTEM_TIME messages in the recording, give the duration in seconds")
+			return 1
+		duration = (last_time - first_time) / 1e6
+
+	print("%d seconds, %d bytes" % (duration, len(data)))
+	if v2_frames:
+		print("%d frames were MAVLink 2, they are not counted in the MAVLink 1 column" % v2_frames)
+	print("%8s %10s %12s %12s" % ("msgid", "msgs/s", "v1 bytes/s", "v2 bytes/s"))
+
+	total_v1 = total_v2 = 0
+	for msgid in sorted(stats):
+		count, v1_bytes, v2_bytes = stats[msgid]
+		total_v1 += v1_bytes
+		total_v2 += v2_bytes
+		print("%8d %10.1f %12.1f %12.1f" % (msgid, count / duration, v1_bytes / duration, v2_bytes / duration))
+
+	print("%8s %10s %12.1f %12.1f" % ("total", "", total_v1 / duration, total_v2 / duration))
+	return 0
+
+
+if __name__ == "__main__":
+	if len(sys.argv) < 2:
+		print(__doc__)
+		sys.exit(1)
+	sys.exit(main(sys.argv[1], float(sys.argv[2]) if len(sys.argv) > 2 else None))
@@ -0,0 +1,250 @@
+/**
+
+This program emulates a telemetry radio link for the autopilot.
+
+It creates a pseudo terminal for the autopilot to use as its radio
+(qgroundcontrol.serial_port), carries what the autopilot writes to a ground
+station over UDP no faster than the given air bit rate through a buffer of
+the given size, and reports the buffer's free space back to the autopilot in
+RADIO_STATUS messages once a second like a SiK radio does.  Data from the
+ground station is passed straight through.
+
+Once a second it prints how long bytes waited in the buffer, so the end to
+end telemetry latency of a configuration can be checked without hardware.
+
+Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the following disclaimer
+  in the documentation and/or other materials provided with the
+  distribution.
+* Neither the name of the  nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**/
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const uint8_t MAVLINK_STX = 0xFE;
+const uint8_t RADIO_STATUS_ID = 109;
+const uint8_t RADIO_STATUS_LENGTH = 9;
+const uint8_t RADIO_STATUS_CRC_EXTRA = 185;
+// SiK radios report as system '3' component 'D'
+const uint8_t RADIO_SYSID = '3';
+const uint8_t RADIO_COMPID = 'D';
+
+
+void crc_accumulate(uint8_t data, uint16_t& crc)
+{
+	uint8_t tmp = data ^ static_cast<uint8_t>(crc & 0xff);
+	tmp ^= (tmp << 4);
+	crc = (crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+/// a MAVLink 1 RADIO_STATUS frame with the given free buffer percentage
+std::vector<uint8_t> radio_status(uint8_t seq, uint8_t txbuf)
+{
+	std::vector<uint8_t> frame {MAVLINK_STX, RADIO_STATUS_LENGTH, seq, RADIO_SYSID, RADIO_COMPID, RADIO_STATUS_ID,
+	                            0, 0,     // rxerrors
+	                            0, 0,     // fixed
+	                            200,      // rssi
+	                            200,      // remrssi
+	                            txbuf,
+	                            40,       // noise
+	                            40};      // remnoise
+
+	uint16_t crc = 0xffff;
+	for (size_t i = 1; i < frame.size(); i++)
+		crc_accumulate(frame[i], crc);
+	crc_accumulate(RADIO_STATUS_CRC_EXTRA, crc);
+
+	frame.push_back(crc & 0xff);
+	frame.push_back(crc >> 8);
+	return frame;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc < 5)
+	{
+		printf("Usage: %s air_bitrate buffer_bytes gcs_host gcs_port [listen_port]\n", argv[0]);
+		printf("\t ex. 57600 4096 127.0.0.1 14550 14551\n");
+
+		return 1;
+	}
+
+	const double bytes_per_second = atof(argv[1]) / 10; // 8N1
+	const size_t buffer_bytes = atoi(argv[2]);
+	const int listen_port = (argc > 5) ? atoi(argv[5]) : 14551;
+
+	////////////////////////////////////////////////////////////////////
+	// Setup the pseudo terminal
+	////////////////////////////////////////////////////////////////////
+
+	int pty = posix_openpt(O_RDWR | O_NOCTTY);
+	if(pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0)
+	{
+		perror("could not create a pseudo terminal");
+		return 1;
+	}
+
+	struct termios options;
+	tcgetattr(pty, &options);
+	cfmakeraw(&options);
+	tcsetattr(pty, TCSANOW, &options);
+
+	printf("radio on %s\n", ptsname(pty));
+	fflush(stdout);
+
+	////////////////////////////////////////////////////////////////////
+	// Setup UDP
+	////////////////////////////////////////////////////////////////////
+
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(listen_port);
+
+	struct sockaddr_in gcs;
+	memset(&gcs, 0, sizeof(gcs));
+	gcs.sin_family = AF_INET;
+	gcs.sin_port = htons(atoi(argv[4]));
+
+	if(sock < 0 || bind(sock, (struct sockaddr*)&local, sizeof(local)) != 0 || inet_pton(AF_INET, argv[3], &gcs.sin_addr) != 1)
+	{
+		perror("could not set up the ground station socket");
+		return 1;
+	}
+
+	////////////////////////////////////////////////////////////////////
+	// Emulate the radio
+	////////////////////////////////////////////////////////////////////
+
+	// bytes waiting to go over the air and when they arrived
+	std::deque<std::pair<uint8_t, Clock::time_point> > air;
+	std::vector<double> latencies_ms;
+	size_t overflow = 0;
+	double credit = 0;
+	uint8_t seq = 0;
+
+	Clock::time_point last = Clock::now();
+	Clock::time_point next_report = last + std::chrono::seconds(1);
+
+	uint8_t buf[2048];
+	while(true)
+	{
+		struct pollfd fds[2] = {{pty, POLLIN, 0}, {sock, POLLIN, 0}};
+		poll(fds, 2, 1);
+		const Clock::time_point now = Clock::now();
+
+		if(fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+		{
+			const int amt = read(pty, buf, sizeof(buf));
+			if(amt <= 0)
+			{
+				// nobody has the radio open yet
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+			for(int i = 0; i < amt; i++)
+			{
+				if(air.size() < buffer_bytes)
+					air.push_back(std::make_pair(buf[i], now));
+				else
+					overflow++;
+			}
+		}
+
+		if(fds[1].revents & POLLIN)
+		{
+			const int amt = recv(sock, buf, sizeof(buf), 0);
+			if(amt > 0 && write(pty, buf, amt) < 0)
+				perror("could not write to the autopilot");
+		}
+
+		// send what the air rate allowed since the last pass, idle time can not be saved up
+		credit += std::chrono::duration<double>(now - last).count() * bytes_per_second;
+		last = now;
+		const size_t n = std::min(air.size(), static_cast<size_t>(credit));
+		credit -= n;
+		if(air.empty())
+			credit = std::min(credit, 1.0);
+
+		if(n > 0)
+		{
+			std::vector<uint8_t> datagram;
+			for(size_t i = 0; i < n; i++)
+			{
+				datagram.push_back(air.front().first);
+				latencies_ms.push_back(std::chrono::duration<double, std::milli>(now - air.front().second).count());
+				air.pop_front();
+			}
+			sendto(sock, &datagram[0], datagram.size(), 0, (struct sockaddr*)&gcs, sizeof(gcs));
+		}
+
+		if(now >= next_report)
+		{
+			next_report += std::chrono::seconds(1);
+
+			const uint8_t txbuf = 100 - (100 * air.size()) / std::max<size_t>(1, buffer_bytes);
+			std::vector<uint8_t> status(radio_status(seq++, txbuf));
+			if(write(pty, &status[0], status.size()) < 0)
+				perror("could not write to the autopilot");
+
+			double p50 = 0, p99 = 0, worst = 0;
+			if(!latencies_ms.empty())
+			{
+				std::sort(latencies_ms.begin(), latencies_ms.end());
+				p50 = latencies_ms[latencies_ms.size() / 2];
+				p99 = latencies_ms[(latencies_ms.size() * 99) / 100];
+				worst = latencies_ms.back();
+			}
+			printf("sent %zu B, queued %zu B, free %d%%, latency p50 %.0f ms p99 %.0f ms max %.0f ms, overflow %zu B\n",
+			       latencies_ms.size(), air.size(), txbuf, p50, p99, worst, overflow);
+			fflush(stdout);
+
+			latencies_ms.clear();
+			overflow = 0;
+		}
+	}
+
+	return 0;
+}
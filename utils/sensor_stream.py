@@ -0,0 +1,144 @@
+'''
+
+sensor_stream.py - decode the batched raw sensor stream.
+
+Reads the frames the autopilot sent to QGroundControl (saved with the
+qgroundcontrol.send_save_path option), decodes the ENCAPSULATED_DATA batches
+sent by the sensor_stream driver and prints the packet rate of the stream
+against the rate one message per sample (RAW_IMU, SERVO_OUTPUT_RAW and
+RC_CHANNELS_RAW) would have needed.
+
+Usage: sensor_stream.py recording [samples.csv]
+
+With a csv path every decoded sample is written to it as
+time_us, kind, value...; gyro rates in rad/s, accelerations in g and pulse
+widths in microseconds.
+
+Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+Dual licensed under the GPL v 3 and the Apache 2.0 License
+'''
+
+
+from __future__ import print_function
+import sys
+
+from mavlink_bandwidth import frames
+
+MSG_ID_ENCAPSULATED_DATA = 131
+DATA_LENGTH = 253
+VERSION = 1
+
+IMU = 1
+SERVO = 2
+RC = 3
+
+# channel count, scale and name of each kind, must match sensor_batch.h
+KINDS = {
+	IMU: (6, [10000.0] * 6, "imu"),
+	SERVO: (9, [1.0] * 9, "servo"),
+	RC: (8, [1.0] * 8, "rc"),
+}
+
+# MAVLink 1 frame bytes of the message each kind would otherwise be sent as
+PER_SAMPLE_FRAME = {
+	IMU: 8 + 26,
+	SERVO: 8 + 21,
+	RC: 8 + 22,
+}
+
+
+def varint(data, i):
+	'''returns (value, next index) of the varint at data[i]'''
+	value = shift = 0
+	while True:
+		byte = data[i]
+		i += 1
+		value |= (byte & 0x7F) << shift
+		shift += 7
+		if not byte & 0x80:
+			return value, i
+
+
+def unzigzag(value):
+	return (value >> 1) ^ -(value & 1)
+
+
+def samples(batch):
+	'''yields (time_us, kind, values) for every sample in a batch'''
+	if len(batch) < 6 or batch[0] != VERSION:
+		return
+	count = batch[1]
+	time = batch[2] | (batch[3] << 8) | (batch[4] << 16) | (batch[5] << 24)
+	previous = dict((kind, [0] * KINDS[kind][0]) for kind in KINDS)
+
+	i = 6
+	for _ in range(count):
+		kind = batch[i]
+		if kind not in KINDS:
+			return
+		dt, i = varint(batch, i + 1)
+		time += dt
+		channels, scales, _ = KINDS[kind]
+		values = previous[kind]
+		for c in range(channels):
+			delta, i = varint(batch, i)
+			values[c] += unzigzag(delta)
+		yield time, kind, [v / s for v, s in zip(values, scales)]
+
+
+def main(path, csv_path=None):
+	with open(path, 'rb') as f:
+		data = bytearray(f.read())
+
+	csv = open(csv_path, 'w') if csv_path else None
+	batches = batch_bytes = 0
+	counts = dict((kind, 0) for kind in KINDS)
+	first_time = last_time = None
+	last_sequence = None
+	lost = 0
+
+	for version, msgid, payload in frames(data):
+		if msgid != MSG_ID_ENCAPSULATED_DATA:
+			continue
+		# MAVLink 2 drops the trailing zeros of the payload
+		payload = payload + bytearray(2 + DATA_LENGTH - len(payload))
+		sequence = payload[0] | (payload[1] << 8)
+		if last_sequence is not None:
+			lost += (sequence - last_sequence - 1) & 0xFFFF
+		last_sequence = sequence
+
+		batches += 1
+		batch_bytes += (8 if version == 1 else 12) + len(payload)
+		for time, kind, values in samples(payload[2:]):
+			counts[kind] += 1
+			first_time = time if first_time is None else first_time
+			last_time = time
+			if csv:
+				csv.write("%d,%s,%s\n" % (time, KINDS[kind][2], ",".join("%g" % v for v in values)))
+
+	if csv:
+		csv.close()
+
+	if not batches:
+		print("No sensor stream batches in the recording")
+		return 1
+
+	# the first sample time wraps every 71 minutes, which is fine for a rate
+	duration = max(1e-6, ((last_time - first_time) & 0xFFFFFFFF) / 1e6)
+	total = sum(counts.values())
+	per_sample_bytes = sum(counts[kind] * PER_SAMPLE_FRAME[kind] for kind in KINDS)
+
+	print("%.1f seconds, %d batches, %d lost" % (duration, batches, lost))
+	for kind in sorted(KINDS):
+		print("%8s %10.1f samples/s" % (KINDS[kind][2], counts[kind] / duration))
+	print("%8s %10s %12s %12s" % ("", "packets/s", "bytes/s", "samples/pkt"))
+	print("%8s %10.1f %12.1f %12.1f" % ("batched", batches / duration, batch_bytes / duration, total / float(batches)))
+	print("%8s %10.1f %12.1f %12.1f" % ("single", total / duration, per_sample_bytes / duration, 1))
+	return 0
+
+
+if __name__ == "__main__":
+	if len(sys.argv) < 2:
+		print(__doc__)
+		sys.exit(1)
+	sys.exit(main(sys.argv[1], sys.argv[2] if len(sys.argv) > 2 else None))
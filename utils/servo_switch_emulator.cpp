@@ -0,0 +1,269 @@
+/**
+
+This program emulates the Microbotics servo switch for the autopilot.
+
+It creates a pseudo terminal for the autopilot to use as its servo switch
+(servo.serial_port) and writes PULSE_INPUTS frames to it at the given rate
+with all sticks centred, except the aileron which steps between two positions
+every step_frames frames.  A STATUS frame reporting pilot manual is written
+once a second.  The PULSE_COMMAND frames the autopilot writes back are read
+and the first one whose outputs differ from the last after each step ends
+the step.
+
+Once a second it prints the percentiles of the time from writing a step to
+reading the command that follows it, so the stick to servo latency of a
+configuration can be checked without hardware.  The autopilot should be in
+direct or scaled manual, where only the sticks move the outputs.
+
+Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+* Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the following disclaimer
+  in the documentation and/or other materials provided with the
+  distribution.
+* Neither the name of the  nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**/
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// As defined in section 4.2 of the February 2, 2007 SSC Manual
+const uint8_t SYNC1 = 0x81;
+const uint8_t SYNC2 = 0xA1;
+const uint8_t STATUS_ID = 10;
+const uint8_t PULSE_INPUTS_ID = 13;
+const uint8_t PULSE_COMMAND_ID = 20;
+const size_t CHANNELS = 9;
+
+const uint16_t CENTRE = 1500;
+const uint16_t STEP_LOW = 1300;
+const uint16_t STEP_HIGH = 1700;
+
+
+/// a frame with the SSC header and checksum
+std::vector<uint8_t> ssc_frame(uint8_t id, const std::vector<uint8_t>& payload)
+{
+	std::vector<uint8_t> frame {SYNC1, SYNC2, id, static_cast<uint8_t>(payload.size())};
+	frame.insert(frame.end(), payload.begin(), payload.end());
+
+	uint8_t a = id + payload.size();
+	uint8_t b = 2 * id + payload.size();
+	for (size_t i = 0; i < payload.size(); i++)
+	{
+		a += payload[i];
+		b += a;
+	}
+	frame.push_back(a);
+	frame.push_back(b);
+	return frame;
+}
+
+/// PULSE_INPUTS with the aileron at aileron and the other sticks centred
+std::vector<uint8_t> pulse_inputs(uint16_t aileron)
+{
+	// CH8 comes first, then CH1 to CH8
+	std::vector<uint16_t> widths(CHANNELS, CENTRE);
+	widths[1] = aileron;
+
+	std::vector<uint8_t> payload;
+	for (uint16_t width : widths)
+	{
+		payload.push_back(width >> 8);
+		payload.push_back(width & 0xff);
+	}
+	return ssc_frame(PULSE_INPUTS_ID, payload);
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc > 1 && (argv[1][0] == '-' || atof(argv[1]) <= 0))
+	{
+		printf("Usage: %s [frame_rate_hz] [step_frames]\n", argv[0]);
+		printf("\t ex. 50 10\n");
+
+		return 1;
+	}
+
+	const double frame_rate_hz = (argc > 1) ? atof(argv[1]) : 50;
+	const int step_frames = (argc > 2) ? std::max(1, atoi(argv[2])) : 10;
+	const Clock::duration frame_period = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(1 / frame_rate_hz));
+
+	////////////////////////////////////////////////////////////////////
+	// Setup the pseudo terminal
+	////////////////////////////////////////////////////////////////////
+
+	int pty = posix_openpt(O_RDWR | O_NOCTTY);
+	if(pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0)
+	{
+		perror("could not create a pseudo terminal");
+		return 1;
+	}
+
+	struct termios options;
+	tcgetattr(pty, &options);
+	cfmakeraw(&options);
+	tcsetattr(pty, TCSANOW, &options);
+
+	printf("servo switch on %s\n", ptsname(pty));
+	fflush(stdout);
+
+	////////////////////////////////////////////////////////////////////
+	// Emulate the servo switch
+	////////////////////////////////////////////////////////////////////
+
+	std::vector<uint8_t> received;
+	std::vector<uint16_t> last_command;
+	std::vector<double> latencies_ms;
+	size_t sent = 0;
+	size_t frames = 0;
+	size_t commands = 0;
+	size_t missed = 0;
+
+	uint16_t aileron = STEP_LOW;
+	bool stepping = false;
+	Clock::time_point step_time;
+
+	Clock::time_point next_frame = Clock::now();
+	Clock::time_point next_report = next_frame + std::chrono::seconds(1);
+
+	uint8_t buf[2048];
+	while(true)
+	{
+		const int wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - Clock::now()).count();
+		struct pollfd fds[1] = {{pty, POLLIN, 0}};
+		poll(fds, 1, std::max(0, wait_ms));
+		Clock::time_point now = Clock::now();
+
+		if(fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+		{
+			const int amt = read(pty, buf, sizeof(buf));
+			if(amt <= 0)
+			{
+				// nobody has the servo switch open yet
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+			received.insert(received.end(), buf, buf + std::max(0, amt));
+		}
+
+		// take the complete frames off the front
+		while(received.size() >= 6)
+		{
+			if(received[0] != SYNC1 || received[1] != SYNC2)
+			{
+				received.erase(received.begin());
+				continue;
+			}
+
+			const size_t length = 4 + received[3] + 2;
+			if(received.size() < length)
+				break;
+
+			const std::vector<uint8_t> payload(received.begin() + 4, received.begin() + 4 + received[3]);
+			const std::vector<uint8_t> expected(ssc_frame(received[2], payload));
+			if(!std::equal(expected.begin(), expected.end(), received.begin()))
+			{
+				received.erase(received.begin());
+				continue;
+			}
+			received.erase(received.begin(), received.begin() + length);
+
+			if(expected[2] != PULSE_COMMAND_ID || payload.size() < 2 * CHANNELS)
+				continue;
+
+			commands++;
+			std::vector<uint16_t> command;
+			for (size_t i = 0; i < CHANNELS; i++)
+				command.push_back((payload[2 * i] << 8) | payload[2 * i + 1]);
+
+			if(stepping && !last_command.empty() && command != last_command)
+			{
+				latencies_ms.push_back(std::chrono::duration<double, std::milli>(now - step_time).count());
+				stepping = false;
+			}
+			last_command = command;
+		}
+
+		now = Clock::now();
+		if(now >= next_frame)
+		{
+			next_frame += frame_period;
+			frames++;
+
+			if(++sent % step_frames == 0)
+			{
+				// a step the outputs never followed is counted, not timed
+				if(stepping)
+					missed++;
+				aileron = (aileron == STEP_LOW) ? STEP_HIGH : STEP_LOW;
+				stepping = true;
+				step_time = now;
+			}
+
+			const std::vector<uint8_t> frame(pulse_inputs(aileron));
+			if(write(pty, &frame[0], frame.size()) < 0)
+				perror("could not write to the autopilot");
+		}
+
+		if(now >= next_report)
+		{
+			next_report += std::chrono::seconds(1);
+
+			// pilot manual
+			const std::vector<uint8_t> status(ssc_frame(STATUS_ID, {0, 1 << 1}));
+			if(write(pty, &status[0], status.size()) < 0)
+				perror("could not write to the autopilot");
+
+			double p50 = 0, p99 = 0, worst = 0;
+			if(!latencies_ms.empty())
+			{
+				std::sort(latencies_ms.begin(), latencies_ms.end());
+				p50 = latencies_ms[latencies_ms.size() / 2];
+				p99 = latencies_ms[(latencies_ms.size() * 99) / 100];
+				worst = latencies_ms.back();
+			}
+			printf("frames %zu, commands %zu, steps %zu, stick to servo p50 %.1f ms p99 %.1f ms max %.1f ms, missed %zu\n",
+			       frames, commands, latencies_ms.size(), p50, p99, worst, missed);
+			fflush(stdout);
+
+			latencies_ms.clear();
+			frames = 0;
+			commands = 0;
+			missed = 0;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,918 @@
+/**
+
+Offline system identification for the helicopter from autopilot flight logs.
+
+Reads the text logs written by LogFile (<name>.dat per log, followed by
+<name>.1.dat, <name>.2.dat, ... once it rotates, first column is microseconds
+since start) from one or more log folders, resamples
+the IMU attitude/rates, the GX3 NED velocity and the normalized inputs onto a
+common time grid and fits linearized rotor/airframe models by least squares:
+
+	roll    p_dot  = Lp * p      + Lu   * u_aileron  + L0
+	pitch   q_dot  = Mq * q      + Mu   * u_elevator + M0
+	yaw     r_dot  = Nr * r      + Nu   * u_rudder   + N0
+	heave   vz_dot = Zw * vz     + Zcol * u_pitch    + Z0     (NED)
+	surge   ax_b   = Xu * vx_b   + Xth  * theta      + X0     (body)
+	sway    ay_b   = Yv * vy_b   + Yph  * phi        + Y0     (body)
+
+The input u is whatever drove the servos: the mixed control output while the
+autopilot is in automatic control and the servo switch in auto, the pilot's
+scaled inputs otherwise, as told by the "Autopilot Modes" log.  Older logs
+without it take the mixed control output wherever it was logged, which can
+not tell a hardware takeover by the pilot.  Where "Output Pulse Widths" was
+logged, samples are only used while the servo switch was being written to.
+Where the GX3 velocity is invalid the Novatel velocity is used instead.
+
+The logs are split into fixed length segments that are accumulated into
+fixed-size normal equations on a pool of worker threads, the segment
+equations are summed and solved once per model.  Per-segment residuals are
+evaluated against the pooled fit directly from the segment normal equations,
+so the samples are only traversed once.
+
+The result is written as a config.xml fragment containing the physical
+parameters (inertia is only re-estimated when the rotor moment gains are
+given on the command line, mass and hub offsets are passed through from the
+input configuration since they are not observable from these logs),
+suggested attitude_pid gains and the identified derivatives.
+
+Copyright 2014 Joseph Lewis <joseph@josephlewis.net>
+
+This file is part of University of Denver Autopilot.
+Dual licensed under the GPL v 3 and the Apache 2.0 License
+**/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace
+{
+
+const double GRAVITY = 9.8;
+
+/// log names as written by the autopilot
+const std::string LOG_EULER = "GX3 Nav Euler Angles";
+const std::string LOG_ANG_RATE = "GX3 Nav Angular Rates";
+const std::string LOG_NED_VEL = "GX3 Estimated NED Velocity";
+const std::string LOG_SCALED_INPUTS = "Scaled Inputs";
+const std::string LOG_MIXED_OUTPUT = "Mixed Control Output";
+const std::string LOG_MODES = "Autopilot Modes";
+const std::string LOG_OUTPUT_PULSES = "Output Pulse Widths";
+const std::string LOG_NOVATEL = "Novatel GPS (Invalid Solutions Removed)";
+
+/// heli::MODE_AUTOMATIC_CONTROL and heli::PILOT_AUTO
+const double AUTOMATIC_CONTROL = 2;
+const double PILOT_AUTO = 1;
+
+/// columns of the Novatel log, after the time
+enum NovatelColumn
+{
+	NOVATEL_P_X = 5,
+	NOVATEL_V_SOL_STATUS = 11,
+	NOVATEL_V_X = 13,
+	NOVATEL_COLUMNS = 16
+};
+
+/// most columns read from a log
+const size_t MAX_COLUMNS = 16;
+
+/// input channel order used by Helicopter::setScaled
+enum InputChannel
+{
+	AILERON = 0,
+	ELEVATOR = 1,
+	THROTTLE = 2,
+	RUDDER = 3,
+	GYRO = 4,
+	PITCH = 5,
+	INPUT_CHANNELS
+};
+
+/**
+ * Fixed size least squares accumulator.  Stores the normal equations
+ * A = sum(x x'), b = sum(x y) along with sum(y^2) so that the residual of
+ * any parameter vector can be evaluated without another pass over the data.
+ */
+template <int N>
+struct NormalEquations
+{
+	std::array<double, N*N> A;
+	std::array<double, N> b;
+	double yy;
+	size_t n;
+
+	NormalEquations()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		A.fill(0);
+		b.fill(0);
+		yy = 0;
+		n = 0;
+	}
+
+	void add(const std::array<double, N>& x, double y)
+	{
+		for (int i = 0; i < N; ++i)
+		{
+			for (int j = 0; j <= i; ++j)
+				A[i*N + j] += x[i] * x[j];
+			b[i] += x[i] * y;
+		}
+		yy += y * y;
+		++n;
+	}
+
+	NormalEquations& operator+=(const NormalEquations& other)
+	{
+		for (int i = 0; i < N*N; ++i)
+			A[i] += other.A[i];
+		for (int i = 0; i < N; ++i)
+			b[i] += other.b[i];
+		yy += other.yy;
+		n += other.n;
+		return *this;
+	}
+
+	/// solve A theta = b by Cholesky decomposition, returns false if A is not positive definite
+	bool solve(std::array<double, N>& theta) const
+	{
+		std::array<double, N*N> L;
+		L.fill(0);
+		for (int i = 0; i < N; ++i)
+		{
+			for (int j = 0; j <= i; ++j)
+			{
+				double sum = A[i*N + j];
+				for (int k = 0; k < j; ++k)
+					sum -= L[i*N + k] * L[j*N + k];
+				if (i == j)
+				{
+					if (sum <= 1e-12 * std::max(1.0, A[i*N + i]))
+						return false;
+					L[i*N + i] = std::sqrt(sum);
+				}
+				else
+					L[i*N + j] = sum / L[j*N + j];
+			}
+		}
+		std::array<double, N> z;
+		for (int i = 0; i < N; ++i)
+		{
+			double sum = b[i];
+			for (int k = 0; k < i; ++k)
+				sum -= L[i*N + k] * z[k];
+			z[i] = sum / L[i*N + i];
+		}
+		for (int i = N - 1; i >= 0; --i)
+		{
+			double sum = z[i];
+			for (int k = i + 1; k < N; ++k)
+				sum -= L[k*N + i] * theta[k];
+			theta[i] = sum / L[i*N + i];
+		}
+		return true;
+	}
+
+	/// root mean square residual of theta over the accumulated samples
+	double rms(const std::array<double, N>& theta) const
+	{
+		if (n == 0)
+			return 0;
+		double quad = 0;
+		double lin = 0;
+		for (int i = 0; i < N; ++i)
+		{
+			lin += theta[i] * b[i];
+			for (int j = 0; j < N; ++j)
+			{
+				double a = (j <= i) ? A[i*N + j] : A[j*N + i];
+				quad += theta[i] * a * theta[j];
+			}
+		}
+		return std::sqrt(std::max(0.0, (yy - 2*lin + quad) / n));
+	}
+
+	/// variance of regressor i, assumes the last regressor is the constant term
+	double variance(int i) const
+	{
+		if (n == 0)
+			return 0;
+		double mean = A[(N-1)*N + i] / n;
+		return A[i*N + i] / n - mean * mean;
+	}
+};
+
+typedef NormalEquations<3> Fit;
+
+enum Model
+{
+	ROLL = 0,
+	PITCH_AXIS,
+	YAW,
+	HEAVE,
+	SURGE,
+	SWAY,
+	MODELS
+};
+
+const char* const MODEL_NAMES[MODELS] = {"roll", "pitch", "yaw", "heave", "surge", "sway"};
+const char* const MODEL_PARAMS[MODELS][3] =
+{
+	{"Lp", "Lu", "L0"},
+	{"Mq", "Mu", "M0"},
+	{"Nr", "Nu", "N0"},
+	{"Zw", "Zcol", "Z0"},
+	{"Xu", "Xth", "X0"},
+	{"Yv", "Yph", "Y0"}
+};
+/// index of the regressor which must be excited for a segment to be used
+const int EXCITED_REGRESSOR[MODELS] = {1, 1, 1, 1, 1, 1};
+
+/// a single log channel, time in seconds followed by a row of values
+struct Channel
+{
+	std::vector<double> time;
+	std::vector<double> values;
+	size_t columns;
+
+	Channel() : columns(0) {}
+
+	size_t size() const
+	{
+		return time.size();
+	}
+};
+
+/**
+ * Append the rows of one LogFile .dat file.  The parser works on the whole file in memory
+ * with strtod since the logs of a long flight are several hundred megabytes.
+ */
+bool load_channel(const std::string& path, size_t columns, Channel& channel)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	std::vector<char> buffer(length + 1);
+	size_t read = fread(buffer.data(), 1, length, file);
+	fclose(file);
+	buffer[read] = '\0';
+
+	channel.columns = columns;
+	channel.time.reserve(channel.time.size() + read / 40);
+	channel.values.reserve(channel.values.size() + read / 40 * columns);
+
+	// skip the header line, each row is terminated in place so a short row can not run in to the next
+	char* cursor = strchr(buffer.data(), '\n');
+	while (cursor != NULL)
+	{
+		char* line = cursor + 1;
+		cursor = strchr(line, '\n');
+		if (cursor != NULL)
+			*cursor = '\0';
+
+		char* end = NULL;
+		double micros = strtod(line, &end);
+		if (end == line)
+			continue;
+		line = end;
+
+		size_t column = 0;
+		double row[MAX_COLUMNS];
+		while (column < columns && column < MAX_COLUMNS)
+		{
+			row[column] = strtod(line, &end);
+			if (end == line)
+				break;
+			line = end;
+			++column;
+		}
+
+		// drop partially written rows
+		if (column == columns)
+		{
+			channel.time.push_back(micros * 1e-6);
+			channel.values.insert(channel.values.end(), row, row + columns);
+		}
+	}
+	return true;
+}
+
+/// path of a segment of a log, as log_segment_writer::segment_name names them
+std::string segment_path(const std::string& folder, const std::string& name, size_t segment)
+{
+	if (segment == 0)
+		return folder + "/" + name + ".dat";
+	std::ostringstream path;
+	path << folder << "/" << name << "." << segment << ".dat";
+	return path.str();
+}
+
+/**
+ * Load every segment of a log in order, each starts with the header.
+ * Returns false if there is not even the first.
+ */
+bool load_log(const std::string& folder, const std::string& name, size_t columns, Channel& channel)
+{
+	size_t segment = 0;
+	while (load_channel(segment_path(folder, name, segment), columns, channel))
+		++segment;
+	return segment > 0;
+}
+
+/**
+ * Sequential linear interpolator over a Channel.  Samples must be requested
+ * in increasing time order, which makes every lookup O(1) amortized.
+ */
+class Interpolator
+{
+public:
+	Interpolator(const Channel& channel, double max_gap)
+		: _channel(channel), _index(0), _max_gap(max_gap)
+	{
+	}
+
+	/// interpolate column at time t, returns false if t is outside the data or in a gap
+	bool operator()(double t, std::array<double, MAX_COLUMNS>& out)
+	{
+		const std::vector<double>& time = _channel.time;
+		while (_index + 1 < time.size() && time[_index + 1] < t)
+			++_index;
+		if (_index + 1 >= time.size() || time[_index] > t)
+			return false;
+
+		double t0 = time[_index];
+		double t1 = time[_index + 1];
+		if (t1 - t0 > _max_gap || t1 <= t0)
+			return false;
+
+		double alpha = (t - t0) / (t1 - t0);
+		const double* v0 = &_channel.values[_index * _channel.columns];
+		const double* v1 = v0 + _channel.columns;
+		for (size_t i = 0; i < _channel.columns; ++i)
+			out[i] = v0[i] + alpha * (v1[i] - v0[i]);
+		return true;
+	}
+
+private:
+	const Channel& _channel;
+	size_t _index;
+	double _max_gap;
+};
+
+/**
+ * Sequential sample and hold over a Channel written only when it changes.
+ * Samples must be requested in increasing time order.
+ */
+class Holder
+{
+public:
+	explicit Holder(const Channel& channel)
+		: _channel(channel), _index(0)
+	{
+	}
+
+	/// the last row at or before t, returns false if there is none
+	bool operator()(double t, std::array<double, MAX_COLUMNS>& out)
+	{
+		const std::vector<double>& time = _channel.time;
+		while (_index < time.size() && time[_index] <= t)
+			++_index;
+		if (_index == 0)
+			return false;
+
+		const double* v = &_channel.values[(_index - 1) * _channel.columns];
+		std::copy(v, v + _channel.columns, out.begin());
+		return true;
+	}
+
+private:
+	const Channel& _channel;
+	size_t _index;
+};
+
+/// rotate an ECEF velocity at an ECEF position in to NED, the latitude is geocentric
+std::array<double, 3> ecef_to_ned(const double* position, const double* v)
+{
+	const double lat = std::atan2(position[2], std::hypot(position[0], position[1]));
+	const double lon = std::atan2(position[1], position[0]);
+	const double sl = std::sin(lat), cl = std::cos(lat);
+	const double so = std::sin(lon), co = std::cos(lon);
+
+	std::array<double, 3> ned;
+	ned[0] = -sl*co*v[0] - sl*so*v[1] + cl*v[2];
+	ned[1] = -so*v[0] + co*v[1];
+	ned[2] = -cl*co*v[0] - cl*so*v[1] - sl*v[2];
+	return ned;
+}
+
+/// one time aligned sample
+struct Sample
+{
+	bool valid;
+	std::array<double, 3> euler;
+	std::array<double, 3> rate;
+	std::array<double, 3> velocity;
+	std::array<double, INPUT_CHANNELS> input;
+};
+
+/// a flight log folder resampled on to a uniform grid
+struct Flight
+{
+	std::string folder;
+	double start;
+	double dt;
+	std::vector<Sample> samples;
+	/// valid samples driven by the controller, and with the Novatel velocity
+	size_t automatic;
+	size_t gps_velocity;
+};
+
+struct Options
+{
+	std::vector<std::string> folders;
+	std::string config;
+	std::string output;
+	std::string residuals;
+	double rate_hz;
+	double segment_s;
+	double input_delay_s;
+	double max_gap_s;
+	double min_excitation;
+	double flap_gain;
+	double tail_gain;
+	double bandwidth;
+	double damping;
+	unsigned int threads;
+
+	Options()
+		: config("config.xml"),
+		  rate_hz(50),
+		  segment_s(10),
+		  input_delay_s(0),
+		  max_gap_s(0.2),
+		  min_excitation(1e-4),
+		  flap_gain(0),
+		  tail_gain(0),
+		  bandwidth(4),
+		  damping(0.7),
+		  threads(std::max(1u, std::thread::hardware_concurrency()))
+	{
+	}
+};
+
+bool load_flight(const std::string& folder, const Options& options, Flight& flight)
+{
+	enum
+	{
+		EULER,
+		RATE,
+		VELOCITY,
+		SCALED,
+		MIXED,
+		MODES,
+		PULSES,
+		NOVATEL,
+		LOGS
+	};
+	const std::string names[LOGS] = {LOG_EULER, LOG_ANG_RATE, LOG_NED_VEL, LOG_SCALED_INPUTS,
+									 LOG_MIXED_OUTPUT, LOG_MODES, LOG_OUTPUT_PULSES, LOG_NOVATEL};
+	const size_t columns[LOGS] = {4, 4, 4, INPUT_CHANNELS, INPUT_CHANNELS, 2, 1, NOVATEL_COLUMNS};
+	/// the rest are optional and do not bound the flight
+	const int REQUIRED = SCALED + 1;
+
+	// the channels are independent files so load them concurrently
+	Channel channels[LOGS];
+	bool loaded[LOGS];
+	std::vector<std::thread> loaders;
+	for (int i = 0; i < LOGS; ++i)
+	{
+		loaders.push_back(std::thread([&, i]()
+		{
+			loaded[i] = load_log(folder, names[i], columns[i], channels[i])
+						&& channels[i].size() >= (i == MODES ? 1u : 2u);
+		}));
+	}
+	for (std::thread& loader : loaders)
+		loader.join();
+
+	double start = 0;
+	double end = 1e300;
+	for (int i = 0; i < REQUIRED; ++i)
+	{
+		if (!loaded[i])
+		{
+			std::cerr << folder << ": missing or empty log '" << names[i] << "', skipping" << std::endl;
+			return false;
+		}
+		start = std::max(start, channels[i].time.front());
+		end = std::min(end, channels[i].time.back());
+	}
+	if (!loaded[MODES])
+		std::cerr << folder << ": no '" << LOG_MODES << "' log, taking '" << LOG_MIXED_OUTPUT
+				  << "' as the input wherever it was logged" << std::endl;
+	start += options.input_delay_s;
+
+	flight.folder = folder;
+	flight.start = start;
+	flight.dt = 1.0 / options.rate_hz;
+	flight.automatic = 0;
+	flight.gps_velocity = 0;
+	if (end <= start)
+		return false;
+
+	size_t count = static_cast<size_t>((end - start) / flight.dt);
+	flight.samples.resize(count);
+
+	Interpolator euler_at(channels[EULER], options.max_gap_s);
+	Interpolator rate_at(channels[RATE], options.max_gap_s);
+	Interpolator velocity_at(channels[VELOCITY], options.max_gap_s);
+	Interpolator scaled_at(channels[SCALED], options.max_gap_s);
+	Interpolator mixed_at(channels[MIXED], options.max_gap_s);
+	Holder modes_at(channels[MODES]);
+	Interpolator pulses_at(channels[PULSES], options.max_gap_s);
+	Interpolator novatel_at(channels[NOVATEL], options.max_gap_s);
+
+	std::array<double, MAX_COLUMNS> row;
+	for (size_t k = 0; k < count; ++k)
+	{
+		double t = start + k * flight.dt;
+		Sample& s = flight.samples[k];
+		s.valid = true;
+
+		// the valid flag is interpolated as well, anything short of 1 borders an invalid sample
+		s.valid &= euler_at(t, row) && row[3] > 0.999;
+		std::copy(row.begin(), row.begin() + 3, s.euler.begin());
+		s.valid &= rate_at(t, row) && row[3] > 0.999;
+		std::copy(row.begin(), row.begin() + 3, s.rate.begin());
+
+		bool gps = false;
+		if (velocity_at(t, row) && row[3] > 0.999)
+		{
+			std::copy(row.begin(), row.begin() + 3, s.velocity.begin());
+		}
+		else if (loaded[NOVATEL] && novatel_at(t, row) && row[NOVATEL_V_SOL_STATUS] == 0)
+		{
+			s.velocity = ecef_to_ned(&row[NOVATEL_P_X], &row[NOVATEL_V_X]);
+			gps = true;
+		}
+		else
+		{
+			s.valid = false;
+		}
+
+		// the servos were only commanded where the servo switch was written to
+		const double input_time = t - options.input_delay_s;
+		if (loaded[PULSES])
+			s.valid &= pulses_at(input_time, row);
+
+		bool automatic = false;
+		if (loaded[MODES])
+			automatic = modes_at(input_time, row) && row[0] == AUTOMATIC_CONTROL && row[1] == PILOT_AUTO;
+		else
+			automatic = loaded[MIXED] && mixed_at(input_time, row);
+
+		if (automatic)
+			s.valid &= loaded[MIXED] && mixed_at(input_time, row);
+		else
+			s.valid &= scaled_at(input_time, row);
+		std::copy(row.begin(), row.begin() + INPUT_CHANNELS, s.input.begin());
+		flight.automatic += s.valid && automatic;
+		flight.gps_velocity += s.valid && gps;
+	}
+	return true;
+}
+
+/// a contiguous range of samples in a flight
+struct Segment
+{
+	const Flight* flight;
+	size_t first;
+	size_t last;
+	std::array<Fit, MODELS> fits;
+};
+
+/// rotate an NED vector in to the body frame using the 3-2-1 euler angles
+std::array<double, 3> ned_to_body(const std::array<double, 3>& euler, const std::array<double, 3>& v)
+{
+	double sr = std::sin(euler[0]), cr = std::cos(euler[0]);
+	double sp = std::sin(euler[1]), cp = std::cos(euler[1]);
+	double sy = std::sin(euler[2]), cy = std::cos(euler[2]);
+
+	std::array<double, 3> body;
+	body[0] = cp*cy*v[0] + cp*sy*v[1] - sp*v[2];
+	body[1] = (sr*sp*cy - cr*sy)*v[0] + (sr*sp*sy + cr*cy)*v[1] + sr*cp*v[2];
+	body[2] = (cr*sp*cy + sr*sy)*v[0] + (cr*sp*sy - sr*cy)*v[1] + cr*cp*v[2];
+	return body;
+}
+
+void accumulate(Segment& segment)
+{
+	const std::vector<Sample>& samples = segment.flight->samples;
+	const double half_inv_dt = 0.5 / segment.flight->dt;
+
+	for (size_t k = std::max<size_t>(segment.first, 1); k + 1 < segment.last && k + 1 < samples.size(); ++k)
+	{
+		const Sample& prev = samples[k - 1];
+		const Sample& s = samples[k];
+		const Sample& next = samples[k + 1];
+		if (!(prev.valid && s.valid && next.valid))
+			continue;
+
+		// central differences for the rates of change
+		std::array<double, 3> rate_dot, accel_ned;
+		for (int i = 0; i < 3; ++i)
+		{
+			rate_dot[i] = (next.rate[i] - prev.rate[i]) * half_inv_dt;
+			accel_ned[i] = (next.velocity[i] - prev.velocity[i]) * half_inv_dt;
+		}
+		std::array<double, 3> accel_body = ned_to_body(s.euler, accel_ned);
+		std::array<double, 3> vel_body = ned_to_body(s.euler, s.velocity);
+
+		segment.fits[ROLL].add({{s.rate[0], s.input[AILERON], 1}}, rate_dot[0]);
+		segment.fits[PITCH_AXIS].add({{s.rate[1], s.input[ELEVATOR], 1}}, rate_dot[1]);
+		segment.fits[YAW].add({{s.rate[2], s.input[RUDDER], 1}}, rate_dot[2]);
+		segment.fits[HEAVE].add({{s.velocity[2], s.input[PITCH], 1}}, accel_ned[2]);
+		segment.fits[SURGE].add({{vel_body[0], s.euler[1], 1}}, accel_body[0]);
+		segment.fits[SWAY].add({{vel_body[1], s.euler[0], 1}}, accel_body[1]);
+	}
+}
+
+void usage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [options] LOG_FOLDER [LOG_FOLDER ...]" << std::endl
+			  << std::endl
+			  << "Options:" << std::endl
+			  << "  -c FILE    configuration to take physical parameters from (config.xml)" << std::endl
+			  << "  -o FILE    write the config fragment to FILE instead of stdout" << std::endl
+			  << "  -r FILE    write per segment residuals to FILE" << std::endl
+			  << "  -f HZ      resampling rate (50)" << std::endl
+			  << "  -s SEC     segment length (10)" << std::endl
+			  << "  -d SEC     input to response delay (0)" << std::endl
+			  << "  -g SEC     largest gap in a log to interpolate over (0.2)" << std::endl
+			  << "  -e VAR     minimum input variance for a segment to be used (1e-4)" << std::endl
+			  << "  -F RAD     main rotor flapping per unit cyclic, enables J_X/J_Y estimates" << std::endl
+			  << "  -T N       tail rotor thrust per unit rudder, enables J_Z estimate" << std::endl
+			  << "  -w RAD/S   attitude loop bandwidth for suggested gains (4)" << std::endl
+			  << "  -z ZETA    attitude loop damping for suggested gains (0.7)" << std::endl
+			  << "  -j N       worker threads (number of cores)" << std::endl;
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if (arg.size() == 2 && arg[0] == '-')
+		{
+			if (i + 1 >= argc)
+				return false;
+			const char* value = argv[++i];
+			switch (arg[1])
+			{
+			case 'c': options.config = value; break;
+			case 'o': options.output = value; break;
+			case 'r': options.residuals = value; break;
+			case 'f': options.rate_hz = atof(value); break;
+			case 's': options.segment_s = atof(value); break;
+			case 'd': options.input_delay_s = atof(value); break;
+			case 'g': options.max_gap_s = atof(value); break;
+			case 'e': options.min_excitation = atof(value); break;
+			case 'F': options.flap_gain = atof(value); break;
+			case 'T': options.tail_gain = atof(value); break;
+			case 'w': options.bandwidth = atof(value); break;
+			case 'z': options.damping = atof(value); break;
+			case 'j': options.threads = std::max(1, atoi(value)); break;
+			default: return false;
+			}
+		}
+		else
+		{
+			options.folders.push_back(arg);
+		}
+	}
+	return !options.folders.empty() && options.rate_hz > 0 && options.segment_s > 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parse_options(argc, argv, options))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	boost::property_tree::ptree config;
+	try
+	{
+		boost::property_tree::read_xml(options.config, config);
+	}
+	catch (const boost::property_tree::xml_parser_error& e)
+	{
+		std::cerr << "Could not read " << options.config << ", using default physical parameters" << std::endl;
+	}
+
+	// load every folder, each folder is one LogFile run
+	std::vector<Flight> flights(options.folders.size());
+	std::vector<bool> loaded(flights.size(), false);
+	{
+		std::atomic<size_t> next(0);
+		std::vector<std::thread> workers;
+		for (unsigned int w = 0; w < std::min<size_t>(options.threads, flights.size()); ++w)
+		{
+			workers.push_back(std::thread([&]()
+			{
+				for (size_t i = next++; i < flights.size(); i = next++)
+					loaded[i] = load_flight(options.folders[i], options, flights[i]);
+			}));
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	// split in to segments
+	std::vector<Segment> segments;
+	for (size_t i = 0; i < flights.size(); ++i)
+	{
+		if (!loaded[i])
+			continue;
+		size_t valid = 0;
+		for (const Sample& sample : flights[i].samples)
+			valid += sample.valid;
+		std::cerr << flights[i].folder << ": " << valid << " samples, " << flights[i].automatic
+				  << " under automatic control, " << flights[i].gps_velocity << " with the Novatel velocity" << std::endl;
+
+		size_t length = std::max<size_t>(3, static_cast<size_t>(options.segment_s * options.rate_hz));
+		for (size_t first = 0; first < flights[i].samples.size(); first += length)
+		{
+			Segment segment;
+			segment.flight = &flights[i];
+			segment.first = first;
+			segment.last = std::min(first + length + 1, flights[i].samples.size());
+			segments.push_back(segment);
+		}
+	}
+	if (segments.empty())
+	{
+		std::cerr << "No usable flight data" << std::endl;
+		return 1;
+	}
+
+	// accumulate the segment normal equations in parallel
+	{
+		std::atomic<size_t> next(0);
+		std::vector<std::thread> workers;
+		for (unsigned int w = 0; w < std::min<size_t>(options.threads, segments.size()); ++w)
+		{
+			workers.push_back(std::thread([&]()
+			{
+				for (size_t i = next++; i < segments.size(); i = next++)
+					accumulate(segments[i]);
+			}));
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	// pool the excited segments and solve
+	std::array<Fit, MODELS> pooled;
+	std::array<size_t, MODELS> used;
+	used.fill(0);
+	for (const Segment& segment : segments)
+	{
+		for (int m = 0; m < MODELS; ++m)
+		{
+			if (segment.fits[m].n > 0 && segment.fits[m].variance(EXCITED_REGRESSOR[m]) >= options.min_excitation)
+			{
+				pooled[m] += segment.fits[m];
+				++used[m];
+			}
+		}
+	}
+
+	std::array<std::array<double, 3>, MODELS> theta;
+	std::array<bool, MODELS> solved;
+	for (int m = 0; m < MODELS; ++m)
+	{
+		theta[m].fill(0);
+		solved[m] = pooled[m].solve(theta[m]);
+		std::cerr << std::setw(6) << MODEL_NAMES[m] << ": ";
+		if (!solved[m])
+		{
+			std::cerr << "not identifiable (" << used[m] << " excited segments)" << std::endl;
+			continue;
+		}
+		for (int p = 0; p < 3; ++p)
+			std::cerr << MODEL_PARAMS[m][p] << " = " << std::setw(10) << theta[m][p] << "  ";
+		std::cerr << "rms = " << pooled[m].rms(theta[m]) << " over " << used[m] << " segments" << std::endl;
+	}
+
+	if (!options.residuals.empty())
+	{
+		std::ofstream residuals(options.residuals.c_str());
+		residuals << "folder\tstart_s\tend_s";
+		for (int m = 0; m < MODELS; ++m)
+			residuals << '\t' << MODEL_NAMES[m] << "_rms\t" << MODEL_NAMES[m] << "_n";
+		residuals << std::endl;
+		for (const Segment& segment : segments)
+		{
+			const Flight& flight = *segment.flight;
+			residuals << flight.folder << '\t' << flight.start + segment.first * flight.dt
+					  << '\t' << flight.start + segment.last * flight.dt;
+			for (int m = 0; m < MODELS; ++m)
+				residuals << '\t' << (solved[m] ? segment.fits[m].rms(theta[m]) : 0) << '\t' << segment.fits[m].n;
+			residuals << std::endl;
+		}
+	}
+
+	// physical parameters
+	const double mass = config.get("configuration.physical_params.mass", 13.65);
+	const double main_hub_z = config.get("configuration.physical_params.main_hub_offset.z", -0.32);
+	const double tail_hub_x = config.get("configuration.physical_params.tail_hub_offset.x", -1.06);
+	std::array<double, 3> inertia;
+	inertia[0] = config.get("configuration.physical_params.inertia.x", 0.36);
+	inertia[1] = config.get("configuration.physical_params.inertia.y", 1.48);
+	inertia[2] = config.get("configuration.physical_params.inertia.z", 1.21);
+
+	// moment per unit input is thrust times lever arm, at hover main rotor thrust is m*g
+	if (options.flap_gain > 0)
+	{
+		const double cyclic_moment = mass * GRAVITY * std::fabs(main_hub_z) * options.flap_gain;
+		if (solved[ROLL] && theta[ROLL][1] != 0)
+			inertia[0] = std::fabs(cyclic_moment / theta[ROLL][1]);
+		if (solved[PITCH_AXIS] && theta[PITCH_AXIS][1] != 0)
+			inertia[1] = std::fabs(cyclic_moment / theta[PITCH_AXIS][1]);
+	}
+	if (options.tail_gain > 0 && solved[YAW] && theta[YAW][1] != 0)
+		inertia[2] = std::fabs(std::fabs(tail_hub_x) * options.tail_gain / theta[YAW][1]);
+
+	boost::property_tree::ptree fragment;
+	fragment.put("configuration.physical_params.mass", mass);
+	fragment.put("configuration.physical_params.main_hub_offset.x", config.get("configuration.physical_params.main_hub_offset.x", 0.0));
+	fragment.put("configuration.physical_params.main_hub_offset.y", config.get("configuration.physical_params.main_hub_offset.y", 0.0));
+	fragment.put("configuration.physical_params.main_hub_offset.z", main_hub_z);
+	fragment.put("configuration.physical_params.tail_hub_offset.x", tail_hub_x);
+	fragment.put("configuration.physical_params.tail_hub_offset.y", config.get("configuration.physical_params.tail_hub_offset.y", 0.0));
+	fragment.put("configuration.physical_params.tail_hub_offset.z", config.get("configuration.physical_params.tail_hub_offset.z", 0.0));
+	fragment.put("configuration.physical_params.inertia.x", inertia[0]);
+	fragment.put("configuration.physical_params.inertia.y", inertia[1]);
+	fragment.put("configuration.physical_params.inertia.z", inertia[2]);
+
+	// pole placement for u = -Kp*e - Kd*e_dot on p_dot = Lp*p + Lu*u
+	const char* const axes[2] = {"roll", "pitch"};
+	for (int m = ROLL; m <= PITCH_AXIS; ++m)
+	{
+		if (!solved[m] || std::fabs(theta[m][1]) < 1e-9)
+			continue;
+		const double wn = options.bandwidth;
+		const double kp = wn * wn / theta[m][1];
+		const double kd = (2 * options.damping * wn + theta[m][0]) / theta[m][1];
+		const std::string gain = std::string("configuration.controller_params.attitude_pid.") + axes[m] + ".gain.";
+		fragment.put(gain + "proportional", kp);
+		fragment.put(gain + "derivative", kd);
+		fragment.put(gain + "integral", config.get(gain + "integral", 1.0));
+	}
+
+	for (int m = 0; m < MODELS; ++m)
+	{
+		if (!solved[m])
+			continue;
+		const std::string model = std::string("configuration.system_identification.") + MODEL_NAMES[m] + ".";
+		for (int p = 0; p < 3; ++p)
+			fragment.put(model + MODEL_PARAMS[m][p], theta[m][p]);
+		fragment.put(model + "rms", pooled[m].rms(theta[m]));
+		fragment.put(model + "samples", pooled[m].n);
+	}
+
+	const auto settings = boost::property_tree::xml_writer_make_settings<std::string>('\t', 1);
+	if (options.output.empty())
+		boost::property_tree::write_xml(std::cout, fragment, settings);
+	else
+		boost::property_tree::write_xml(options.output, fragment, std::locale(), settings);
+
+	return 0;
+}